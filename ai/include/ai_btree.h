@@ -29,6 +29,10 @@
 
 #include <citrusleaf/cf_ll.h>
 
+// Called per (skey, digest) entry - skey is a ulong or cf_digest, as for
+// ai_btree_put(). Return false to stop the reduce.
+typedef bool (*ai_btree_reduce_fn)(void *skey, cf_digest *value, void *udata);
+
 void ai_btree_create(as_sindex_metadata *imd);
 
 void ai_btree_destroy(as_sindex_metadata *imd);
@@ -53,6 +57,8 @@ uint64_t ai_btree_get_numkeys(as_sindex_metadata *imd);
 
 void ai_btree_dump(as_sindex_metadata *imd, char *fname, bool verbose);
 
+bool ai_btree_reduce(as_sindex_metadata *imd, as_sindex_pmetadata *pimd, ai_btree_reduce_fn cb, void *udata);
+
 int ai_btree_build_defrag_list(as_sindex_metadata *imd, as_sindex_pmetadata *pimd, struct ai_obj *icol, ulong *nofst, ulong lim, uint64_t * tot_processed, uint64_t * tot_found, cf_ll *apk2d);
 
 bool ai_btree_defrag_list(as_sindex_metadata *imd, as_sindex_pmetadata *pimd, cf_ll *apk2d, ulong n2del, ulong *deleted);
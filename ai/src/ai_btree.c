@@ -631,16 +631,22 @@ get_recl(as_sindex_metadata *imd, ai_obj *afk, as_sindex_qctx *qctx)
  *        -1 in case of failure
  */
 static int
-get_numeric_range_recl(as_sindex_metadata *imd, uint64_t begk, uint64_t endk, as_sindex_qctx *qctx)
+get_range_recl(as_sindex_metadata *imd, ai_obj *begk, ai_obj *efk, as_sindex_qctx *qctx)
 {
 	ai_obj sfk;
-	init_ai_objLong(&sfk, qctx->new_ibtr ? begk : qctx->bkey->l);
-	ai_obj efk;
-	init_ai_objLong(&efk, endk);
+	if (qctx->new_ibtr) {
+		ai_objClone(&sfk, begk);
+	}
+	else if (C_IS_DG(imd->sktype)) {
+		init_ai_objU160(&sfk, qctx->bkey->y);
+	}
+	else {
+		init_ai_objLong(&sfk, qctx->bkey->l);
+	}
 	as_sindex_pmetadata *pimd = &imd->pimd[qctx->pimd_idx];
 	bool fullrng              = qctx->new_ibtr;
 	int ret                   = 0;
-	btSIter *bi               = btGetRangeIter(pimd->ibtr, &sfk, &efk, 1);
+	btSIter *bi               = btGetRangeIter(pimd->ibtr, &sfk, efk, 1);
 	btEntry *be;
 
 	if (bi) {
@@ -713,7 +719,18 @@ ai_btree_query(as_sindex_metadata *imd, as_sindex_range *srange, as_sindex_qctx
 		}
 		err = get_recl(imd, &afk, qctx);
 	} else {                // RANGE LOOKUP
-		err = get_numeric_range_recl(imd, srange->start.u.i64, srange->end.u.i64, qctx);
+		ai_obj sfk, efk;
+		init_ai_obj(&sfk);
+		init_ai_obj(&efk);
+		if (C_IS_DG(imd->sktype)) { // composite index keys
+			init_ai_objFromDigest(&sfk, &srange->start.digest);
+			init_ai_objFromDigest(&efk, &srange->end.digest);
+		}
+		else {
+			init_ai_objLong(&sfk, srange->start.u.i64);
+			init_ai_objLong(&efk, srange->end.u.i64);
+		}
+		err = get_range_recl(imd, &sfk, &efk, qctx);
 	}
 	return (err ? AS_SINDEX_ERR_NO_MEMORY :
 			(qctx->n_bdigs >= qctx->bsize) ? AS_SINDEX_CONTINUE : AS_SINDEX_OK);
@@ -1094,6 +1111,75 @@ ai_btree_dump(as_sindex_metadata *imd, char *fname, bool verbose)
 	fclose(fp);
 }
 
+static bool
+reduce_nbtr(void *skey, bt *nbtr, ai_btree_reduce_fn cb, void *udata)
+{
+	btSIter *nbi = btGetFullRangeIter(nbtr, 1, NULL);
+	if (!nbi) {
+		return false;
+	}
+
+	bool ok = true;
+	btEntry *nbe;
+	while (ok && (nbe = btRangeNext(nbi, 1))) {
+		cf_digest dig;
+		cloneDigestFromai_obj(&dig, nbe->key);
+		ok = cb(skey, &dig, udata);
+	}
+	btReleaseRangeIterator(nbi);
+	return ok;
+}
+
+/*
+ * Walks every entry of the pimd in index order. Caller holds the pimd lock.
+ *
+ * Returns false if the walk was stopped or failed.
+ */
+bool
+ai_btree_reduce(as_sindex_metadata *imd, as_sindex_pmetadata *pimd, ai_btree_reduce_fn cb, void *udata)
+{
+	if (!pimd->ibtr || !pimd->ibtr->numkeys) {
+		return true;
+	}
+
+	ai_obj iL;
+	ai_obj iH;
+	assignMinKey(pimd->ibtr, &iL);
+	assignMaxKey(pimd->ibtr, &iH);
+	btSIter *bi = btGetRangeIter(pimd->ibtr, &iL, &iH, 1);
+	if (!bi) {
+		return false;
+	}
+
+	bool ok = true;
+	btEntry *be;
+	while (ok && (be = btRangeNext(bi, 1))) {
+		ai_obj *acol = be->key;
+		ai_nbtr *anbtr = be->val;
+		if (!anbtr) {
+			continue;
+		}
+
+		cf_digest dkey;
+		void *skey = &acol->l;
+		if (C_IS_DG(imd->sktype)) {
+			cloneDigestFromai_obj(&dkey, acol);
+			skey = &dkey;
+		}
+
+		if (anbtr->is_btree) {
+			ok = reduce_nbtr(skey, anbtr->u.nbtr, cb, udata);
+		} else {
+			ai_arr *arr = anbtr->u.arr;
+			for (int i = 0; ok && i < arr->used; i++) {
+				ok = cb(skey, (cf_digest *)&arr->data[i * CF_DIGEST_KEY_SZ], udata);
+			}
+		}
+	}
+	btReleaseRangeIterator(bi);
+	return ok;
+}
+
 uint64_t
 ai_btree_get_numkeys(as_sindex_metadata *imd)
 {
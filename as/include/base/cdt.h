@@ -299,8 +299,12 @@ uint8_t *rollback_alloc_reserve(rollback_alloc *alloc_buf, size_t sz);
 void rollback_alloc_rollback(rollback_alloc *alloc_buf);
 bool rollback_alloc_from_msgpack(rollback_alloc *alloc_buf, as_bin *b, const cdt_payload *seg);
 
+// msgpack scanning
+bool cdt_msgpack_skip(const uint8_t *buf, uint32_t buf_sz, uint32_t *offset_r, uint32_t n);
+
 // msgpacked_index
 void msgpacked_index_set(msgpacked_index *idxs, uint32_t index, uint32_t value);
+void msgpacked_index_set_n(msgpacked_index *idxs, uint32_t index, const uint32_t *values, uint32_t count);
 void msgpacked_index_incr(msgpacked_index *idxs, uint32_t index);
 void msgpacked_index_set_ptr(msgpacked_index *idxs, uint8_t *ptr);
 void *msgpacked_index_get_mem(const msgpacked_index *idxs, uint32_t index);
@@ -318,6 +322,7 @@ void offset_index_set_filled(offset_index *offidx, uint32_t ele_filled);
 void offset_index_set_ptr(offset_index *offidx, uint8_t *idx_mem, const uint8_t *packed_mem);
 void offset_index_copy(offset_index *dest, const offset_index *src, uint32_t d_start, uint32_t s_start, uint32_t count, int delta);
 void offset_index_append_size(offset_index *offidx, uint32_t delta);
+bool offset_index_fill_scan(offset_index *offidx, uint32_t start, uint32_t end, uint32_t n_per_ele, uint32_t *offset_r);
 
 bool offset_index_find_items(offset_index *full_offidx, cdt_find_items_idxs_type find_type, as_unpacker *items_pk, order_index *items_ordidx_r, bool inverted, uint64_t *rm_mask, uint32_t *rm_count_r, order_index *rm_ranks_r);
 
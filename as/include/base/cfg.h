@@ -103,6 +103,9 @@ typedef struct as_config_s {
 	uint32_t		batch_max_unused_buffers; // maximum number of buffers allowed in buffer pool at any one time
 	uint32_t		batch_priority; // number of records between an enforced context switch, used by old batch only
 	uint32_t		n_batch_index_threads;
+	uint64_t		client_quota_read_tps; // per client address - 0 means no limit
+	uint64_t		client_quota_write_bps; // request bytes, per client address - 0 means no limit
+	uint64_t		client_quota_write_tps; // per client address - 0 means no limit
 	int				clock_skew_max_ms; // maximum allowed skew between this node's physical clock and the physical component of its hybrid clock
 	char			cluster_name[AS_CLUSTER_NAME_SZ];
 	as_clustering_config clustering_config;
@@ -148,6 +151,8 @@ typedef struct as_config_s {
 	uint32_t		sindex_builder_threads; // secondary index builder thread pool size
 	uint32_t		sindex_gc_max_rate; // Max sindex entries processed per second for gc
 	uint32_t		sindex_gc_period; // same as nsup_period for sindex gc
+	PAD_BOOL		stale_map_hints; // flag proxied client responses so the client refreshes its partition map
+	PAD_BOOL		stale_map_redirect; // answer misrouted client requests with the owning node instead of proxying
 	uint32_t		ticker_interval;
 	uint64_t		transaction_max_ns;
 	uint32_t		transaction_pending_limit; // 0 means no limit
@@ -173,6 +178,8 @@ typedef struct as_config_s {
 	// Normally hidden:
 
 	cf_serv_spec	tls_service; // TLS client service
+	char*			service_unix_path; // AF_UNIX listener for co-located clients
+	uint32_t		service_unix_mode; // permission bits for service_unix_path
 
 	//--------------------------------------------
 	// network::heartbeat context.
@@ -217,6 +224,7 @@ typedef struct as_config_s {
 	//
 
 	mod_lua_config	mod_lua;
+	bool			udf_native_enabled; // allow native UDF modules - trusted code, no isolation
 	as_sec_config	sec_cfg;
 
 	uint32_t		n_tls_specs;
@@ -0,0 +1,93 @@
+/*
+ * change_stream.h
+ *
+ * Copyright (C) 2018 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+
+#pragma once
+
+//==========================================================
+// Includes.
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "citrusleaf/cf_atomic.h"
+#include "citrusleaf/cf_digest.h"
+
+#include "dynbuf.h"
+
+
+//==========================================================
+// Forward declarations.
+//
+
+struct as_namespace_s;
+
+
+//==========================================================
+// Typedefs & constants.
+//
+
+#define AS_CHANGE_STREAM_MIN_SIZE 1024
+#define AS_CHANGE_STREAM_MAX_SIZE (1 << 26)
+
+typedef enum {
+	AS_CHANGE_OP_WRITE,
+	AS_CHANGE_OP_DELETE,
+	AS_CHANGE_OP_DURABLE_DELETE
+} as_change_op;
+
+typedef struct as_change_s {
+	cf_digest	keyd;
+	uint64_t	last_update_time;
+	uint16_t	set_id;
+	uint16_t	generation;
+	uint8_t		op; // as_change_op
+} as_change;
+
+typedef struct as_change_slot_s {
+	cf_atomic64	seq; // 1 + sequence number of change held, marked busy while being written
+	as_change	change;
+} as_change_slot;
+
+// In-memory ring of recent master writes and deletes. Changes are numbered in
+// order of append - a consumer resumes by asking for changes from the number
+// after the last one it got.
+typedef struct as_change_stream_s {
+	as_change_slot*	slots; // NULL if change-stream-size is 0
+	uint32_t		mask;
+	uint64_t		epoch; // changes on restart - numbering starts over
+	cf_atomic64		next_seq;
+	cf_atomic64		read_seq; // furthest position handed back to a consumer
+	cf_atomic64		lost_seq; // changes before this are counted in n_lost
+	cf_atomic64		n_lost; // changes overwritten before a consumer got them
+} as_change_stream;
+
+
+//==========================================================
+// Public API.
+//
+
+void as_change_stream_init(struct as_namespace_s* ns);
+void as_change_stream_append(struct as_namespace_s* ns, const cf_digest* keyd, uint16_t set_id, uint16_t generation, uint64_t last_update_time, as_change_op op);
+bool as_change_stream_read(struct as_namespace_s* ns, const uint64_t* p_from, uint32_t max, cf_dyn_buf* db);
+uint64_t as_change_stream_lag(struct as_namespace_s* ns);
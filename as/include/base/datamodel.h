@@ -49,7 +49,9 @@
 #include "vmapx.h"
 
 #include "base/cfg.h"
+#include "base/change_stream.h"
 #include "base/proto.h"
+#include "base/quota.h"
 #include "base/rec_props.h"
 #include "base/transaction_policy.h"
 #include "base/truncate.h"
@@ -60,6 +62,7 @@
 
 #define AS_STORAGE_MAX_DEVICES (64) // maximum devices per namespace
 #define AS_STORAGE_MAX_FILES (64) // maximum files per namespace
+#define AS_STORAGE_MAX_DEVICE_GROUPS (8) // group 0 is the default, unnamed group
 #define AS_STORAGE_MAX_DEVICE_SIZE (2L * 1024L * 1024L * 1024L * 1024L) // 2Tb, due to rblock_id in as_index
 
 #define OBJ_SIZE_HIST_NUM_BUCKETS 100
@@ -129,6 +132,8 @@ as_gen_less_than(uint16_t lhs, uint16_t rhs)
  *    STRING: a null-terminated UTF-8 string
  *    BLOB: arbitrary-length binary data
  *    TIMESTAMP: milliseconds since 1 January 1970, 00:00:00 GMT
+ *    HLL: a HyperLogLog cardinality estimator
+ *    TIMESERIES: compressed (timestamp, value) samples
  *    DIGEST: an internal Aerospike key digest */
 typedef enum {
 	AS_PARTICLE_TYPE_NULL = 0,
@@ -144,8 +149,10 @@ typedef enum {
 	AS_PARTICLE_TYPE_RUBY_BLOB = 10,
 	AS_PARTICLE_TYPE_PHP_BLOB = 11,
 	AS_PARTICLE_TYPE_ERLANG_BLOB = 12,
+	AS_PARTICLE_TYPE_HLL = 18,
 	AS_PARTICLE_TYPE_MAP = 19,
 	AS_PARTICLE_TYPE_LIST = 20,
+	AS_PARTICLE_TYPE_TIMESERIES = 21,
 	AS_PARTICLE_TYPE_GEOJSON = 23,
 	AS_PARTICLE_TYPE_MAX = 24,
 	AS_PARTICLE_TYPE_BAD = AS_PARTICLE_TYPE_MAX
@@ -214,6 +221,16 @@ extern int as_bin_cdt_read_from_client(const as_bin *b, as_msg_op *op, as_bin *r
 extern int as_bin_cdt_alloc_modify_from_client(as_bin *b, as_msg_op *op, as_bin *result);
 extern int as_bin_cdt_stack_modify_from_client(as_bin *b, cf_ll_buf *particles_llb, as_msg_op *op, as_bin *result);
 
+// Same for HLLs - see particle_hll.c.
+extern int as_bin_hll_read_from_client(const as_bin *b, as_msg_op *op, as_bin *result);
+extern int as_bin_hll_alloc_modify_from_client(as_bin *b, as_msg_op *op, as_bin *result);
+extern int as_bin_hll_stack_modify_from_client(as_bin *b, cf_ll_buf *particles_llb, as_msg_op *op, as_bin *result);
+
+// Same for time series - see particle_timeseries.c.
+extern int as_bin_timeseries_read_from_client(const as_bin *b, as_msg_op *op, as_bin *result);
+extern int as_bin_timeseries_alloc_modify_from_client(as_bin *b, as_msg_op *op, as_bin *result);
+extern int as_bin_timeseries_stack_modify_from_client(as_bin *b, cf_ll_buf *particles_llb, as_msg_op *op, as_bin *result);
+
 // as_val:
 extern int as_bin_particle_replace_from_asval(as_bin *b, const as_val *val);
 extern void as_bin_particle_stack_from_asval(as_bin *b, uint8_t* stack, const as_val *val);
@@ -227,6 +244,14 @@ extern int as_bin_particle_cast_from_flat(as_bin *b, uint8_t *flat, uint32_t fla
 extern int as_bin_particle_replace_from_flat(as_bin *b, const uint8_t *flat, uint32_t flat_size);
 extern uint32_t as_bin_particle_flat_size(as_bin *b);
 extern uint32_t as_bin_particle_to_flat(const as_bin *b, uint8_t *flat);
+extern bool as_bin_particle_equal(as_bin *b1, as_bin *b2);
+
+// client message reference (copy-free replace writes):
+extern bool as_bin_particle_ref_from_client(as_bin *b, const as_msg_op *op);
+extern uint32_t as_particle_client_ref_flat_size(const as_msg_op *op);
+extern uint32_t as_particle_client_ref_to_flat(const as_msg_op *op, uint8_t *flat);
+extern uint32_t as_particle_client_ref_pickled_size(const as_msg_op *op);
+extern uint32_t as_particle_client_ref_to_pickled(const as_msg_op *op, uint8_t *pickled);
 
 // odd as_bin particle functions for specific particle types
 
@@ -234,6 +259,9 @@ extern uint32_t as_bin_particle_to_flat(const as_bin *b, uint8_t *flat);
 extern int64_t as_bin_particle_integer_value(const as_bin *b);
 extern void as_bin_particle_integer_set(as_bin *b, int64_t i);
 
+// float:
+extern double as_bin_particle_float_value(const as_bin *b);
+
 // string:
 extern uint32_t as_bin_particle_string_ptr(const as_bin *b, char **p_value);
 
@@ -244,6 +272,7 @@ typedef void * geo_region_t;
 extern size_t as_bin_particle_geojson_cellids(const as_bin *b, uint64_t **pp_cells);
 extern bool as_particle_geojson_match(as_particle *p, uint64_t cellid, geo_region_t region, bool is_strict);
 extern bool as_particle_geojson_match_asval(const as_val *val, uint64_t cellid, geo_region_t region, bool is_strict);
+extern bool as_particle_geojson_point(const as_particle *p, uint64_t *cellid);
 char const *as_geojson_mem_jsonstr(const as_particle *p, size_t *p_jsonsz);
 
 // list:
@@ -549,16 +578,20 @@ typedef struct as_index_tree_shared_s {
 	as_index_value_destructor destructor;
 	void*			destructor_udata;
 
-	// Number of lock pairs and sprigs per partition tree.
+	// Number of lock pairs and sprigs per partition tree. Sprigs may be
+	// changed online - new trees use it, existing trees are re-split by nsup.
 	uint32_t		n_lock_pairs;
 	uint32_t		n_sprigs;
 
-	// Bit-shifts used to calculate indexes from digest bits.
+	// Bit-shift used to calculate lock pair index from digest bits.
 	uint32_t		locks_shift;
-	uint32_t		sprigs_shift;
 
 	// Offset into as_index_tree struct's variable-sized data.
 	uint32_t		sprigs_offset;
+
+	// Lock pair contention stats.
+	cf_atomic64		n_lock_waits;
+	cf_atomic64		lock_wait_us;
 } as_index_tree_shared;
 
 
@@ -644,6 +677,16 @@ struct as_namespace_s {
 	cf_atomic32		n_reads_from_cache;
 	cf_atomic32		n_reads_from_device;
 
+	// Reads served by another reader's device read - see coalesce-reads.
+	cf_atomic64		n_reads_coalesced;
+
+	// Bulk load progress - see bulk-load info command.
+	cf_atomic32		bulk_loading;
+	uint64_t		bulk_load_total_bytes;
+	cf_atomic64		bulk_load_read_bytes;
+	cf_atomic64		n_bulk_load_records;
+	cf_atomic64		n_bulk_load_skipped;
+
 	uint8_t			storage_encryption_key[32];
 
 	//--------------------------------------------
@@ -652,12 +695,19 @@ struct as_namespace_s {
 
 	as_truncate		truncate;
 
+	//--------------------------------------------
+	// Change stream.
+	//
+
+	as_change_stream change_stream;
+
 	//--------------------------------------------
 	// Secondary index.
 	//
 
 	int				sindex_cnt;
 	uint32_t		n_setless_sindexes;
+	uint32_t		n_composite_sindexes;
 	struct as_sindex_s* sindex; // array with AS_MAX_SINDEX metadata
 	cf_shash*		sindex_set_binid_hash;
 	cf_shash*		sindex_iname_hash;
@@ -678,7 +728,10 @@ struct as_namespace_s {
 	PAD_BOOL		ns_allow_nonxdr_writes; // namespace-level flag to allow nonxdr writes or not
 	PAD_BOOL		ns_allow_xdr_writes; // namespace-level flag to allow xdr writes or not
 
+	uint32_t		change_stream_size; // 0 means no change stream
+	PAD_BOOL		cold_start_early_rejoin; // serve partitions as index snapshot loads them
 	uint32_t		cold_start_evict_ttl;
+	PAD_BOOL		compact_index; // 52-byte as_index elements - data-not-in-memory only
 	conflict_resolution_pol conflict_resolution_policy;
 	PAD_BOOL		data_in_index; // with single-bin, allows warm restart for data-in-memory (with storage-engine device)
 	PAD_BOOL		write_dup_res_disabled;
@@ -698,9 +751,11 @@ struct as_namespace_s {
 	uint32_t		migrate_retransmit_ms;
 	uint32_t		migrate_sleep;
 	cf_atomic32		obj_size_hist_max; // TODO - doesn't need to be atomic, really.
+	PAD_BOOL		partition_tree_sprigs_auto; // nsup re-sizes sprigs based on depth
 	uint32_t		rack_id;
 	as_read_consistency_level read_consistency_level;
 	PAD_BOOL		single_bin; // restrict the namespace to objects with exactly one bin
+	PAD_BOOL		skip_unchanged_writes; // complete writes that change nothing without storing or replicating
 	uint32_t		stop_writes_pct;
 	uint32_t		tomb_raider_eligible_age; // relevant only for enterprise edition
 	uint32_t		tomb_raider_period; // relevant only for enterprise edition
@@ -712,11 +767,14 @@ struct as_namespace_s {
 	char*			storage_devices[AS_STORAGE_MAX_DEVICES];
 	char*			storage_shadows[AS_STORAGE_MAX_DEVICES];
 	char*			storage_files[AS_STORAGE_MAX_FILES];
+	char*			storage_device_group_names[AS_STORAGE_MAX_DEVICE_GROUPS];
+	uint8_t			storage_device_groups[AS_STORAGE_MAX_DEVICES]; // group id per device (or file), in config order
 	uint64_t		storage_filesize;
 	char*			storage_scheduler_mode; // relevant for devices only, not files
 	uint32_t		storage_write_block_size;
 	PAD_BOOL		storage_data_in_memory;
 
+	PAD_BOOL		storage_coalesce_reads; // concurrent reads of a record share one device read
 	PAD_BOOL		storage_cold_start_empty;
 	uint32_t		storage_defrag_lwm_pct;
 	uint32_t		storage_defrag_queue_min;
@@ -728,13 +786,16 @@ struct as_namespace_s {
 	char*			storage_encryption_key_file;
 	uint64_t		storage_flush_max_us;
 	uint64_t		storage_fsync_max_us;
+	char*			storage_index_snapshot_file;
 	uint64_t		storage_max_write_cache;
 	uint32_t		storage_min_avail_pct;
+	as_storage_placement storage_placement_policy;
 	cf_atomic32 	storage_post_write_queue; // number of swbs/device held after writing to device
 	uint32_t		storage_tomb_raider_sleep; // relevant only for enterprise edition
 	uint32_t		storage_write_threads;
 
 	uint32_t		sindex_num_partitions;
+	char*			sindex_snapshot_file;
 
 	PAD_BOOL		geo2dsphere_within_strict;
 	uint16_t		geo2dsphere_within_min_level;
@@ -767,11 +828,28 @@ struct as_namespace_s {
 	uint32_t		nsup_cycle_duration; // seconds taken for most recent nsup cycle
 	uint32_t		nsup_cycle_sleep_pct; // fraction of most recent nsup cycle that was spent sleeping
 
+	// Index tree stats, refreshed by nsup.
+
+	uint32_t		index_sprig_avg_depth; // estimated from sprig sizes
+	uint32_t		index_sprig_max_depth; // estimated from largest lock pair's sprigs
+
 	// Memory usage stats.
 
 	cf_atomic_int	n_bytes_memory;
 	cf_atomic64		n_bytes_sindex_memory;
 
+	// Primary index startup stats.
+
+	PAD_BOOL		index_snapshot_loaded;
+	uint64_t		index_snapshot_load_ms;
+	cf_atomic32		cold_start_partitions_loaded;
+
+	// Secondary index startup stats.
+
+	PAD_BOOL		sindex_snapshot_loaded;
+	uint64_t		sindex_snapshot_load_ms;
+	uint64_t		sindex_rebuild_ms;
+
 	// Persistent storage stats.
 
 	float			cache_read_pct;
@@ -804,6 +882,7 @@ struct as_namespace_s {
 	cf_atomic64		n_client_proxy_complete;
 	cf_atomic64		n_client_proxy_error;
 	cf_atomic64		n_client_proxy_timeout;
+	cf_atomic64		n_client_proxy_redirect;
 
 	cf_atomic64		n_client_read_success;
 	cf_atomic64		n_client_read_error;
@@ -814,6 +893,9 @@ struct as_namespace_s {
 	cf_atomic64		n_client_write_error;
 	cf_atomic64		n_client_write_timeout;
 
+	// Subset of n_client_write_success - writes that changed nothing.
+	cf_atomic64		n_client_write_unchanged;
+
 	// Subset of n_client_write_... above, respectively.
 	cf_atomic64		n_xdr_write_success;
 	cf_atomic64		n_xdr_write_error;
@@ -930,6 +1012,8 @@ struct as_namespace_s {
 	cf_atomic64		geo_region_query_cells;		// number of cells used by region queries
 	cf_atomic64		geo_region_query_points;	// number of valid points found
 	cf_atomic64		geo_region_query_falsepos;	// number of false positives found
+	cf_atomic64		geo_near_query_count;		// number of nearest-neighbor queries
+	cf_atomic64		geo_near_query_rings;		// number of rings searched by them
 
 	// Special errors that deserve their own counters:
 
@@ -1046,7 +1130,9 @@ struct as_set_s {
 	cf_atomic32		disable_eviction;	// don't evict anything in this set (note - expiration still works)
 	cf_atomic32		enable_xdr;			// white-list (AS_SET_ENABLE_XDR_TRUE) or black-list (AS_SET_ENABLE_XDR_FALSE) a set for XDR replication
 	uint32_t		n_sindexes;
-	uint8_t padding[12];
+	cf_atomic32		device_group;		// storage device group id - 0 means default group
+	as_quotas		quotas;				// admission rate limits, and their stats
+	uint8_t padding[8];
 };
 
 static inline bool
@@ -31,6 +31,7 @@
 
 #include "arenax.h"
 #include "cf_mutex.h"
+#include "fault.h"
 
 #include "base/datamodel.h"
 
@@ -45,33 +46,40 @@
 typedef struct as_index_s {
 
 	// offset: 0
-	cf_atomic32 rc;
+	uint16_t rc; // use as_index_reserve() & as_index_release()
 
-	// offset: 4
-	cf_digest keyd;
-
-	// offset: 24
-	uint64_t right_h: 40;
-	uint64_t left_h: 40;
-
-	// offset: 34
+	// offset: 2
 	// Don't use the free bits here for record info - this is accessed outside
 	// the record lock.
-	uint16_t color: 1;
-	uint16_t unused_but_unsafe: 15;
+	uint8_t color: 1;
+	uint8_t unused_but_unsafe: 7;
 
 	// Everything below here is used under the record lock.
 
-	// offset: 36
+	// offset: 3
+	uint8_t repl_state: 2;
+	uint8_t unused_flag: 1;
+	uint8_t key_stored: 1;
+	uint8_t unused: 4;
+
+	// offset: 4
+	cf_digest keyd;
+
+	// offset: 24
+	// Arena handles are 8-bit stage-id plus 24-bit element-id.
+	uint64_t right_h: 32;
+	uint64_t left_h: 32;
+
+	// offset: 32
 	uint32_t tombstone: 1;
 	uint32_t cenotaph: 1;
 	uint32_t void_time: 30;
 
-	// offset: 40
+	// offset: 36
 	uint64_t last_update_time: 40;
 	uint64_t generation: 16;
 
-	// offset: 47
+	// offset: 43
 	// Used by the storage engines.
 	uint64_t rblock_id: 34;		// can address 2^34 * 128b = 2Tb drive
 	uint64_t n_rblocks: 14;		// is enough for 1Mb/128b = 8K rblocks
@@ -79,20 +87,21 @@ typedef struct as_index_s {
 
 	uint64_t set_id_bits: 10;	// do not use directly, used for set-ID
 
+	// offset: 51
+	// Compact index elements end here.
+	uint8_t unused_pad[4];
+
 	// offset: 55
 	// In single-bin mode for data-in-memory namespaces, this offset is cast to
-	// an as_bin, but only 4 bits get used (for the iparticle state). The other
-	// 4 bits are used for replication state and index flags.
-	uint8_t repl_state: 2;
-	uint8_t unused_flag: 1;
-	uint8_t key_stored: 1;
+	// an as_bin, but only 4 bits get used (for the iparticle state).
+	uint8_t unused_bits: 4;
 	uint8_t single_bin_state: 4; // used indirectly, only in single-bin mode
 
 	// offset: 56
-	// For data-not-in-memory namespaces, these 8 bytes are currently unused.
+	// For data-not-in-memory namespaces, these 8 bytes are unused.
 	// For data-in-memory namespaces: in single-bin mode the as_bin is embedded
-	// here (these 8 bytes plus 4 bits in flex_bits above), but in multi-bin
-	// mode this is a pointer to either of:
+	// here (these 8 bytes plus 4 bits in single_bin_state above), but in
+	// multi-bin mode this is a pointer to either of:
 	// - an as_bin_space containing n_bins and an array of as_bin structs
 	// - an as_rec_space containing an as_bin_space pointer and other metadata
 	void* dim;
@@ -103,31 +112,48 @@ typedef struct as_index_s {
 
 #define AS_INDEX_SINGLE_BIN_OFFSET 55 // can't use offsetof() with bit fields
 
+// Compact index elements (data-not-in-memory only) leave off everything from
+// offset 52 - kept a multiple of 4 so 'rc' stays aligned in the arena.
+#define AS_INDEX_COMPACT_SIZE 52
+
 
 //==========================================================
 // Accessor functions for bits in as_index.
 //
 
-// Size in bytes of as_index, currently the same for all namespaces.
+// Size in bytes of as_index arena elements for this namespace.
 static inline
 uint32_t as_index_size_get(as_namespace *ns)
 {
-	return (uint32_t)sizeof(as_index);
+	return ns->compact_index ?
+			AS_INDEX_COMPACT_SIZE : (uint32_t)sizeof(as_index);
 }
 
 // Fast way to clear the record portion of as_index.
-// Note - relies on current layout and size of as_index!
+// Note - relies on current layout and size of as_index! Doesn't touch anything
+// beyond the compact size - data-in-memory callers must clear 'dim' and
+// single-bin state themselves.
 static inline
 void as_index_clear_record_info(as_index *index) {
-	*(uint32_t*)((uint8_t*)index + 36) = 0;
+	*((uint8_t*)index + 3) = 0;
 
-	uint64_t *p_clear = (uint64_t*)((uint8_t*)index + 40);
+	uint32_t *p_clear32 = (uint32_t*)((uint8_t*)index + 32);
+
+	*p_clear32 = 0;
+
+	uint64_t *p_clear = (uint64_t*)((uint8_t*)index + 36);
 
-	*p_clear++	= 0;
 	*p_clear++	= 0;
 	*p_clear	= 0;
 }
 
+// Clear the part of as_index beyond the compact size - data-in-memory only.
+static inline
+void as_index_clear_dim(as_index *index) {
+	index->single_bin_state = 0;
+	index->dim = NULL;
+}
+
 // Generation 0 is never written, and generation plays no role in record
 // destruction, so it works to flag both "half created" and deleted records.
 static inline
@@ -251,6 +277,17 @@ typedef struct as_index_tree_s {
 	// later use multiple arenas per namespace.
 	cf_arenax				*arena;
 
+	// Number of reduces in progress - sprigs aren't re-split during reduces.
+	cf_atomic32				n_reduces;
+
+	// Sprigs in the whole tree, set once every pair has been re-split - lets
+	// re-split skip the tree without taking pair locks.
+	uint32_t				n_sprigs;
+
+	// Re-split target that reduces blocked, 0 if none - the last reduce to
+	// finish does the re-split.
+	uint32_t				resplit_n_sprigs;
+
 	// Variable length data, dependent on configuration.
 	uint8_t					data[];
 } as_index_tree;
@@ -260,16 +297,26 @@ typedef struct as_index_tree_s {
 // as_index_tree variable length data components.
 //
 
+typedef struct as_sprig_s {
+	cf_arenax_handle	root_h;
+	uint64_t			n_elements;
+} as_sprig;
+
 typedef struct as_lock_pair_s {
 	// Note: reduce_lock's scope is always inside of lock's scope.
 	cf_mutex lock;        // insert, delete vs. insert, delete, get
 	cf_mutex reduce_lock; // insert, delete vs. reduce
-} as_lock_pair;
 
-typedef struct as_sprig_s {
-	cf_arenax_handle	root_h;
-	uint64_t			n_elements;
-} as_sprig;
+	// The sprigs covered by this lock pair. These may be re-split online, so
+	// only access them under lock or reduce_lock.
+	as_sprig *sprigs;      // initially points into tree's data
+	uint32_t n_sprigs;
+	uint32_t sprigs_shift;
+	bool sprigs_alloced;   // sprigs was re-split and must be freed
+
+	// Sum of the sprigs' n_elements - readable without locks.
+	uint64_t n_elements;
+} as_lock_pair;
 
 static inline as_lock_pair *
 tree_locks(as_index_tree *tree)
@@ -296,11 +343,14 @@ as_index_tree *as_index_tree_resume(as_index_tree_shared *shared, cf_arenax *are
 void as_index_tree_shutdown(as_index_tree *tree, as_treex *treex);
 int as_index_tree_release(as_index_tree *tree);
 uint64_t as_index_tree_size(as_index_tree *tree);
+bool as_index_tree_resplit(as_index_tree *tree, uint32_t n_sprigs);
+void as_index_tree_sprig_stats(as_index_tree *tree, uint32_t *avg_depth, uint32_t *max_depth);
 
 typedef void (*as_index_reduce_fn) (as_index_ref *value, void *udata);
 
 void as_index_reduce(as_index_tree *tree, as_index_reduce_fn cb, void *udata);
 void as_index_reduce_partial(as_index_tree *tree, uint64_t sample_count, as_index_reduce_fn cb, void *udata);
+void as_index_reduce_skip_lock(as_index_tree *tree, as_index_reduce_fn cb, void *udata);
 
 void as_index_reduce_live(as_index_tree *tree, as_index_reduce_fn cb, void *udata);
 void as_index_reduce_partial_live(as_index_tree *tree, uint64_t sample_count, as_index_reduce_fn cb, void *udata);
@@ -310,8 +360,41 @@ int as_index_get_vlock(as_index_tree *tree, cf_digest *keyd, as_index_ref *index
 int as_index_get_insert_vlock(as_index_tree *tree, cf_digest *keyd, as_index_ref *index_ref);
 int as_index_delete(as_index_tree *tree, cf_digest *keyd);
 
-#define as_index_reserve(_r) cf_atomic32_incr(&(_r->rc))
-#define as_index_release(_r) cf_atomic32_decr(&(_r->rc))
+// Ref-count is only 16 bits, so it saturates instead of wrapping - a saturated
+// element is pinned (leaked) rather than freed while still referenced.
+#define AS_INDEX_RC_SATURATED UINT16_MAX
+
+static inline int
+as_index_reserve(as_index *r)
+{
+	uint16_t rc = __atomic_load_n(&r->rc, __ATOMIC_RELAXED);
+
+	do {
+		if (rc == AS_INDEX_RC_SATURATED) {
+			return rc;
+		}
+	} while (! __atomic_compare_exchange_n(&r->rc, &rc, rc + 1, true,
+			__ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+	return rc + 1;
+}
+
+static inline int
+as_index_release(as_index *r)
+{
+	uint16_t rc = __atomic_load_n(&r->rc, __ATOMIC_RELAXED);
+
+	do {
+		if (rc == AS_INDEX_RC_SATURATED) {
+			return rc;
+		}
+
+		cf_assert(rc != 0, AS_INDEX, "index ref-count over-release");
+	} while (! __atomic_compare_exchange_n(&r->rc, &rc, rc - 1, true,
+			__ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+	return rc - 1;
+}
 
 
 //------------------------------------------------
@@ -325,8 +408,13 @@ typedef struct as_index_sprig_s {
 
 	cf_arenax		*arena;
 
+	as_index_tree_shared *shared;
+
 	as_lock_pair	*pair;
-	as_sprig		*sprig;
+	as_sprig		*sprig; // resolved only under pair's lock
+
+	// The 12 most significant non-pid digest bits, to resolve sprig.
+	uint32_t		bits;
 } as_index_sprig;
 
 #define SENTINEL_H 0
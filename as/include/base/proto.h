@@ -36,6 +36,7 @@
 #include "citrusleaf/cf_vector.h"
 
 #include "dynbuf.h"
+#include "node.h"
 #include "socket.h"
 
 
@@ -75,6 +76,8 @@ struct as_transaction_s;
 #define AS_PROTO_RESULT_FAIL_ELEMENT_NOT_FOUND		23
 #define AS_PROTO_RESULT_FAIL_ELEMENT_EXISTS			24
 #define AS_PROTO_RESULT_FAIL_ENTERPRISE_ONLY		25	// attempting enterprise functionality on community build
+#define AS_PROTO_RESULT_FAIL_PARTITION_MOVED		26	// partition is owned elsewhere - see partition hint field
+#define AS_PROTO_RESULT_FAIL_QUOTA_EXCEEDED			27	// client or set is over its configured rate quota
 
 // Security result codes. Must be <= 255, to fit in one byte. Defined here to
 // ensure no overlap with other result codes.
@@ -205,6 +208,13 @@ typedef struct as_msg_field_s {
 #define AS_MSG_FIELD_TYPE_BATCH					41
 #define AS_MSG_FIELD_TYPE_BATCH_WITH_SET		42
 #define AS_MSG_FIELD_TYPE_PREDEXP				43
+#define AS_MSG_FIELD_TYPE_QUERY_ORDER_BY		44
+#define AS_MSG_FIELD_TYPE_QUERY_LIMIT			45
+#define AS_MSG_FIELD_TYPE_QUERY_COUNT			46
+#define AS_MSG_FIELD_TYPE_QUERY_GEO_NEAR		47
+
+// Response only.
+#define AS_MSG_FIELD_TYPE_PARTITION_HINT		48
 
 	/* NB: field_sz is sizeof(type) + sizeof(data) */
 	uint32_t field_sz; // get the data size through the accessor function, don't worry, it's a small macro
@@ -233,6 +243,23 @@ typedef struct as_msg_field_s {
 #define AS_MSG_FIELD_BIT_BATCH				0x00010000
 #define AS_MSG_FIELD_BIT_BATCH_WITH_SET		0x00020000
 #define AS_MSG_FIELD_BIT_PREDEXP			0x00040000
+#define AS_MSG_FIELD_BIT_QUERY_ORDER_BY		0x00080000
+#define AS_MSG_FIELD_BIT_QUERY_LIMIT		0x00100000
+#define AS_MSG_FIELD_BIT_QUERY_COUNT		0x00200000
+#define AS_MSG_FIELD_BIT_QUERY_GEO_NEAR		0x00400000
+
+// AS_MSG_FIELD_TYPE_QUERY_COUNT value is one byte of flags.
+#define AS_MSG_QUERY_COUNT_VERIFY			0x01 // check records in primary index
+
+// AS_MSG_FIELD_TYPE_QUERY_GEO_NEAR value is the max distance in meters as a
+// big-endian uint64 - 0 means unbounded. The query limit is k.
+
+// AS_MSG_FIELD_TYPE_PARTITION_HINT value is the node owning the partition then
+// the cluster key the ownership is valid for, both big-endian uint64.
+typedef struct as_msg_partition_hint_s {
+	uint64_t node;
+	uint64_t cluster_key;
+} __attribute__((__packed__)) as_msg_partition_hint;
 
 // as_msg ops
 
@@ -251,6 +278,14 @@ typedef struct as_msg_field_s {
 #define AS_MSG_OP_PREPEND 10		// prepend a value to an existing value, works on strings and blobs
 #define AS_MSG_OP_TOUCH 11			// touch a value without doing anything else to it - will increment the generation
 
+// HLL top-level ops - see particle_hll.c:
+#define AS_MSG_OP_HLL_READ 15
+#define AS_MSG_OP_HLL_MODIFY 16
+
+// Time series top-level ops - see particle_timeseries.c:
+#define AS_MSG_OP_TIMESERIES_READ 17
+#define AS_MSG_OP_TIMESERIES_MODIFY 18
+
 #define AS_MSG_OP_MC_INCR 129		// Memcache-compatible version of the increment command
 #define AS_MSG_OP_MC_APPEND 130		// append the value to an existing value, works only strings for now
 #define AS_MSG_OP_MC_PREPEND 131	// prepend a value to an existing value, works only strings for now
@@ -330,6 +365,13 @@ typedef struct cl_msg_s {
 	as_msg		msg;
 } __attribute__((__packed__)) cl_msg;
 
+/* as_msg_read_ops
+ * Read ops copied from a scan or query request, evaluated per record */
+typedef struct as_msg_read_ops_s {
+	uint16_t	n_ops;
+	as_msg_op	*ops[];		// followed by the copied ops
+} as_msg_read_ops;
+
 #define AS_MSG_INFO1_READ				(1 << 0) // contains a read operation
 #define AS_MSG_INFO1_GET_ALL			(1 << 1) // get all bins, period
 // (Note:  Bit 2 is unused.)
@@ -345,7 +387,7 @@ typedef struct cl_msg_s {
 #define AS_MSG_INFO2_GENERATION_GT		(1 << 3) // apply write if new generation > old, good for restore
 #define AS_MSG_INFO2_DURABLE_DELETE		(1 << 4) // op resulting in record deletion leaves tombstone (Enterprise only)
 #define AS_MSG_INFO2_CREATE_ONLY		(1 << 5) // write record only if it doesn't exist
-// (Note:  Bit 6 is unused.)
+#define AS_MSG_INFO2_SKIP_UNCHANGED		(1 << 6) // don't store or replicate a write that changes nothing
 #define AS_MSG_INFO2_RESPOND_ALL_OPS	(1 << 7) // all bin ops (read, write, or modify) require a response, in request order
 
 #define AS_MSG_INFO3_LAST				(1 << 0) // this is the last of a multi-part message
@@ -354,7 +396,7 @@ typedef struct cl_msg_s {
 #define AS_MSG_INFO3_UPDATE_ONLY		(1 << 3) // update existing record only, do not create new record
 #define AS_MSG_INFO3_CREATE_OR_REPLACE	(1 << 4) // completely replace existing record, or create new record
 #define AS_MSG_INFO3_REPLACE_ONLY		(1 << 5) // completely replace existing record, do not create new record
-// (Note:  Bit 6 is unused.)
+#define AS_MSG_INFO3_PARTITION_MOVED	(1 << 6) // response only - partition is owned elsewhere, refresh partition map
 // (Note:  Bit 7 is unused.)
 
 #define AS_MSG_FIELD_SCAN_UNUSED_2					(0x02) // was - whether to send ldt bin data back to the client
@@ -484,9 +526,17 @@ cl_msg *as_msg_make_response_msg(uint32_t result_code, uint32_t generation,
 		uint32_t void_time, as_msg_op **ops, struct as_bin_s **bins,
 		uint16_t bin_count, struct as_namespace_s *ns, cl_msg *msgp_in,
 		size_t *msg_sz_in, uint64_t trid);
+cl_msg *as_msg_make_transient_response_msg(uint32_t result_code,
+		uint32_t generation, uint32_t void_time, as_msg_op **ops,
+		struct as_bin_s **bins, uint16_t bin_count, struct as_namespace_s *ns,
+		cl_msg *msgp_in, size_t *msg_sz_in, uint64_t trid);
 int32_t as_msg_make_response_bufbuilder(cf_buf_builder **bb_r,
 		struct as_storage_rd_s *rd, bool no_bin_data, bool include_key,
 		bool skip_empty_records, cf_vector *select_bins);
+as_msg_read_ops *as_msg_read_ops_create(as_msg *m, int *result);
+void as_msg_read_ops_destroy(as_msg_read_ops *read_ops);
+int32_t as_msg_make_read_ops_response_bufbuilder(cf_buf_builder **bb_r,
+		struct as_storage_rd_s *rd, const as_msg_read_ops *read_ops);
 cl_msg *as_msg_make_val_response(bool success, const as_val *val,
 		uint32_t result_code, uint32_t generation, uint32_t void_time,
 		uint64_t trid, size_t *p_msg_sz);
@@ -498,6 +548,8 @@ int as_msg_send_reply(struct as_file_handle_s *fd_h, uint32_t result_code,
 		struct as_bin_s **bins, uint16_t bin_count, struct as_namespace_s *ns,
 		uint64_t trid);
 int as_msg_send_ops_reply(struct as_file_handle_s *fd_h, cf_dyn_buf *db);
+int as_msg_send_partition_redirect(struct as_file_handle_s *fd_h,
+		cf_node node, uint64_t cluster_key, uint64_t trid);
 bool as_msg_send_fin(cf_socket *sock, uint32_t result_code);
 size_t as_msg_send_fin_timeout(cf_socket *sock, uint32_t result_code,
 		int32_t timeout);
@@ -0,0 +1,78 @@
+/*
+ * quota.h
+ *
+ * Copyright (C) 2018 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#pragma once
+
+//==========================================================
+// Includes.
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "citrusleaf/cf_atomic.h"
+
+#include "cf_mutex.h"
+
+
+//==========================================================
+// Forward declarations.
+//
+
+struct as_namespace_s;
+struct as_transaction_s;
+
+
+//==========================================================
+// Typedefs & constants.
+//
+
+typedef enum {
+	AS_QUOTA_READ_TPS,
+	AS_QUOTA_WRITE_TPS,
+	AS_QUOTA_WRITE_BPS, // request bytes
+
+	AS_N_QUOTAS
+} as_quota_type;
+
+typedef struct as_quota_bucket_s {
+	uint64_t	tokens; // in millionths of a unit
+	uint64_t	last_us;
+} as_quota_bucket;
+
+// Token buckets for one set. (Client buckets take limits from g_config.)
+typedef struct as_quotas_s {
+	cf_atomic64		limits[AS_N_QUOTAS]; // per second - 0 means no limit
+	cf_mutex		lock;
+	as_quota_bucket	buckets[AS_N_QUOTAS];
+	cf_atomic64		n_consumed[AS_N_QUOTAS];
+	cf_atomic64		n_rejected[AS_N_QUOTAS];
+} as_quotas;
+
+
+//==========================================================
+// Public API.
+//
+
+void as_quota_init();
+bool as_quota_admit(struct as_transaction_s* tr, struct as_namespace_s* ns, bool is_write);
+void as_quota_reap_clients();
@@ -60,6 +60,7 @@
 #define SINDEX_MODULE              "sindex"
 #define AS_SINDEX_MAX_PATH_LENGTH  256
 #define AS_SINDEX_MAX_DEPTH        10
+#define AS_SINDEX_MAX_COMPOSITE_BINS 4
 #define AS_SINDEX_TYPE_STR_SIZE    20 // LIST / MAPKEYS / MAPVALUES / DEFAULT(NONE)
 #define AS_SINDEXDATA_STR_SIZE     AS_SINDEX_MAX_PATH_LENGTH + 1 + 8 // binpath + separator (,) + keytype (string/numeric)
 #define AS_INDEX_KEYS_ARRAY_QUEUE_HIGHWATER  512
@@ -252,8 +253,17 @@ typedef struct as_sindex_metadata_s {
 	int                   path_length;
 	char                * path_str;
 	int                   nprts;   // Aerospike Index Number of Index partitions	
+
+	// Composite index - ordered tuple of bins, n_cbins == 0 for single bin.
+	// bname/binid mirror the first bin, sktype is COL_TYPE_DIGEST.
+	uint32_t              n_cbins;
+	char                * cbnames[AS_SINDEX_MAX_COMPOSITE_BINS];
+	uint32_t              cbinids[AS_SINDEX_MAX_COMPOSITE_BINS];
+	as_sindex_ktype       cbtypes[AS_SINDEX_MAX_COMPOSITE_BINS];
 } as_sindex_metadata;
 
+#define as_sindex_is_composite(imd) ((imd)->n_cbins != 0)
+
 /*
  * This structure right now hangs from the namespace structure for the
  * Aerospike Index B-tree.
@@ -333,6 +343,15 @@ typedef struct as_sindex_bin_data_s {
 	cf_digest         digest;
 } as_sindex_bin_data;
 
+// Old and new composite index keys of one record, across a write.
+typedef struct as_sindex_composite_keys_s {
+	as_sindex       * si;
+	bool              old_valid;
+	bool              new_valid;
+	cf_digest         old_key;
+	cf_digest         new_key;
+} as_sindex_composite_keys;
+
 // Caution: Using this will waste 12 bytes per long type skey 
 typedef struct as_sindex_key_s {
 	union {
@@ -443,6 +462,11 @@ extern  int as_sindex_init(as_namespace *ns);
  * Do not use any "sindex" functions after calling this function, so free your indexes beforehand.
  */
 extern int  as_sindex_reinit(char *name, char *params, cf_dyn_buf *db);
+
+/*
+ * Write configured snapshots at clean shutdown, after storage is flushed.
+ */
+extern void as_sindex_shutdown();
 // **************************************************************************************************
 
 /*
@@ -490,6 +514,25 @@ void as_sindex_putall_rd(as_namespace *ns, as_storage_rd *rd);
 // **************************************************************************************************
 
 
+/*
+ * COMPOSITE INDEXES
+ * Composite keys span several bins, so they are not maintained via sbins.
+ * Writers look up the set's composite indexes, compute keys from the bins
+ * before and after the write, and apply the difference.
+ */
+// **************************************************************************************************
+extern int  as_sindex_composite_lookup_lockfree(as_namespace *ns, const char *set,
+			as_sindex_composite_keys ckeys[]);
+extern void as_sindex_composite_keys_from_bins(as_sindex_composite_keys ckeys[], int n_ckeys,
+			const as_bin *bins, uint32_t n_bins, bool is_new);
+extern bool as_sindex_composite_update(as_sindex_composite_keys ckeys[], int n_ckeys,
+			cf_digest *keyd);
+extern void as_sindex_composite_release(as_sindex_composite_keys ckeys[], int n_ckeys);
+extern bool as_sindex_composite_key_from_bins(as_sindex_metadata *imd, const as_bin *bins,
+			uint32_t n_bins, cf_digest *key);
+// **************************************************************************************************
+
+
 /* 
  * UTILS
  */
@@ -504,6 +547,7 @@ extern as_sindex_status     as_sindex__delete_from_set_binid_hash(as_namespace *
 extern as_val             * as_sindex_extract_val_from_path(as_sindex_metadata * imd, as_val * v);
 extern as_sindex_gc_status  as_sindex_can_defrag_record(as_namespace *ns, cf_digest *keyd);
 extern as_sindex_status     as_sindex_extract_bin_path(as_sindex_metadata * imd, char * path_str);
+extern as_sindex_status     as_sindex_extract_composite_bins(as_sindex_metadata * imd, const char * path_str);
 int                         as_sindex_create_check_params(as_namespace* ns, as_sindex_metadata* imd);
 bool                        as_sindex_delete_checker(as_namespace *ns, as_sindex_metadata *imd);
 as_particle_type            as_sindex_pktype(as_sindex_metadata * imd);
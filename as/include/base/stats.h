@@ -32,6 +32,7 @@
 
 #include "hist.h"
 
+#include "base/quota.h"
 #include "fabric/fabric.h"
 
 
@@ -44,12 +45,18 @@ typedef struct as_stats_s {
 	// Connection stats.
 	cf_atomic64		proto_connections_opened; // not just a statistic
 	cf_atomic64		proto_connections_closed; // not just a statistic
+	cf_atomic64		unix_connections_opened; // subset of proto connections
+	cf_atomic64		unix_connections_closed;
 	// In ticker but not collected via info:
 	cf_atomic64		heartbeat_connections_opened;
 	cf_atomic64		heartbeat_connections_closed;
 	cf_atomic64		fabric_connections_opened;
 	cf_atomic64		fabric_connections_closed;
 
+	// Client quota stats - summed over all client addresses.
+	cf_atomic64		client_quota_consumed[AS_N_QUOTAS];
+	cf_atomic64		client_quota_rejected[AS_N_QUOTAS];
+
 	// Heartbeat stats.
 	cf_atomic64		heartbeat_received_self;
 	cf_atomic64		heartbeat_received_foreign;
@@ -100,6 +107,8 @@ typedef struct as_stats_s {
 	uint64_t		fabric_meta_r_rate;
 	uint64_t		fabric_rw_s_rate;
 	uint64_t		fabric_rw_r_rate;
+	uint64_t		fabric_rw_q_depth[AS_FABRIC_N_SEND_CLASSES];
+	uint64_t		fabric_rw_q_wait_avg_us[AS_FABRIC_N_SEND_CLASSES]; // over last ticker interval
 
 	//--------------------------------------------
 	// Histograms.
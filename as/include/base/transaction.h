@@ -109,6 +109,7 @@ typedef struct as_file_handle_s {
 
 #define FH_INFO_DONOT_REAP	0x00000001	// this bit indicates that this file handle should not be reaped
 #define FH_INFO_XDR			0x00000002	// the file handle belongs to an XDR connection
+#define FH_INFO_UNIX		0x00000004	// the file handle belongs to an AF_UNIX connection
 
 // Helpers to release transaction file handles.
 void as_release_file_handle(as_file_handle *proto_fd_h);
@@ -209,6 +210,8 @@ typedef struct as_transaction_s {
 // 'flags' bits - set in transaction body after queuing:
 #define AS_TRANSACTION_FLAG_SINDEX_TOUCHED	0x01
 #define AS_TRANSACTION_FLAG_IS_DELETE		0x02
+#define AS_TRANSACTION_FLAG_UNCHANGED		0x04
+#define AS_TRANSACTION_FLAG_READ_FLIGHT	0x08
 
 
 void as_transaction_init_head(as_transaction *tr, cf_digest *, cl_msg *);
@@ -311,6 +314,30 @@ as_transaction_has_predexp(const as_transaction *tr)
 	return (tr->msg_fields & AS_MSG_FIELD_BIT_PREDEXP) != 0;
 }
 
+static inline bool
+as_transaction_has_query_order_by(const as_transaction *tr)
+{
+	return (tr->msg_fields & AS_MSG_FIELD_BIT_QUERY_ORDER_BY) != 0;
+}
+
+static inline bool
+as_transaction_has_query_limit(const as_transaction *tr)
+{
+	return (tr->msg_fields & AS_MSG_FIELD_BIT_QUERY_LIMIT) != 0;
+}
+
+static inline bool
+as_transaction_has_query_count(const as_transaction *tr)
+{
+	return (tr->msg_fields & AS_MSG_FIELD_BIT_QUERY_COUNT) != 0;
+}
+
+static inline bool
+as_transaction_has_query_geo_near(const as_transaction *tr)
+{
+	return (tr->msg_fields & AS_MSG_FIELD_BIT_QUERY_GEO_NEAR) != 0;
+}
+
 // For now it's not worth storing the trid in the as_transaction struct since we
 // only parse it from the msg once per transaction anyway.
 static inline uint64_t
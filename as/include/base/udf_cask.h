@@ -32,6 +32,7 @@
 
 // UDF Types
 #define AS_UDF_TYPE_LUA 0
+#define AS_UDF_TYPE_NATIVE 1
 #define MAX_UDF_CONTENT_LENGTH (1024 * 1024) //(1MB)
 
 extern char *as_udf_type_name[];
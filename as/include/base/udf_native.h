@@ -0,0 +1,77 @@
+/*
+ * udf_native.h
+ *
+ * Copyright (C) 2018 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+#pragma once
+
+//==========================================================
+// Includes.
+//
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aerospike/as_list.h"
+#include "aerospike/as_rec.h"
+#include "aerospike/as_result.h"
+#include "aerospike/as_stream.h"
+#include "aerospike/as_udf_context.h"
+
+#include "base/udf_native_abi.h"
+
+
+//==========================================================
+// Typedefs & constants.
+//
+
+// Native modules are trusted code - they run in the server process with its
+// privileges, no isolation, and no time or memory limits. They're off unless
+// mod-lua native-udf-enabled is set, and are uploaded only via udf-put-native,
+// which requires service-ctrl permission.
+
+#define UDF_NATIVE_MAX_MODULES 64
+#define UDF_NATIVE_MAX_FUNCTIONS 1024
+#define UDF_NATIVE_MAX_CONTENT_LENGTH (16 * 1024 * 1024) // 16M
+
+// Returned by apply if the module doesn't export the function.
+#define UDF_NATIVE_ERR_FUNCTION_NOT_FOUND 2
+
+
+//==========================================================
+// Public API.
+//
+
+bool udf_native_validate(const char* filename, const uint8_t* content,
+		size_t size, char* err, size_t err_sz);
+bool udf_native_load(const char* filename, const uint8_t* content, size_t size);
+void udf_native_unload(const char* filename);
+void udf_native_unload_same_name(const char* filename);
+
+// Return false if no native module is registered under this module name (i.e.
+// filename less extension) - the caller should then apply the (Lua) UDF as
+// before.
+bool udf_native_apply_record(as_udf_context* ctx, const char* filename,
+		const char* function, as_rec* rec, as_list* args, as_result* res,
+		int* rv);
+bool udf_native_apply_stream(as_udf_context* ctx, const char* filename,
+		const char* function, as_stream* istream, as_list* args,
+		as_stream* ostream, as_result* res, int* rv);
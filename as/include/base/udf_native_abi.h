@@ -0,0 +1,99 @@
+/*
+ * udf_native_abi.h
+ *
+ * Copyright (C) 2018 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+//==========================================================
+// The C ABI between the server and native UDF modules. Modules are shared
+// objects built against this header and aerospike-common only - they must
+// not depend on server internals.
+//
+// A module exports one as_udf_native_module named AS_UDF_NATIVE_MODULE_SYMBOL.
+// Record functions are applied exactly where a Lua record UDF would be, and
+// write through the as_rec and as_aerospike interfaces (e.g. as_rec_set() then
+// as_aerospike_rec_update()). Bin reads should use the api accessors, which
+// read the record's bins in place rather than converting them to as_vals.
+//
+// Native functions run in transaction threads and can't be preempted - long
+// running functions should poll as_timer_timedout(ctx->timer).
+//
+
+#pragma once
+
+//==========================================================
+// Includes.
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "aerospike/as_list.h"
+#include "aerospike/as_rec.h"
+#include "aerospike/as_result.h"
+#include "aerospike/as_stream.h"
+#include "aerospike/as_udf_context.h"
+
+
+//==========================================================
+// Typedefs & constants.
+//
+
+// Bumped on any incompatible change to the structs below.
+#define AS_UDF_NATIVE_ABI_VERSION 1
+
+#define AS_UDF_NATIVE_MODULE_SYMBOL "as_udf_native_module"
+
+// Accessors the server passes to module functions. Each returns false if the
+// bin doesn't exist or isn't of the accessor's type. Reads reflect writes made
+// earlier in the same call. Values are only valid until the function returns.
+typedef struct as_udf_native_api_s {
+	uint32_t abi_version;
+
+	bool (*bin_get_int)(as_rec* rec, const char* name, int64_t* value);
+	bool (*bin_get_float)(as_rec* rec, const char* name, double* value);
+	bool (*bin_get_str)(as_rec* rec, const char* name, const char** value,
+			uint32_t* size);
+} as_udf_native_api;
+
+// Return 0 on success - anything else is reported as a UDF execution error.
+typedef int (*as_udf_native_record_fn)(const as_udf_native_api* api,
+		as_udf_context* ctx, as_rec* rec, as_list* args, as_result* res);
+
+typedef int (*as_udf_native_stream_fn)(const as_udf_native_api* api,
+		as_udf_context* ctx, as_stream* istream, as_list* args,
+		as_stream* ostream, as_result* res);
+
+typedef struct as_udf_native_function_s {
+	const char* name;
+	as_udf_native_record_fn record_fn; // NULL if not usable as record UDF
+	as_udf_native_stream_fn stream_fn; // NULL if not usable in aggregations
+} as_udf_native_function;
+
+typedef struct as_udf_native_module_s {
+	uint32_t abi_version; // must be AS_UDF_NATIVE_ABI_VERSION
+
+	// Optional - called once after loading, and before unloading when no
+	// function is running. A non-zero return from init rejects the module.
+	int (*init)(const as_udf_native_api* api);
+	void (*destroy)(void);
+
+	uint32_t n_functions;
+	const as_udf_native_function* functions;
+} as_udf_native_module;
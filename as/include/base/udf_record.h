@@ -91,6 +91,7 @@ extern const as_rec_hooks udf_record_hooks;
 // Utility functions for all the wrapper as_record implementation
 // which use udf_record under the hood
 extern void     udf_record_cache_free   (udf_record *);
+extern as_val * udf_record_cache_get    (udf_record *, const char *);
 extern int      udf_record_open         (udf_record *);
 extern int      udf_storage_record_open (udf_record *);
 extern void     udf_record_close        (udf_record *);
@@ -65,9 +65,22 @@ typedef enum {
 #define MAX_FABRIC_CHANNEL_THREADS 128
 #define MAX_FABRIC_CHANNEL_SOCKETS 128
 
+// Send queue classes - only the rw channel splits its send queue by class.
+typedef enum {
+	AS_FABRIC_SEND_CLASS_SMALL = 0,	// acks, dup-res & proxy replies, etc.
+	AS_FABRIC_SEND_CLASS_LARGE = 1,	// e.g. big replica writes
+
+	AS_FABRIC_N_SEND_CLASSES
+} as_fabric_send_class;
+
 typedef struct fabric_rate_s {
 	uint64_t s_bytes[AS_FABRIC_N_CHANNELS];
 	uint64_t r_bytes[AS_FABRIC_N_CHANNELS];
+
+	// rw channel send queue, per class.
+	uint64_t rw_q_depth[AS_FABRIC_N_SEND_CLASSES]; // summed over nodes
+	uint64_t rw_q_msgs[AS_FABRIC_N_SEND_CLASSES]; // dequeued since last capture
+	uint64_t rw_q_wait_us[AS_FABRIC_N_SEND_CLASSES]; // total wait of the above
 } fabric_rate;
 
 typedef int (*as_fabric_msg_fn) (cf_node node_id, msg *m, void *udata);
@@ -86,6 +86,8 @@ typedef struct as_partition_s {
 	cf_atomic64 n_tombstones; // relevant only for enterprise edition
 	cf_atomic64 max_void_time; // TODO - convert to 32-bit ...
 
+	bool loading; // cold start has not yet loaded this partition's index
+
 	// Replica information.
 	uint32_t n_replicas;
 	cf_node replicas[AS_CLUSTER_SZ];
@@ -150,6 +152,8 @@ void as_partition_init(struct as_namespace_s* ns, uint32_t pid);
 void as_partition_shutdown(struct as_namespace_s* ns, uint32_t pid);
 
 void as_partition_freeze(as_partition* p);
+void as_partition_loaded(struct as_namespace_s* ns, uint32_t pid);
+void as_partition_wait_loaded(as_partition* p);
 
 uint32_t as_partition_get_other_replicas(as_partition* p, cf_node* nv);
 
@@ -54,6 +54,20 @@ extern bool geo_point_centers(as_namespace * ns,
 
 extern bool geo_point_within(uint64_t cellidval, geo_region_t region);
 
+extern bool geo_cap_cover(as_namespace * ns,
+						  uint64_t cellidval,
+						  double radius_meters,
+						  int maxnumcells,
+						  uint64_t * cellminp,
+						  uint64_t * cellmaxp,
+						  int * numcellsp);
+
+extern double geo_point_distance(as_namespace * ns,
+								 uint64_t cellidval1,
+								 uint64_t cellidval2);
+
+extern double geo_max_distance(as_namespace * ns);
+
 extern void geo_region_destroy(geo_region_t region);
 
 #ifdef __cplusplus
@@ -197,6 +197,7 @@ typedef struct drv_ssd_s
 
 	uint64_t		file_size;
 	int				file_id;
+	uint32_t		device_group;		// storage device group this device belongs to
 
 	uint32_t		open_flag;
 	bool			data_in_memory;
@@ -205,6 +206,7 @@ typedef struct drv_ssd_s
 	uint64_t		io_min_size;		// device IO operations are aligned and sized in multiples of this
 
 	cf_atomic64		inuse_size;			// number of bytes in actual use on this device
+	cf_atomic64		write_latency_us;	// smoothed swb flush latency, for placement
 
 	uint32_t		write_block_size;	// number of bytes to write at a time
 
@@ -230,6 +232,51 @@ typedef struct drv_ssd_s
 } drv_ssd;
 
 
+//------------------------------------------------
+// Devices belonging to a storage device group.
+//
+typedef struct ssd_device_group_s
+{
+	int				n_ssds;
+	uint8_t			file_ids[AS_STORAGE_MAX_DEVICES];
+} ssd_device_group;
+
+
+//------------------------------------------------
+// Readers of a record that overlap, sharing the
+// buffer of the first one's device read. A flight
+// is only created when a second reader joins.
+//
+typedef struct ssd_read_flight_s
+{
+	struct ssd_read_flight_s *next;
+	cf_digest		keyd;
+	uint32_t		n_readers;			// joined and not yet left
+
+	// Valid only if buf is set - the record version buf holds.
+	uint32_t		file_id;
+	uint64_t		rblock_id;
+	uint32_t		n_rblocks;
+	uint16_t		generation;
+	uint64_t		last_update_time;
+
+	uint8_t			*buf;				// freed when the last reader leaves
+	struct drv_ssd_block_s *block;		// points into buf
+} ssd_read_flight;
+
+#define SSD_READ_FLIGHT_N_STRIPES 1024 // must be power of 2
+
+// Lock-free count of readers per digest slot - a lone reader never touches a
+// stripe lock or allocates a flight.
+#define SSD_READ_ACTIVE_N_SLOTS (64 * 1024) // must be power of 2
+
+typedef struct ssd_read_flight_stripe_s
+{
+	cf_mutex		lock;
+	ssd_read_flight	*head;
+} ssd_read_flight_stripe;
+
+
 //------------------------------------------------
 // Per-namespace storage information.
 //
@@ -242,6 +289,20 @@ typedef struct drv_ssds_s
 	// load a record.
 	bool get_state_from_storage[AS_PARTITIONS];
 
+	// Used only at startup - index is loaded from snapshot, not device sweep.
+	bool loading_index_snapshot;
+
+	// Header random of the previous run, 0 if any device started fresh.
+	uint64_t prev_random;
+
+	// Only populated if sets are assigned to named device groups.
+	bool				has_device_groups;
+	ssd_device_group	groups[AS_STORAGE_MAX_DEVICE_GROUPS];
+
+	// Only allocated if coalesce-reads is configured.
+	ssd_read_flight_stripe	*read_flights;
+	uint32_t				*read_active;
+
 	int					n_ssds;
 	drv_ssd				ssds[];
 } drv_ssds;
@@ -35,8 +35,10 @@
 // Forward declarations.
 struct as_bin_s;
 struct as_index_s;
+struct as_msg_op_s;
 struct as_partition_s;
 struct as_namespace_s;
+struct as_set_s;
 struct drv_ssd_s;
 struct drv_ssd_block_s;
 
@@ -48,6 +50,12 @@ typedef enum {
 	AS_NUM_STORAGE_ENGINES
 } as_storage_type;
 
+// Where device-backed namespaces put new record versions.
+typedef enum {
+	AS_STORAGE_PLACEMENT_DIGEST	= 0, // device is a function of the digest
+	AS_STORAGE_PLACEMENT_LOAD	= 1  // pick by free space, write queue & latency
+} as_storage_placement;
+
 typedef struct as_storage_rd_s {
 	struct as_index_s		*r;
 	struct as_namespace_s	*ns;
@@ -65,6 +73,12 @@ typedef struct as_storage_rd_s {
 	uint8_t					*key;
 
 	bool					is_durable_delete; // enterprise only
+	bool					is_joined_read; // caller did as_storage_read_join()
+	bool					in_read_flight; // ... and it returned true
+
+	// Copy-free replace writes - non-NULL entries are values of the parallel
+	// bins, still in the client message. (See as_bin_particle_ref_from_client().)
+	struct as_msg_op_s		**client_ops;
 
 	// Specific to storage type AS_STORAGE_ENGINE_SSD:
 	struct drv_ssd_block_s	*block;
@@ -89,6 +103,12 @@ extern int as_storage_record_create(struct as_namespace_s *ns, struct as_index_s
 extern int as_storage_record_open(struct as_namespace_s *ns, struct as_index_s *r, as_storage_rd *rd);
 extern int as_storage_record_close(as_storage_rd *rd);
 
+// Single-flight reads - readers join before taking the record lock, and leave
+// after closing the as_storage_rd, so queued readers can share a device read.
+// Join returns true if the reader is in a flight - pass that to leave.
+extern bool as_storage_read_join(struct as_namespace_s *ns, const cf_digest *keyd);
+extern void as_storage_read_leave(struct as_namespace_s *ns, const cf_digest *keyd, bool in_flight);
+
 // Called within as_storage_rd usage cycle.
 extern int as_storage_record_load_n_bins(as_storage_rd *rd);
 extern int as_storage_record_load_bins(as_storage_rd *rd);
@@ -100,12 +120,17 @@ extern void as_storage_wait_for_defrag();
 extern bool as_storage_overloaded(struct as_namespace_s *ns); // returns true if write queue is too backed up
 extern bool as_storage_has_space(struct as_namespace_s *ns);
 extern void as_storage_defrag_sweep(struct as_namespace_s *ns);
+extern int as_storage_add_device(struct as_namespace_s *ns, const char *name);
+extern int as_storage_bulk_load(struct as_namespace_s *ns, const char *path);
+extern int as_storage_set_device_group(struct as_namespace_s *ns, struct as_set_s *p_set, const char *group_name);
 
 // Storage of generic data into device headers.
 extern void as_storage_info_set(struct as_namespace_s *ns, const struct as_partition_s *p, bool flush);
 extern void as_storage_info_get(struct as_namespace_s *ns, struct as_partition_s *p);
 extern int as_storage_info_flush(struct as_namespace_s *ns);
 extern void as_storage_save_evict_void_time(struct as_namespace_s *ns, uint32_t evict_void_time);
+extern uint64_t as_storage_header_random(struct as_namespace_s *ns); // new each run
+extern uint64_t as_storage_prev_header_random(struct as_namespace_s *ns); // 0 if devices were wiped or replaced
 
 // Statistics.
 extern int as_storage_stats(struct as_namespace_s *ns, int *available_pct, uint64_t *inuse_disk_bytes); // available percent is that of worst device
@@ -157,6 +182,9 @@ extern int as_storage_record_create_ssd(as_storage_rd *rd);
 extern int as_storage_record_open_ssd(as_storage_rd *rd);
 extern int as_storage_record_close_ssd(as_storage_rd *rd);
 
+extern bool as_storage_read_join_ssd(struct as_namespace_s *ns, const cf_digest *keyd);
+extern void as_storage_read_leave_ssd(struct as_namespace_s *ns, const cf_digest *keyd, bool in_flight);
+
 extern int as_storage_record_load_n_bins_ssd(as_storage_rd *rd);
 extern int as_storage_record_load_bins_ssd(as_storage_rd *rd);
 extern bool as_storage_record_size_and_check_ssd(as_storage_rd *rd);
@@ -166,11 +194,16 @@ extern void as_storage_wait_for_defrag_ssd(struct as_namespace_s *ns);
 extern bool as_storage_overloaded_ssd(struct as_namespace_s *ns);
 extern bool as_storage_has_space_ssd(struct as_namespace_s *ns);
 extern void as_storage_defrag_sweep_ssd(struct as_namespace_s *ns);
+extern int as_storage_add_device_ssd(struct as_namespace_s *ns, const char *name);
+extern int as_storage_bulk_load_ssd(struct as_namespace_s *ns, const char *path);
+extern int as_storage_set_device_group_ssd(struct as_namespace_s *ns, struct as_set_s *p_set, const char *group_name);
 
 extern void as_storage_info_set_ssd(struct as_namespace_s *ns, const struct as_partition_s *p, bool flush);
 extern void as_storage_info_get_ssd(struct as_namespace_s *ns, struct as_partition_s *p);
 extern int as_storage_info_flush_ssd(struct as_namespace_s *ns);
 extern void as_storage_save_evict_void_time_ssd(struct as_namespace_s *ns, uint32_t evict_void_time);
+extern uint64_t as_storage_header_random_ssd(struct as_namespace_s *ns);
+extern uint64_t as_storage_prev_header_random_ssd(struct as_namespace_s *ns);
 
 extern int as_storage_stats_ssd(struct as_namespace_s *ns, int *available_pct, uint64_t *used_disk_bytes);
 extern int as_storage_ticker_stats_ssd(struct as_namespace_s *ns);
@@ -51,6 +51,7 @@ void as_proxy_init();
 uint32_t as_proxy_hash_count();
 
 void as_proxy_divert(cf_node dst, struct as_transaction_s* tr, struct as_namespace_s* ns);
+void as_proxy_redirect(cf_node dst, struct as_transaction_s* tr, struct as_namespace_s* ns);
 void as_proxy_return_to_sender(const struct as_transaction_s* tr, struct as_namespace_s* ns);
 
 void as_proxy_send_response(cf_node dst, uint32_t proxy_tid,
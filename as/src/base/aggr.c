@@ -39,6 +39,7 @@
 #include "base/transaction.h"
 #include "base/udf_arglist.h"
 #include "base/udf_memtracker.h"
+#include "base/udf_native.h"
 #include "base/udf_record.h"
 #include "fabric/partition.h"
 
@@ -330,7 +331,11 @@ as_aggr_process(as_namespace *ns, as_aggr_call * ag_call, cf_ll * ap_recl, void
 		.timer      = NULL,
 		.memtracker = NULL
 	};
-	int ret = as_module_apply_stream(&mod_lua, &ctx, ag_call->def.filename, ag_call->def.function, &istream, ag_call->def.arglist, &ostream, ap_res);
+	int ret;
+
+	if (! udf_native_apply_stream(&ctx, ag_call->def.filename, ag_call->def.function, &istream, ag_call->def.arglist, &ostream, ap_res, &ret)) {
+		ret = as_module_apply_stream(&mod_lua, &ctx, ag_call->def.filename, ag_call->def.function, &istream, ag_call->def.arglist, &ostream, ap_res);
+	}
 
 	acleanup(&astate);
 	return ret;
@@ -47,6 +47,7 @@
 #include "base/index.h"
 #include "base/json_init.h"
 #include "base/monitor.h"
+#include "base/quota.h"
 #include "base/scan.h"
 #include "base/secondary_index.h"
 #include "base/security.h"
@@ -359,7 +360,9 @@ main(int argc, char **argv)
 
 	// Initialize the storage system. For cold starts, this includes reading
 	// all the objects off the drives. This may block for a long time. The
-	// defrag subsystem starts operating at the end of this call.
+	// defrag subsystem starts operating at the end of this call - unless a
+	// namespace with cold-start-early-rejoin is still loading its index from
+	// snapshot, in which case it starts when loading completes.
 	as_storage_init();
 
 	// Migrate memory to correct NUMA node (includes restored index arenas).
@@ -380,6 +383,7 @@ main(int argc, char **argv)
 	as_info_init();				// info transaction handling
 	as_migrate_init();			// move data between nodes
 	as_proxy_init();			// do work on behalf of others
+	as_quota_init();			// per-client & per-set rate quotas
 	as_rw_init();				// read & write service
 	as_query_init();			// query transaction handling
 	as_udf_init();				// user-defined functions
@@ -437,6 +441,7 @@ main(int argc, char **argv)
 	//
 
 	as_storage_shutdown();
+	as_sindex_shutdown(); // after storage - no more writes
 	as_xdr_shutdown();
 	as_smd_shutdown(g_smd);
 
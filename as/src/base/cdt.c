@@ -182,6 +182,66 @@ typedef struct {
 	bool error;
 } index_sort_userdata;
 
+#define OFFSET_SCAN_BATCH 64
+
+// How to find the end of an element from its first byte - one table lookup
+// instead of a branchy type decode.
+typedef enum {
+	MSGPACK_SCAN_INVALID,
+	MSGPACK_SCAN_FIXED,		// sz is whole element size
+	MSGPACK_SCAN_FIXSTR,	// size is in type byte
+	MSGPACK_SCAN_FIXARRAY,	// count is in type byte
+	MSGPACK_SCAN_FIXMAP,	// count is in type byte
+	MSGPACK_SCAN_BYTES,		// sz is size of length field
+	MSGPACK_SCAN_EXT,		// sz is size of length field, then ext type byte
+	MSGPACK_SCAN_ARRAY,		// sz is size of count field
+	MSGPACK_SCAN_MAP		// sz is size of count field
+} msgpack_scan_kind;
+
+typedef struct msgpack_scan_entry_s {
+	uint8_t kind;
+	uint8_t sz;
+} msgpack_scan_entry;
+
+static const msgpack_scan_entry msgpack_scan_table[256] = {
+		[0x00 ... 0x7f] = { MSGPACK_SCAN_FIXED, 1 }, // positive fixint
+		[0x80 ... 0x8f] = { MSGPACK_SCAN_FIXMAP, 1 },
+		[0x90 ... 0x9f] = { MSGPACK_SCAN_FIXARRAY, 1 },
+		[0xa0 ... 0xbf] = { MSGPACK_SCAN_FIXSTR, 1 },
+		[0xc0] = { MSGPACK_SCAN_FIXED, 1 }, // nil
+		[0xc1] = { MSGPACK_SCAN_INVALID, 0 },
+		[0xc2 ... 0xc3] = { MSGPACK_SCAN_FIXED, 1 }, // false, true
+		[0xc4] = { MSGPACK_SCAN_BYTES, 1 }, // bin 8
+		[0xc5] = { MSGPACK_SCAN_BYTES, 2 }, // bin 16
+		[0xc6] = { MSGPACK_SCAN_BYTES, 4 }, // bin 32
+		[0xc7] = { MSGPACK_SCAN_EXT, 1 }, // ext 8
+		[0xc8] = { MSGPACK_SCAN_EXT, 2 }, // ext 16
+		[0xc9] = { MSGPACK_SCAN_EXT, 4 }, // ext 32
+		[0xca] = { MSGPACK_SCAN_FIXED, 5 }, // float 32
+		[0xcb] = { MSGPACK_SCAN_FIXED, 9 }, // float 64
+		[0xcc] = { MSGPACK_SCAN_FIXED, 2 }, // uint 8
+		[0xcd] = { MSGPACK_SCAN_FIXED, 3 }, // uint 16
+		[0xce] = { MSGPACK_SCAN_FIXED, 5 }, // uint 32
+		[0xcf] = { MSGPACK_SCAN_FIXED, 9 }, // uint 64
+		[0xd0] = { MSGPACK_SCAN_FIXED, 2 }, // int 8
+		[0xd1] = { MSGPACK_SCAN_FIXED, 3 }, // int 16
+		[0xd2] = { MSGPACK_SCAN_FIXED, 5 }, // int 32
+		[0xd3] = { MSGPACK_SCAN_FIXED, 9 }, // int 64
+		[0xd4] = { MSGPACK_SCAN_FIXED, 3 }, // fixext 1
+		[0xd5] = { MSGPACK_SCAN_FIXED, 4 }, // fixext 2
+		[0xd6] = { MSGPACK_SCAN_FIXED, 6 }, // fixext 4
+		[0xd7] = { MSGPACK_SCAN_FIXED, 10 }, // fixext 8
+		[0xd8] = { MSGPACK_SCAN_FIXED, 18 }, // fixext 16
+		[0xd9] = { MSGPACK_SCAN_BYTES, 1 }, // str 8
+		[0xda] = { MSGPACK_SCAN_BYTES, 2 }, // str 16
+		[0xdb] = { MSGPACK_SCAN_BYTES, 4 }, // str 32
+		[0xdc] = { MSGPACK_SCAN_ARRAY, 2 }, // array 16
+		[0xdd] = { MSGPACK_SCAN_ARRAY, 4 }, // array 32
+		[0xde] = { MSGPACK_SCAN_MAP, 2 }, // map 16
+		[0xdf] = { MSGPACK_SCAN_MAP, 4 }, // map 32
+		[0xe0 ... 0xff] = { MSGPACK_SCAN_FIXED, 1 } // negative fixint
+};
+
 
 //==========================================================
 // Forward declares.
@@ -194,6 +254,7 @@ static bool unpack_map_value(as_unpacker *pk, cdt_payload *payload_r);
 inline static void cdt_payload_pack_val(cdt_payload *value, const as_val *val);
 
 static inline uint32_t order_index_ele_sz(uint32_t max_idx);
+static inline bool msgpack_scan(const uint8_t *buf, uint32_t buf_sz, uint32_t *offset_r, uint32_t n);
 
 
 //==========================================================
@@ -1189,6 +1250,33 @@ msgpacked_index_set(msgpacked_index *idxs, uint32_t index, uint32_t value)
 	}
 }
 
+// Set count consecutive values from index - one switch for the whole run.
+void
+msgpacked_index_set_n(msgpacked_index *idxs, uint32_t index,
+		const uint32_t *values, uint32_t count)
+{
+	switch (idxs->ele_sz) {
+	case 1:
+		for (uint32_t i = 0; i < count; i++) {
+			idxs->ptr[index + i] = (uint8_t)values[i];
+		}
+		break;
+	case 2:
+		for (uint32_t i = 0; i < count; i++) {
+			((uint16_t *)idxs->ptr)[index + i] = (uint16_t)values[i];
+		}
+		break;
+	case 3:
+		for (uint32_t i = 0; i < count; i++) {
+			((index_pack24 *)idxs->ptr)[index + i].value = values[i];
+		}
+		break;
+	default:
+		memcpy((uint32_t *)idxs->ptr + index, values, sizeof(uint32_t) * count);
+		break;
+	}
+}
+
 void
 msgpacked_index_incr(msgpacked_index *idxs, uint32_t index)
 {
@@ -1341,6 +1429,105 @@ msgpacked_index_print(const msgpacked_index *idxs, const char *name)
 }
 
 
+//==========================================================
+// msgpack scanning
+//
+
+// Skip n elements (nested elements included) from *offset_r. Validates that
+// the elements are well-formed and fit in buf.
+bool
+cdt_msgpack_skip(const uint8_t *buf, uint32_t buf_sz, uint32_t *offset_r,
+		uint32_t n)
+{
+	return msgpack_scan(buf, buf_sz, offset_r, n);
+}
+
+static inline bool
+msgpack_scan(const uint8_t *buf, uint32_t buf_sz, uint32_t *offset_r,
+		uint32_t n)
+{
+	uint64_t offset = *offset_r;
+	uint64_t pending = n; // elements left to skip, including nested ones
+
+	// Every element takes at least a byte, so this ends within buf_sz steps.
+	while (pending != 0) {
+		if (offset >= buf_sz) {
+			return false;
+		}
+
+		uint8_t type = buf[offset];
+		const msgpack_scan_entry *e = &msgpack_scan_table[type];
+
+		pending--;
+
+		switch (e->kind) {
+		case MSGPACK_SCAN_FIXED:
+			offset += e->sz;
+			continue;
+		case MSGPACK_SCAN_FIXSTR:
+			offset += 1 + (type & 0x1f);
+			continue;
+		case MSGPACK_SCAN_FIXARRAY:
+			offset++;
+			pending += type & 0x0f;
+			continue;
+		case MSGPACK_SCAN_FIXMAP:
+			offset++;
+			pending += 2 * (type & 0x0f);
+			continue;
+		case MSGPACK_SCAN_INVALID:
+			return false;
+		default:
+			break;
+		}
+
+		if (offset + 1 + e->sz > buf_sz) {
+			return false;
+		}
+
+		const uint8_t *p = buf + offset + 1;
+		uint32_t len;
+
+		switch (e->sz) {
+		case 1:
+			len = *p;
+			break;
+		case 2:
+			len = cf_swap_from_be16(*(const uint16_t *)p);
+			break;
+		default:
+			len = cf_swap_from_be32(*(const uint32_t *)p);
+			break;
+		}
+
+		offset += 1 + e->sz;
+
+		switch (e->kind) {
+		case MSGPACK_SCAN_BYTES:
+			offset += len;
+			break;
+		case MSGPACK_SCAN_EXT:
+			offset += 1 + (uint64_t)len;
+			break;
+		case MSGPACK_SCAN_ARRAY:
+			pending += len;
+			break;
+		default: // MSGPACK_SCAN_MAP
+			pending += 2 * (uint64_t)len;
+			break;
+		}
+	}
+
+	if (offset > buf_sz) {
+		return false;
+	}
+
+	*offset_r = (uint32_t)offset;
+
+	return true;
+}
+
+
 //==========================================================
 // offset_index
 //
@@ -1459,6 +1646,44 @@ offset_index_append_size(offset_index *offidx, uint32_t delta)
 	offset_index_set(offidx, filled, last + delta);
 }
 
+// Fill offsets of elements [start, end), scanning on from *offset_r - the
+// offset of element start - 1. Each element spans n_per_ele msgpack elements -
+// 1 for lists, 2 for maps. Leaves *offset_r at the offset of element end.
+// Caller sets filled count.
+bool
+offset_index_fill_scan(offset_index *offidx, uint32_t start, uint32_t end,
+		uint32_t n_per_ele, uint32_t *offset_r)
+{
+	cf_assert(start != 0 && end <= offidx->_.ele_count, AS_PARTICLE, "start(%u) end(%u) ele_count(%u)", start, end, offidx->_.ele_count);
+
+	uint32_t batch[OFFSET_SCAN_BATCH];
+	uint32_t offset = *offset_r;
+
+	while (start < end) {
+		uint32_t count = end - start;
+
+		if (count > OFFSET_SCAN_BATCH) {
+			count = OFFSET_SCAN_BATCH;
+		}
+
+		for (uint32_t i = 0; i < count; i++) {
+			if (! msgpack_scan(offidx->contents, offidx->content_sz, &offset,
+					n_per_ele)) {
+				return false;
+			}
+
+			batch[i] = offset;
+		}
+
+		msgpacked_index_set_n((msgpacked_index *)offidx, start, batch, count);
+		start += count;
+	}
+
+	*offset_r = offset;
+
+	return true;
+}
+
 bool
 offset_index_find_items(offset_index *full_offidx,
 		cdt_find_items_idxs_type find_type, as_unpacker *items_pk,
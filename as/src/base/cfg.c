@@ -31,6 +31,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/resource.h>
@@ -103,6 +104,9 @@ void cfg_add_mesh_seed_addr_port(char* addr, cf_ip_port port, bool tls);
 as_set* cfg_add_set(as_namespace* ns);
 void cfg_add_storage_file(as_namespace* ns, char* file_name);
 void cfg_add_storage_device(as_namespace* ns, char* device_name, char* shadow_name);
+uint32_t cfg_device_group_id(as_namespace* ns, char* group_name);
+void cfg_add_storage_device_group(as_namespace* ns, char* group_name, char* device_name);
+void cfg_check_storage_device_groups(as_namespace* ns);
 uint32_t cfg_obj_size_hist_max(uint32_t hist_max);
 void cfg_set_cluster_name(char* cluster_name);
 void create_and_check_hist_track(cf_hist_track** h, const char* name, histogram_scale scale);
@@ -152,6 +156,7 @@ cfg_set_defaults()
 	c->nsup_period = 120; // run nsup once every 2 minutes
 	c->nsup_startup_evict = true;
 	c->proto_fd_idle_ms = 60000; // 1 minute reaping of proto file descriptors
+	c->service_unix_mode = 0660; // owner & group only
 	c->proto_slow_netio_sleep_ms = 1; // 1 ms sleep between retry for slow queries
 	c->run_as_daemon = true; // set false only to run in debugger & see console output
 	c->scan_max_active = 100;
@@ -267,6 +272,9 @@ typedef enum {
 	CASE_SERVICE_BATCH_MAX_UNUSED_BUFFERS,
 	CASE_SERVICE_BATCH_PRIORITY,
 	CASE_SERVICE_BATCH_INDEX_THREADS,
+	CASE_SERVICE_CLIENT_QUOTA_READ_TPS,
+	CASE_SERVICE_CLIENT_QUOTA_WRITE_BPS,
+	CASE_SERVICE_CLIENT_QUOTA_WRITE_TPS,
 	CASE_SERVICE_CLOCK_SKEW_MAX_MS,
 	CASE_SERVICE_CLUSTER_NAME,
 	CASE_SERVICE_ENABLE_BENCHMARKS_FABRIC,
@@ -311,6 +319,8 @@ typedef enum {
 	CASE_SERVICE_SINDEX_BUILDER_THREADS,
 	CASE_SERVICE_SINDEX_GC_MAX_RATE,
 	CASE_SERVICE_SINDEX_GC_PERIOD,
+	CASE_SERVICE_STALE_MAP_HINTS,
+	CASE_SERVICE_STALE_MAP_REDIRECT,
 	CASE_SERVICE_TICKER_INTERVAL,
 	CASE_SERVICE_TRANSACTION_MAX_MS,
 	CASE_SERVICE_TRANSACTION_PENDING_LIMIT,
@@ -429,6 +439,8 @@ typedef enum {
 	CASE_NETWORK_SERVICE_TLS_AUTHENTICATE_CLIENT,
 	CASE_NETWORK_SERVICE_TLS_NAME,
 	CASE_NETWORK_SERVICE_TLS_PORT,
+	CASE_NETWORK_SERVICE_UNIX_SOCKET,
+	CASE_NETWORK_SERVICE_UNIX_SOCKET_MODE,
 	// Obsoleted:
 	CASE_NETWORK_SERVICE_ALTERNATE_ADDRESS,
 	CASE_NETWORK_SERVICE_NETWORK_INTERFACE_NAME,
@@ -519,7 +531,10 @@ typedef enum {
 	CASE_NAMESPACE_ALLOW_NONXDR_WRITES,
 	CASE_NAMESPACE_ALLOW_XDR_WRITES,
 	// Normally hidden:
+	CASE_NAMESPACE_CHANGE_STREAM_SIZE,
+	CASE_NAMESPACE_COLD_START_EARLY_REJOIN,
 	CASE_NAMESPACE_COLD_START_EVICT_TTL,
+	CASE_NAMESPACE_COMPACT_INDEX,
 	CASE_NAMESPACE_CONFLICT_RESOLUTION_POLICY,
 	CASE_NAMESPACE_DATA_IN_INDEX,
 	CASE_NAMESPACE_DISABLE_WRITE_DUP_RES,
@@ -541,12 +556,14 @@ typedef enum {
 	CASE_NAMESPACE_OBJ_SIZE_HIST_MAX,
 	CASE_NAMESPACE_PARTITION_TREE_LOCKS,
 	CASE_NAMESPACE_PARTITION_TREE_SPRIGS,
+	CASE_NAMESPACE_PARTITION_TREE_SPRIGS_AUTO,
 	CASE_NAMESPACE_RACK_ID,
 	CASE_NAMESPACE_READ_CONSISTENCY_LEVEL_OVERRIDE,
 	CASE_NAMESPACE_SET_BEGIN,
 	CASE_NAMESPACE_SINDEX_BEGIN,
 	CASE_NAMESPACE_GEO2DSPHERE_WITHIN_BEGIN,
 	CASE_NAMESPACE_SINGLE_BIN,
+	CASE_NAMESPACE_SKIP_UNCHANGED_WRITES,
 	CASE_NAMESPACE_STOP_WRITES_PCT,
 	CASE_NAMESPACE_TOMB_RAIDER_ELIGIBLE_AGE,
 	CASE_NAMESPACE_TOMB_RAIDER_PERIOD,
@@ -588,19 +605,23 @@ typedef enum {
 	CASE_NAMESPACE_STORAGE_DEVICE_MEMORY_ALL, // renamed
 	CASE_NAMESPACE_STORAGE_DEVICE_DATA_IN_MEMORY,
 	// Normally hidden:
+	CASE_NAMESPACE_STORAGE_DEVICE_COALESCE_READS,
 	CASE_NAMESPACE_STORAGE_DEVICE_COLD_START_EMPTY,
 	CASE_NAMESPACE_STORAGE_DEVICE_DEFRAG_LWM_PCT,
 	CASE_NAMESPACE_STORAGE_DEVICE_DEFRAG_QUEUE_MIN,
 	CASE_NAMESPACE_STORAGE_DEVICE_DEFRAG_SLEEP,
 	CASE_NAMESPACE_STORAGE_DEVICE_DEFRAG_STARTUP_MINIMUM,
+	CASE_NAMESPACE_STORAGE_DEVICE_DEVICE_GROUP,
 	CASE_NAMESPACE_STORAGE_DEVICE_DISABLE_ODIRECT,
 	CASE_NAMESPACE_STORAGE_DEVICE_ENABLE_BENCHMARKS_STORAGE,
 	CASE_NAMESPACE_STORAGE_DEVICE_ENABLE_OSYNC,
 	CASE_NAMESPACE_STORAGE_DEVICE_ENCRYPTION_KEY_FILE,
 	CASE_NAMESPACE_STORAGE_DEVICE_FLUSH_MAX_MS,
 	CASE_NAMESPACE_STORAGE_DEVICE_FSYNC_MAX_SEC,
+	CASE_NAMESPACE_STORAGE_DEVICE_INDEX_SNAPSHOT_FILE,
 	CASE_NAMESPACE_STORAGE_DEVICE_MAX_WRITE_CACHE,
 	CASE_NAMESPACE_STORAGE_DEVICE_MIN_AVAIL_PCT,
+	CASE_NAMESPACE_STORAGE_DEVICE_PLACEMENT_POLICY,
 	CASE_NAMESPACE_STORAGE_DEVICE_POST_WRITE_QUEUE,
 	CASE_NAMESPACE_STORAGE_DEVICE_TOMB_RAIDER_SLEEP,
 	CASE_NAMESPACE_STORAGE_DEVICE_WRITE_THREADS,
@@ -613,10 +634,18 @@ typedef enum {
 	CASE_NAMESPACE_STORAGE_DEVICE_SIGNATURE,
 	CASE_NAMESPACE_STORAGE_DEVICE_WRITE_SMOOTHING_PERIOD,
 
+	// Namespace storage-engine device placement-policy options (value tokens):
+	CASE_NAMESPACE_STORAGE_DEVICE_PLACEMENT_DIGEST,
+	CASE_NAMESPACE_STORAGE_DEVICE_PLACEMENT_LOAD,
+
 	// Namespace set options:
 	CASE_NAMESPACE_SET_DISABLE_EVICTION,
 	CASE_NAMESPACE_SET_ENABLE_XDR,
 	CASE_NAMESPACE_SET_STOP_WRITES_COUNT,
+	CASE_NAMESPACE_SET_DEVICE_GROUP,
+	CASE_NAMESPACE_SET_QUOTA_READ_TPS,
+	CASE_NAMESPACE_SET_QUOTA_WRITE_BPS,
+	CASE_NAMESPACE_SET_QUOTA_WRITE_TPS,
 	// Deprecated:
 	CASE_NAMESPACE_SET_EVICT_HWM_COUNT,
 	CASE_NAMESPACE_SET_EVICT_HWM_PCT,
@@ -637,6 +666,7 @@ typedef enum {
 
 	// Namespace sindex options:
 	CASE_NAMESPACE_SINDEX_NUM_PARTITIONS,
+	CASE_NAMESPACE_SINDEX_SNAPSHOT_FILE,
 
 	// Namespace geo2dsphere within options:
 	CASE_NAMESPACE_GEO2DSPHERE_WITHIN_STRICT,
@@ -648,6 +678,7 @@ typedef enum {
 
 	// Mod-lua options:
 	CASE_MOD_LUA_CACHE_ENABLED,
+	CASE_MOD_LUA_NATIVE_UDF_ENABLED,
 	CASE_MOD_LUA_SYSTEM_PATH,
 	CASE_MOD_LUA_USER_PATH,
 
@@ -758,6 +789,9 @@ const cfg_opt SERVICE_OPTS[] = {
 		{ "batch-max-unused-buffers",		CASE_SERVICE_BATCH_MAX_UNUSED_BUFFERS },
 		{ "batch-priority",					CASE_SERVICE_BATCH_PRIORITY },
 		{ "batch-index-threads",			CASE_SERVICE_BATCH_INDEX_THREADS },
+		{ "client-quota-read-tps",			CASE_SERVICE_CLIENT_QUOTA_READ_TPS },
+		{ "client-quota-write-bps",			CASE_SERVICE_CLIENT_QUOTA_WRITE_BPS },
+		{ "client-quota-write-tps",			CASE_SERVICE_CLIENT_QUOTA_WRITE_TPS },
 		{ "clock-skew-max-ms",				CASE_SERVICE_CLOCK_SKEW_MAX_MS },
 		{ "cluster-name",					CASE_SERVICE_CLUSTER_NAME },
 		{ "enable-benchmarks-fabric",		CASE_SERVICE_ENABLE_BENCHMARKS_FABRIC },
@@ -802,6 +836,8 @@ const cfg_opt SERVICE_OPTS[] = {
 		{ "sindex-builder-threads",			CASE_SERVICE_SINDEX_BUILDER_THREADS },
 		{ "sindex-gc-max-rate",				CASE_SERVICE_SINDEX_GC_MAX_RATE },
 		{ "sindex-gc-period",				CASE_SERVICE_SINDEX_GC_PERIOD },
+		{ "stale-map-hints",				CASE_SERVICE_STALE_MAP_HINTS },
+		{ "stale-map-redirect",				CASE_SERVICE_STALE_MAP_REDIRECT },
 		{ "ticker-interval",				CASE_SERVICE_TICKER_INTERVAL },
 		{ "transaction-max-ms",				CASE_SERVICE_TRANSACTION_MAX_MS },
 		{ "transaction-pending-limit",		CASE_SERVICE_TRANSACTION_PENDING_LIMIT },
@@ -921,6 +957,8 @@ const cfg_opt NETWORK_SERVICE_OPTS[] = {
 		{ "tls-authenticate-client",		CASE_NETWORK_SERVICE_TLS_AUTHENTICATE_CLIENT },
 		{ "tls-name",						CASE_NETWORK_SERVICE_TLS_NAME },
 		{ "tls-port",						CASE_NETWORK_SERVICE_TLS_PORT },
+		{ "unix-socket",					CASE_NETWORK_SERVICE_UNIX_SOCKET },
+		{ "unix-socket-mode",				CASE_NETWORK_SERVICE_UNIX_SOCKET_MODE },
 		{ "alternate-address",				CASE_NETWORK_SERVICE_ALTERNATE_ADDRESS },
 		{ "network-interface-name",			CASE_NETWORK_SERVICE_NETWORK_INTERFACE_NAME },
 		{ "reuse-address",					CASE_NETWORK_SERVICE_REUSE_ADDRESS },
@@ -1011,7 +1049,10 @@ const cfg_opt NAMESPACE_OPTS[] = {
 		{ "ns-forward-xdr-writes",			CASE_NAMESPACE_FORWARD_XDR_WRITES },
 		{ "allow-nonxdr-writes",			CASE_NAMESPACE_ALLOW_NONXDR_WRITES },
 		{ "allow-xdr-writes",				CASE_NAMESPACE_ALLOW_XDR_WRITES },
+		{ "change-stream-size",				CASE_NAMESPACE_CHANGE_STREAM_SIZE },
+		{ "cold-start-early-rejoin",		CASE_NAMESPACE_COLD_START_EARLY_REJOIN },
 		{ "cold-start-evict-ttl",			CASE_NAMESPACE_COLD_START_EVICT_TTL },
+		{ "compact-index",					CASE_NAMESPACE_COMPACT_INDEX },
 		{ "conflict-resolution-policy",		CASE_NAMESPACE_CONFLICT_RESOLUTION_POLICY },
 		{ "data-in-index",					CASE_NAMESPACE_DATA_IN_INDEX },
 		{ "disable-write-dup-res",			CASE_NAMESPACE_DISABLE_WRITE_DUP_RES },
@@ -1033,12 +1074,14 @@ const cfg_opt NAMESPACE_OPTS[] = {
 		{ "obj-size-hist-max",				CASE_NAMESPACE_OBJ_SIZE_HIST_MAX },
 		{ "partition-tree-locks",			CASE_NAMESPACE_PARTITION_TREE_LOCKS },
 		{ "partition-tree-sprigs",			CASE_NAMESPACE_PARTITION_TREE_SPRIGS },
+		{ "partition-tree-sprigs-auto",		CASE_NAMESPACE_PARTITION_TREE_SPRIGS_AUTO },
 		{ "rack-id",						CASE_NAMESPACE_RACK_ID },
 		{ "read-consistency-level-override", CASE_NAMESPACE_READ_CONSISTENCY_LEVEL_OVERRIDE },
 		{ "set",							CASE_NAMESPACE_SET_BEGIN },
 		{ "sindex",							CASE_NAMESPACE_SINDEX_BEGIN },
 		{ "geo2dsphere-within",				CASE_NAMESPACE_GEO2DSPHERE_WITHIN_BEGIN },
 		{ "single-bin",						CASE_NAMESPACE_SINGLE_BIN },
+		{ "skip-unchanged-writes",			CASE_NAMESPACE_SKIP_UNCHANGED_WRITES },
 		{ "stop-writes-pct",				CASE_NAMESPACE_STOP_WRITES_PCT },
 		{ "tomb-raider-eligible-age",		CASE_NAMESPACE_TOMB_RAIDER_ELIGIBLE_AGE },
 		{ "tomb-raider-period",				CASE_NAMESPACE_TOMB_RAIDER_PERIOD },
@@ -1083,19 +1126,23 @@ const cfg_opt NAMESPACE_STORAGE_DEVICE_OPTS[] = {
 		{ "write-block-size",				CASE_NAMESPACE_STORAGE_DEVICE_WRITE_BLOCK_SIZE },
 		{ "memory-all",						CASE_NAMESPACE_STORAGE_DEVICE_MEMORY_ALL },
 		{ "data-in-memory",					CASE_NAMESPACE_STORAGE_DEVICE_DATA_IN_MEMORY },
+		{ "coalesce-reads",					CASE_NAMESPACE_STORAGE_DEVICE_COALESCE_READS },
 		{ "cold-start-empty",				CASE_NAMESPACE_STORAGE_DEVICE_COLD_START_EMPTY },
 		{ "defrag-lwm-pct",					CASE_NAMESPACE_STORAGE_DEVICE_DEFRAG_LWM_PCT },
 		{ "defrag-queue-min",				CASE_NAMESPACE_STORAGE_DEVICE_DEFRAG_QUEUE_MIN },
 		{ "defrag-sleep",					CASE_NAMESPACE_STORAGE_DEVICE_DEFRAG_SLEEP },
 		{ "defrag-startup-minimum",			CASE_NAMESPACE_STORAGE_DEVICE_DEFRAG_STARTUP_MINIMUM },
+		{ "device-group",					CASE_NAMESPACE_STORAGE_DEVICE_DEVICE_GROUP },
 		{ "disable-odirect",				CASE_NAMESPACE_STORAGE_DEVICE_DISABLE_ODIRECT },
 		{ "enable-benchmarks-storage",		CASE_NAMESPACE_STORAGE_DEVICE_ENABLE_BENCHMARKS_STORAGE },
 		{ "enable-osync",					CASE_NAMESPACE_STORAGE_DEVICE_ENABLE_OSYNC },
 		{ "encryption-key-file",			CASE_NAMESPACE_STORAGE_DEVICE_ENCRYPTION_KEY_FILE },
 		{ "flush-max-ms",					CASE_NAMESPACE_STORAGE_DEVICE_FLUSH_MAX_MS },
 		{ "fsync-max-sec",					CASE_NAMESPACE_STORAGE_DEVICE_FSYNC_MAX_SEC },
+		{ "index-snapshot-file",			CASE_NAMESPACE_STORAGE_DEVICE_INDEX_SNAPSHOT_FILE },
 		{ "max-write-cache",				CASE_NAMESPACE_STORAGE_DEVICE_MAX_WRITE_CACHE },
 		{ "min-avail-pct",					CASE_NAMESPACE_STORAGE_DEVICE_MIN_AVAIL_PCT },
+		{ "placement-policy",				CASE_NAMESPACE_STORAGE_DEVICE_PLACEMENT_POLICY },
 		{ "post-write-queue",				CASE_NAMESPACE_STORAGE_DEVICE_POST_WRITE_QUEUE },
 		{ "tomb-raider-sleep",				CASE_NAMESPACE_STORAGE_DEVICE_TOMB_RAIDER_SLEEP },
 		{ "write-threads",					CASE_NAMESPACE_STORAGE_DEVICE_WRITE_THREADS },
@@ -1109,10 +1156,19 @@ const cfg_opt NAMESPACE_STORAGE_DEVICE_OPTS[] = {
 		{ "}",								CASE_CONTEXT_END }
 };
 
+const cfg_opt NAMESPACE_STORAGE_DEVICE_PLACEMENT_OPTS[] = {
+		{ "digest",							CASE_NAMESPACE_STORAGE_DEVICE_PLACEMENT_DIGEST },
+		{ "load",							CASE_NAMESPACE_STORAGE_DEVICE_PLACEMENT_LOAD }
+};
+
 const cfg_opt NAMESPACE_SET_OPTS[] = {
 		{ "set-disable-eviction",			CASE_NAMESPACE_SET_DISABLE_EVICTION },
 		{ "set-enable-xdr",					CASE_NAMESPACE_SET_ENABLE_XDR },
 		{ "set-stop-writes-count",			CASE_NAMESPACE_SET_STOP_WRITES_COUNT },
+		{ "set-device-group",				CASE_NAMESPACE_SET_DEVICE_GROUP },
+		{ "set-quota-read-tps",				CASE_NAMESPACE_SET_QUOTA_READ_TPS },
+		{ "set-quota-write-bps",			CASE_NAMESPACE_SET_QUOTA_WRITE_BPS },
+		{ "set-quota-write-tps",			CASE_NAMESPACE_SET_QUOTA_WRITE_TPS },
 		{ "set-evict-hwm-count",			CASE_NAMESPACE_SET_EVICT_HWM_COUNT },
 		{ "set-evict-hwm-pct",				CASE_NAMESPACE_SET_EVICT_HWM_PCT },
 		{ "set-stop-write-count",			CASE_NAMESPACE_SET_STOP_WRITE_COUNT },
@@ -1136,6 +1192,7 @@ const cfg_opt NAMESPACE_SI_OPTS[] = {
 
 const cfg_opt NAMESPACE_SINDEX_OPTS[] = {
 		{ "num-partitions",					CASE_NAMESPACE_SINDEX_NUM_PARTITIONS },
+		{ "snapshot-file",					CASE_NAMESPACE_SINDEX_SNAPSHOT_FILE },
 		{ "}",								CASE_CONTEXT_END }
 };
 
@@ -1151,6 +1208,7 @@ const cfg_opt NAMESPACE_GEO2DSPHERE_WITHIN_OPTS[] = {
 
 const cfg_opt MOD_LUA_OPTS[] = {
 		{ "cache-enabled",					CASE_MOD_LUA_CACHE_ENABLED },
+		{ "native-udf-enabled",				CASE_MOD_LUA_NATIVE_UDF_ENABLED },
 		{ "system-path",					CASE_MOD_LUA_SYSTEM_PATH },
 		{ "user-path",						CASE_MOD_LUA_USER_PATH },
 		{ "}",								CASE_CONTEXT_END }
@@ -1255,6 +1313,7 @@ const int NUM_NAMESPACE_READ_CONSISTENCY_OPTS		= sizeof(NAMESPACE_READ_CONSISTEN
 const int NUM_NAMESPACE_WRITE_COMMIT_OPTS			= sizeof(NAMESPACE_WRITE_COMMIT_OPTS) / sizeof(cfg_opt);
 const int NUM_NAMESPACE_STORAGE_OPTS				= sizeof(NAMESPACE_STORAGE_OPTS) / sizeof(cfg_opt);
 const int NUM_NAMESPACE_STORAGE_DEVICE_OPTS			= sizeof(NAMESPACE_STORAGE_DEVICE_OPTS) / sizeof(cfg_opt);
+const int NUM_NAMESPACE_STORAGE_DEVICE_PLACEMENT_OPTS	= sizeof(NAMESPACE_STORAGE_DEVICE_PLACEMENT_OPTS) / sizeof(cfg_opt);
 const int NUM_NAMESPACE_SET_OPTS					= sizeof(NAMESPACE_SET_OPTS) / sizeof(cfg_opt);
 const int NUM_NAMESPACE_SET_ENABLE_XDR_OPTS			= sizeof(NAMESPACE_SET_ENABLE_XDR_OPTS) / sizeof(cfg_opt);
 const int NUM_NAMESPACE_SI_OPTS						= sizeof(NAMESPACE_SI_OPTS) / sizeof(cfg_opt);
@@ -1964,6 +2023,21 @@ cfg_port_val3(const cfg_line* p_line)
 	return (cf_ip_port)cfg_int_val3(p_line, CFG_MIN_PORT, CFG_MAX_PORT);
 }
 
+// File permission bits, given in octal, e.g. 0660.
+uint32_t
+cfg_file_mode(const cfg_line* p_line)
+{
+	char* end;
+	unsigned long value = strtoul(p_line->val_tok_1, &end, 8);
+
+	if (*p_line->val_tok_1 == '\0' || *end != '\0' || value > 0777) {
+		cf_crash_nostack(AS_CFG, "line %d :: %s must be octal permission bits <= 0777, not %s",
+				p_line->num, p_line->name_tok, p_line->val_tok_1);
+	}
+
+	return (uint32_t)value;
+}
+
 //------------------------------------------------
 // Constants used in parsing.
 //
@@ -2167,6 +2241,15 @@ as_config_init(const char* config_file)
 			case CASE_SERVICE_BATCH_INDEX_THREADS:
 				c->n_batch_index_threads = cfg_u32(&line, 1, MAX_BATCH_THREADS);
 				break;
+			case CASE_SERVICE_CLIENT_QUOTA_READ_TPS:
+				c->client_quota_read_tps = cfg_u64_no_checks(&line);
+				break;
+			case CASE_SERVICE_CLIENT_QUOTA_WRITE_BPS:
+				c->client_quota_write_bps = cfg_u64_no_checks(&line);
+				break;
+			case CASE_SERVICE_CLIENT_QUOTA_WRITE_TPS:
+				c->client_quota_write_tps = cfg_u64_no_checks(&line);
+				break;
 			case CASE_SERVICE_CLOCK_SKEW_MAX_MS:
 				c->clock_skew_max_ms = cfg_u32_no_checks(&line);
 				break;
@@ -2300,6 +2383,12 @@ as_config_init(const char* config_file)
 			case CASE_SERVICE_SINDEX_GC_PERIOD:
 				c->sindex_gc_period = cfg_u32_no_checks(&line);
 				break;
+			case CASE_SERVICE_STALE_MAP_HINTS:
+				c->stale_map_hints = cfg_bool(&line);
+				break;
+			case CASE_SERVICE_STALE_MAP_REDIRECT:
+				c->stale_map_redirect = cfg_bool(&line);
+				break;
 			case CASE_SERVICE_TICKER_INTERVAL:
 				c->ticker_interval = cfg_u32_no_checks(&line);
 				break;
@@ -2575,6 +2664,12 @@ as_config_init(const char* config_file)
 				cfg_enterprise_only(&line);
 				c->tls_service.bind_port = cfg_port(&line);
 				break;
+			case CASE_NETWORK_SERVICE_UNIX_SOCKET:
+				c->service_unix_path = cfg_strdup(&line, true);
+				break;
+			case CASE_NETWORK_SERVICE_UNIX_SOCKET_MODE:
+				c->service_unix_mode = cfg_file_mode(&line);
+				break;
 			case CASE_NETWORK_SERVICE_ALTERNATE_ADDRESS:
 				cfg_obsolete(&line, "see Aerospike documentation http://www.aerospike.com/docs/operations/upgrade/network_to_3_10");
 				break;
@@ -2884,9 +2979,21 @@ as_config_init(const char* config_file)
 			case CASE_NAMESPACE_ALLOW_XDR_WRITES:
 				ns->ns_allow_xdr_writes = cfg_bool(&line);
 				break;
+			case CASE_NAMESPACE_CHANGE_STREAM_SIZE:
+				ns->change_stream_size = cfg_u32_power_of_2(&line, 0, AS_CHANGE_STREAM_MAX_SIZE);
+				if (ns->change_stream_size != 0 && ns->change_stream_size < AS_CHANGE_STREAM_MIN_SIZE) {
+					cf_crash_nostack(AS_CFG, "line %d :: %s must be 0 or >= %u", line.num, line.name_tok, AS_CHANGE_STREAM_MIN_SIZE);
+				}
+				break;
+			case CASE_NAMESPACE_COLD_START_EARLY_REJOIN:
+				ns->cold_start_early_rejoin = cfg_bool(&line);
+				break;
 			case CASE_NAMESPACE_COLD_START_EVICT_TTL:
 				ns->cold_start_evict_ttl = cfg_u32_no_checks(&line);
 				break;
+			case CASE_NAMESPACE_COMPACT_INDEX:
+				ns->compact_index = cfg_bool(&line);
+				break;
 			case CASE_NAMESPACE_CONFLICT_RESOLUTION_POLICY:
 				switch (cfg_find_tok(line.val_tok_1, NAMESPACE_CONFLICT_RESOLUTION_OPTS, NUM_NAMESPACE_CONFLICT_RESOLUTION_OPTS)) {
 				case CASE_NAMESPACE_CONFLICT_RESOLUTION_GENERATION:
@@ -2961,6 +3068,9 @@ as_config_init(const char* config_file)
 			case CASE_NAMESPACE_PARTITION_TREE_SPRIGS:
 				ns->tree_shared.n_sprigs = cfg_u32_power_of_2(&line, 16, 4096);
 				break;
+			case CASE_NAMESPACE_PARTITION_TREE_SPRIGS_AUTO:
+				ns->partition_tree_sprigs_auto = cfg_bool(&line);
+				break;
 			case CASE_NAMESPACE_RACK_ID:
 				ns->rack_id = cfg_u32(&line, 0, MAX_RACK_ID);
 				break;
@@ -2995,6 +3105,9 @@ as_config_init(const char* config_file)
 			case CASE_NAMESPACE_SINGLE_BIN:
 				ns->single_bin = cfg_bool(&line);
 				break;
+			case CASE_NAMESPACE_SKIP_UNCHANGED_WRITES:
+				ns->skip_unchanged_writes = cfg_bool(&line);
+				break;
 			case CASE_NAMESPACE_STOP_WRITES_PCT:
 				ns->stop_writes_pct = cfg_u32(&line, 0, 100);
 				break;
@@ -3040,12 +3153,16 @@ as_config_init(const char* config_file)
 				if (ns->data_in_index && ! (ns->single_bin && ns->storage_data_in_memory && ns->storage_type == AS_STORAGE_ENGINE_SSD)) {
 					cf_crash_nostack(AS_CFG, "ns %s data-in-index can't be true unless storage-engine is device and both single-bin and data-in-memory are true", ns->name);
 				}
+				if (ns->compact_index && ! (ns->storage_type == AS_STORAGE_ENGINE_SSD && ! ns->storage_data_in_memory)) {
+					cf_crash_nostack(AS_CFG, "ns %s compact-index can't be true unless storage-engine is device and data-in-memory is false", ns->name);
+				}
 				if (ns->default_ttl > ns->max_ttl) {
 					cf_crash_nostack(AS_CFG, "ns %s default-ttl can't be > max-ttl", ns->name);
 				}
 				if (ns->tree_shared.n_lock_pairs > ns->tree_shared.n_sprigs) {
 					cf_crash_nostack(AS_CFG, "ns %s partition-tree-locks can't be > partition-tree-sprigs", ns->name);
 				}
+				cfg_check_storage_device_groups(ns);
 				if (ns->storage_data_in_memory) {
 					ns->storage_post_write_queue = 0; // override default (or configuration mistake)
 					c->n_namespaces_inlined++;
@@ -3089,6 +3206,9 @@ as_config_init(const char* config_file)
 			case CASE_NAMESPACE_STORAGE_DEVICE_DATA_IN_MEMORY:
 				ns->storage_data_in_memory = cfg_bool(&line);
 				break;
+			case CASE_NAMESPACE_STORAGE_DEVICE_COALESCE_READS:
+				ns->storage_coalesce_reads = cfg_bool(&line);
+				break;
 			case CASE_NAMESPACE_STORAGE_DEVICE_COLD_START_EMPTY:
 				ns->storage_cold_start_empty = cfg_bool(&line);
 				break;
@@ -3104,6 +3224,9 @@ as_config_init(const char* config_file)
 			case CASE_NAMESPACE_STORAGE_DEVICE_DEFRAG_STARTUP_MINIMUM:
 				ns->storage_defrag_startup_minimum = cfg_int(&line, 1, 99);
 				break;
+			case CASE_NAMESPACE_STORAGE_DEVICE_DEVICE_GROUP:
+				cfg_add_storage_device_group(ns, cfg_strdup(&line, true), cfg_strdup_val2(&line, true));
+				break;
 			case CASE_NAMESPACE_STORAGE_DEVICE_DISABLE_ODIRECT:
 				ns->storage_disable_odirect = cfg_bool(&line);
 				break;
@@ -3123,12 +3246,29 @@ as_config_init(const char* config_file)
 			case CASE_NAMESPACE_STORAGE_DEVICE_FSYNC_MAX_SEC:
 				ns->storage_fsync_max_us = cfg_u64_no_checks(&line) * 1000000;
 				break;
+			case CASE_NAMESPACE_STORAGE_DEVICE_INDEX_SNAPSHOT_FILE:
+				ns->storage_index_snapshot_file = cfg_strdup(&line, true);
+				break;
 			case CASE_NAMESPACE_STORAGE_DEVICE_MAX_WRITE_CACHE:
 				ns->storage_max_write_cache = cfg_u64_no_checks(&line);
 				break;
 			case CASE_NAMESPACE_STORAGE_DEVICE_MIN_AVAIL_PCT:
 				ns->storage_min_avail_pct = cfg_u32(&line, 0, 100);
 				break;
+			case CASE_NAMESPACE_STORAGE_DEVICE_PLACEMENT_POLICY:
+				switch (cfg_find_tok(line.val_tok_1, NAMESPACE_STORAGE_DEVICE_PLACEMENT_OPTS, NUM_NAMESPACE_STORAGE_DEVICE_PLACEMENT_OPTS)) {
+				case CASE_NAMESPACE_STORAGE_DEVICE_PLACEMENT_DIGEST:
+					ns->storage_placement_policy = AS_STORAGE_PLACEMENT_DIGEST;
+					break;
+				case CASE_NAMESPACE_STORAGE_DEVICE_PLACEMENT_LOAD:
+					ns->storage_placement_policy = AS_STORAGE_PLACEMENT_LOAD;
+					break;
+				case CASE_NOT_FOUND:
+				default:
+					cfg_unknown_val_tok_1(&line);
+					break;
+				}
+				break;
 			case CASE_NAMESPACE_STORAGE_DEVICE_POST_WRITE_QUEUE:
 				ns->storage_post_write_queue = cfg_u32(&line, 0, 4 * 1024);
 				break;
@@ -3186,6 +3326,18 @@ as_config_init(const char* config_file)
 			case CASE_NAMESPACE_SET_STOP_WRITES_COUNT:
 				p_set->stop_writes_count = cfg_u64_no_checks(&line);
 				break;
+			case CASE_NAMESPACE_SET_DEVICE_GROUP:
+				p_set->device_group = cfg_device_group_id(ns, cfg_strdup(&line, true));
+				break;
+			case CASE_NAMESPACE_SET_QUOTA_READ_TPS:
+				p_set->quotas.limits[AS_QUOTA_READ_TPS] = cfg_u64_no_checks(&line);
+				break;
+			case CASE_NAMESPACE_SET_QUOTA_WRITE_BPS:
+				p_set->quotas.limits[AS_QUOTA_WRITE_BPS] = cfg_u64_no_checks(&line);
+				break;
+			case CASE_NAMESPACE_SET_QUOTA_WRITE_TPS:
+				p_set->quotas.limits[AS_QUOTA_WRITE_TPS] = cfg_u64_no_checks(&line);
+				break;
 			case CASE_NAMESPACE_SET_EVICT_HWM_COUNT:
 			case CASE_NAMESPACE_SET_EVICT_HWM_PCT:
 			case CASE_NAMESPACE_SET_STOP_WRITE_COUNT:
@@ -3238,6 +3390,9 @@ as_config_init(const char* config_file)
 				// FIXME - minimum should be 1, but currently crashes.
 				ns->sindex_num_partitions = cfg_u32(&line, MIN_PARTITIONS_PER_INDEX, MAX_PARTITIONS_PER_INDEX);
 				break;
+			case CASE_NAMESPACE_SINDEX_SNAPSHOT_FILE:
+				ns->sindex_snapshot_file = cfg_strdup(&line, true);
+				break;
 			case CASE_CONTEXT_END:
 				cfg_end_context(&state);
 				break;
@@ -3289,6 +3444,9 @@ as_config_init(const char* config_file)
 			case CASE_MOD_LUA_CACHE_ENABLED:
 				c->mod_lua.cache_enabled = cfg_bool(&line);
 				break;
+			case CASE_MOD_LUA_NATIVE_UDF_ENABLED:
+				c->udf_native_enabled = cfg_bool(&line);
+				break;
 			case CASE_MOD_LUA_SYSTEM_PATH:
 				cfg_strcpy(&line, c->mod_lua.system_path, sizeof(c->mod_lua.system_path));
 				break;
@@ -3835,7 +3993,6 @@ as_config_post_process(as_config* c, const char* config_file)
 		ns->tree_shared.destructor			= (as_index_value_destructor)&as_record_destroy;
 		ns->tree_shared.destructor_udata	= (void*)ns;
 		ns->tree_shared.locks_shift			= 12 - cf_msb(ns->tree_shared.n_lock_pairs);
-		ns->tree_shared.sprigs_shift		= 12 - cf_msb(ns->tree_shared.n_sprigs);
 		ns->tree_shared.sprigs_offset		= sizeof(as_lock_pair) * ns->tree_shared.n_lock_pairs;
 
 		ssd_init_encryption_key(ns);
@@ -4438,6 +4595,91 @@ cfg_add_storage_device(as_namespace* ns, char* device_name, char* shadow_name)
 	}
 }
 
+uint32_t
+cfg_device_group_id(as_namespace* ns, char* group_name)
+{
+	if (strcmp(group_name, "default") == 0) {
+		cf_free(group_name);
+		return 0;
+	}
+
+	uint32_t group_id;
+
+	for (group_id = 1; group_id < AS_STORAGE_MAX_DEVICE_GROUPS; group_id++) {
+		char* name = ns->storage_device_group_names[group_id];
+
+		if (! name) {
+			ns->storage_device_group_names[group_id] = group_name;
+			return group_id;
+		}
+
+		if (strcmp(name, group_name) == 0) {
+			cf_free(group_name);
+			return group_id;
+		}
+	}
+
+	cf_crash_nostack(AS_CFG, "namespace %s - too many device groups", ns->name);
+
+	return 0;
+}
+
+void
+cfg_add_storage_device_group(as_namespace* ns, char* group_name, char* device_name)
+{
+	// Devices and files can't be mixed, so this indexes whichever is in use.
+	for (int i = 0; i < AS_STORAGE_MAX_DEVICES; i++) {
+		if ((ns->storage_devices[i] &&
+				strcmp(ns->storage_devices[i], device_name) == 0) ||
+			(ns->storage_files[i] &&
+				strcmp(ns->storage_files[i], device_name) == 0)) {
+			ns->storage_device_groups[i] = (uint8_t)cfg_device_group_id(ns, group_name);
+			cf_free(device_name);
+			return;
+		}
+	}
+
+	cf_crash_nostack(AS_CFG, "namespace %s - device-group %s must follow its device or file", ns->name, device_name);
+}
+
+static bool
+cfg_device_group_has_device(const as_namespace* ns, uint32_t group_id)
+{
+	for (int i = 0; i < AS_STORAGE_MAX_DEVICES; i++) {
+		if ((ns->storage_devices[i] || ns->storage_files[i]) &&
+				ns->storage_device_groups[i] == group_id) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void
+cfg_check_storage_device_groups(as_namespace* ns)
+{
+	// Sets may name groups before the storage context defines them, so names
+	// only get checked here - an unknown name has no devices.
+	for (uint32_t i = 0; i < ns->sets_cfg_count; i++) {
+		as_set* p_set = &ns->sets_cfg_array[i];
+		uint32_t group_id = p_set->device_group;
+
+		if (group_id != 0 && ! cfg_device_group_has_device(ns, group_id)) {
+			cf_crash_nostack(AS_CFG, "ns %s set %s set-device-group %s is not a configured device-group", ns->name, p_set->name, ns->storage_device_group_names[group_id]);
+		}
+	}
+
+	for (uint32_t group_id = 1; group_id < AS_STORAGE_MAX_DEVICE_GROUPS; group_id++) {
+		if (! ns->storage_device_group_names[group_id]) {
+			break;
+		}
+
+		if (! cfg_device_group_has_device(ns, group_id)) {
+			cf_crash_nostack(AS_CFG, "ns %s device-group %s has no devices", ns->name, ns->storage_device_group_names[group_id]);
+		}
+	}
+}
+
 uint32_t
 cfg_obj_size_hist_max(uint32_t hist_max)
 {
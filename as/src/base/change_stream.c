@@ -0,0 +1,292 @@
+/*
+ * change_stream.c
+ *
+ * Copyright (C) 2018 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+
+//==========================================================
+// Includes.
+//
+
+#include "base/change_stream.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "citrusleaf/alloc.h"
+#include "citrusleaf/cf_atomic.h"
+#include "citrusleaf/cf_b64.h"
+#include "citrusleaf/cf_clock.h"
+#include "citrusleaf/cf_digest.h"
+
+#include "dynbuf.h"
+#include "fault.h"
+
+#include "base/datamodel.h"
+
+
+//==========================================================
+// Typedefs & constants.
+//
+
+#define DIGEST_B64_SZ 28 // no null-terminator
+
+// Marks a slot's seq while an appender is writing the change.
+#define CHANGE_SLOT_BUSY (1UL << 63)
+
+#define cpu_relax() asm volatile("pause\n": : :"memory")
+
+static const char* OP_NAMES[] = {
+		[AS_CHANGE_OP_WRITE] = "write",
+		[AS_CHANGE_OP_DELETE] = "delete",
+		[AS_CHANGE_OP_DURABLE_DELETE] = "durable-delete"
+};
+
+
+//==========================================================
+// Forward declarations.
+//
+
+static void count_lost(as_change_stream* cs, uint64_t from_seq, uint64_t to_seq);
+static bool read_change(const as_change_slot* slot, uint64_t seq, as_change* change);
+static void append_change(as_namespace* ns, uint64_t seq, const as_change* change, cf_dyn_buf* db);
+
+
+//==========================================================
+// Public API.
+//
+
+void
+as_change_stream_init(as_namespace* ns)
+{
+	as_change_stream* cs = &ns->change_stream;
+
+	cs->epoch = cf_clepoch_milliseconds();
+
+	if (ns->change_stream_size == 0) {
+		return;
+	}
+
+	// Size is a power of 2 - enforced by config parsing.
+	cs->slots = cf_calloc(ns->change_stream_size, sizeof(as_change_slot));
+	cs->mask = ns->change_stream_size - 1;
+
+	cf_info(AS_NAMESPACE, "{%s} change stream holds %u changes", ns->name,
+			ns->change_stream_size);
+}
+
+
+// Called from master write and delete paths after the record lock is released.
+// Lock-free - each appender claims its slot by swapping in its sequence number
+// marked busy. An appender lapped by a newer one on the same slot gives way.
+void
+as_change_stream_append(as_namespace* ns, const cf_digest* keyd,
+		uint16_t set_id, uint16_t generation, uint64_t last_update_time,
+		as_change_op op)
+{
+	as_change_stream* cs = &ns->change_stream;
+
+	if (! cs->slots) {
+		return;
+	}
+
+	uint64_t seq = (uint64_t)cf_atomic64_incr(&cs->next_seq) - 1;
+	as_change_slot* slot = &cs->slots[seq & cs->mask];
+	uint64_t mine = seq + 1;
+
+	while (true) {
+		uint64_t cur = (uint64_t)cf_atomic64_get(slot->seq);
+		uint64_t cur_seq = cur & ~CHANGE_SLOT_BUSY;
+
+		// A newer change has (or is taking) the slot - ours is already lost.
+		if (cur_seq >= mine) {
+			return;
+		}
+
+		// An older appender is still writing - wait for it to finish.
+		if ((cur & CHANGE_SLOT_BUSY) != 0) {
+			cpu_relax();
+			continue;
+		}
+
+		// Readers never match a busy value, so know the slot is in flux.
+		if (__sync_bool_compare_and_swap(&slot->seq, cur,
+				mine | CHANGE_SLOT_BUSY)) {
+			break;
+		}
+	}
+
+	slot->change.keyd = *keyd;
+	slot->change.last_update_time = last_update_time;
+	slot->change.set_id = set_id;
+	slot->change.generation = generation;
+	slot->change.op = (uint8_t)op;
+
+	__sync_synchronize();
+	cf_atomic64_set(&slot->seq, mine);
+}
+
+
+// Format is:
+//
+//	epoch=<epoch>:next=<seq>:lost=<n>;<seq>,<digest>,<set>,<gen>,<lut>,<op>;...
+//
+// A consumer passes 'next' back as 'from' on its next call. If 'epoch' changed
+// the node restarted and the consumer must rescan. Changes overwritten before
+// the consumer got to them are skipped and counted in 'lost'.
+bool
+as_change_stream_read(as_namespace* ns, const uint64_t* p_from, uint32_t max,
+		cf_dyn_buf* db)
+{
+	as_change_stream* cs = &ns->change_stream;
+
+	if (! cs->slots) {
+		return false;
+	}
+
+	uint64_t n_slots = (uint64_t)cs->mask + 1;
+	uint64_t next_seq = (uint64_t)cf_atomic64_get(cs->next_seq);
+	uint64_t oldest_seq = next_seq > n_slots ? next_seq - n_slots : 0;
+	uint64_t seq = p_from ? *p_from : oldest_seq;
+
+	// Cursor from a previous epoch - consumer will see the epoch change.
+	if (seq > next_seq) {
+		seq = next_seq;
+	}
+
+	uint64_t n_lost = 0;
+
+	if (seq < oldest_seq) {
+		n_lost = oldest_seq - seq;
+		count_lost(cs, seq, oldest_seq);
+		seq = oldest_seq;
+	}
+
+	cf_dyn_buf_define_size(changes_db, 16 * 1024);
+	uint32_t n_read = 0;
+
+	// Stop at a slot being written or overwritten - next call picks up there.
+	while (n_read < max && seq < next_seq) {
+		as_change change;
+
+		if (! read_change(&cs->slots[seq & cs->mask], seq, &change)) {
+			break;
+		}
+
+		append_change(ns, seq, &change, &changes_db);
+
+		seq++;
+		n_read++;
+	}
+
+	cf_atomic64_setmax(&cs->read_seq, (int64_t)seq);
+
+	cf_dyn_buf_append_string(db, "epoch=");
+	cf_dyn_buf_append_uint64(db, cs->epoch);
+	cf_dyn_buf_append_string(db, ":next=");
+	cf_dyn_buf_append_uint64(db, seq);
+	cf_dyn_buf_append_string(db, ":lost=");
+	cf_dyn_buf_append_uint64(db, n_lost);
+
+	if (changes_db.used_sz != 0) {
+		cf_dyn_buf_append_buf(db, changes_db.buf, changes_db.used_sz);
+	}
+
+	cf_dyn_buf_free(&changes_db);
+
+	return true;
+}
+
+
+uint64_t
+as_change_stream_lag(as_namespace* ns)
+{
+	as_change_stream* cs = &ns->change_stream;
+
+	uint64_t next_seq = (uint64_t)cf_atomic64_get(cs->next_seq);
+	uint64_t read_seq = (uint64_t)cf_atomic64_get(cs->read_seq);
+
+	return next_seq > read_seq ? next_seq - read_seq : 0;
+}
+
+
+//==========================================================
+// Local helpers.
+//
+
+// Several consumers may miss the same changes - count each only once, by
+// advancing a mark past all changes counted so far.
+static void
+count_lost(as_change_stream* cs, uint64_t from_seq, uint64_t to_seq)
+{
+	uint64_t mark = (uint64_t)cf_atomic64_get(cs->lost_seq);
+
+	while (mark < to_seq) {
+		if (__sync_bool_compare_and_swap(&cs->lost_seq, mark, to_seq)) {
+			uint64_t start = mark > from_seq ? mark : from_seq;
+
+			cf_atomic64_add(&cs->n_lost, (int64_t)(to_seq - start));
+			return;
+		}
+
+		mark = (uint64_t)cf_atomic64_get(cs->lost_seq);
+	}
+}
+
+static bool
+read_change(const as_change_slot* slot, uint64_t seq, as_change* change)
+{
+	if ((uint64_t)cf_atomic64_get(slot->seq) != seq + 1) {
+		return false; // not yet written, being written, or overwritten
+	}
+
+	__sync_synchronize();
+	*change = slot->change;
+	__sync_synchronize();
+
+	// Check an appender didn't wrap around and start on the slot meanwhile.
+	return (uint64_t)cf_atomic64_get(slot->seq) == seq + 1;
+}
+
+static void
+append_change(as_namespace* ns, uint64_t seq, const as_change* change,
+		cf_dyn_buf* db)
+{
+	char digest_b64[DIGEST_B64_SZ];
+
+	cf_b64_encode((const uint8_t*)&change->keyd, CF_DIGEST_KEY_SZ,
+			digest_b64);
+
+	const char* set_name = as_namespace_get_set_name(ns, change->set_id);
+
+	cf_dyn_buf_append_char(db, ';');
+	cf_dyn_buf_append_uint64(db, seq);
+	cf_dyn_buf_append_char(db, ',');
+	cf_dyn_buf_append_buf(db, (uint8_t*)digest_b64, sizeof(digest_b64));
+	cf_dyn_buf_append_char(db, ',');
+	cf_dyn_buf_append_string(db, set_name ? set_name : "");
+	cf_dyn_buf_append_char(db, ',');
+	cf_dyn_buf_append_uint32(db, change->generation);
+	cf_dyn_buf_append_char(db, ',');
+	cf_dyn_buf_append_uint64(db, change->last_update_time);
+	cf_dyn_buf_append_char(db, ',');
+	cf_dyn_buf_append_string(db, OP_NAMES[change->op]);
+}
@@ -40,6 +40,7 @@
 #include "citrusleaf/cf_queue.h"
 
 #include "arenax.h"
+#include "bits.h"
 #include "cf_mutex.h"
 #include "fault.h"
 #include "olock.h"
@@ -94,10 +95,15 @@ void as_index_tree_destroy(as_index_tree *tree);
 void as_index_sprig_done(as_index_sprig *isprig, as_index *r, cf_arenax_handle r_h);
 bool as_index_sprig_invalid_record_done(as_index_sprig *isprig, as_index_ref *index_ref);
 
-uint64_t as_index_sprig_reduce_partial(as_index_sprig *isprig, uint64_t sample_count, as_index_reduce_fn cb, void *udata);
+void as_index_reduce_partial_w_skip_lock(as_index_tree *tree, uint64_t sample_count, as_index_reduce_fn cb, void *udata, bool skip_lock);
+uint64_t as_index_sprig_reduce_partial(as_index_sprig *isprig, uint64_t sample_count, as_index_reduce_fn cb, void *udata, bool skip_lock);
 void as_index_sprig_traverse(as_index_sprig *isprig, cf_arenax_handle r_h, as_index_ph_array *v_a);
 void as_index_sprig_traverse_purge(as_index_sprig *isprig, cf_arenax_handle r_h);
 
+void as_index_pair_resplit(as_index_tree *tree, as_lock_pair *pair, uint32_t n_sprigs);
+void as_index_sprig_collect(as_index_sprig *isprig, cf_arenax_handle r_h, cf_arenax_handle *handles, uint64_t *pos);
+cf_arenax_handle as_index_sprig_build(as_index_sprig *isprig, cf_arenax_handle *handles, uint64_t n_handles, uint32_t depth, uint32_t red_depth);
+
 int as_index_sprig_exists(as_index_sprig *isprig, cf_digest *keyd);
 int as_index_sprig_get_vlock(as_index_sprig *isprig, cf_digest *keyd, as_index_ref *index_ref);
 int as_index_sprig_get_insert_vlock(as_index_sprig *isprig, cf_digest *keyd, as_index_ref *index_ref);
@@ -109,38 +115,64 @@ void as_index_sprig_delete_rebalance(as_index_sprig *isprig, as_index *root_pare
 void as_index_rotate_left(as_index_ele *a, as_index_ele *b);
 void as_index_rotate_right(as_index_ele *a, as_index_ele *b);
 
-static inline void
-as_index_sprig_from_i(as_index_tree *tree, as_index_sprig *isprig,
-		uint32_t sprig_i)
+static inline uint32_t
+as_index_keyd_bits(const cf_digest *keyd)
+{
+	// Get the 12 most significant non-pid bits in the digest. Note - this is
+	// hardwired around the way we currently extract the (12 bit) partition-ID
+	// from the digest.
+	return (((uint32_t)keyd->digest[1] & 0xF0) << 4) |
+			(uint32_t)keyd->digest[2];
+}
+
+static inline uint32_t
+as_index_pair_sprig_i(const as_lock_pair *pair, uint32_t bits)
 {
-	uint32_t lock_i = sprig_i >>
-			(tree->shared->locks_shift - tree->shared->sprigs_shift);
+	return (bits >> pair->sprigs_shift) & (pair->n_sprigs - 1);
+}
 
+static inline void
+as_index_sprig_from_pair(as_index_tree *tree, as_index_sprig *isprig,
+		as_lock_pair *pair)
+{
 	isprig->destructor = tree->shared->destructor;
 	isprig->destructor_udata = tree->shared->destructor_udata;
 	isprig->arena = tree->arena;
-	isprig->pair = tree_locks(tree) + lock_i;
-	isprig->sprig = tree_sprigs(tree) + sprig_i;
+	isprig->shared = tree->shared;
+	isprig->pair = pair;
+	isprig->sprig = NULL;
+	isprig->bits = 0;
 }
 
 static inline void
 as_index_sprig_from_keyd(as_index_tree *tree, as_index_sprig *isprig,
 		const cf_digest *keyd)
 {
-	// Get the 12 most significant non-pid bits in the digest. Note - this is
-	// hardwired around the way we currently extract the (12 bit) partition-ID
-	// from the digest.
-	uint32_t bits = (((uint32_t)keyd->digest[1] & 0xF0) << 4) |
-			(uint32_t)keyd->digest[2];
+	uint32_t bits = as_index_keyd_bits(keyd);
 
-	uint32_t lock_i = bits >> tree->shared->locks_shift;
-	uint32_t sprig_i = bits >> tree->shared->sprigs_shift;
+	as_index_sprig_from_pair(tree, isprig,
+			tree_locks(tree) + (bits >> tree->shared->locks_shift));
 
-	isprig->destructor = tree->shared->destructor;
-	isprig->destructor_udata = tree->shared->destructor_udata;
-	isprig->arena = tree->arena;
-	isprig->pair = tree_locks(tree) + lock_i;
-	isprig->sprig = tree_sprigs(tree) + sprig_i;
+	// Sprig is resolved when the pair is locked - it may be re-split.
+	isprig->bits = bits;
+}
+
+// Lock the sprig's pair, counting waits if contended, and resolve the sprig.
+static inline void
+as_index_sprig_lock(as_index_sprig *isprig)
+{
+	if (! cf_mutex_trylock(&isprig->pair->lock)) {
+		uint64_t start_us = cf_getus();
+
+		cf_mutex_lock(&isprig->pair->lock);
+
+		cf_atomic64_incr(&isprig->shared->n_lock_waits);
+		cf_atomic64_add(&isprig->shared->lock_wait_us,
+				(int64_t)(cf_getus() - start_us));
+	}
+
+	isprig->sprig = isprig->pair->sprigs +
+			as_index_pair_sprig_i(isprig->pair, isprig->bits);
 }
 
 
@@ -180,21 +212,37 @@ as_index_tree_gc_queue_size()
 as_index_tree *
 as_index_tree_create(as_index_tree_shared *shared, cf_arenax *arena)
 {
-	size_t locks_size = sizeof(cf_mutex) * shared->n_lock_pairs * 2;
-	size_t sprigs_size = sizeof(as_sprig) * shared->n_sprigs;
+	// Sprigs may be changed online - snapshot the current setting.
+	uint32_t n_sprigs = shared->n_sprigs;
+	uint32_t pair_n_sprigs = n_sprigs / shared->n_lock_pairs;
+
+	size_t locks_size = sizeof(as_lock_pair) * shared->n_lock_pairs;
+	size_t sprigs_size = sizeof(as_sprig) * n_sprigs;
 	size_t tree_size = sizeof(as_index_tree) + locks_size + sprigs_size;
 
 	as_index_tree *tree = cf_rc_alloc(tree_size);
 
 	tree->shared = shared;
 	tree->arena = arena;
+	tree->n_reduces = 0;
+	tree->n_sprigs = n_sprigs;
+	tree->resplit_n_sprigs = 0;
 
 	as_lock_pair *pair = tree_locks(tree);
 	as_lock_pair *pair_end = pair + shared->n_lock_pairs;
+	as_sprig *sprigs = tree_sprigs(tree);
 
 	while (pair < pair_end) {
 		cf_mutex_init(&pair->lock);
 		cf_mutex_init(&pair->reduce_lock);
+
+		pair->sprigs = sprigs;
+		pair->n_sprigs = pair_n_sprigs;
+		pair->sprigs_shift = shared->locks_shift - cf_msb(pair_n_sprigs);
+		pair->sprigs_alloced = false;
+		pair->n_elements = 0;
+
+		sprigs += pair_n_sprigs;
 		pair++;
 	}
 
@@ -231,18 +279,118 @@ uint64_t
 as_index_tree_size(as_index_tree *tree)
 {
 	uint64_t n_elements = 0;
-	as_sprig* sprig = tree_sprigs(tree);
-	as_sprig* sprig_end = sprig + tree->shared->n_sprigs;
+	as_lock_pair *pair = tree_locks(tree);
+	as_lock_pair *pair_end = pair + tree->shared->n_lock_pairs;
 
-	while (sprig < sprig_end) {
-		n_elements += sprig->n_elements;
-		sprig++;
+	while (pair < pair_end) {
+		n_elements += pair->n_elements;
+		pair++;
 	}
 
 	return n_elements;
 }
 
 
+// Estimate the average and maximum sprig depths in the tree. Digests are
+// uniformly distributed, so a pair's sprigs are all about the same size.
+void
+as_index_tree_sprig_stats(as_index_tree *tree, uint32_t *avg_depth,
+		uint32_t *max_depth)
+{
+	uint64_t n_elements = 0;
+	uint64_t n_sprigs = 0;
+	uint64_t max_per_sprig = 0;
+
+	as_lock_pair *pair = tree_locks(tree);
+	as_lock_pair *pair_end = pair + tree->shared->n_lock_pairs;
+
+	while (pair < pair_end) {
+		uint64_t pair_n_elements = pair->n_elements;
+		uint32_t pair_n_sprigs = pair->n_sprigs;
+		uint64_t per_sprig = pair_n_elements / pair_n_sprigs;
+
+		if (per_sprig > max_per_sprig) {
+			max_per_sprig = per_sprig;
+		}
+
+		n_elements += pair_n_elements;
+		n_sprigs += pair_n_sprigs;
+		pair++;
+	}
+
+	// A balanced sprig with n elements is msb(n) + 1 levels deep.
+	*avg_depth = (uint32_t)(cf_msb(n_elements / n_sprigs) + 1);
+	*max_depth = (uint32_t)(cf_msb(max_per_sprig) + 1);
+}
+
+
+//==========================================================
+// Public API - re-split a tree's sprigs.
+//
+
+// Change the number of sprigs in each of the tree's lock pairs, so the tree
+// has n_sprigs in all. Each pair is re-bucketed under its own locks, so only
+// operations on that pair wait. Returns false if pairs were skipped because a
+// reduce was in progress - the last reduce to finish re-splits them, and the
+// caller may also try again later.
+bool
+as_index_tree_resplit(as_index_tree *tree, uint32_t n_sprigs)
+{
+	// Already done - don't touch the pair locks.
+	if (__atomic_load_n(&tree->n_sprigs, __ATOMIC_ACQUIRE) == n_sprigs) {
+		return true;
+	}
+
+	uint32_t pair_n_sprigs = n_sprigs / tree->shared->n_lock_pairs;
+	bool done = true;
+
+	as_lock_pair *pair = tree_locks(tree);
+	as_lock_pair *pair_end = pair + tree->shared->n_lock_pairs;
+
+	for ( ; pair < pair_end; pair++) {
+		cf_mutex_lock(&pair->lock);
+
+		if (pair->n_sprigs == pair_n_sprigs) {
+			cf_mutex_unlock(&pair->lock);
+			continue;
+		}
+
+		// Reduces iterate sprigs across several reduce_lock scopes, so don't
+		// change sprigs from under them.
+		if (! cf_mutex_trylock(&pair->reduce_lock)) {
+			cf_mutex_unlock(&pair->lock);
+			done = false;
+			continue;
+		}
+
+		if (cf_atomic32_get(tree->n_reduces) != 0) {
+			cf_mutex_unlock(&pair->reduce_lock);
+			cf_mutex_unlock(&pair->lock);
+			done = false;
+			continue;
+		}
+
+		as_index_pair_resplit(tree, pair, pair_n_sprigs);
+
+		cf_mutex_unlock(&pair->reduce_lock);
+		cf_mutex_unlock(&pair->lock);
+	}
+
+	if (! done) {
+		__atomic_store_n(&tree->resplit_n_sprigs, n_sprigs, __ATOMIC_RELEASE);
+		return false;
+	}
+
+	uint32_t expected = n_sprigs;
+
+	__atomic_compare_exchange_n(&tree->resplit_n_sprigs, &expected, 0, false,
+			__ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+	__atomic_store_n(&tree->n_sprigs, n_sprigs, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+
 //==========================================================
 // Public API - reduce a tree.
 //
@@ -261,20 +409,18 @@ void
 as_index_reduce_partial(as_index_tree *tree, uint64_t sample_count,
 		as_index_reduce_fn cb, void *udata)
 {
-	// Reduce sprigs from largest to smallest digests to preserve this order for
-	// the whole tree. (Rapid rebalance requires exact order.)
-
-	for (int i = (int)tree->shared->n_sprigs - 1; i >= 0; i--) {
-		as_index_sprig isprig;
-		as_index_sprig_from_i(tree, &isprig, (uint32_t)i);
+	as_index_reduce_partial_w_skip_lock(tree, sample_count, cb, udata, false);
+}
 
-		sample_count -= as_index_sprig_reduce_partial(&isprig, sample_count, cb,
-				udata);
 
-		if (sample_count == 0) {
-			break;
-		}
-	}
+// Make a callback for every element in the tree, without taking record locks -
+// for when the caller already holds all of them, i.e. at shutdown. Callback
+// must still call as_record_done() to release the record.
+void
+as_index_reduce_skip_lock(as_index_tree *tree, as_index_reduce_fn cb,
+		void *udata)
+{
+	as_index_reduce_partial_w_skip_lock(tree, AS_REDUCE_ALL, cb, udata, true);
 }
 
 
@@ -371,25 +517,27 @@ run_index_tree_gc(void *unused)
 void
 as_index_tree_destroy(as_index_tree *tree)
 {
-	as_sprig* sprig = tree_sprigs(tree);
-	as_sprig* sprig_end = sprig + tree->shared->n_sprigs;
+	as_lock_pair *pair = tree_locks(tree);
+	as_lock_pair *pair_end = pair + tree->shared->n_lock_pairs;
 
-	while (sprig < sprig_end) {
-		as_index_sprig isprig;
+	while (pair < pair_end) {
+		as_sprig *sprig = pair->sprigs;
+		as_sprig *sprig_end = sprig + pair->n_sprigs;
 
-		isprig.destructor = tree->shared->destructor;
-		isprig.destructor_udata = tree->shared->destructor_udata;
-		isprig.arena = tree->arena;
-		isprig.sprig = sprig;
+		while (sprig < sprig_end) {
+			as_index_sprig isprig;
 
-		as_index_sprig_traverse_purge(&isprig, isprig.sprig->root_h);
-		sprig++;
-	}
+			as_index_sprig_from_pair(tree, &isprig, pair);
+			isprig.sprig = sprig;
 
-	as_lock_pair *pair = tree_locks(tree);
-	as_lock_pair *pair_end = pair + tree->shared->n_lock_pairs;
+			as_index_sprig_traverse_purge(&isprig, isprig.sprig->root_h);
+			sprig++;
+		}
+
+		if (pair->sprigs_alloced) {
+			cf_free(pair->sprigs);
+		}
 
-	while (pair < pair_end) {
 		cf_mutex_destroy(&pair->lock);
 		cf_mutex_destroy(&pair->reduce_lock);
 		pair++;
@@ -436,6 +584,59 @@ as_index_sprig_invalid_record_done(as_index_sprig *isprig,
 }
 
 
+//==========================================================
+// Local helpers - reduce a tree.
+//
+
+void
+as_index_reduce_partial_w_skip_lock(as_index_tree *tree, uint64_t sample_count,
+		as_index_reduce_fn cb, void *udata, bool skip_lock)
+{
+	// Block re-splitting - sprigs must stay put while we iterate them.
+	cf_atomic32_incr(&tree->n_reduces);
+
+	// Reduce sprigs from largest to smallest digests to preserve this order for
+	// the whole tree. (Rapid rebalance requires exact order.)
+
+	for (int lock_i = (int)tree->shared->n_lock_pairs - 1;
+			lock_i >= 0 && sample_count != 0; lock_i--) {
+		as_lock_pair *pair = tree_locks(tree) + lock_i;
+
+		// Any re-split in progress on this pair completes before we get this.
+		cf_mutex_lock(&pair->reduce_lock);
+
+		uint32_t n_sprigs = pair->n_sprigs;
+
+		cf_mutex_unlock(&pair->reduce_lock);
+
+		for (int i = (int)n_sprigs - 1; i >= 0; i--) {
+			as_index_sprig isprig;
+
+			as_index_sprig_from_pair(tree, &isprig, pair);
+			isprig.sprig = pair->sprigs + i;
+
+			sample_count -= as_index_sprig_reduce_partial(&isprig, sample_count,
+					cb, udata, skip_lock);
+
+			if (sample_count == 0) {
+				break;
+			}
+		}
+	}
+
+	// Do any re-split we blocked - a steady stream of overlapping reduces
+	// would otherwise keep nsup from ever finding the tree idle.
+	if (cf_atomic32_decr(&tree->n_reduces) == 0) {
+		uint32_t resplit_n_sprigs =
+				__atomic_load_n(&tree->resplit_n_sprigs, __ATOMIC_ACQUIRE);
+
+		if (resplit_n_sprigs != 0) {
+			as_index_tree_resplit(tree, resplit_n_sprigs);
+		}
+	}
+}
+
+
 //==========================================================
 // Local helpers - reduce a sprig.
 //
@@ -444,7 +645,7 @@ as_index_sprig_invalid_record_done(as_index_sprig *isprig,
 // the tree lock.
 uint64_t
 as_index_sprig_reduce_partial(as_index_sprig *isprig, uint64_t sample_count,
-		as_index_reduce_fn cb, void *udata)
+		as_index_reduce_fn cb, void *udata, bool skip_lock)
 {
 	bool reduce_all = sample_count == AS_REDUCE_ALL;
 
@@ -485,11 +686,13 @@ as_index_sprig_reduce_partial(as_index_sprig *isprig, uint64_t sample_count,
 	for (i = 0; i < v_a->pos; i++) {
 		as_index_ref r_ref;
 
-		r_ref.skip_lock = false;
+		r_ref.skip_lock = skip_lock;
 		r_ref.r = v_a->indexes[i].r;
 		r_ref.r_h = v_a->indexes[i].r_h;
 
-		olock_vlock(g_record_locks, &r_ref.r->keyd, &r_ref.olock);
+		if (! skip_lock) {
+			olock_vlock(g_record_locks, &r_ref.r->keyd, &r_ref.olock);
+		}
 
 		// Ignore this record if it's "half created" or deleted.
 		if (as_index_sprig_invalid_record_done(isprig, &r_ref)) {
@@ -552,6 +755,114 @@ as_index_sprig_traverse_purge(as_index_sprig *isprig, cf_arenax_handle r_h)
 }
 
 
+//==========================================================
+// Local helpers - re-split a lock pair's sprigs.
+//
+
+// Re-bucket all of a pair's elements into n_sprigs new sprigs. Caller must
+// hold both of the pair's locks.
+void
+as_index_pair_resplit(as_index_tree *tree, as_lock_pair *pair,
+		uint32_t n_sprigs)
+{
+	as_index_sprig isprig;
+	as_index_sprig_from_pair(tree, &isprig, pair);
+
+	uint64_t n_elements = pair->n_elements;
+	cf_arenax_handle *handles = cf_malloc(sizeof(cf_arenax_handle) *
+			(n_elements + 1)); // + 1 - don't malloc 0 bytes
+	uint64_t n_handles = 0;
+
+	// Collect handles from largest to smallest digests.
+	for (int i = (int)pair->n_sprigs - 1; i >= 0; i--) {
+		as_index_sprig_collect(&isprig, pair->sprigs[i].root_h, handles,
+				&n_handles);
+	}
+
+	cf_assert(n_handles == n_elements, AS_INDEX, "collected %lu of %lu",
+			n_handles, n_elements);
+
+	as_sprig *sprigs = cf_malloc(sizeof(as_sprig) * n_sprigs);
+
+	if (pair->sprigs_alloced) {
+		cf_free(pair->sprigs);
+	}
+
+	pair->sprigs = sprigs;
+	pair->n_sprigs = n_sprigs;
+	pair->sprigs_shift = tree->shared->locks_shift - cf_msb(n_sprigs);
+	pair->sprigs_alloced = true;
+
+	// Handles are in descending digest order, so each new sprig's elements are
+	// contiguous, and already sorted the way the sprig needs them.
+	uint64_t pos = 0;
+
+	for (int i = (int)n_sprigs - 1; i >= 0; i--) {
+		uint64_t start = pos;
+
+		while (pos < n_handles && as_index_pair_sprig_i(pair,
+				as_index_keyd_bits(&RESOLVE_H(handles[pos])->keyd)) ==
+						(uint32_t)i) {
+			pos++;
+		}
+
+		uint64_t n = pos - start;
+
+		isprig.sprig = sprigs + i;
+		isprig.sprig->n_elements = n;
+		isprig.sprig->root_h = n == 0 ? SENTINEL_H :
+				as_index_sprig_build(&isprig, handles + start, n, 0,
+						(uint32_t)cf_msb(n));
+	}
+
+	cf_assert(pos == n_handles, AS_INDEX, "re-bucketed %lu of %lu", pos,
+			n_handles);
+
+	cf_free(handles);
+}
+
+
+void
+as_index_sprig_collect(as_index_sprig *isprig, cf_arenax_handle r_h,
+		cf_arenax_handle *handles, uint64_t *pos)
+{
+	if (r_h == SENTINEL_H) {
+		return;
+	}
+
+	as_index *r = RESOLVE_H(r_h);
+
+	as_index_sprig_collect(isprig, r->left_h, handles, pos);
+	handles[(*pos)++] = r_h;
+	as_index_sprig_collect(isprig, r->right_h, handles, pos);
+}
+
+
+// Build a balanced sprig from handles sorted in descending digest order. Only
+// the deepest level may be incomplete - making it red (unless it's the root)
+// keeps black heights equal.
+cf_arenax_handle
+as_index_sprig_build(as_index_sprig *isprig, cf_arenax_handle *handles,
+		uint64_t n_handles, uint32_t depth, uint32_t red_depth)
+{
+	if (n_handles == 0) {
+		return SENTINEL_H;
+	}
+
+	uint64_t mid = n_handles / 2;
+	cf_arenax_handle r_h = handles[mid];
+	as_index *r = RESOLVE_H(r_h);
+
+	r->left_h = as_index_sprig_build(isprig, handles, mid, depth + 1,
+			red_depth);
+	r->right_h = as_index_sprig_build(isprig, handles + mid + 1,
+			n_handles - mid - 1, depth + 1, red_depth);
+	r->color = depth != 0 && depth == red_depth ? AS_RED : AS_BLACK;
+
+	return r_h;
+}
+
+
 //==========================================================
 // Local helpers - get/insert/delete an element in a sprig.
 //
@@ -559,7 +870,7 @@ as_index_sprig_traverse_purge(as_index_sprig *isprig, cf_arenax_handle r_h)
 int
 as_index_sprig_exists(as_index_sprig *isprig, cf_digest *keyd)
 {
-	cf_mutex_lock(&isprig->pair->lock);
+	as_index_sprig_lock(isprig);
 
 	int rv = as_index_sprig_search_lockless(isprig, keyd, NULL, NULL);
 
@@ -573,7 +884,7 @@ int
 as_index_sprig_get_vlock(as_index_sprig *isprig, cf_digest *keyd,
 		as_index_ref *index_ref)
 {
-	cf_mutex_lock(&isprig->pair->lock);
+	as_index_sprig_lock(isprig);
 
 	int rv = as_index_sprig_search_lockless(isprig, keyd, &index_ref->r,
 			&index_ref->r_h);
@@ -617,7 +928,7 @@ as_index_sprig_get_insert_vlock(as_index_sprig *isprig, cf_digest *keyd,
 	do {
 		ele = eles;
 
-		cf_mutex_lock(&isprig->pair->lock);
+		as_index_sprig_lock(isprig);
 
 		// Search for the specified element, or a parent to insert it under.
 
@@ -732,6 +1043,7 @@ as_index_sprig_get_insert_vlock(as_index_sprig *isprig, cf_digest *keyd,
 	}
 
 	isprig->sprig->n_elements++;
+	isprig->pair->n_elements++;
 
 	cf_mutex_unlock(&isprig->pair->reduce_lock);
 	cf_mutex_unlock(&isprig->pair->lock);
@@ -764,7 +1076,7 @@ as_index_sprig_delete(as_index_sprig *isprig, cf_digest *keyd)
 	do {
 		ele = eles;
 
-		cf_mutex_lock(&isprig->pair->lock);
+		as_index_sprig_lock(isprig);
 
 		root_parent.left_h = isprig->sprig->root_h;
 		root_parent.color = AS_BLACK;
@@ -901,6 +1213,7 @@ as_index_sprig_delete(as_index_sprig *isprig, cf_digest *keyd)
 	as_index_sprig_done(isprig, r, r_h);
 
 	isprig->sprig->n_elements--;
+	isprig->pair->n_elements--;
 
 	cf_mutex_unlock(&isprig->pair->reduce_lock);
 	cf_mutex_unlock(&isprig->pair->lock);
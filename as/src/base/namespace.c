@@ -40,6 +40,7 @@
 #include "vmapx.h"
 
 #include "base/cfg.h"
+#include "base/change_stream.h"
 #include "base/datamodel.h"
 #include "base/index.h"
 #include "base/proto.h"
@@ -177,6 +178,7 @@ as_namespace_create(char *name)
 	ns->storage_flush_max_us = 1000 * 1000; // wait this many microseconds before flushing inactive current write buffer (0 = never)
 	ns->storage_max_write_cache = 1024 * 1024 * 64;
 	ns->storage_min_avail_pct = 5; // stop writes when < 5% disk is writable
+	ns->storage_placement_policy = AS_STORAGE_PLACEMENT_DIGEST;
 	ns->storage_post_write_queue = 256; // number of wblocks per device used as post-write cache
 	ns->storage_tomb_raider_sleep = 1000; // sleep this many microseconds between each device read
 	ns->storage_write_threads = 1;
@@ -214,6 +216,7 @@ as_namespaces_init(bool cold_start_cmd, uint32_t instance)
 		}
 
 		as_truncate_init(ns);
+		as_change_stream_init(ns);
 		as_sindex_init(ns);
 	}
 
@@ -243,6 +246,9 @@ as_namespace_configure_sets(as_namespace *ns)
 			p_set->stop_writes_count = ns->sets_cfg_array[i].stop_writes_count;
 			p_set->disable_eviction = ns->sets_cfg_array[i].disable_eviction;
 			p_set->enable_xdr = ns->sets_cfg_array[i].enable_xdr;
+			p_set->device_group = ns->sets_cfg_array[i].device_group;
+			memcpy(p_set->quotas.limits, ns->sets_cfg_array[i].quotas.limits,
+					sizeof(p_set->quotas.limits));
 		}
 		else {
 			// Maybe exceeded max sets allowed, but try failing gracefully.
@@ -715,12 +721,48 @@ append_set_props(as_set *p_set, cf_dyn_buf *db)
 	cf_dyn_buf_append_uint64(db, p_set->truncate_lut);
 	cf_dyn_buf_append_char(db, ':');
 
+	cf_dyn_buf_append_string(db, "quota_read_tps_consumed=");
+	cf_dyn_buf_append_uint64(db, cf_atomic64_get(p_set->quotas.n_consumed[AS_QUOTA_READ_TPS]));
+	cf_dyn_buf_append_char(db, ':');
+
+	cf_dyn_buf_append_string(db, "quota_read_tps_rejected=");
+	cf_dyn_buf_append_uint64(db, cf_atomic64_get(p_set->quotas.n_rejected[AS_QUOTA_READ_TPS]));
+	cf_dyn_buf_append_char(db, ':');
+
+	cf_dyn_buf_append_string(db, "quota_write_tps_consumed=");
+	cf_dyn_buf_append_uint64(db, cf_atomic64_get(p_set->quotas.n_consumed[AS_QUOTA_WRITE_TPS]));
+	cf_dyn_buf_append_char(db, ':');
+
+	cf_dyn_buf_append_string(db, "quota_write_tps_rejected=");
+	cf_dyn_buf_append_uint64(db, cf_atomic64_get(p_set->quotas.n_rejected[AS_QUOTA_WRITE_TPS]));
+	cf_dyn_buf_append_char(db, ':');
+
+	cf_dyn_buf_append_string(db, "quota_write_bps_consumed=");
+	cf_dyn_buf_append_uint64(db, cf_atomic64_get(p_set->quotas.n_consumed[AS_QUOTA_WRITE_BPS]));
+	cf_dyn_buf_append_char(db, ':');
+
+	cf_dyn_buf_append_string(db, "quota_write_bps_rejected=");
+	cf_dyn_buf_append_uint64(db, cf_atomic64_get(p_set->quotas.n_rejected[AS_QUOTA_WRITE_BPS]));
+	cf_dyn_buf_append_char(db, ':');
+
 	// Configuration:
 
 	cf_dyn_buf_append_string(db, "stop-writes-count=");
 	cf_dyn_buf_append_uint64(db, cf_atomic64_get(p_set->stop_writes_count));
 	cf_dyn_buf_append_char(db, ':');
 
+	cf_dyn_buf_append_string(db, "set-quota-read-tps=");
+	cf_dyn_buf_append_uint64(db, cf_atomic64_get(p_set->quotas.limits[AS_QUOTA_READ_TPS]));
+	cf_dyn_buf_append_char(db, ':');
+
+	cf_dyn_buf_append_string(db, "set-quota-write-bps=");
+	cf_dyn_buf_append_uint64(db, cf_atomic64_get(p_set->quotas.limits[AS_QUOTA_WRITE_BPS]));
+	cf_dyn_buf_append_char(db, ':');
+
+	cf_dyn_buf_append_string(db, "set-quota-write-tps=");
+	cf_dyn_buf_append_uint64(db, cf_atomic64_get(p_set->quotas.limits[AS_QUOTA_WRITE_TPS]));
+	cf_dyn_buf_append_char(db, ':');
+
 	cf_dyn_buf_append_string(db, "set-enable-xdr=");
 
 	if (cf_atomic32_get(p_set->enable_xdr) == AS_SET_ENABLE_XDR_TRUE) {
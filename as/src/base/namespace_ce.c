@@ -64,7 +64,7 @@ check_capacity(uint32_t capacity)
 }
 
 #define MIN_STAGE_CAPACITY (MAX_STAGE_CAPACITY / 8)
-#define NS_MIN_MB (((sizeof(as_index) * MIN_STAGE_CAPACITY) * 2) / (1024 * 1024))
+#define NS_MIN_MB(_ns) (((as_index_size_get(_ns) * (uint64_t)MIN_STAGE_CAPACITY) * 2) / (1024 * 1024))
 
 uint32_t
 as_mem_check()
@@ -78,7 +78,13 @@ as_mem_check()
 	}
 
 	if (capacity < MIN_STAGE_CAPACITY) {
-		cf_crash_nostack(AS_NAMESPACE, "server requires at least %luMb of memory per namespace", NS_MIN_MB);
+		uint64_t min_mb = 0;
+
+		for (uint32_t i = 0; i < g_config.n_namespaces; i++) {
+			min_mb += NS_MIN_MB(g_config.namespaces[i]);
+		}
+
+		cf_crash_nostack(AS_NAMESPACE, "server requires at least %luMb of memory for %u namespaces", min_mb, g_config.n_namespaces);
 	}
 
 	if (capacity < MAX_STAGE_CAPACITY) {
@@ -55,6 +55,8 @@ extern const as_particle_vtable blob_vtable;
 extern const as_particle_vtable map_vtable;
 extern const as_particle_vtable list_vtable;
 extern const as_particle_vtable geojson_vtable;
+extern const as_particle_vtable hll_vtable;
+extern const as_particle_vtable timeseries_vtable;
 
 // Array of particle vtable pointers.
 const as_particle_vtable *particle_vtable[] = {
@@ -70,8 +72,10 @@ const as_particle_vtable *particle_vtable[] = {
 		[AS_PARTICLE_TYPE_RUBY_BLOB]	= &blob_vtable,
 		[AS_PARTICLE_TYPE_PHP_BLOB]		= &blob_vtable,
 		[AS_PARTICLE_TYPE_ERLANG_BLOB]	= &blob_vtable,
+		[AS_PARTICLE_TYPE_HLL]			= &hll_vtable,
 		[AS_PARTICLE_TYPE_MAP]			= &map_vtable,
 		[AS_PARTICLE_TYPE_LIST]			= &list_vtable,
+		[AS_PARTICLE_TYPE_TIMESERIES]	= &timeseries_vtable,
 		[AS_PARTICLE_TYPE_GEOJSON]		= &geojson_vtable
 };
 
@@ -96,8 +100,10 @@ safe_particle_type(uint8_t type)
 	case AS_PARTICLE_TYPE_RUBY_BLOB:
 	case AS_PARTICLE_TYPE_PHP_BLOB:
 	case AS_PARTICLE_TYPE_ERLANG_BLOB:
+	case AS_PARTICLE_TYPE_HLL:
 	case AS_PARTICLE_TYPE_MAP:
 	case AS_PARTICLE_TYPE_LIST:
+	case AS_PARTICLE_TYPE_TIMESERIES:
 	case AS_PARTICLE_TYPE_GEOJSON:
 		return (as_particle_type)type;
 	// Note - AS_PARTICLE_TYPE_NULL is considered bad here.
@@ -988,6 +994,121 @@ as_bin_particle_to_flat(const as_bin *b, uint8_t *flat)
 	return particle_vtable[type]->to_flat_fn(b->particle, flat);
 }
 
+// Compares the flat (storage) representations - i.e. whether writing b2 in
+// place of b1 would change what's on device.
+bool
+as_bin_particle_equal(as_bin *b1, as_bin *b2)
+{
+	if (! as_bin_inuse(b1) || ! as_bin_inuse(b2)) {
+		return ! as_bin_inuse(b1) && ! as_bin_inuse(b2);
+	}
+
+	uint8_t type = as_bin_get_particle_type(b1);
+
+	if (type != as_bin_get_particle_type(b2)) {
+		return false;
+	}
+
+	if (b1->particle == b2->particle) {
+		return true;
+	}
+
+	if (is_embedded_particle_type(type)) {
+		return false;
+	}
+
+	uint32_t flat_size = as_bin_particle_flat_size(b1);
+
+	if (flat_size != as_bin_particle_flat_size(b2)) {
+		return false;
+	}
+
+	uint8_t stack_flat[2 * 4096];
+	uint8_t *flat1 = flat_size <= 4096 ?
+			stack_flat : cf_malloc(2 * (size_t)flat_size);
+	uint8_t *flat2 = flat1 + flat_size;
+
+	uint32_t size1 = as_bin_particle_to_flat(b1, flat1);
+	uint32_t size2 = as_bin_particle_to_flat(b2, flat2);
+
+	bool equal = size1 == size2 && memcmp(flat1, flat2, size1) == 0;
+
+	if (flat1 != stack_flat) {
+		cf_free(flat1);
+	}
+
+	return equal;
+}
+
+//------------------------------------------------
+// Handle values left in the client message.
+//
+
+// For copy-free replace writes - the bin gets no particle, and its value is
+// flattened and pickled straight from the client message. Only for string and
+// blob types, whose wire value is the raw data. Caller must keep op around
+// until the record is written and pickled, and must not otherwise use the bin.
+bool
+as_bin_particle_ref_from_client(as_bin *b, const as_msg_op *op)
+{
+	switch ((as_particle_type)op->particle_type) {
+	case AS_PARTICLE_TYPE_STRING:
+	case AS_PARTICLE_TYPE_BLOB:
+	case AS_PARTICLE_TYPE_JAVA_BLOB:
+	case AS_PARTICLE_TYPE_CSHARP_BLOB:
+	case AS_PARTICLE_TYPE_PYTHON_BLOB:
+	case AS_PARTICLE_TYPE_RUBY_BLOB:
+	case AS_PARTICLE_TYPE_PHP_BLOB:
+	case AS_PARTICLE_TYPE_ERLANG_BLOB:
+		break;
+	default:
+		return false;
+	}
+
+	as_bin_state_set_from_type(b, (as_particle_type)op->particle_type);
+	b->particle = NULL;
+
+	return true;
+}
+
+uint32_t
+as_particle_client_ref_flat_size(const as_msg_op *op)
+{
+	// Same as blob_flat - type byte and host order 32-bit size.
+	return 1 + 4 + as_msg_op_get_value_sz(op);
+}
+
+uint32_t
+as_particle_client_ref_to_flat(const as_msg_op *op, uint8_t *flat)
+{
+	uint32_t value_size = as_msg_op_get_value_sz(op);
+
+	*flat++ = op->particle_type;
+	*(uint32_t *)flat = value_size;
+	memcpy(flat + 4, as_msg_op_get_value_p((as_msg_op *)op), value_size);
+
+	return 1 + 4 + value_size;
+}
+
+uint32_t
+as_particle_client_ref_pickled_size(const as_msg_op *op)
+{
+	// Always a type byte and a 32-bit size.
+	return 1 + 4 + as_msg_op_get_value_sz(op);
+}
+
+uint32_t
+as_particle_client_ref_to_pickled(const as_msg_op *op, uint8_t *pickled)
+{
+	uint32_t value_size = as_msg_op_get_value_sz(op);
+
+	*pickled++ = op->particle_type;
+	*(uint32_t *)pickled = cf_swap_to_be32(value_size);
+	memcpy(pickled + 4, as_msg_op_get_value_p((as_msg_op *)op), value_size);
+
+	return 1 + 4 + value_size;
+}
+
 
 //==========================================================
 // as_bin particle functions specific to CDTs.
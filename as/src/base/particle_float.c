@@ -198,3 +198,15 @@ float_from_msgpack(const uint8_t *packed, uint32_t packed_size, as_particle **pp
 
 	*(double *)pp = x;
 }
+
+
+//==========================================================
+// as_bin particle functions specific to FLOAT.
+//
+
+double
+as_bin_particle_float_value(const as_bin *b)
+{
+	// Caller must ensure this is called only for FLOAT particles.
+	return *(double *)&b->particle;
+}
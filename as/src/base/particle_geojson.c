@@ -429,6 +429,21 @@ as_bin_particle_geojson_cellids(const as_bin *b, uint64_t **ppcells)
 	return (size_t)gp->ncells;
 }
 
+// Returns false if the particle geometry is a region rather than a point.
+bool
+as_particle_geojson_point(const as_particle *particle, uint64_t *cellid)
+{
+	const geojson_mem *gp = (const geojson_mem *)particle;
+
+	if ((gp->flags & GEOJSON_ISREGION) != 0 || gp->ncells == 0) {
+		return false;
+	}
+
+	*cellid = ((const uint64_t *)gp->data)[0];
+
+	return true;
+}
+
 bool
 as_particle_geojson_match(as_particle *particle, uint64_t query_cellid, geo_region_t query_region, bool is_strict)
 {
@@ -0,0 +1,1063 @@
+/*
+ * particle_hll.c
+ *
+ * Copyright (C) 2018 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "aerospike/as_msgpack.h"
+#include "aerospike/as_val.h"
+#include "citrusleaf/alloc.h"
+
+#include "bits.h"
+#include "dynbuf.h"
+#include "fault.h"
+
+#include "base/cdt.h"
+#include "base/datamodel.h"
+#include "base/particle.h"
+#include "base/particle_blob.h"
+#include "base/proto.h"
+
+
+//==========================================================
+// HLL particle interface - function declarations.
+//
+
+// Most HLL particle table functions just use the equivalent BLOB particle
+// functions - an HLL is a blob whose contents are validated and which can't be
+// concatenated. Here are the differences...
+
+// Handle "wire" format.
+int32_t hll_concat_size_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp);
+int hll_append_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp);
+int hll_prepend_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp);
+int32_t hll_size_from_wire(const uint8_t *wire_value, uint32_t value_size);
+
+// Handle on-device "flat" format.
+int32_t hll_size_from_flat(const uint8_t *flat, uint32_t flat_size);
+int hll_cast_from_flat(uint8_t *flat, uint32_t flat_size, as_particle **pp);
+int hll_from_flat(const uint8_t *flat, uint32_t flat_size, as_particle **pp);
+
+
+//==========================================================
+// HLL particle interface - vtable.
+//
+
+const as_particle_vtable hll_vtable = {
+		blob_destruct,
+		blob_size,
+
+		hll_concat_size_from_wire,
+		hll_append_from_wire,
+		hll_prepend_from_wire,
+		blob_incr_from_wire,
+		hll_size_from_wire,
+		blob_from_wire,
+		blob_compare_from_wire,
+		blob_wire_size,
+		blob_to_wire,
+
+		blob_size_from_asval,
+		blob_from_asval,
+		blob_to_asval,
+		blob_asval_wire_size,
+		blob_asval_to_wire,
+
+		blob_size_from_msgpack,
+		blob_from_msgpack,
+
+		hll_size_from_flat,
+		hll_cast_from_flat,
+		hll_from_flat,
+		blob_flat_size,
+		blob_to_flat
+};
+
+
+//==========================================================
+// Typedefs & constants.
+//
+
+// Op payload is msgpack [op, args...]:
+//   INIT           [0, index-bits]            - (re)set to empty
+//   ADD            [1, [values], index-bits]  - index-bits used only to create,
+//                                               returns # registers updated
+//   SET_UNION      [2, [hlls], index-bits]    - index-bits used only to create
+//   COUNT          [50]                       - returns estimate
+//   GET_UNION      [51, [hlls]]               - returns HLL
+//   UNION_COUNT    [52, [hlls]]               - returns estimate
+//   INTERSECT_COUNT [53, [hlls]]              - returns estimate
+// Operand HLLs are the bytes read from HLL bins, packed as msgpack blobs.
+// Operands with more index bits are folded down to the fewest present.
+typedef enum {
+	HLL_OP_INIT = 0,
+	HLL_OP_ADD = 1,
+	HLL_OP_SET_UNION = 2,
+
+	HLL_OP_COUNT = 50,
+	HLL_OP_GET_UNION = 51,
+	HLL_OP_UNION_COUNT = 52,
+	HLL_OP_INTERSECT_COUNT = 53
+} hll_op_type;
+
+#define HLL_MIN_INDEX_BITS 4
+#define HLL_MAX_INDEX_BITS 16
+#define HLL_REG_BITS 6
+
+// Inclusion-exclusion needs 2^n - 1 union estimates, and its error grows
+// quickly with n - keep n (including the bin itself) small.
+#define HLL_MAX_INTERSECT_SETS 4
+
+#define HLL_MAX_OPERANDS 64
+
+typedef enum {
+	HLL_ENCODING_SPARSE = 0,
+	HLL_ENCODING_DENSE = 1
+} hll_encoding;
+
+// Same layout as blob_mem, so BLOB particle table functions can be used.
+typedef struct hll_mem_s {
+	uint8_t		type;
+	uint32_t	sz;
+	uint8_t		data[];
+} __attribute__ ((__packed__)) hll_mem;
+
+typedef hll_mem hll_flat;
+
+// Sparse data is n_sparse uint32_t entries, (index << 8) | register value,
+// sorted by index and in host order. Only non-zero registers have entries.
+// Dense data is all 2^n_index_bits 6-bit registers packed LSB first. We use
+// sparse while it's no bigger than dense.
+typedef struct hll_s {
+	uint8_t		encoding;
+	uint8_t		n_index_bits;
+	uint16_t	n_sparse;
+	uint8_t		data[];
+} __attribute__ ((__packed__)) hll_t;
+
+// Unpacked - one byte per register.
+typedef struct hll_regs_s {
+	uint8_t		n_index_bits;
+	uint8_t		*regs;
+} hll_regs;
+
+typedef struct hll_op_s {
+	as_unpacker pk;
+	hll_op_type type;
+	uint32_t n_args;
+} hll_op;
+
+
+//==========================================================
+// Forward declarations.
+//
+
+static bool hll_verify(const uint8_t *buf, uint32_t sz);
+static uint64_t hll_estimate(const hll_t *hll);
+
+static bool hll_op_init(hll_op *op, const as_msg_op *msg_op);
+static bool hll_op_unpack_index_bits(hll_op *op, uint8_t *n_index_bits);
+static bool hll_op_unpack_hlls(hll_op *op, const hll_t **hlls, uint32_t *n_hlls);
+
+static int hll_modify(as_bin *b, const hll_op *op, as_bin *result, cf_ll_buf *particles_llb);
+static int hll_read(const as_bin *b, const hll_op *op, as_bin *result);
+static int64_t hll_intersect_count(const hll_t **sets, uint32_t n_sets);
+
+static void hll_regs_init(hll_regs *hr, uint8_t n_index_bits);
+static void hll_regs_destroy(hll_regs *hr);
+static void hll_regs_merge(hll_regs *hr, const hll_t *hll);
+static uint32_t hll_regs_add(hll_regs *hr, uint64_t hash);
+static uint64_t hll_regs_estimate(const hll_regs *hr);
+static uint32_t hll_regs_packed_sz(const hll_regs *hr, uint32_t *n_set);
+static void hll_regs_pack(const hll_regs *hr, uint32_t n_set, hll_t *hll);
+static void hll_regs_to_bin(const hll_regs *hr, as_bin *b, cf_ll_buf *particles_llb);
+
+static uint64_t hll_hash(const uint8_t *buf, uint32_t sz);
+
+
+//==========================================================
+// Inlines & macros.
+//
+
+static inline uint32_t
+hll_n_regs(uint8_t n_index_bits)
+{
+	return 1U << n_index_bits;
+}
+
+static inline uint32_t
+hll_dense_data_sz(uint8_t n_index_bits)
+{
+	// Always whole bytes since n_index_bits >= 2.
+	return (hll_n_regs(n_index_bits) * HLL_REG_BITS) / 8;
+}
+
+static inline uint8_t
+hll_max_reg_value(uint8_t n_index_bits)
+{
+	return (uint8_t)(64 - n_index_bits + 1);
+}
+
+static inline uint32_t
+hll_sparse_get(const uint8_t *data, uint32_t i)
+{
+	uint32_t entry;
+
+	memcpy(&entry, data + (i * sizeof(uint32_t)), sizeof(uint32_t));
+
+	return entry;
+}
+
+static inline uint8_t
+hll_dense_get(const uint8_t *data, uint32_t ix)
+{
+	uint32_t bit = ix * HLL_REG_BITS;
+	uint32_t byte = bit >> 3;
+	uint32_t shift = bit & 7;
+	uint32_t v = (uint32_t)data[byte] >> shift;
+
+	if (shift > 8 - HLL_REG_BITS) {
+		v |= (uint32_t)data[byte + 1] << (8 - shift);
+	}
+
+	return (uint8_t)(v & 0x3f);
+}
+
+static inline void
+hll_dense_set(uint8_t *data, uint32_t ix, uint8_t value)
+{
+	uint32_t bit = ix * HLL_REG_BITS;
+	uint32_t byte = bit >> 3;
+	uint32_t shift = bit & 7;
+
+	data[byte] = (uint8_t)((data[byte] & ~(0x3f << shift)) | (value << shift));
+
+	if (shift > 8 - HLL_REG_BITS) {
+		data[byte + 1] = (uint8_t)((data[byte + 1] & ~(0x3f >> (8 - shift))) |
+				(value >> (8 - shift)));
+	}
+}
+
+static inline const hll_t *
+hll_from_bin(const as_bin *b)
+{
+	return (const hll_t *)((const hll_mem *)b->particle)->data;
+}
+
+
+//==========================================================
+// HLL particle interface - function definitions.
+//
+
+//------------------------------------------------
+// Handle "wire" format.
+//
+
+int32_t
+hll_concat_size_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp)
+{
+	cf_warning(AS_PARTICLE, "invalid operation on hll particle");
+	return -AS_PROTO_RESULT_FAIL_INCOMPATIBLE_TYPE;
+}
+
+int
+hll_append_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp)
+{
+	cf_warning(AS_PARTICLE, "invalid operation on hll particle");
+	return -AS_PROTO_RESULT_FAIL_INCOMPATIBLE_TYPE;
+}
+
+int
+hll_prepend_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp)
+{
+	cf_warning(AS_PARTICLE, "invalid operation on hll particle");
+	return -AS_PROTO_RESULT_FAIL_INCOMPATIBLE_TYPE;
+}
+
+int32_t
+hll_size_from_wire(const uint8_t *wire_value, uint32_t value_size)
+{
+	if (! hll_verify(wire_value, value_size)) {
+		cf_warning(AS_PARTICLE, "invalid wire hll");
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	return blob_size_from_wire(wire_value, value_size);
+}
+
+//------------------------------------------------
+// Handle on-device "flat" format.
+//
+
+int32_t
+hll_size_from_flat(const uint8_t *flat, uint32_t flat_size)
+{
+	int32_t mem_size = blob_size_from_flat(flat, flat_size);
+
+	if (mem_size < 0) {
+		return mem_size;
+	}
+
+	const hll_flat *p_hll_flat = (const hll_flat *)flat;
+
+	if (! hll_verify(p_hll_flat->data, p_hll_flat->sz)) {
+		cf_warning(AS_PARTICLE, "invalid flat hll");
+		return -AS_PROTO_RESULT_FAIL_UNKNOWN;
+	}
+
+	return mem_size;
+}
+
+int
+hll_cast_from_flat(uint8_t *flat, uint32_t flat_size, as_particle **pp)
+{
+	int32_t mem_size = hll_size_from_flat(flat, flat_size);
+
+	if (mem_size < 0) {
+		return mem_size;
+	}
+
+	return blob_cast_from_flat(flat, flat_size, pp);
+}
+
+int
+hll_from_flat(const uint8_t *flat, uint32_t flat_size, as_particle **pp)
+{
+	int32_t mem_size = hll_size_from_flat(flat, flat_size);
+
+	if (mem_size < 0) {
+		return mem_size;
+	}
+
+	return blob_from_flat(flat, flat_size, pp);
+}
+
+
+//==========================================================
+// as_bin particle functions specific to HLLs.
+//
+
+int
+as_bin_hll_read_from_client(const as_bin *b, as_msg_op *op, as_bin *result)
+{
+	hll_op hop;
+
+	if (! hll_op_init(&hop, op)) {
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	return hll_read(b, &hop, result);
+}
+
+int
+as_bin_hll_alloc_modify_from_client(as_bin *b, as_msg_op *op, as_bin *result)
+{
+	hll_op hop;
+
+	if (! hll_op_init(&hop, op)) {
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	return hll_modify(b, &hop, result, NULL);
+}
+
+int
+as_bin_hll_stack_modify_from_client(as_bin *b, cf_ll_buf *particles_llb, as_msg_op *op, as_bin *result)
+{
+	hll_op hop;
+
+	if (! hll_op_init(&hop, op)) {
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	return hll_modify(b, &hop, result, particles_llb);
+}
+
+
+//==========================================================
+// Local helpers - HLL values.
+//
+
+static bool
+hll_verify(const uint8_t *buf, uint32_t sz)
+{
+	if (sz < sizeof(hll_t)) {
+		return false;
+	}
+
+	const hll_t *hll = (const hll_t *)buf;
+	uint8_t n_index_bits = hll->n_index_bits;
+
+	if (n_index_bits < HLL_MIN_INDEX_BITS ||
+			n_index_bits > HLL_MAX_INDEX_BITS) {
+		return false;
+	}
+
+	uint32_t dense_sz = hll_dense_data_sz(n_index_bits);
+
+	if (hll->encoding == HLL_ENCODING_DENSE) {
+		return sz == sizeof(hll_t) + dense_sz;
+	}
+
+	if (hll->encoding != HLL_ENCODING_SPARSE) {
+		return false;
+	}
+
+	uint32_t sparse_sz = hll->n_sparse * sizeof(uint32_t);
+
+	if (sz != sizeof(hll_t) + sparse_sz || sparse_sz > dense_sz) {
+		return false;
+	}
+
+	uint32_t n_regs = hll_n_regs(n_index_bits);
+	uint8_t max_value = hll_max_reg_value(n_index_bits);
+	uint32_t prev_ix = 0;
+
+	for (uint32_t i = 0; i < hll->n_sparse; i++) {
+		uint32_t entry = hll_sparse_get(hll->data, i);
+		uint32_t ix = entry >> 8;
+		uint8_t value = (uint8_t)entry;
+
+		if (ix >= n_regs || (i != 0 && ix <= prev_ix) ||
+				value == 0 || value > max_value) {
+			return false;
+		}
+
+		prev_ix = ix;
+	}
+
+	return true;
+}
+
+static double
+hll_alpha(uint32_t n_regs)
+{
+	switch (n_regs) {
+	case 16:
+		return 0.673;
+	case 32:
+		return 0.697;
+	case 64:
+		return 0.709;
+	default:
+		return 0.7213 / (1.0 + (1.079 / n_regs));
+	}
+}
+
+static uint64_t
+hll_estimate_from_sum(uint8_t n_index_bits, double sum, uint32_t n_zero)
+{
+	double m = (double)hll_n_regs(n_index_bits);
+	double estimate = hll_alpha(hll_n_regs(n_index_bits)) * m * m / sum;
+
+	// Small range correction - linear counting. The 64-bit hash makes the
+	// large range correction unnecessary.
+	if (estimate <= 2.5 * m && n_zero != 0) {
+		estimate = m * log(m / n_zero);
+	}
+
+	return (uint64_t)(estimate + 0.5);
+}
+
+// Estimate directly from the packed value - no need to unpack for a count.
+static uint64_t
+hll_estimate(const hll_t *hll)
+{
+	uint32_t n_regs = hll_n_regs(hll->n_index_bits);
+	double sum = 0;
+	uint32_t n_zero = 0;
+
+	if (hll->encoding == HLL_ENCODING_DENSE) {
+		for (uint32_t ix = 0; ix < n_regs; ix++) {
+			uint8_t value = hll_dense_get(hll->data, ix);
+
+			sum += ldexp(1.0, -(int)value);
+			n_zero += value == 0 ? 1 : 0;
+		}
+	}
+	else {
+		n_zero = n_regs - hll->n_sparse;
+		sum = (double)n_zero;
+
+		for (uint32_t i = 0; i < hll->n_sparse; i++) {
+			sum += ldexp(1.0, -(int)(uint8_t)hll_sparse_get(hll->data, i));
+		}
+	}
+
+	return hll_estimate_from_sum(hll->n_index_bits, sum, n_zero);
+}
+
+static uint8_t
+hll_min_index_bits(const hll_t **hlls, uint32_t n_hlls, uint8_t n_index_bits)
+{
+	for (uint32_t i = 0; i < n_hlls; i++) {
+		if (hlls[i]->n_index_bits < n_index_bits) {
+			n_index_bits = hlls[i]->n_index_bits;
+		}
+	}
+
+	return n_index_bits;
+}
+
+
+//==========================================================
+// Local helpers - ops.
+//
+
+static bool
+hll_op_init(hll_op *op, const as_msg_op *msg_op)
+{
+	uint32_t sz = msg_op->op_sz - 4 - msg_op->name_sz;
+
+	op->pk.buffer = msg_op->name + msg_op->name_sz;
+	op->pk.length = sz;
+	op->pk.offset = 0;
+
+	int64_t ele_count = as_unpack_list_header_element_count(&op->pk);
+	uint64_t type64;
+
+	if (ele_count < 1 || as_unpack_uint64(&op->pk, &type64) != 0) {
+		cf_warning(AS_PARTICLE, "hll_op_init() unpack parameters failed: size=%u ele_count=%ld", sz, ele_count);
+		return false;
+	}
+
+	op->type = (hll_op_type)type64;
+	op->n_args = (uint32_t)ele_count - 1;
+
+	return true;
+}
+
+static bool
+hll_op_unpack_index_bits(hll_op *op, uint8_t *n_index_bits)
+{
+	int64_t value;
+
+	if (as_unpack_int64(&op->pk, &value) != 0) {
+		cf_warning(AS_PARTICLE, "hll op %u - invalid index bits", op->type);
+		return false;
+	}
+
+	if (value < HLL_MIN_INDEX_BITS || value > HLL_MAX_INDEX_BITS) {
+		cf_warning(AS_PARTICLE, "hll op %u - index bits %ld not in range %d-%d", op->type, value, HLL_MIN_INDEX_BITS, HLL_MAX_INDEX_BITS);
+		return false;
+	}
+
+	*n_index_bits = (uint8_t)value;
+
+	return true;
+}
+
+// Operand HLLs point into the op - no copies are made.
+static bool
+hll_op_unpack_hlls(hll_op *op, const hll_t **hlls, uint32_t *n_hlls)
+{
+	int64_t ele_count = as_unpack_list_header_element_count(&op->pk);
+
+	if (ele_count < 0 || ele_count > *n_hlls) {
+		cf_warning(AS_PARTICLE, "hll op %u - invalid operand list, count %ld max %u", op->type, ele_count, *n_hlls);
+		return false;
+	}
+
+	for (int64_t i = 0; i < ele_count; i++) {
+		int64_t blob_size = as_unpack_blob_size(&op->pk);
+
+		// Leading byte is the blob's as_bytes type.
+		if (blob_size < 1 || op->pk.offset + blob_size > op->pk.length) {
+			cf_warning(AS_PARTICLE, "hll op %u - invalid operand %ld", op->type, i);
+			return false;
+		}
+
+		const uint8_t *ptr = op->pk.buffer + op->pk.offset + 1;
+
+		op->pk.offset += (uint32_t)blob_size;
+
+		if (! hll_verify(ptr, (uint32_t)blob_size - 1)) {
+			cf_warning(AS_PARTICLE, "hll op %u - operand %ld not a valid hll", op->type, i);
+			return false;
+		}
+
+		hlls[i] = (const hll_t *)ptr;
+	}
+
+	*n_hlls = (uint32_t)ele_count;
+
+	return true;
+}
+
+static int
+hll_modify(as_bin *b, const hll_op *op_in, as_bin *result,
+		cf_ll_buf *particles_llb)
+{
+	hll_op op = *op_in;
+	bool exists = as_bin_inuse(b);
+
+	if (exists && as_bin_get_particle_type(b) != AS_PARTICLE_TYPE_HLL) {
+		cf_warning(AS_PARTICLE, "hll modify - bin is not hll");
+		return -AS_PROTO_RESULT_FAIL_INCOMPATIBLE_TYPE;
+	}
+
+	hll_regs hr;
+
+	switch (op.type) {
+	case HLL_OP_INIT: {
+		uint8_t n_index_bits;
+
+		if (op.n_args != 1 || ! hll_op_unpack_index_bits(&op, &n_index_bits)) {
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+
+		hll_regs_init(&hr, n_index_bits);
+		hll_regs_to_bin(&hr, b, particles_llb);
+		hll_regs_destroy(&hr);
+		break;
+	}
+	case HLL_OP_ADD: {
+		if (op.n_args < 1 || op.n_args > 2) {
+			cf_warning(AS_PARTICLE, "hll add - expected 1 or 2 args, got %u", op.n_args);
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+
+		int64_t ele_count = as_unpack_list_header_element_count(&op.pk);
+
+		if (ele_count < 0) {
+			cf_warning(AS_PARTICLE, "hll add - invalid value list");
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+
+		uint32_t values_offset = op.pk.offset;
+
+		for (int64_t i = 0; i < ele_count; i++) {
+			if (as_unpack_size(&op.pk) <= 0) {
+				cf_warning(AS_PARTICLE, "hll add - invalid value %ld", i);
+				return -AS_PROTO_RESULT_FAIL_PARAMETER;
+			}
+		}
+
+		uint8_t n_index_bits;
+
+		if (exists) {
+			n_index_bits = hll_from_bin(b)->n_index_bits;
+		}
+		else if (op.n_args != 2 || ! hll_op_unpack_index_bits(&op, &n_index_bits)) {
+			cf_warning(AS_PARTICLE, "hll add - need valid index bits to create");
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+
+		hll_regs_init(&hr, n_index_bits);
+
+		if (exists) {
+			hll_regs_merge(&hr, hll_from_bin(b));
+		}
+
+		as_unpacker pk_values = {
+				.buffer = op.pk.buffer,
+				.offset = values_offset,
+				.length = op.pk.length
+		};
+
+		uint32_t n_updated = 0;
+
+		for (int64_t i = 0; i < ele_count; i++) {
+			const uint8_t *value = pk_values.buffer + pk_values.offset;
+			int64_t value_sz = as_unpack_size(&pk_values);
+
+			n_updated += hll_regs_add(&hr, hll_hash(value, (uint32_t)value_sz));
+		}
+
+		// Leave an unchanged HLL in place - the caller treats this as a noop.
+		if (n_updated != 0 || ! exists) {
+			hll_regs_to_bin(&hr, b, particles_llb);
+		}
+
+		hll_regs_destroy(&hr);
+		as_bin_set_int(result, (int64_t)n_updated);
+		break;
+	}
+	case HLL_OP_SET_UNION: {
+		const hll_t *hlls[HLL_MAX_OPERANDS];
+		uint32_t n_hlls = HLL_MAX_OPERANDS;
+
+		if (op.n_args < 1 || op.n_args > 2 ||
+				! hll_op_unpack_hlls(&op, hlls, &n_hlls)) {
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+
+		uint8_t n_index_bits = HLL_MAX_INDEX_BITS;
+
+		if (exists) {
+			n_index_bits = hll_from_bin(b)->n_index_bits;
+		}
+		else if (op.n_args == 2 &&
+				! hll_op_unpack_index_bits(&op, &n_index_bits)) {
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+
+		n_index_bits = hll_min_index_bits(hlls, n_hlls, n_index_bits);
+		hll_regs_init(&hr, n_index_bits);
+
+		if (exists) {
+			hll_regs_merge(&hr, hll_from_bin(b));
+		}
+
+		for (uint32_t i = 0; i < n_hlls; i++) {
+			hll_regs_merge(&hr, hlls[i]);
+		}
+
+		hll_regs_to_bin(&hr, b, particles_llb);
+		hll_regs_destroy(&hr);
+		break;
+	}
+	default:
+		cf_warning(AS_PARTICLE, "hll modify - unknown op %u", op.type);
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	return AS_PROTO_RESULT_OK;
+}
+
+static int
+hll_read(const as_bin *b, const hll_op *op_in, as_bin *result)
+{
+	hll_op op = *op_in;
+
+	if (as_bin_get_particle_type(b) != AS_PARTICLE_TYPE_HLL) {
+		cf_warning(AS_PARTICLE, "hll read - bin is not hll");
+		return -AS_PROTO_RESULT_FAIL_INCOMPATIBLE_TYPE;
+	}
+
+	const hll_t *hll = hll_from_bin(b);
+
+	switch (op.type) {
+	case HLL_OP_COUNT:
+		as_bin_set_int(result, (int64_t)hll_estimate(hll));
+		break;
+	case HLL_OP_GET_UNION:
+	case HLL_OP_UNION_COUNT: {
+		const hll_t *hlls[HLL_MAX_OPERANDS];
+		uint32_t n_hlls = HLL_MAX_OPERANDS;
+
+		if (op.n_args != 1 || ! hll_op_unpack_hlls(&op, hlls, &n_hlls)) {
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+
+		hll_regs hr;
+
+		hll_regs_init(&hr, hll_min_index_bits(hlls, n_hlls, hll->n_index_bits));
+		hll_regs_merge(&hr, hll);
+
+		for (uint32_t i = 0; i < n_hlls; i++) {
+			hll_regs_merge(&hr, hlls[i]);
+		}
+
+		if (op.type == HLL_OP_GET_UNION) {
+			hll_regs_to_bin(&hr, result, NULL);
+		}
+		else {
+			as_bin_set_int(result, (int64_t)hll_regs_estimate(&hr));
+		}
+
+		hll_regs_destroy(&hr);
+		break;
+	}
+	case HLL_OP_INTERSECT_COUNT: {
+		const hll_t *sets[HLL_MAX_INTERSECT_SETS] = { hll };
+		uint32_t n_hlls = HLL_MAX_INTERSECT_SETS - 1;
+
+		if (op.n_args != 1 || ! hll_op_unpack_hlls(&op, sets + 1, &n_hlls)) {
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+
+		as_bin_set_int(result, hll_intersect_count(sets, n_hlls + 1));
+		break;
+	}
+	default:
+		cf_warning(AS_PARTICLE, "hll read - unknown op %u", op.type);
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	return AS_PROTO_RESULT_OK;
+}
+
+// Inclusion-exclusion - |A & B| = |A| + |B| - |A | B|, etc.
+static int64_t
+hll_intersect_count(const hll_t **sets, uint32_t n_sets)
+{
+	uint8_t n_index_bits = hll_min_index_bits(sets, n_sets, HLL_MAX_INDEX_BITS);
+	int64_t count = 0;
+	hll_regs hr;
+
+	hll_regs_init(&hr, n_index_bits);
+
+	for (uint32_t mask = 1; mask < (1U << n_sets); mask++) {
+		memset(hr.regs, 0, hll_n_regs(n_index_bits));
+
+		for (uint32_t i = 0; i < n_sets; i++) {
+			if ((mask & (1U << i)) != 0) {
+				hll_regs_merge(&hr, sets[i]);
+			}
+		}
+
+		int64_t estimate = (int64_t)hll_regs_estimate(&hr);
+
+		count += (cf_bit_count64(mask) & 1) != 0 ? estimate : -estimate;
+	}
+
+	hll_regs_destroy(&hr);
+
+	return count < 0 ? 0 : count;
+}
+
+
+//==========================================================
+// Local helpers - unpacked registers.
+//
+
+static void
+hll_regs_init(hll_regs *hr, uint8_t n_index_bits)
+{
+	hr->n_index_bits = n_index_bits;
+	hr->regs = cf_calloc(hll_n_regs(n_index_bits), 1);
+}
+
+static void
+hll_regs_destroy(hll_regs *hr)
+{
+	cf_free(hr->regs);
+}
+
+static inline void
+hll_regs_merge_one(hll_regs *hr, uint8_t n_index_bits, uint32_t ix,
+		uint8_t value)
+{
+	uint8_t shift = n_index_bits - hr->n_index_bits;
+
+	// Fold - the index bits we drop become the leading bits of the register
+	// value's bit pattern.
+	if (shift != 0) {
+		uint32_t dropped = ix & ((1U << shift) - 1);
+
+		value = dropped != 0 ?
+				(uint8_t)(shift - (31 - __builtin_clz(dropped))) :
+				(uint8_t)(shift + value);
+		ix >>= shift;
+	}
+
+	if (value > hr->regs[ix]) {
+		hr->regs[ix] = value;
+	}
+}
+
+// Caller ensures hll has at least as many index bits as hr.
+static void
+hll_regs_merge(hll_regs *hr, const hll_t *hll)
+{
+	if (hll->encoding == HLL_ENCODING_DENSE) {
+		uint32_t n_regs = hll_n_regs(hll->n_index_bits);
+
+		for (uint32_t ix = 0; ix < n_regs; ix++) {
+			uint8_t value = hll_dense_get(hll->data, ix);
+
+			if (value != 0) {
+				hll_regs_merge_one(hr, hll->n_index_bits, ix, value);
+			}
+		}
+
+		return;
+	}
+
+	for (uint32_t i = 0; i < hll->n_sparse; i++) {
+		uint32_t entry = hll_sparse_get(hll->data, i);
+
+		hll_regs_merge_one(hr, hll->n_index_bits, entry >> 8, (uint8_t)entry);
+	}
+}
+
+// Returns 1 if a register was updated, 0 otherwise.
+static uint32_t
+hll_regs_add(hll_regs *hr, uint64_t hash)
+{
+	uint8_t n_index_bits = hr->n_index_bits;
+	uint32_t ix = (uint32_t)(hash >> (64 - n_index_bits));
+	uint32_t value = cf_msb64(hash << n_index_bits) + 1;
+	uint8_t max_value = hll_max_reg_value(n_index_bits);
+
+	if (value > max_value) {
+		value = max_value;
+	}
+
+	if (value <= hr->regs[ix]) {
+		return 0;
+	}
+
+	hr->regs[ix] = (uint8_t)value;
+
+	return 1;
+}
+
+static uint64_t
+hll_regs_estimate(const hll_regs *hr)
+{
+	uint32_t n_regs = hll_n_regs(hr->n_index_bits);
+	double sum = 0;
+	uint32_t n_zero = 0;
+
+	for (uint32_t ix = 0; ix < n_regs; ix++) {
+		sum += ldexp(1.0, -(int)hr->regs[ix]);
+		n_zero += hr->regs[ix] == 0 ? 1 : 0;
+	}
+
+	return hll_estimate_from_sum(hr->n_index_bits, sum, n_zero);
+}
+
+static uint32_t
+hll_regs_packed_sz(const hll_regs *hr, uint32_t *n_set)
+{
+	uint32_t n_regs = hll_n_regs(hr->n_index_bits);
+	uint32_t n = 0;
+
+	for (uint32_t ix = 0; ix < n_regs; ix++) {
+		n += hr->regs[ix] != 0 ? 1 : 0;
+	}
+
+	*n_set = n;
+
+	uint32_t sparse_sz = n * sizeof(uint32_t);
+	uint32_t dense_sz = hll_dense_data_sz(hr->n_index_bits);
+
+	return sizeof(hll_t) + (sparse_sz <= dense_sz ? sparse_sz : dense_sz);
+}
+
+static void
+hll_regs_pack(const hll_regs *hr, uint32_t n_set, hll_t *hll)
+{
+	uint32_t n_regs = hll_n_regs(hr->n_index_bits);
+	uint32_t dense_sz = hll_dense_data_sz(hr->n_index_bits);
+
+	hll->n_index_bits = hr->n_index_bits;
+
+	if (n_set * sizeof(uint32_t) > dense_sz) {
+		hll->encoding = HLL_ENCODING_DENSE;
+		hll->n_sparse = 0;
+		memset(hll->data, 0, dense_sz);
+
+		for (uint32_t ix = 0; ix < n_regs; ix++) {
+			if (hr->regs[ix] != 0) {
+				hll_dense_set(hll->data, ix, hr->regs[ix]);
+			}
+		}
+
+		return;
+	}
+
+	hll->encoding = HLL_ENCODING_SPARSE;
+	hll->n_sparse = (uint16_t)n_set;
+
+	uint8_t *at = hll->data;
+
+	for (uint32_t ix = 0; ix < n_regs; ix++) {
+		if (hr->regs[ix] != 0) {
+			uint32_t entry = (ix << 8) | hr->regs[ix];
+
+			memcpy(at, &entry, sizeof(uint32_t));
+			at += sizeof(uint32_t);
+		}
+	}
+}
+
+// Never modifies a bin's existing particle in place - the caller may still be
+// holding it for cleanup or rollback.
+static void
+hll_regs_to_bin(const hll_regs *hr, as_bin *b, cf_ll_buf *particles_llb)
+{
+	uint32_t n_set;
+	uint32_t data_sz = hll_regs_packed_sz(hr, &n_set);
+	size_t mem_sz = sizeof(hll_mem) + data_sz;
+	hll_mem *p_hll_mem;
+
+	if (particles_llb) {
+		cf_ll_buf_reserve(particles_llb, mem_sz, (uint8_t **)&p_hll_mem);
+	}
+	else {
+		p_hll_mem = cf_malloc_ns(mem_sz);
+	}
+
+	p_hll_mem->type = AS_PARTICLE_TYPE_HLL;
+	p_hll_mem->sz = data_sz;
+	hll_regs_pack(hr, n_set, (hll_t *)p_hll_mem->data);
+
+	b->particle = (as_particle *)p_hll_mem;
+	as_bin_state_set_from_type(b, AS_PARTICLE_TYPE_HLL);
+}
+
+
+//==========================================================
+// Local helpers - hashing.
+//
+
+// MurmurHash64A, seed 0. Values are hashed in their msgpack form, so equal
+// values of different types (e.g. 1 and "1") count as distinct.
+static uint64_t
+hll_hash(const uint8_t *buf, uint32_t sz)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ULL;
+	const int r = 47;
+
+	uint64_t h = sz * m;
+	const uint8_t *end = buf + (sz & ~7U);
+
+	while (buf != end) {
+		uint64_t k;
+
+		memcpy(&k, buf, sizeof(k));
+		buf += sizeof(k);
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	switch (sz & 7) {
+	case 7: h ^= (uint64_t)buf[6] << 48; // no break
+	case 6: h ^= (uint64_t)buf[5] << 40; // no break
+	case 5: h ^= (uint64_t)buf[4] << 32; // no break
+	case 4: h ^= (uint64_t)buf[3] << 24; // no break
+	case 3: h ^= (uint64_t)buf[2] << 16; // no break
+	case 2: h ^= (uint64_t)buf[1] << 8; // no break
+	case 1: h ^= (uint64_t)buf[0];
+		h *= m;
+	default:
+		break;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+
+	return h;
+}
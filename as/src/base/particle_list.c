@@ -1077,11 +1077,7 @@ packed_list_find_idx_offset(const packed_list *list, uint32_t index)
 		return offset_index_get_const(&list->full_offidx, index);
 	}
 
-	as_unpacker pk = {
-			.buffer = list->contents,
-			.length = list->content_sz
-	};
-
+	uint32_t offset = 0;
 	uint32_t steps = index;
 
 	if (offset_index_is_valid(&list->offidx)) {
@@ -1093,7 +1089,7 @@ packed_list_find_idx_offset(const packed_list *list, uint32_t index)
 			idx = filled - 1;
 		}
 
-		pk.offset = offset_index_get_const(&list->offidx, idx);
+		offset = offset_index_get_const(&list->offidx, idx);
 		steps -= idx * PACKED_LIST_INDEX_STEP;
 
 		offset_index *offidx = (offset_index *)&list->offidx; // mutable struct variable
@@ -1102,24 +1098,21 @@ packed_list_find_idx_offset(const packed_list *list, uint32_t index)
 		steps %= PACKED_LIST_INDEX_STEP;
 
 		for (uint32_t i = 0; i < blocks; i++) {
-			for (uint32_t j = 0; j < PACKED_LIST_INDEX_STEP; j++) {
-				if (as_unpack_size(&pk) <= 0) {
-					return 0;
-				}
+			if (! cdt_msgpack_skip(list->contents, list->content_sz, &offset,
+					PACKED_LIST_INDEX_STEP)) {
+				return 0;
 			}
 
 			idx++;
-			offset_index_set_next(offidx, idx, pk.offset);
+			offset_index_set_next(offidx, idx, offset);
 		}
 	}
 
-	for (uint32_t i = 0; i < steps; i++) {
-		if (as_unpack_size(&pk) <= 0) {
-			return 0;
-		}
+	if (! cdt_msgpack_skip(list->contents, list->content_sz, &offset, steps)) {
+		return 0;
 	}
 
-	return pk.offset;
+	return offset;
 }
 
 static uint32_t
@@ -4092,18 +4085,10 @@ list_full_offset_index_fill_to(offset_index *offidx, uint32_t index)
 		return true;
 	}
 
-	as_unpacker pk = {
-			.buffer = offidx->contents,
-			.offset = offset_index_get_const(offidx, start - 1),
-			.length = offidx->content_sz
-	};
-
-	for (uint32_t i = start; i < index; i++) {
-		if (as_unpack_size(&pk) <= 0) {
-			return false;
-		}
+	uint32_t offset = offset_index_get_const(offidx, start - 1);
 
-		offset_index_set(offidx, i, pk.offset);
+	if (! offset_index_fill_scan(offidx, start, index, 1, &offset)) {
+		return false;
 	}
 
 	offset_index_set_filled(offidx, index);
@@ -5693,46 +5693,34 @@ map_offset_index_fill(offset_index *offidx, uint32_t index)
 		return true;
 	}
 
-	as_unpacker pk = {
-			.buffer = offidx->contents,
-			.length = offidx->content_sz
-	};
-
-	pk.offset = offset_index_get_const(offidx, ele_filled - 1);
+	uint32_t offset = offset_index_get_const(offidx, ele_filled - 1);
 
-	for (uint32_t i = ele_filled; i < index; i++) {
-		if (as_unpack_size(&pk) <= 0) {
-			return false;
-		}
-
-		if (as_unpack_size(&pk) <= 0) {
+	// Make sure last iteration is in range for set.
+	if (index < offidx->_.ele_count) {
+		if (! offset_index_fill_scan(offidx, ele_filled, index + 1, 2,
+				&offset)) {
 			return false;
 		}
 
-		offset_index_set(offidx, i, pk.offset);
-	}
+		offset_index_set_filled(offidx, index + 1);
 
-	if (as_unpack_size(&pk) <= 0) {
-		return false;
+		return true;
 	}
 
-	if (as_unpack_size(&pk) <= 0) {
+	if (! offset_index_fill_scan(offidx, ele_filled, offidx->_.ele_count, 2,
+			&offset) ||
+			! cdt_msgpack_skip(offidx->contents, offidx->content_sz, &offset,
+					2)) {
 		return false;
 	}
 
-	// Make sure last iteration is in range for set.
-	if (index < offidx->_.ele_count) {
-		offset_index_set(offidx, index, pk.offset);
-		offset_index_set_filled(offidx, index + 1);
-	}
 	// Check if sizes match.
-	else if (pk.offset != offidx->content_sz) {
-		cf_warning(AS_PARTICLE, "map_offset_index_fill() offset mismatch %u, expected %u", pk.offset, offidx->content_sz);
+	if (offset != offidx->content_sz) {
+		cf_warning(AS_PARTICLE, "map_offset_index_fill() offset mismatch %u, expected %u", offset, offidx->content_sz);
 		return false;
 	}
-	else {
-		offset_index_set_filled(offidx, offidx->_.ele_count);
-	}
+
+	offset_index_set_filled(offidx, offidx->_.ele_count);
 
 	return true;
 }
@@ -0,0 +1,1348 @@
+/*
+ * particle_timeseries.c
+ *
+ * Copyright (C) 2018 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "aerospike/as_double.h"
+#include "aerospike/as_integer.h"
+#include "aerospike/as_msgpack.h"
+#include "aerospike/as_val.h"
+#include "citrusleaf/alloc.h"
+
+#include "bits.h"
+#include "dynbuf.h"
+#include "fault.h"
+
+#include "base/cdt.h"
+#include "base/datamodel.h"
+#include "base/particle.h"
+#include "base/particle_blob.h"
+#include "base/proto.h"
+
+
+//==========================================================
+// TIMESERIES particle interface - function declarations.
+//
+
+// Most TIMESERIES particle table functions just use the equivalent BLOB
+// particle functions - a time series is a blob whose contents are validated
+// and which can't be concatenated. Here are the differences...
+
+// Handle "wire" format.
+int32_t timeseries_concat_size_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp);
+int timeseries_append_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp);
+int timeseries_prepend_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp);
+int32_t timeseries_size_from_wire(const uint8_t *wire_value, uint32_t value_size);
+
+// Handle on-device "flat" format.
+int32_t timeseries_size_from_flat(const uint8_t *flat, uint32_t flat_size);
+int timeseries_cast_from_flat(uint8_t *flat, uint32_t flat_size, as_particle **pp);
+int timeseries_from_flat(const uint8_t *flat, uint32_t flat_size, as_particle **pp);
+
+
+//==========================================================
+// TIMESERIES particle interface - vtable.
+//
+
+const as_particle_vtable timeseries_vtable = {
+		blob_destruct,
+		blob_size,
+
+		timeseries_concat_size_from_wire,
+		timeseries_append_from_wire,
+		timeseries_prepend_from_wire,
+		blob_incr_from_wire,
+		timeseries_size_from_wire,
+		blob_from_wire,
+		blob_compare_from_wire,
+		blob_wire_size,
+		blob_to_wire,
+
+		blob_size_from_asval,
+		blob_from_asval,
+		blob_to_asval,
+		blob_asval_wire_size,
+		blob_asval_to_wire,
+
+		blob_size_from_msgpack,
+		blob_from_msgpack,
+
+		timeseries_size_from_flat,
+		timeseries_cast_from_flat,
+		timeseries_from_flat,
+		blob_flat_size,
+		blob_to_flat
+};
+
+
+//==========================================================
+// Typedefs & constants.
+//
+
+// Op payload is msgpack [op, args...]:
+//   APPEND     [0, [[ts, value], ...]]                 - ts must increase
+//   TRIM       [1, before-ts]                          - returns # removed
+//   RANGE      [50, start-ts, end-ts]                  - returns [[ts, value], ...]
+//   AGGREGATE  [51, start-ts, end-ts, agg, bucket-ms]  - returns value, or
+//                                 [[bucket-ts, value], ...] if bucket-ms > 0
+// Ranges include start-ts and exclude end-ts. Values are stored as doubles.
+typedef enum {
+	TS_OP_APPEND = 0,
+	TS_OP_TRIM = 1,
+
+	TS_OP_RANGE = 50,
+	TS_OP_AGGREGATE = 51
+} ts_op_type;
+
+typedef enum {
+	TS_AGG_COUNT = 0,
+	TS_AGG_SUM = 1,
+	TS_AGG_MIN = 2,
+	TS_AGG_MAX = 3,
+	TS_AGG_AVG = 4,
+	TS_AGG_FIRST = 5,
+	TS_AGG_LAST = 6
+} ts_agg_type;
+
+// Bounds decode work for range reads and trims that split a block.
+#define TS_BLOCK_MAX_SAMPLES 256
+
+// Worst case encoding of a sample after the first in a block - 4 + 64 bits
+// for the delta-of-delta, 2 + 6 + 6 + 64 bits for the value XOR.
+#define TS_MAX_SAMPLE_BYTES 19
+
+#define TS_NO_WINDOW 0xff
+
+// Same layout as blob_mem, so BLOB particle table functions can be used.
+typedef struct ts_mem_s {
+	uint8_t		type;
+	uint32_t	sz;
+	uint8_t		data[];
+} __attribute__ ((__packed__)) ts_mem;
+
+typedef ts_mem ts_flat;
+
+// Each block starts with a raw 64-bit value (first_ts is in the header), then
+// per sample a delta-of-delta timestamp and a value XOR'd with the previous,
+// as in Facebook's Gorilla. Bits are MSB first, multi-byte fields host order.
+typedef struct ts_block_s {
+	int64_t		first_ts;
+	int64_t		last_ts;
+	uint16_t	n_samples;
+	uint32_t	n_bytes;
+	uint8_t		data[];
+} __attribute__ ((__packed__)) ts_block;
+
+// The encoder state after the last sample is kept here, so appends don't have
+// to decode the last block.
+typedef struct ts_s {
+	uint32_t	n_samples;
+	uint32_t	n_blocks;
+	uint32_t	last_block_offset; // from start of blocks
+	uint32_t	tail_bits; // bits used in last block
+	int64_t		last_delta;
+	uint64_t	last_value; // double bits
+	uint8_t		last_leading; // TS_NO_WINDOW if none
+	uint8_t		last_trailing;
+	uint8_t		blocks[];
+} __attribute__ ((__packed__)) ts_t;
+
+typedef struct ts_encoder_s {
+	uint8_t		*blocks;
+	uint32_t	n_blocks;
+	uint32_t	n_samples;
+	uint32_t	end; // offset past last block
+	ts_block	*block; // last block, NULL if none
+	uint32_t	n_bits;
+	int64_t		delta;
+	uint64_t	value;
+	uint8_t		leading;
+	uint8_t		trailing;
+} ts_encoder;
+
+typedef struct ts_decoder_s {
+	const ts_block *block;
+	uint32_t	n_bits;
+	uint32_t	pos;
+	uint32_t	ix;
+	int64_t		ts;
+	int64_t		delta;
+	uint64_t	value;
+	uint8_t		leading;
+	uint8_t		trailing;
+} ts_decoder;
+
+typedef struct ts_sample_s {
+	int64_t		ts;
+	double		value;
+} ts_sample;
+
+typedef struct ts_op_s {
+	as_unpacker pk;
+	ts_op_type type;
+	uint32_t n_args;
+} ts_op;
+
+
+//==========================================================
+// Forward declarations.
+//
+
+static bool ts_verify(const uint8_t *buf, uint32_t sz);
+
+static bool ts_op_init(ts_op *op, const as_msg_op *msg_op);
+static bool ts_op_unpack_int(ts_op *op, int64_t *value);
+
+static int ts_modify(as_bin *b, const ts_op *op, as_bin *result, cf_ll_buf *particles_llb);
+static int ts_append(as_bin *b, ts_op *op, cf_ll_buf *particles_llb);
+static int ts_trim(as_bin *b, ts_op *op, as_bin *result, cf_ll_buf *particles_llb);
+static int ts_read(const as_bin *b, const ts_op *op, as_bin *result);
+static int ts_aggregate(const ts_sample *samples, uint32_t n_samples, int64_t start, int64_t bucket_ms, ts_agg_type agg, as_bin *result);
+static int ts_collect(const ts_t *ts, int64_t start, int64_t end, ts_sample **samples_r, uint32_t *n_samples_r);
+
+static void ts_encoder_init(ts_encoder *e, uint8_t *blocks, const ts_t *from, uint32_t blocks_sz);
+static void ts_encoder_add(ts_encoder *e, int64_t ts, uint64_t value);
+static uint32_t ts_encoder_finish(const ts_encoder *e, ts_t *ts);
+
+static void ts_decoder_init(ts_decoder *d, const ts_block *block);
+static bool ts_decoder_next(ts_decoder *d, int64_t *ts_r, uint64_t *value_r);
+
+static void ts_to_bin(const uint8_t *data, uint32_t data_sz, as_bin *b, cf_ll_buf *particles_llb);
+static void ts_result_list_start(cdt_container_builder *builder, uint32_t n_pairs);
+static void ts_result_list_add(cdt_container_builder *builder, int64_t ts, const as_val *val);
+
+
+//==========================================================
+// Inlines & macros.
+//
+
+static inline const ts_t *
+ts_from_bin(const as_bin *b)
+{
+	return (const ts_t *)((const ts_mem *)b->particle)->data;
+}
+
+static inline uint32_t
+ts_sz_from_bin(const as_bin *b)
+{
+	return ((const ts_mem *)b->particle)->sz;
+}
+
+static inline const ts_block *
+ts_block_at(const uint8_t *blocks, uint32_t offset)
+{
+	return (const ts_block *)(blocks + offset);
+}
+
+static inline uint32_t
+ts_block_sz(const ts_block *block)
+{
+	return (uint32_t)sizeof(ts_block) + block->n_bytes;
+}
+
+static inline uint64_t
+ts_double_to_bits(double value)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+
+	return bits;
+}
+
+static inline double
+ts_bits_to_double(uint64_t bits)
+{
+	double value;
+
+	memcpy(&value, &bits, sizeof(value));
+
+	return value;
+}
+
+
+//==========================================================
+// TIMESERIES particle interface - function definitions.
+//
+
+//------------------------------------------------
+// Handle "wire" format.
+//
+
+int32_t
+timeseries_concat_size_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp)
+{
+	cf_warning(AS_PARTICLE, "invalid operation on timeseries particle");
+	return -AS_PROTO_RESULT_FAIL_INCOMPATIBLE_TYPE;
+}
+
+int
+timeseries_append_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp)
+{
+	cf_warning(AS_PARTICLE, "invalid operation on timeseries particle");
+	return -AS_PROTO_RESULT_FAIL_INCOMPATIBLE_TYPE;
+}
+
+int
+timeseries_prepend_from_wire(as_particle_type wire_type, const uint8_t *wire_value, uint32_t value_size, as_particle **pp)
+{
+	cf_warning(AS_PARTICLE, "invalid operation on timeseries particle");
+	return -AS_PROTO_RESULT_FAIL_INCOMPATIBLE_TYPE;
+}
+
+int32_t
+timeseries_size_from_wire(const uint8_t *wire_value, uint32_t value_size)
+{
+	if (! ts_verify(wire_value, value_size)) {
+		cf_warning(AS_PARTICLE, "invalid wire timeseries");
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	return blob_size_from_wire(wire_value, value_size);
+}
+
+//------------------------------------------------
+// Handle on-device "flat" format.
+//
+
+int32_t
+timeseries_size_from_flat(const uint8_t *flat, uint32_t flat_size)
+{
+	int32_t mem_size = blob_size_from_flat(flat, flat_size);
+
+	if (mem_size < 0) {
+		return mem_size;
+	}
+
+	const ts_flat *p_ts_flat = (const ts_flat *)flat;
+
+	if (! ts_verify(p_ts_flat->data, p_ts_flat->sz)) {
+		cf_warning(AS_PARTICLE, "invalid flat timeseries");
+		return -AS_PROTO_RESULT_FAIL_UNKNOWN;
+	}
+
+	return mem_size;
+}
+
+int
+timeseries_cast_from_flat(uint8_t *flat, uint32_t flat_size, as_particle **pp)
+{
+	int32_t mem_size = timeseries_size_from_flat(flat, flat_size);
+
+	if (mem_size < 0) {
+		return mem_size;
+	}
+
+	return blob_cast_from_flat(flat, flat_size, pp);
+}
+
+int
+timeseries_from_flat(const uint8_t *flat, uint32_t flat_size, as_particle **pp)
+{
+	int32_t mem_size = timeseries_size_from_flat(flat, flat_size);
+
+	if (mem_size < 0) {
+		return mem_size;
+	}
+
+	return blob_from_flat(flat, flat_size, pp);
+}
+
+
+//==========================================================
+// as_bin particle functions specific to TIMESERIES.
+//
+
+int
+as_bin_timeseries_read_from_client(const as_bin *b, as_msg_op *op, as_bin *result)
+{
+	ts_op top;
+
+	if (! ts_op_init(&top, op)) {
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	return ts_read(b, &top, result);
+}
+
+int
+as_bin_timeseries_alloc_modify_from_client(as_bin *b, as_msg_op *op, as_bin *result)
+{
+	ts_op top;
+
+	if (! ts_op_init(&top, op)) {
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	return ts_modify(b, &top, result, NULL);
+}
+
+int
+as_bin_timeseries_stack_modify_from_client(as_bin *b, cf_ll_buf *particles_llb, as_msg_op *op, as_bin *result)
+{
+	ts_op top;
+
+	if (! ts_op_init(&top, op)) {
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	return ts_modify(b, &top, result, particles_llb);
+}
+
+
+//==========================================================
+// Local helpers - validation.
+//
+
+static bool
+ts_verify(const uint8_t *buf, uint32_t sz)
+{
+	if (sz < sizeof(ts_t)) {
+		return false;
+	}
+
+	const ts_t *ts = (const ts_t *)buf;
+	uint64_t blocks_sz = sz - sizeof(ts_t);
+	uint64_t offset = 0;
+	uint64_t last_offset = 0;
+	uint64_t n_samples = 0;
+	int64_t prev_last_ts = 0;
+
+	for (uint32_t i = 0; i < ts->n_blocks; i++) {
+		if (offset + sizeof(ts_block) > blocks_sz) {
+			return false;
+		}
+
+		const ts_block *block = ts_block_at(ts->blocks, (uint32_t)offset);
+
+		if (block->n_samples == 0 || block->n_samples > TS_BLOCK_MAX_SAMPLES ||
+				block->first_ts > block->last_ts ||
+				(i != 0 && block->first_ts <= prev_last_ts)) {
+			return false;
+		}
+
+		prev_last_ts = block->last_ts;
+		n_samples += block->n_samples;
+		last_offset = offset;
+		offset += sizeof(ts_block) + (uint64_t)block->n_bytes;
+	}
+
+	if (offset != blocks_sz || n_samples != ts->n_samples) {
+		return false;
+	}
+
+	if (ts->n_blocks == 0) {
+		return true;
+	}
+
+	if (ts->last_leading != TS_NO_WINDOW &&
+			ts->last_leading + ts->last_trailing >= 64) {
+		return false;
+	}
+
+	const ts_block *last = ts_block_at(ts->blocks, (uint32_t)last_offset);
+
+	return last_offset == ts->last_block_offset &&
+			(ts->tail_bits + 7) / 8 == last->n_bytes;
+}
+
+
+//==========================================================
+// Local helpers - ops.
+//
+
+static bool
+ts_op_init(ts_op *op, const as_msg_op *msg_op)
+{
+	uint32_t sz = msg_op->op_sz - 4 - msg_op->name_sz;
+
+	op->pk.buffer = msg_op->name + msg_op->name_sz;
+	op->pk.length = sz;
+	op->pk.offset = 0;
+
+	int64_t ele_count = as_unpack_list_header_element_count(&op->pk);
+	uint64_t type64;
+
+	if (ele_count < 1 || as_unpack_uint64(&op->pk, &type64) != 0) {
+		cf_warning(AS_PARTICLE, "ts_op_init() unpack parameters failed: size=%u ele_count=%ld", sz, ele_count);
+		return false;
+	}
+
+	op->type = (ts_op_type)type64;
+	op->n_args = (uint32_t)ele_count - 1;
+
+	return true;
+}
+
+static bool
+ts_op_unpack_int(ts_op *op, int64_t *value)
+{
+	if (as_unpack_int64(&op->pk, value) != 0) {
+		cf_warning(AS_PARTICLE, "timeseries op %u - invalid integer arg", op->type);
+		return false;
+	}
+
+	return true;
+}
+
+static int
+ts_modify(as_bin *b, const ts_op *op_in, as_bin *result,
+		cf_ll_buf *particles_llb)
+{
+	ts_op op = *op_in;
+
+	if (as_bin_inuse(b) &&
+			as_bin_get_particle_type(b) != AS_PARTICLE_TYPE_TIMESERIES) {
+		cf_warning(AS_PARTICLE, "timeseries modify - bin is not timeseries");
+		return -AS_PROTO_RESULT_FAIL_INCOMPATIBLE_TYPE;
+	}
+
+	switch (op.type) {
+	case TS_OP_APPEND:
+		return ts_append(b, &op, particles_llb);
+	case TS_OP_TRIM:
+		return ts_trim(b, &op, result, particles_llb);
+	default:
+		cf_warning(AS_PARTICLE, "timeseries modify - unknown op %u", op.type);
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+}
+
+static int
+ts_append(as_bin *b, ts_op *op, cf_ll_buf *particles_llb)
+{
+	int64_t ele_count;
+
+	if (op->n_args != 1 ||
+			(ele_count = as_unpack_list_header_element_count(&op->pk)) < 0) {
+		cf_warning(AS_PARTICLE, "timeseries append - expected sample list");
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	if (ele_count == 0) {
+		return AS_PROTO_RESULT_OK;
+	}
+
+	// Each sample packs to at least 3 bytes - don't trust the header count.
+	if (ele_count * 3 > op->pk.length - op->pk.offset) {
+		cf_warning(AS_PARTICLE, "timeseries append - sample count %ld exceeds op size", ele_count);
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	const ts_t *old = as_bin_inuse(b) ? ts_from_bin(b) : NULL;
+	int64_t prev_ts = INT64_MIN;
+
+	if (old && old->n_blocks != 0) {
+		prev_ts = ts_block_at(old->blocks, old->last_block_offset)->last_ts;
+	}
+
+	ts_sample *samples = cf_malloc(ele_count * sizeof(ts_sample));
+
+	for (int64_t i = 0; i < ele_count; i++) {
+		ts_sample *s = &samples[i];
+
+		if (as_unpack_list_header_element_count(&op->pk) != 2 ||
+				as_unpack_int64(&op->pk, &s->ts) != 0) {
+			cf_warning(AS_PARTICLE, "timeseries append - invalid sample %ld", i);
+			cf_free(samples);
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+
+		if (s->ts <= prev_ts) {
+			cf_warning(AS_PARTICLE, "timeseries append - sample %ld ts %ld not after %ld", i, s->ts, prev_ts);
+			cf_free(samples);
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+
+		prev_ts = s->ts;
+
+		as_val_t type = as_unpack_peek_type(&op->pk);
+		int64_t value_int;
+
+		if (type == AS_INTEGER && as_unpack_int64(&op->pk, &value_int) == 0) {
+			s->value = (double)value_int;
+		}
+		else if (type != AS_DOUBLE ||
+				as_unpack_double(&op->pk, &s->value) != 0) {
+			cf_warning(AS_PARTICLE, "timeseries append - sample %ld value not numeric", i);
+			cf_free(samples);
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+	}
+
+	uint32_t old_blocks_sz = old ? ts_sz_from_bin(b) - (uint32_t)sizeof(ts_t) : 0;
+	uint32_t max_new_blocks = (uint32_t)ele_count / TS_BLOCK_MAX_SAMPLES + 1;
+	size_t max_sz = sizeof(ts_t) + old_blocks_sz +
+			(ele_count * TS_MAX_SAMPLE_BYTES) +
+			(max_new_blocks * (sizeof(ts_block) + 1));
+	uint8_t *data = cf_malloc(max_sz);
+
+	if (old) {
+		memcpy(data, old, sizeof(ts_t) + old_blocks_sz);
+	}
+
+	ts_t *ts = (ts_t *)data;
+	ts_encoder e;
+
+	ts_encoder_init(&e, ts->blocks, old, old_blocks_sz);
+
+	for (int64_t i = 0; i < ele_count; i++) {
+		ts_encoder_add(&e, samples[i].ts, ts_double_to_bits(samples[i].value));
+	}
+
+	cf_free(samples);
+
+	ts_to_bin(data, ts_encoder_finish(&e, ts), b, particles_llb);
+	cf_free(data);
+
+	return AS_PROTO_RESULT_OK;
+}
+
+static int
+ts_trim(as_bin *b, ts_op *op, as_bin *result, cf_ll_buf *particles_llb)
+{
+	int64_t before_ts;
+
+	if (op->n_args != 1 || ! ts_op_unpack_int(op, &before_ts)) {
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	if (! as_bin_inuse(b)) {
+		as_bin_set_int(result, 0);
+		return AS_PROTO_RESULT_OK;
+	}
+
+	const ts_t *old = ts_from_bin(b);
+	uint32_t old_blocks_sz = ts_sz_from_bin(b) - (uint32_t)sizeof(ts_t);
+	uint32_t offset = 0;
+	uint32_t i = 0;
+
+	// Find the first block with samples to keep.
+	while (i < old->n_blocks &&
+			ts_block_at(old->blocks, offset)->last_ts < before_ts) {
+		offset += ts_block_sz(ts_block_at(old->blocks, offset));
+		i++;
+	}
+
+	const ts_block *split = i < old->n_blocks ?
+			ts_block_at(old->blocks, offset) : NULL;
+
+	if (i == 0 && split && split->first_ts >= before_ts) {
+		as_bin_set_int(result, 0);
+		return AS_PROTO_RESULT_OK; // noop
+	}
+
+	// Re-encoding the kept part of a split block may cost one extra block
+	// header and a couple of samples' worth of bits.
+	uint8_t *data = cf_malloc(sizeof(ts_t) + old_blocks_sz + sizeof(ts_block) +
+			(2 * TS_MAX_SAMPLE_BYTES));
+	ts_t *ts = (ts_t *)data;
+	ts_encoder e;
+
+	ts_encoder_init(&e, ts->blocks, NULL, 0);
+
+	if (split && split->first_ts < before_ts) {
+		ts_decoder d;
+		int64_t sample_ts;
+		uint64_t value;
+
+		ts_decoder_init(&d, split);
+
+		for (uint32_t s = 0; s < split->n_samples; s++) {
+			if (! ts_decoder_next(&d, &sample_ts, &value)) {
+				cf_warning(AS_PARTICLE, "timeseries trim - corrupt block");
+				cf_free(data);
+				return -AS_PROTO_RESULT_FAIL_UNKNOWN;
+			}
+
+			if (sample_ts >= before_ts) {
+				ts_encoder_add(&e, sample_ts, value);
+			}
+		}
+
+		offset += ts_block_sz(split);
+		i++;
+	}
+
+	uint32_t data_sz = ts_encoder_finish(&e, ts);
+
+	// Blocks after the split one are copied as-is, including the last one -
+	// so the tail encoder state carries over.
+	if (i < old->n_blocks) {
+		uint32_t rest_sz = old_blocks_sz - offset;
+		uint32_t n_rest_samples = old->n_samples;
+
+		for (uint32_t o = 0; o < offset; ) {
+			const ts_block *block = ts_block_at(old->blocks, o);
+
+			n_rest_samples -= block->n_samples;
+			o += ts_block_sz(block);
+		}
+
+		memcpy(ts->blocks + e.end, old->blocks + offset, rest_sz);
+
+		ts->n_samples = e.n_samples + n_rest_samples;
+		ts->n_blocks = e.n_blocks + (old->n_blocks - i);
+		ts->last_block_offset = e.end + (old->last_block_offset - offset);
+		ts->tail_bits = old->tail_bits;
+		ts->last_delta = old->last_delta;
+		ts->last_value = old->last_value;
+		ts->last_leading = old->last_leading;
+		ts->last_trailing = old->last_trailing;
+
+		data_sz += rest_sz;
+	}
+
+	as_bin_set_int(result, (int64_t)(old->n_samples - ts->n_samples));
+	ts_to_bin(data, data_sz, b, particles_llb);
+	cf_free(data);
+
+	return AS_PROTO_RESULT_OK;
+}
+
+static int
+ts_read(const as_bin *b, const ts_op *op_in, as_bin *result)
+{
+	ts_op op = *op_in;
+
+	if (as_bin_get_particle_type(b) != AS_PARTICLE_TYPE_TIMESERIES) {
+		cf_warning(AS_PARTICLE, "timeseries read - bin is not timeseries");
+		return -AS_PROTO_RESULT_FAIL_INCOMPATIBLE_TYPE;
+	}
+
+	int64_t start;
+	int64_t end;
+	int64_t agg = 0;
+	int64_t bucket_ms = 0;
+
+	switch (op.type) {
+	case TS_OP_RANGE:
+		if (op.n_args != 2 || ! ts_op_unpack_int(&op, &start) ||
+				! ts_op_unpack_int(&op, &end)) {
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+		break;
+	case TS_OP_AGGREGATE:
+		if (op.n_args != 4 || ! ts_op_unpack_int(&op, &start) ||
+				! ts_op_unpack_int(&op, &end) ||
+				! ts_op_unpack_int(&op, &agg) ||
+				! ts_op_unpack_int(&op, &bucket_ms)) {
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+
+		if (agg < TS_AGG_COUNT || agg > TS_AGG_LAST || bucket_ms < 0) {
+			cf_warning(AS_PARTICLE, "timeseries aggregate - bad agg %ld or bucket %ld", agg, bucket_ms);
+			return -AS_PROTO_RESULT_FAIL_PARAMETER;
+		}
+		break;
+	default:
+		cf_warning(AS_PARTICLE, "timeseries read - unknown op %u", op.type);
+		return -AS_PROTO_RESULT_FAIL_PARAMETER;
+	}
+
+	ts_sample *samples;
+	uint32_t n_samples;
+	int ret = ts_collect(ts_from_bin(b), start, end, &samples, &n_samples);
+
+	if (ret != AS_PROTO_RESULT_OK) {
+		return ret;
+	}
+
+	if (op.type == TS_OP_RANGE) {
+		cdt_container_builder builder;
+
+		ts_result_list_start(&builder, n_samples);
+
+		for (uint32_t i = 0; i < n_samples; i++) {
+			as_double value;
+
+			as_double_init(&value, samples[i].value);
+			ts_result_list_add(&builder, samples[i].ts, (const as_val *)&value);
+		}
+
+		result->particle = builder.particle;
+		as_bin_state_set_from_type(result, AS_PARTICLE_TYPE_LIST);
+	}
+	else {
+		ret = ts_aggregate(samples, n_samples, start, bucket_ms,
+				(ts_agg_type)agg, result);
+	}
+
+	cf_free(samples);
+
+	return ret;
+}
+
+static double
+ts_agg_value(ts_agg_type agg, const ts_sample *samples, uint32_t n_samples)
+{
+	double value = samples[0].value;
+
+	switch (agg) {
+	case TS_AGG_SUM:
+	case TS_AGG_AVG:
+		for (uint32_t i = 1; i < n_samples; i++) {
+			value += samples[i].value;
+		}
+
+		return agg == TS_AGG_AVG ? value / n_samples : value;
+	case TS_AGG_MIN:
+		for (uint32_t i = 1; i < n_samples; i++) {
+			if (samples[i].value < value) {
+				value = samples[i].value;
+			}
+		}
+
+		return value;
+	case TS_AGG_MAX:
+		for (uint32_t i = 1; i < n_samples; i++) {
+			if (samples[i].value > value) {
+				value = samples[i].value;
+			}
+		}
+
+		return value;
+	case TS_AGG_LAST:
+		return samples[n_samples - 1].value;
+	case TS_AGG_FIRST:
+	default:
+		return value;
+	}
+}
+
+static int
+ts_aggregate(const ts_sample *samples, uint32_t n_samples, int64_t start,
+		int64_t bucket_ms, ts_agg_type agg, as_bin *result)
+{
+	if (bucket_ms == 0) {
+		if (agg == TS_AGG_COUNT) {
+			as_bin_set_int(result, (int64_t)n_samples);
+		}
+		else if (n_samples != 0) {
+			as_bin_set_double(result, ts_agg_value(agg, samples, n_samples));
+		}
+		// else - no result.
+
+		return AS_PROTO_RESULT_OK;
+	}
+
+	// Samples are in time order, so each bucket is a contiguous run.
+	uint32_t n_buckets = 0;
+	int64_t prev_bucket = -1;
+
+	for (uint32_t i = 0; i < n_samples; i++) {
+		int64_t bucket = (samples[i].ts - start) / bucket_ms;
+
+		if (bucket != prev_bucket) {
+			n_buckets++;
+			prev_bucket = bucket;
+		}
+	}
+
+	cdt_container_builder builder;
+
+	ts_result_list_start(&builder, n_buckets);
+
+	uint32_t run_start = 0;
+
+	for (uint32_t i = 1; i <= n_samples; i++) {
+		int64_t bucket = (samples[run_start].ts - start) / bucket_ms;
+
+		if (i < n_samples && (samples[i].ts - start) / bucket_ms == bucket) {
+			continue;
+		}
+
+		uint32_t run_count = i - run_start;
+		int64_t bucket_ts = start + (bucket * bucket_ms);
+
+		if (agg == TS_AGG_COUNT) {
+			as_integer value;
+
+			as_integer_init(&value, (int64_t)run_count);
+			ts_result_list_add(&builder, bucket_ts, (const as_val *)&value);
+		}
+		else {
+			as_double value;
+
+			as_double_init(&value,
+					ts_agg_value(agg, &samples[run_start], run_count));
+			ts_result_list_add(&builder, bucket_ts, (const as_val *)&value);
+		}
+
+		run_start = i;
+	}
+
+	result->particle = builder.particle;
+	as_bin_state_set_from_type(result, AS_PARTICLE_TYPE_LIST);
+
+	return AS_PROTO_RESULT_OK;
+}
+
+// Decodes only blocks that overlap [start, end).
+static int
+ts_collect(const ts_t *ts, int64_t start, int64_t end, ts_sample **samples_r,
+		uint32_t *n_samples_r)
+{
+	uint32_t max_samples = 0;
+	uint32_t offset = 0;
+
+	for (uint32_t i = 0; i < ts->n_blocks; i++) {
+		const ts_block *block = ts_block_at(ts->blocks, offset);
+
+		if (block->first_ts >= end) {
+			break;
+		}
+
+		if (block->last_ts >= start) {
+			max_samples += block->n_samples;
+		}
+
+		offset += ts_block_sz(block);
+	}
+
+	ts_sample *samples = cf_malloc((max_samples + 1) * sizeof(ts_sample));
+	uint32_t n_samples = 0;
+
+	offset = 0;
+
+	for (uint32_t i = 0; i < ts->n_blocks; i++) {
+		const ts_block *block = ts_block_at(ts->blocks, offset);
+
+		if (block->first_ts >= end) {
+			break;
+		}
+
+		offset += ts_block_sz(block);
+
+		if (block->last_ts < start) {
+			continue;
+		}
+
+		ts_decoder d;
+
+		ts_decoder_init(&d, block);
+
+		for (uint32_t s = 0; s < block->n_samples; s++) {
+			int64_t sample_ts;
+			uint64_t value;
+
+			if (! ts_decoder_next(&d, &sample_ts, &value)) {
+				cf_warning(AS_PARTICLE, "timeseries read - corrupt block");
+				cf_free(samples);
+				return -AS_PROTO_RESULT_FAIL_UNKNOWN;
+			}
+
+			if (sample_ts >= end) {
+				break;
+			}
+
+			if (sample_ts >= start) {
+				samples[n_samples].ts = sample_ts;
+				samples[n_samples].value = ts_bits_to_double(value);
+				n_samples++;
+			}
+		}
+	}
+
+	*samples_r = samples;
+	*n_samples_r = n_samples;
+
+	return AS_PROTO_RESULT_OK;
+}
+
+
+//==========================================================
+// Local helpers - encoding.
+//
+
+static void
+ts_encoder_init(ts_encoder *e, uint8_t *blocks, const ts_t *from,
+		uint32_t blocks_sz)
+{
+	e->blocks = blocks;
+
+	if (! from || from->n_blocks == 0) {
+		e->n_blocks = 0;
+		e->n_samples = 0;
+		e->end = 0;
+		e->block = NULL;
+		e->n_bits = 0;
+		return;
+	}
+
+	// Assumes from's blocks are already at blocks.
+	e->n_blocks = from->n_blocks;
+	e->n_samples = from->n_samples;
+	e->end = blocks_sz;
+	e->block = (ts_block *)(blocks + from->last_block_offset);
+	e->n_bits = from->tail_bits;
+	e->delta = from->last_delta;
+	e->value = from->last_value;
+	e->leading = from->last_leading;
+	e->trailing = from->last_trailing;
+}
+
+// Writes the low n bits of value, MSB first.
+static void
+ts_encoder_write(ts_encoder *e, uint64_t value, uint32_t n)
+{
+	uint8_t *data = e->block->data;
+
+	while (n != 0) {
+		uint32_t bit_off = e->n_bits & 7;
+		uint32_t room = 8 - bit_off;
+		uint32_t take = n < room ? n : room;
+		uint8_t chunk = (uint8_t)((value >> (n - take)) & ((1U << take) - 1));
+		uint8_t *byte = &data[e->n_bits >> 3];
+
+		if (bit_off == 0) {
+			*byte = 0;
+		}
+
+		*byte |= (uint8_t)(chunk << (room - take));
+		e->n_bits += take;
+		n -= take;
+	}
+}
+
+static void
+ts_encoder_add(ts_encoder *e, int64_t ts, uint64_t value)
+{
+	if (! e->block || e->block->n_samples == TS_BLOCK_MAX_SAMPLES) {
+		e->block = (ts_block *)(e->blocks + e->end);
+		e->block->first_ts = ts;
+		e->block->last_ts = ts;
+		e->block->n_samples = 1;
+		e->n_blocks++;
+		e->n_samples++;
+		e->n_bits = 0;
+
+		ts_encoder_write(e, value, 64);
+
+		e->delta = 0;
+		e->value = value;
+		e->leading = TS_NO_WINDOW;
+		e->trailing = 0;
+		e->block->n_bytes = (e->n_bits + 7) / 8;
+		e->end += ts_block_sz(e->block);
+		return;
+	}
+
+	uint32_t block_offset = (uint32_t)((uint8_t *)e->block - e->blocks);
+	int64_t delta = ts - e->block->last_ts;
+	int64_t dod = delta - e->delta;
+
+	if (dod == 0) {
+		ts_encoder_write(e, 0x0, 1);
+	}
+	else if (dod >= -63 && dod <= 64) {
+		ts_encoder_write(e, 0x2, 2);
+		ts_encoder_write(e, (uint64_t)(dod + 63), 7);
+	}
+	else if (dod >= -255 && dod <= 256) {
+		ts_encoder_write(e, 0x6, 3);
+		ts_encoder_write(e, (uint64_t)(dod + 255), 9);
+	}
+	else if (dod >= -2047 && dod <= 2048) {
+		ts_encoder_write(e, 0xe, 4);
+		ts_encoder_write(e, (uint64_t)(dod + 2047), 12);
+	}
+	else {
+		ts_encoder_write(e, 0xf, 4);
+		ts_encoder_write(e, (uint64_t)dod, 64);
+	}
+
+	uint64_t xor = value ^ e->value;
+
+	if (xor == 0) {
+		ts_encoder_write(e, 0x0, 1);
+	}
+	else {
+		uint8_t leading = (uint8_t)cf_msb64(xor);
+		uint8_t trailing = (uint8_t)cf_lsb64(xor);
+
+		if (e->leading != TS_NO_WINDOW &&
+				leading >= e->leading && trailing >= e->trailing) {
+			// Meaningful bits fit in the previous window.
+			ts_encoder_write(e, 0x2, 2);
+			ts_encoder_write(e, xor >> e->trailing,
+					64 - e->leading - e->trailing);
+		}
+		else {
+			uint32_t n_meaningful = 64 - leading - trailing;
+
+			ts_encoder_write(e, 0x3, 2);
+			ts_encoder_write(e, leading, 6);
+			ts_encoder_write(e, n_meaningful - 1, 6);
+			ts_encoder_write(e, xor >> trailing, n_meaningful);
+
+			e->leading = leading;
+			e->trailing = trailing;
+		}
+	}
+
+	e->delta = delta;
+	e->value = value;
+	e->block->last_ts = ts;
+	e->block->n_samples++;
+	e->block->n_bytes = (e->n_bits + 7) / 8;
+	e->end = block_offset + ts_block_sz(e->block);
+	e->n_samples++;
+}
+
+// Returns the data size.
+static uint32_t
+ts_encoder_finish(const ts_encoder *e, ts_t *ts)
+{
+	ts->n_samples = e->n_samples;
+	ts->n_blocks = e->n_blocks;
+
+	if (e->block) {
+		ts->last_block_offset = (uint32_t)((uint8_t *)e->block - e->blocks);
+		ts->tail_bits = e->n_bits;
+		ts->last_delta = e->delta;
+		ts->last_value = e->value;
+		ts->last_leading = e->leading;
+		ts->last_trailing = e->trailing;
+	}
+	else {
+		ts->last_block_offset = 0;
+		ts->tail_bits = 0;
+		ts->last_delta = 0;
+		ts->last_value = 0;
+		ts->last_leading = TS_NO_WINDOW;
+		ts->last_trailing = 0;
+	}
+
+	return (uint32_t)sizeof(ts_t) + e->end;
+}
+
+
+//==========================================================
+// Local helpers - decoding.
+//
+
+static void
+ts_decoder_init(ts_decoder *d, const ts_block *block)
+{
+	d->block = block;
+	d->n_bits = block->n_bytes * 8;
+	d->pos = 0;
+	d->ix = 0;
+}
+
+static bool
+ts_decoder_read(ts_decoder *d, uint32_t n, uint64_t *value_r)
+{
+	if (d->pos + n > d->n_bits) {
+		return false;
+	}
+
+	const uint8_t *data = d->block->data;
+	uint64_t value = 0;
+
+	while (n != 0) {
+		uint32_t bit_off = d->pos & 7;
+		uint32_t room = 8 - bit_off;
+		uint32_t take = n < room ? n : room;
+		uint8_t byte = data[d->pos >> 3];
+
+		value = (value << take) | ((byte >> (room - take)) & ((1U << take) - 1));
+		d->pos += take;
+		n -= take;
+	}
+
+	*value_r = value;
+
+	return true;
+}
+
+static bool
+ts_decoder_next(ts_decoder *d, int64_t *ts_r, uint64_t *value_r)
+{
+	uint64_t bits;
+
+	if (d->ix == 0) {
+		if (! ts_decoder_read(d, 64, &d->value)) {
+			return false;
+		}
+
+		d->ts = d->block->first_ts;
+		d->delta = 0;
+		d->leading = TS_NO_WINDOW;
+		d->trailing = 0;
+	}
+	else {
+		uint32_t n_ones = 0;
+
+		while (n_ones < 4) {
+			if (! ts_decoder_read(d, 1, &bits)) {
+				return false;
+			}
+
+			if (bits == 0) {
+				break;
+			}
+
+			n_ones++;
+		}
+
+		int64_t dod = 0;
+
+		switch (n_ones) {
+		case 0:
+			break;
+		case 1:
+			if (! ts_decoder_read(d, 7, &bits)) {
+				return false;
+			}
+			dod = (int64_t)bits - 63;
+			break;
+		case 2:
+			if (! ts_decoder_read(d, 9, &bits)) {
+				return false;
+			}
+			dod = (int64_t)bits - 255;
+			break;
+		case 3:
+			if (! ts_decoder_read(d, 12, &bits)) {
+				return false;
+			}
+			dod = (int64_t)bits - 2047;
+			break;
+		default:
+			if (! ts_decoder_read(d, 64, &bits)) {
+				return false;
+			}
+			dod = (int64_t)bits;
+			break;
+		}
+
+		d->delta += dod;
+		d->ts += d->delta;
+
+		if (! ts_decoder_read(d, 1, &bits)) {
+			return false;
+		}
+
+		if (bits != 0) {
+			if (! ts_decoder_read(d, 1, &bits)) {
+				return false;
+			}
+
+			if (bits != 0) {
+				uint64_t leading;
+				uint64_t n_meaningful;
+
+				if (! ts_decoder_read(d, 6, &leading) ||
+						! ts_decoder_read(d, 6, &n_meaningful)) {
+					return false;
+				}
+
+				n_meaningful++;
+
+				if (leading + n_meaningful > 64) {
+					return false;
+				}
+
+				d->leading = (uint8_t)leading;
+				d->trailing = (uint8_t)(64 - leading - n_meaningful);
+			}
+			else if (d->leading == TS_NO_WINDOW) {
+				return false;
+			}
+
+			if (! ts_decoder_read(d, 64 - d->leading - d->trailing, &bits)) {
+				return false;
+			}
+
+			d->value ^= bits << d->trailing;
+		}
+	}
+
+	d->ix++;
+	*ts_r = d->ts;
+	*value_r = d->value;
+
+	return true;
+}
+
+
+//==========================================================
+// Local helpers - results.
+//
+
+// Never modifies a bin's existing particle in place - the caller may still be
+// holding it for cleanup or rollback.
+static void
+ts_to_bin(const uint8_t *data, uint32_t data_sz, as_bin *b,
+		cf_ll_buf *particles_llb)
+{
+	size_t mem_sz = sizeof(ts_mem) + data_sz;
+	ts_mem *p_ts_mem;
+
+	if (particles_llb) {
+		cf_ll_buf_reserve(particles_llb, mem_sz, (uint8_t **)&p_ts_mem);
+	}
+	else {
+		p_ts_mem = cf_malloc_ns(mem_sz);
+	}
+
+	p_ts_mem->type = AS_PARTICLE_TYPE_TIMESERIES;
+	p_ts_mem->sz = data_sz;
+	memcpy(p_ts_mem->data, data, data_sz);
+
+	b->particle = (as_particle *)p_ts_mem;
+	as_bin_state_set_from_type(b, AS_PARTICLE_TYPE_TIMESERIES);
+}
+
+static void
+ts_result_list_start(cdt_container_builder *builder, uint32_t n_pairs)
+{
+	define_rollback_alloc(alloc, NULL, 1, false);
+
+	// Each pair packs to at most 1 + 9 + 9 bytes.
+	cdt_list_builder_start(builder, alloc, n_pairs, n_pairs * 19);
+}
+
+static void
+ts_result_list_add(cdt_container_builder *builder, int64_t ts,
+		const as_val *val)
+{
+	as_integer ts_val;
+	as_packer pk = {
+			.buffer = builder->write_ptr,
+			.capacity = INT_MAX
+	};
+
+	as_integer_init(&ts_val, ts);
+	as_pack_list_header(&pk, 2);
+	as_pack_val(&pk, (const as_val *)&ts_val);
+	as_pack_val(&pk, val);
+
+	cdt_container_builder_add_n(builder, NULL, 1, (uint32_t)pk.offset);
+}
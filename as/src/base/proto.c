@@ -42,6 +42,7 @@
 
 #include "dynbuf.h"
 #include "fault.h"
+#include "node.h"
 #include "socket.h"
 
 #include "base/as_stap.h"
@@ -62,6 +63,16 @@
 static const char SUCCESS_BIN_NAME[] = "SUCCESS";
 static const char FAILURE_BIN_NAME[] = "FAILURE";
 
+// Namespace, digest, set and key fields leading each record response.
+typedef struct response_fields_s {
+	const char *set_name;
+	size_t set_name_len;
+	uint8_t *key;
+	uint32_t key_size;
+	uint16_t n_fields;
+	size_t size;
+} response_fields;
+
 
 //==========================================================
 // Globals.
@@ -75,9 +86,12 @@ static cf_queue g_netio_slow_queue;
 // Forward declarations.
 //
 
+static cl_msg *make_response_msg(uint32_t result_code, uint32_t generation, uint32_t void_time, as_msg_op **ops, as_bin **bins, uint16_t bin_count, as_namespace *ns, cl_msg *msgp_in, size_t *msg_sz_in, uint64_t trid, bool transient);
 static int send_reply_buf(as_file_handle *fd_h, uint8_t *msgp, size_t msg_sz);
 static void *run_netio(void *q_to_wait_on);
 static int netio_send_packet(as_file_handle *fd_h, cf_buf_builder *bb_r, uint32_t *offset, bool blocking);
+static bool response_fields_init(as_storage_rd *rd, bool include_key, response_fields *rf);
+static uint8_t *response_fields_pack(as_storage_rd *rd, const response_fields *rf, uint8_t *buf);
 
 
 //==========================================================
@@ -180,6 +194,27 @@ cl_msg *
 as_msg_make_response_msg(uint32_t result_code, uint32_t generation,
 		uint32_t void_time, as_msg_op **ops, as_bin **bins, uint16_t bin_count,
 		as_namespace *ns, cl_msg *msgp_in, size_t *msg_sz_in, uint64_t trid)
+{
+	return make_response_msg(result_code, generation, void_time, ops, bins,
+			bin_count, ns, msgp_in, msg_sz_in, trid, false);
+}
+
+// Allocates cl_msg returned from the transaction region - caller must free it
+// with cf_region_free(), or cf_region_escape() it if it's handed off.
+cl_msg *
+as_msg_make_transient_response_msg(uint32_t result_code, uint32_t generation,
+		uint32_t void_time, as_msg_op **ops, as_bin **bins, uint16_t bin_count,
+		as_namespace *ns, cl_msg *msgp_in, size_t *msg_sz_in, uint64_t trid)
+{
+	return make_response_msg(result_code, generation, void_time, ops, bins,
+			bin_count, ns, msgp_in, msg_sz_in, trid, true);
+}
+
+static cl_msg *
+make_response_msg(uint32_t result_code, uint32_t generation,
+		uint32_t void_time, as_msg_op **ops, as_bin **bins, uint16_t bin_count,
+		as_namespace *ns, cl_msg *msgp_in, size_t *msg_sz_in, uint64_t trid,
+		bool transient)
 {
 	uint16_t n_fields = 0;
 	size_t msg_sz = sizeof(cl_msg);
@@ -211,7 +246,7 @@ as_msg_make_response_msg(uint32_t result_code, uint32_t generation,
 	uint8_t *buf;
 
 	if (! msgp_in || *msg_sz_in < msg_sz) {
-		buf = cf_malloc(msg_sz);
+		buf = transient ? cf_region_malloc(msg_sz) : cf_malloc(msg_sz);
 	}
 	else {
 		buf = (uint8_t *)msgp_in;
@@ -292,37 +327,13 @@ as_msg_make_response_bufbuilder(cf_buf_builder **bb_r, as_storage_rd *rd,
 	as_namespace *ns = rd->ns;
 	as_record *r = rd->r;
 
-	size_t ns_len = strlen(ns->name);
-	const char *set_name = as_index_get_set_name(r, ns);
-	size_t set_name_len = set_name ? strlen(set_name) : 0;
-
-	uint8_t* key = NULL;
-	uint32_t key_size = 0;
+	response_fields rf;
 
-	if (include_key && r->key_stored == 1) {
-		if (! as_storage_record_get_key(rd)) {
-			cf_warning(AS_PROTO, "can't get key - skipping record");
-			return -1;
-		}
-
-		key = rd->key;
-		key_size = rd->key_size;
+	if (! response_fields_init(rd, include_key, &rf)) {
+		return -1;
 	}
 
-	uint16_t n_fields = 2; // always add namespace and digest
-	size_t msg_sz = sizeof(as_msg) +
-			sizeof(as_msg_field) + ns_len +
-			sizeof(as_msg_field) + sizeof(cf_digest);
-
-	if (set_name) {
-		n_fields++;
-		msg_sz += sizeof(as_msg_field) + set_name_len;
-	}
-
-	if (key) {
-		n_fields++;
-		msg_sz += sizeof(as_msg_field) + key_size;
-	}
+	size_t msg_sz = sizeof(as_msg) + rf.size;
 
 	uint32_t n_select_bins = 0;
 	uint16_t n_bins_matched = 0;
@@ -390,7 +401,7 @@ as_msg_make_response_bufbuilder(cf_buf_builder **bb_r, as_storage_rd *rd,
 	m->generation = r->generation;
 	m->record_ttl = r->void_time;
 	m->transaction_ttl = 0;
-	m->n_fields = n_fields;
+	m->n_fields = rf.n_fields;
 
 	if (no_bin_data) {
 		m->n_ops = 0;
@@ -401,40 +412,7 @@ as_msg_make_response_bufbuilder(cf_buf_builder **bb_r, as_storage_rd *rd,
 
 	as_msg_swap_header(m);
 
-	buf = m->data;
-
-	as_msg_field *mf = (as_msg_field *)buf;
-
-	mf->field_sz = ns_len + 1;
-	mf->type = AS_MSG_FIELD_TYPE_NAMESPACE;
-	memcpy(mf->data, ns->name, ns_len);
-	as_msg_swap_field(mf);
-	buf += sizeof(as_msg_field) + ns_len;
-
-	mf = (as_msg_field *)buf;
-	mf->field_sz = sizeof(cf_digest) + 1;
-	mf->type = AS_MSG_FIELD_TYPE_DIGEST_RIPE;
-	memcpy(mf->data, &r->keyd, sizeof(cf_digest));
-	as_msg_swap_field(mf);
-	buf += sizeof(as_msg_field) + sizeof(cf_digest);
-
-	if (set_name) {
-		mf = (as_msg_field *)buf;
-		mf->field_sz = set_name_len + 1;
-		mf->type = AS_MSG_FIELD_TYPE_SET;
-		memcpy(mf->data, set_name, set_name_len);
-		as_msg_swap_field(mf);
-		buf += sizeof(as_msg_field) + set_name_len;
-	}
-
-	if (key) {
-		mf = (as_msg_field *)buf;
-		mf->field_sz = key_size + 1;
-		mf->type = AS_MSG_FIELD_TYPE_KEY;
-		memcpy(mf->data, key, key_size);
-		as_msg_swap_field(mf);
-		buf += sizeof(as_msg_field) + key_size;
-	}
+	buf = response_fields_pack(rd, &rf, m->data);
 
 	if (no_bin_data) {
 		return (int32_t)msg_sz;
@@ -484,6 +462,215 @@ as_msg_make_response_bufbuilder(cf_buf_builder **bb_r, as_storage_rd *rd,
 	return (int32_t)msg_sz;
 }
 
+// Copies a scan or query request's ops if any must be evaluated per record,
+// i.e. any is a CDT, HLL or time series read. Returns NULL with result OK if the ops only select
+// bins, in which case the caller projects by bin name as before.
+as_msg_read_ops *
+as_msg_read_ops_create(as_msg *m, int *result)
+{
+	*result = AS_PROTO_RESULT_OK;
+
+	as_msg_op *op = NULL;
+	int n = 0;
+	bool has_cdt_read = false;
+	bool name_too_long = false;
+	uint16_t n_read_ops = 0;
+	size_t ops_sz = 0;
+
+	while ((op = as_msg_op_iterate(m, op, &n)) != NULL) {
+		if (op->op == AS_MSG_OP_CDT_READ || op->op == AS_MSG_OP_HLL_READ ||
+				op->op == AS_MSG_OP_TIMESERIES_READ) {
+			has_cdt_read = true;
+		}
+		else if (op->op != AS_MSG_OP_READ) {
+			continue; // scans & queries have always ignored other ops
+		}
+
+		if (op->name_sz >= AS_ID_BIN_SZ) {
+			name_too_long = true;
+		}
+
+		n_read_ops++;
+		ops_sz += sizeof(uint32_t) + op->op_sz;
+	}
+
+	if (! has_cdt_read) {
+		return NULL;
+	}
+
+	if (name_too_long) {
+		cf_warning(AS_PROTO, "read ops - bin name too long");
+		*result = AS_PROTO_RESULT_FAIL_BIN_NAME;
+		return NULL;
+	}
+
+	as_msg_read_ops *read_ops = cf_malloc(sizeof(as_msg_read_ops) +
+			(n_read_ops * sizeof(as_msg_op *)) + ops_sz);
+	uint8_t *buf = (uint8_t *)&read_ops->ops[n_read_ops];
+	uint16_t i = 0;
+
+	read_ops->n_ops = n_read_ops;
+
+	while ((op = as_msg_op_iterate(m, op, &n)) != NULL) {
+		if (op->op != AS_MSG_OP_READ && op->op != AS_MSG_OP_CDT_READ &&
+				op->op != AS_MSG_OP_HLL_READ &&
+				op->op != AS_MSG_OP_TIMESERIES_READ) {
+			continue;
+		}
+
+		size_t op_sz = sizeof(uint32_t) + op->op_sz;
+
+		memcpy(buf, op, op_sz);
+		read_ops->ops[i++] = (as_msg_op *)buf;
+		buf += op_sz;
+	}
+
+	return read_ops;
+}
+
+void
+as_msg_read_ops_destroy(as_msg_read_ops *read_ops)
+{
+	cf_free(read_ops);
+}
+
+// Evaluates read ops against a record whose bins are loaded, and packs the
+// results. Pass NULL bb_r for sizing only. Returns 0 if no op had a result (the
+// record is skipped), size if > 0, error if < 0.
+int32_t
+as_msg_make_read_ops_response_bufbuilder(cf_buf_builder **bb_r,
+		as_storage_rd *rd, const as_msg_read_ops *read_ops)
+{
+	as_namespace *ns = rd->ns;
+	as_record *r = rd->r;
+
+	uint16_t n_ops = read_ops->n_ops;
+	as_msg_op *ops[n_ops];
+	as_bin *response_bins[n_ops];
+	uint16_t n_bins = 0;
+
+	as_bin result_bins[n_ops];
+	uint32_t n_result_bins = 0;
+
+	int32_t result = 0;
+
+	for (uint16_t i = 0; i < n_ops; i++) {
+		as_msg_op *op = read_ops->ops[i];
+		as_bin *b = as_bin_get_from_buf(rd, op->name, op->name_sz);
+
+		if (! b) {
+			continue;
+		}
+
+		if (op->op == AS_MSG_OP_READ) {
+			ops[n_bins] = op;
+			response_bins[n_bins++] = b;
+			continue;
+		}
+
+		as_bin *rb = &result_bins[n_result_bins];
+
+		as_bin_set_empty(rb);
+
+		if (op->op == AS_MSG_OP_HLL_READ) {
+			if ((result = as_bin_hll_read_from_client(b, op, rb)) < 0) {
+				cf_detail_digest(AS_PROTO, &r->keyd, "read ops - hll read failed (%d) ",
+						result);
+				goto Cleanup;
+			}
+		}
+		else if (op->op == AS_MSG_OP_TIMESERIES_READ) {
+			if ((result = as_bin_timeseries_read_from_client(b, op, rb)) < 0) {
+				cf_detail_digest(AS_PROTO, &r->keyd, "read ops - timeseries read failed (%d) ",
+						result);
+				goto Cleanup;
+			}
+		}
+		else if ((result = as_bin_cdt_read_from_client(b, op, rb)) < 0) {
+			cf_detail_digest(AS_PROTO, &r->keyd, "read ops - cdt read failed (%d) ",
+					result);
+			goto Cleanup;
+		}
+
+		if (as_bin_inuse(rb)) {
+			n_result_bins++;
+			ops[n_bins] = op;
+			response_bins[n_bins++] = rb;
+		}
+	}
+
+	// Don't return an empty record.
+	if (n_bins == 0) {
+		result = 0;
+		goto Cleanup;
+	}
+
+	response_fields rf;
+
+	if (! response_fields_init(rd, true, &rf)) {
+		result = -1;
+		goto Cleanup;
+	}
+
+	size_t msg_sz = sizeof(as_msg) + rf.size + (sizeof(as_msg_op) * n_bins);
+
+	for (uint16_t i = 0; i < n_bins; i++) {
+		msg_sz += ns->single_bin ? 0 : ops[i]->name_sz;
+		msg_sz += as_bin_particle_client_value_size(response_bins[i]);
+	}
+
+	result = (int32_t)msg_sz;
+
+	// NULL buf-builder means just return size.
+	if (! bb_r) {
+		goto Cleanup;
+	}
+
+	uint8_t *buf;
+
+	cf_buf_builder_reserve(bb_r, (int)msg_sz, &buf);
+
+	as_msg *m = (as_msg *)buf;
+
+	m->header_sz = sizeof(as_msg);
+	m->info1 = 0;
+	m->info2 = 0;
+	m->info3 = 0;
+	m->unused = 0;
+	m->result_code = AS_PROTO_RESULT_OK;
+	m->generation = r->generation;
+	m->record_ttl = r->void_time;
+	m->transaction_ttl = 0;
+	m->n_fields = rf.n_fields;
+	m->n_ops = n_bins;
+
+	as_msg_swap_header(m);
+
+	buf = response_fields_pack(rd, &rf, m->data);
+
+	for (uint16_t i = 0; i < n_bins; i++) {
+		as_msg_op *op = (as_msg_op *)buf;
+
+		op->op = AS_MSG_OP_READ;
+		op->version = 0;
+		op->name_sz = ns->single_bin ? 0 : ops[i]->name_sz;
+		memcpy(op->name, ops[i]->name, op->name_sz);
+		op->op_sz = 4 + op->name_sz;
+
+		buf += sizeof(as_msg_op) + op->name_sz;
+		buf += as_bin_particle_to_client(response_bins[i], op);
+
+		as_msg_swap_op(op);
+	}
+
+Cleanup:
+	for (uint32_t i = 0; i < n_result_bins; i++) {
+		as_bin_particle_destroy(&result_bins[i], true);
+	}
+
+	return result;
+}
+
 cl_msg *
 as_msg_make_val_response(bool success, const as_val *val, uint32_t result_code,
 		uint32_t generation, uint32_t void_time, uint64_t trid,
@@ -632,14 +819,14 @@ as_msg_send_reply(as_file_handle *fd_h, uint32_t result_code,
 {
 	uint8_t stack_buf[MSG_STACK_BUFFER_SZ];
 	size_t msg_sz = sizeof(stack_buf);
-	uint8_t *msgp = (uint8_t *)as_msg_make_response_msg(result_code, generation,
-			void_time, ops, bins, bin_count, ns, (cl_msg *)stack_buf, &msg_sz,
-			trid);
+	uint8_t *msgp = (uint8_t *)as_msg_make_transient_response_msg(result_code,
+			generation, void_time, ops, bins, bin_count, ns,
+			(cl_msg *)stack_buf, &msg_sz, trid);
 
 	int rv = send_reply_buf(fd_h, msgp, msg_sz);
 
 	if (msgp != stack_buf) {
-		cf_free(msgp);
+		cf_region_free(msgp);
 	}
 
 	return rv;
@@ -652,6 +839,72 @@ as_msg_send_ops_reply(as_file_handle *fd_h, cf_dyn_buf *db)
 	return send_reply_buf(fd_h, db->buf, db->used_sz);
 }
 
+// Tell the client which node owns the partition, instead of proxying.
+int
+as_msg_send_partition_redirect(as_file_handle *fd_h, cf_node node,
+		uint64_t cluster_key, uint64_t trid)
+{
+	uint8_t buf[sizeof(cl_msg) + sizeof(as_msg_field) +
+				sizeof(as_msg_partition_hint) + sizeof(as_msg_field) +
+				sizeof(uint64_t)];
+	size_t msg_sz = sizeof(cl_msg) + sizeof(as_msg_field) +
+			sizeof(as_msg_partition_hint);
+	uint16_t n_fields = 1;
+
+	if (trid != 0) {
+		msg_sz += sizeof(as_msg_field) + sizeof(uint64_t);
+		n_fields++;
+	}
+
+	cl_msg *msgp = (cl_msg *)buf;
+
+	msgp->proto.version = PROTO_VERSION;
+	msgp->proto.type = PROTO_TYPE_AS_MSG;
+	msgp->proto.sz = msg_sz - sizeof(as_proto);
+
+	as_proto_swap(&msgp->proto);
+
+	as_msg *m = &msgp->msg;
+
+	m->header_sz = sizeof(as_msg);
+	m->info1 = 0;
+	m->info2 = 0;
+	m->info3 = AS_MSG_INFO3_PARTITION_MOVED;
+	m->unused = 0;
+	m->result_code = AS_PROTO_RESULT_FAIL_PARTITION_MOVED;
+	m->generation = 0;
+	m->record_ttl = 0;
+	m->transaction_ttl = 0;
+	m->n_fields = n_fields;
+	m->n_ops = 0;
+
+	as_msg_swap_header(m);
+
+	as_msg_field *mf = (as_msg_field *)m->data;
+
+	mf->field_sz = 1 + sizeof(as_msg_partition_hint);
+	mf->type = AS_MSG_FIELD_TYPE_PARTITION_HINT;
+
+	as_msg_partition_hint *hint = (as_msg_partition_hint *)mf->data;
+
+	hint->node = cf_swap_to_be64(node);
+	hint->cluster_key = cf_swap_to_be64(cluster_key);
+
+	as_msg_swap_field(mf);
+
+	if (trid != 0) {
+		mf = (as_msg_field *)(m->data + sizeof(as_msg_field) +
+				sizeof(as_msg_partition_hint));
+
+		mf->field_sz = 1 + sizeof(uint64_t);
+		mf->type = AS_MSG_FIELD_TYPE_TRID;
+		*(uint64_t *)mf->data = cf_swap_to_be64(trid);
+		as_msg_swap_field(mf);
+	}
+
+	return send_reply_buf(fd_h, buf, msg_sz);
+}
+
 // Send a blocking "fin" message with default timeout.
 bool
 as_msg_send_fin(cf_socket *sock, uint32_t result_code)
@@ -784,6 +1037,86 @@ as_netio_send(as_netio *io, bool slow, bool blocking)
 // Local helpers.
 //
 
+static bool
+response_fields_init(as_storage_rd *rd, bool include_key, response_fields *rf)
+{
+	as_namespace *ns = rd->ns;
+	as_record *r = rd->r;
+
+	rf->set_name = as_index_get_set_name(r, ns);
+	rf->set_name_len = rf->set_name ? strlen(rf->set_name) : 0;
+	rf->key = NULL;
+	rf->key_size = 0;
+
+	if (include_key && r->key_stored == 1) {
+		if (! as_storage_record_get_key(rd)) {
+			cf_warning(AS_PROTO, "can't get key - skipping record");
+			return false;
+		}
+
+		rf->key = rd->key;
+		rf->key_size = rd->key_size;
+	}
+
+	rf->n_fields = 2; // always add namespace and digest
+	rf->size = sizeof(as_msg_field) + strlen(ns->name) +
+			sizeof(as_msg_field) + sizeof(cf_digest);
+
+	if (rf->set_name) {
+		rf->n_fields++;
+		rf->size += sizeof(as_msg_field) + rf->set_name_len;
+	}
+
+	if (rf->key) {
+		rf->n_fields++;
+		rf->size += sizeof(as_msg_field) + rf->key_size;
+	}
+
+	return true;
+}
+
+static uint8_t *
+response_fields_pack(as_storage_rd *rd, const response_fields *rf, uint8_t *buf)
+{
+	as_namespace *ns = rd->ns;
+	size_t ns_len = strlen(ns->name);
+
+	as_msg_field *mf = (as_msg_field *)buf;
+
+	mf->field_sz = ns_len + 1;
+	mf->type = AS_MSG_FIELD_TYPE_NAMESPACE;
+	memcpy(mf->data, ns->name, ns_len);
+	as_msg_swap_field(mf);
+	buf += sizeof(as_msg_field) + ns_len;
+
+	mf = (as_msg_field *)buf;
+	mf->field_sz = sizeof(cf_digest) + 1;
+	mf->type = AS_MSG_FIELD_TYPE_DIGEST_RIPE;
+	memcpy(mf->data, &rd->r->keyd, sizeof(cf_digest));
+	as_msg_swap_field(mf);
+	buf += sizeof(as_msg_field) + sizeof(cf_digest);
+
+	if (rf->set_name) {
+		mf = (as_msg_field *)buf;
+		mf->field_sz = rf->set_name_len + 1;
+		mf->type = AS_MSG_FIELD_TYPE_SET;
+		memcpy(mf->data, rf->set_name, rf->set_name_len);
+		as_msg_swap_field(mf);
+		buf += sizeof(as_msg_field) + rf->set_name_len;
+	}
+
+	if (rf->key) {
+		mf = (as_msg_field *)buf;
+		mf->field_sz = rf->key_size + 1;
+		mf->type = AS_MSG_FIELD_TYPE_KEY;
+		memcpy(mf->data, rf->key, rf->key_size);
+		as_msg_swap_field(mf);
+		buf += sizeof(as_msg_field) + rf->key_size;
+	}
+
+	return buf;
+}
+
 static int
 send_reply_buf(as_file_handle *fd_h, uint8_t *msgp, size_t msg_sz)
 {
@@ -0,0 +1,375 @@
+/*
+ * quota.c
+ *
+ * Copyright (C) 2018 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+//==========================================================
+// Includes.
+//
+
+#include "base/quota.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "citrusleaf/cf_atomic.h"
+#include "citrusleaf/cf_clock.h"
+
+#include "cf_mutex.h"
+#include "fault.h"
+#include "shash.h"
+#include "vmapx.h"
+
+#include "base/batch.h"
+#include "base/cfg.h"
+#include "base/datamodel.h"
+#include "base/proto.h"
+#include "base/stats.h"
+#include "base/transaction.h"
+
+
+//==========================================================
+// Typedefs & constants.
+//
+
+#define CLIENT_KEY_SZ 64 // as for as_file_handle client
+#define CLIENT_IDLE_MS (60 * 1000) // reap client buckets unused this long
+
+typedef struct client_quota_s {
+	as_quota_bucket	buckets[AS_N_QUOTAS];
+	uint64_t		last_ms;
+} client_quota;
+
+
+//==========================================================
+// Globals.
+//
+
+static cf_shash* g_client_quotas; // key is client address, value is client_quota
+
+
+//==========================================================
+// Forward declarations.
+//
+
+static as_quotas* get_set_quotas(as_transaction* tr, as_namespace* ns, uint64_t* limits);
+static client_quota* get_client_quota(as_transaction* tr, pthread_mutex_t** p_vlock);
+static bool check(as_quota_bucket* buckets, const uint64_t* limits, const uint64_t* units, uint64_t now_us, uint64_t* costs, as_quota_type* failed);
+static void take(as_quota_bucket* buckets, const uint64_t* costs);
+static void count_consumed(cf_atomic64* n_consumed, const uint64_t* limits, const uint64_t* units);
+static void refill(as_quota_bucket* bucket, uint64_t limit, uint64_t now_us);
+static int reap_reduce_fn(const void* key, void* data, void* udata);
+
+
+//==========================================================
+// Inlines & macros.
+//
+
+static inline void
+get_client_limits(uint64_t* limits)
+{
+	limits[AS_QUOTA_READ_TPS] = g_config.client_quota_read_tps;
+	limits[AS_QUOTA_WRITE_TPS] = g_config.client_quota_write_tps;
+	limits[AS_QUOTA_WRITE_BPS] = g_config.client_quota_write_bps;
+}
+
+static inline bool
+client_quotas_configured()
+{
+	return g_config.client_quota_read_tps != 0 ||
+			g_config.client_quota_write_tps != 0 ||
+			g_config.client_quota_write_bps != 0;
+}
+
+
+//==========================================================
+// Public API.
+//
+
+void
+as_quota_init()
+{
+	g_client_quotas = cf_shash_create(cf_shash_fn_zstr, CLIENT_KEY_SZ,
+			sizeof(client_quota), 1024, CF_SHASH_MANY_LOCK);
+}
+
+
+// Charge a single-record transaction against its set's and its client's
+// quotas. Called once per transaction, before the partition reservation, so
+// rejected transactions never reach storage. Takes from both quotas, or from
+// neither - a transaction one quota rejects doesn't use up the other.
+bool
+as_quota_admit(as_transaction* tr, as_namespace* ns, bool is_write)
+{
+	if (tr->origin != FROM_CLIENT && tr->origin != FROM_BATCH) {
+		return true;
+	}
+
+	uint64_t set_limits[AS_N_QUOTAS];
+	as_quotas* q = get_set_quotas(tr, ns, set_limits);
+	bool use_client = client_quotas_configured();
+
+	if (! q && ! use_client) {
+		return true;
+	}
+
+	uint64_t units[AS_N_QUOTAS] = { 0 };
+
+	if (is_write) {
+		units[AS_QUOTA_WRITE_TPS] = 1;
+		units[AS_QUOTA_WRITE_BPS] = as_proto_size_get(&tr->msgp->proto);
+	}
+	else {
+		units[AS_QUOTA_READ_TPS] = 1;
+	}
+
+	uint64_t client_limits[AS_N_QUOTAS];
+
+	get_client_limits(client_limits);
+
+	uint64_t now_us = cf_getus();
+
+	// Lock order is always set, then client.
+	if (q) {
+		cf_mutex_lock(&q->lock);
+	}
+
+	pthread_mutex_t* vlock = NULL;
+	client_quota* cq = use_client ? get_client_quota(tr, &vlock) : NULL;
+
+	uint64_t set_costs[AS_N_QUOTAS];
+	uint64_t client_costs[AS_N_QUOTAS];
+	as_quota_type failed;
+
+	bool set_ok = ! q ||
+			check(q->buckets, set_limits, units, now_us, set_costs, &failed);
+	bool client_ok = set_ok && (! cq ||
+			check(cq->buckets, client_limits, units, now_us, client_costs,
+					&failed));
+
+	if (client_ok) {
+		if (q) {
+			take(q->buckets, set_costs);
+		}
+
+		if (cq) {
+			take(cq->buckets, client_costs);
+		}
+	}
+
+	if (cq) {
+		cq->last_ms = cf_getms();
+		pthread_mutex_unlock(vlock);
+	}
+
+	if (q) {
+		cf_mutex_unlock(&q->lock);
+	}
+
+	if (! set_ok) {
+		cf_atomic64_incr(&q->n_rejected[failed]);
+		return false;
+	}
+
+	if (! client_ok) {
+		cf_atomic64_incr(&g_stats.client_quota_rejected[failed]);
+		return false;
+	}
+
+	if (q) {
+		count_consumed(q->n_consumed, set_limits, units);
+	}
+
+	if (cq) {
+		count_consumed(g_stats.client_quota_consumed, client_limits, units);
+	}
+
+	return true;
+}
+
+
+// Forget clients that have gone quiet - called from the ticker.
+void
+as_quota_reap_clients()
+{
+	uint64_t now_ms = cf_getms();
+
+	cf_shash_reduce(g_client_quotas, reap_reduce_fn, &now_ms);
+}
+
+
+//==========================================================
+// Local helpers.
+//
+
+// Returns NULL if the transaction's set has no quotas.
+static as_quotas*
+get_set_quotas(as_transaction* tr, as_namespace* ns, uint64_t* limits)
+{
+	if (! as_transaction_has_set(tr)) {
+		return NULL;
+	}
+
+	as_msg_field* f = as_msg_field_get(&tr->msgp->msg, AS_MSG_FIELD_TYPE_SET);
+	uint32_t idx;
+
+	if (cf_vmapx_get_index_w_len(ns->p_sets_vmap, (const char*)f->data,
+			as_msg_field_get_value_sz(f), &idx) != CF_VMAPX_OK) {
+		return NULL; // new set - can't have a quota yet
+	}
+
+	as_set* p_set;
+
+	if (cf_vmapx_get_by_index(ns->p_sets_vmap, idx, (void**)&p_set) !=
+			CF_VMAPX_OK) {
+		return NULL;
+	}
+
+	as_quotas* q = &p_set->quotas;
+	bool any = false;
+
+	for (uint32_t t = 0; t < AS_N_QUOTAS; t++) {
+		limits[t] = cf_atomic64_get(q->limits[t]);
+		any = any || limits[t] != 0;
+	}
+
+	return any ? q : NULL;
+}
+
+// Returns with the client's entry locked - caller unlocks *p_vlock.
+static client_quota*
+get_client_quota(as_transaction* tr, pthread_mutex_t** p_vlock)
+{
+	as_file_handle* fd_h = tr->origin == FROM_CLIENT ?
+			tr->from.proto_fd_h : as_batch_get_fd_h(tr->from.batch_shared);
+
+	// Key on the address only - a client's connections share its quota.
+	char key[CLIENT_KEY_SZ] = { 0 };
+	char* port = strrchr(fd_h->client, ':');
+	size_t key_len = port ? (size_t)(port - fd_h->client) :
+			strlen(fd_h->client);
+
+	memcpy(key, fd_h->client, key_len);
+
+	client_quota* cq;
+
+	while (cf_shash_get_vlock(g_client_quotas, key, (void**)&cq, p_vlock) !=
+			CF_SHASH_OK) {
+		client_quota new_cq;
+
+		memset(&new_cq, 0, sizeof(new_cq));
+
+		// Ignore failure - means another thread just added it.
+		cf_shash_put_unique(g_client_quotas, key, &new_cq);
+	}
+
+	return cq;
+}
+
+// Check all relevant buckets can pay, and fill in what each will be charged.
+static bool
+check(as_quota_bucket* buckets, const uint64_t* limits, const uint64_t* units,
+		uint64_t now_us, uint64_t* costs, as_quota_type* failed)
+{
+	for (uint32_t t = 0; t < AS_N_QUOTAS; t++) {
+		costs[t] = 0;
+
+		if (limits[t] == 0 || units[t] == 0) {
+			continue;
+		}
+
+		refill(&buckets[t], limits[t], now_us);
+
+		// Something bigger than a second's worth needs a full bucket.
+		uint64_t capacity = limits[t] * 1000000;
+
+		costs[t] = units[t] * 1000000;
+
+		if (costs[t] > capacity) {
+			costs[t] = capacity;
+		}
+
+		if (buckets[t].tokens < costs[t]) {
+			*failed = (as_quota_type)t;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+take(as_quota_bucket* buckets, const uint64_t* costs)
+{
+	for (uint32_t t = 0; t < AS_N_QUOTAS; t++) {
+		buckets[t].tokens -= costs[t];
+	}
+}
+
+static void
+count_consumed(cf_atomic64* n_consumed, const uint64_t* limits,
+		const uint64_t* units)
+{
+	for (uint32_t t = 0; t < AS_N_QUOTAS; t++) {
+		if (limits[t] != 0 && units[t] != 0) {
+			cf_atomic64_add(&n_consumed[t], (int64_t)units[t]);
+		}
+	}
+}
+
+// Buckets hold at most one second's worth, and start full.
+static void
+refill(as_quota_bucket* bucket, uint64_t limit, uint64_t now_us)
+{
+	uint64_t capacity = limit * 1000000;
+
+	if (bucket->last_us == 0) {
+		bucket->tokens = capacity;
+		bucket->last_us = now_us;
+		return;
+	}
+
+	// Another thread may have got a slightly later now_us.
+	if (now_us <= bucket->last_us) {
+		return;
+	}
+
+	uint64_t elapsed_us = now_us - bucket->last_us;
+
+	if (elapsed_us >= 1000000 ||
+			(bucket->tokens += limit * elapsed_us) > capacity) {
+		bucket->tokens = capacity;
+	}
+
+	bucket->last_us = now_us;
+}
+
+static int
+reap_reduce_fn(const void* key, void* data, void* udata)
+{
+	client_quota* cq = (client_quota*)data;
+	uint64_t now_ms = *(uint64_t*)udata;
+
+	return now_ms > cq->last_ms + CLIENT_IDLE_MS ?
+			CF_SHASH_REDUCE_DELETE : CF_SHASH_OK;
+}
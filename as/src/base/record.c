@@ -129,6 +129,11 @@ as_record_get_create(as_index_tree *tree, cf_digest *keyd, as_index_ref *r_ref,
 	}
 
 	if (rv == 1) {
+		// Index tree doesn't know if the element has 'dim' - clear it here.
+		if (ns->storage_data_in_memory) {
+			as_index_clear_dim(r_ref->r);
+		}
+
 		cf_atomic64_incr(&ns->n_objects);
 	}
 
@@ -198,6 +203,11 @@ as_record_rescue(as_index_ref *r_ref, as_namespace *ns)
 	record_delete_adjust_sindex(r_ref->r, ns);
 	as_record_destroy(r_ref->r, ns);
 	as_index_clear_record_info(r_ref->r);
+
+	if (ns->storage_data_in_memory) {
+		as_index_clear_dim(r_ref->r);
+	}
+
 	cf_atomic64_incr(&ns->n_objects);
 }
 
@@ -330,7 +340,10 @@ as_record_pickle(as_storage_rd *rd, size_t *len_r)
 				0 : strlen(as_bin_get_name_from_id(ns, b->id)); // for bin name
 		sz += 1; // was for version - currently not used
 
-		sz += as_bin_particle_pickled_size(b);
+		sz += rd->client_ops && rd->client_ops[n_bins_in_use] ?
+				as_particle_client_ref_pickled_size(
+						rd->client_ops[n_bins_in_use]) :
+				as_bin_particle_pickled_size(b);
 	}
 
 	uint8_t *pickle = cf_malloc(sz);
@@ -349,7 +362,9 @@ as_record_pickle(as_storage_rd *rd, size_t *len_r)
 		buf += name_len; // skip past bin name
 		*buf++ = 0; // was version - currently not used
 
-		buf += as_bin_particle_to_pickled(b, buf);
+		buf += rd->client_ops && rd->client_ops[i] ?
+				as_particle_client_ref_to_pickled(rd->client_ops[i], buf) :
+				as_bin_particle_to_pickled(b, buf);
 	}
 
 	*len_r = sz;
@@ -533,6 +533,7 @@ typedef struct basic_scan_job_s {
 	uint32_t		sample_pct;
 	predexp_eval_t*	predexp;
 	cf_vector*		bin_names;
+	as_msg_read_ops* read_ops;
 } basic_scan_job;
 
 void basic_scan_job_slice(as_job* _job, as_partition_reservation* rsv);
@@ -586,13 +587,26 @@ basic_scan_job_start(as_transaction* tr, as_namespace* ns, uint16_t set_id)
 	job->sample_pct = options.sample_pct;
 	job->predexp = predexp;
 
+	job->bin_names = NULL;
+
 	int result;
 
-	job->bin_names = bin_names_from_op(&tr->msgp->msg, &result);
+	// Ops including CDT reads are evaluated per record - otherwise, ops just
+	// select bins.
+	job->read_ops = as_msg_read_ops_create(&tr->msgp->msg, &result);
 
-	if (! job->bin_names && result != AS_PROTO_RESULT_OK) {
-		as_job_destroy(_job);
-		return result;
+	if (! job->read_ops) {
+		if (result != AS_PROTO_RESULT_OK) {
+			as_job_destroy(_job);
+			return result;
+		}
+
+		job->bin_names = bin_names_from_op(&tr->msgp->msg, &result);
+
+		if (! job->bin_names && result != AS_PROTO_RESULT_OK) {
+			as_job_destroy(_job);
+			return result;
+		}
 	}
 
 	if (job->fail_on_cluster_change &&
@@ -701,6 +715,10 @@ basic_scan_job_destroy(as_job* _job)
 		cf_vector_destroy(job->bin_names);
 	}
 
+	if (job->read_ops) {
+		as_msg_read_ops_destroy(job->read_ops);
+	}
+
 	if (job->predexp) {
 		predexp_destroy(job->predexp);
 	}
@@ -777,8 +795,14 @@ basic_scan_job_reduce_cb(as_index_ref* r_ref, void* udata)
 			return;
 		}
 
-		as_msg_make_response_bufbuilder(slice->bb_r, &rd, false, true, true,
-				job->bin_names);
+		if (job->read_ops) {
+			as_msg_make_read_ops_response_bufbuilder(slice->bb_r, &rd,
+					job->read_ops);
+		}
+		else {
+			as_msg_make_response_bufbuilder(slice->bb_r, &rd, false, true,
+					true, job->bin_names);
+		}
 	}
 
 	as_storage_record_close(&rd);
@@ -49,6 +49,8 @@
  * BOOT INDEX
  *
  * as_sindex_boot_populateall --> If fast restart or data in memory and load at start up --> as_sbld_build_all
+ *                            |
+ *                            --> If a snapshot was written at clean shutdown --> as_sindex__snapshot_load
  *
  * SBIN creation
  *
@@ -80,8 +82,10 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include "citrusleaf/cf_atomic.h"
 #include "citrusleaf/cf_clock.h"
@@ -114,6 +118,7 @@
 #include "base/thr_info.h"
 #include "fabric/partition.h"
 #include "geospatial/geospatial.h"
+#include "storage/storage.h"
 #include "transaction/udf.h"
 
 
@@ -403,6 +408,13 @@ as_sindex__dup_meta(as_sindex_metadata *imd, as_sindex_metadata **qimd)
 	qimdp->sktype       = imd->sktype;
 	qimdp->binid       = imd->binid;
 
+	qimdp->n_cbins     = imd->n_cbins;
+	for (uint32_t i = 0; i < imd->n_cbins; i++) {
+		qimdp->cbnames[i] = cf_strdup(imd->cbnames[i]);
+		qimdp->cbinids[i] = imd->cbinids[i];
+		qimdp->cbtypes[i] = imd->cbtypes[i];
+	}
+
 	*qimd = qimdp;
 }
 
@@ -477,6 +489,17 @@ as_sindex__populate_binid(as_namespace *ns, as_sindex_metadata *imd)
 	imd->binid = as_bin_get_or_assign_id(ns, bname);
 	cf_debug(AS_SINDEX, " Assigned %d for %s", imd->binid, imd->bname);
 
+	// Composite index - every bin of the tuple needs an id.
+	for (uint32_t i = 0; i < imd->n_cbins; i++) {
+		if (!as_bin_name_within_quota(ns, imd->cbnames[i])) {
+			cf_warning(AS_SINDEX, "Bin %s not added. Quota is full", imd->cbnames[i]);
+			return AS_SINDEX_ERR;
+		}
+
+		strncpy(bname, imd->cbnames[i], AS_ID_BIN_SZ);
+		imd->cbinids[i] = as_bin_get_or_assign_id(ns, bname);
+	}
+
 	return AS_SINDEX_OK;
 }
 
@@ -514,6 +537,14 @@ as_sindex_imd_free(as_sindex_metadata *imd)
 		imd->bname = NULL;
 	}
 
+	for (uint32_t i = 0; i < imd->n_cbins; i++) {
+		if (imd->cbnames[i]) {
+			cf_free(imd->cbnames[i]);
+			imd->cbnames[i] = NULL;
+		}
+	}
+	imd->n_cbins = 0;
+
 	return AS_SINDEX_OK;
 }
 //                                           END - UTILITY
@@ -1515,6 +1546,9 @@ sindex_create_lockless(as_namespace *ns, as_sindex_metadata *imd)
 	} else {
 		ns->n_setless_sindexes++;
 	}
+	if (as_sindex_is_composite(si->imd)) {
+		ns->n_composite_sindexes++;
+	}
 	cf_atomic64_add(&ns->n_bytes_sindex_memory, ai_btree_get_isize(si->imd));
 
 	// Queue this for secondary index builder if create is done after boot.
@@ -1783,6 +1817,387 @@ as_sindex_populate_done(as_sindex *si)
 	si->flag &= ~AS_SINDEX_FLAG_POPULATING;
 	return AS_SINDEX_OK;
 }
+/*
+ * Snapshot of a namespace's secondary indexes, written at clean shutdown and
+ * loaded at the next boot instead of scanning every record on the device. The
+ * file is removed when boot reads it - usable or not - so it is never loaded
+ * after the node may have taken writes it does not reflect. It also records the
+ * device header random of the run that wrote it, so it is not loaded if the
+ * devices were since wiped, replaced or written by another run.
+ *
+ * Layout: header, one directory entry per sindex, each sindex's entries as
+ * (skey, digest) pairs in directory order, then the magic again.
+ */
+#define SINDEX_SNAPSHOT_MAGIC	0x534e5853 // "SXNS"
+#define SINDEX_SNAPSHOT_VERSION	2
+
+typedef struct sindex_snapshot_header_s {
+	uint32_t magic;
+	uint32_t version;
+	char     ns_name[AS_ID_NAMESPACE_SZ];
+	uint64_t random; // device header random of the run that wrote it
+	uint32_t n_sindexes;
+} __attribute__ ((__packed__)) sindex_snapshot_header;
+
+typedef struct sindex_snapshot_dir_s {
+	char     iname[AS_ID_INAME_SZ];
+	char     set[AS_SET_NAME_MAX_SIZE];
+	char     path_str[AS_SINDEX_MAX_PATH_LENGTH];
+	uint8_t  sktype;
+	uint8_t  itype;
+	uint64_t n_entries;
+} __attribute__ ((__packed__)) sindex_snapshot_dir;
+
+typedef struct sindex_snapshot_write_s {
+	FILE     * fp;
+	size_t     key_sz;
+	uint64_t   n_entries;
+} sindex_snapshot_write;
+
+static size_t
+as_sindex__snapshot_key_sz(as_sindex_metadata *imd)
+{
+	return C_IS_DG(imd->sktype) ? sizeof(cf_digest) : sizeof(uint64_t);
+}
+
+static void
+as_sindex__snapshot_dir_fill(as_sindex_metadata *imd, sindex_snapshot_dir *dir)
+{
+	memset(dir, 0, sizeof(sindex_snapshot_dir));
+	strncpy(dir->iname, imd->iname, sizeof(dir->iname) - 1);
+	if (imd->set) {
+		strncpy(dir->set, imd->set, sizeof(dir->set) - 1);
+	}
+	if (imd->path_str) {
+		strncpy(dir->path_str, imd->path_str, sizeof(dir->path_str) - 1);
+	}
+	dir->sktype = imd->sktype;
+	dir->itype = (uint8_t)imd->itype;
+}
+
+static bool
+as_sindex__snapshot_write_entry(void *skey, cf_digest *value, void *udata)
+{
+	sindex_snapshot_write *sw = (sindex_snapshot_write *)udata;
+
+	if (fwrite(skey, sw->key_sz, 1, sw->fp) != 1 ||
+			fwrite(value, sizeof(cf_digest), 1, sw->fp) != 1) {
+		return false;
+	}
+	sw->n_entries++;
+	return true;
+}
+
+// Caller holds SINDEX_GRLOCK.
+static bool
+as_sindex__snapshot_write(as_namespace *ns, FILE *fp, uint64_t *p_n_entries)
+{
+	as_sindex *sis[AS_SINDEX_MAX];
+	uint32_t n_sis = 0;
+
+	for (int i = 0; i < AS_SINDEX_MAX; i++) {
+		as_sindex *si = &ns->sindex[i];
+		if (!as_sindex_isactive(si)) {
+			continue;
+		}
+		if (!(si->flag & AS_SINDEX_FLAG_RACTIVE)) {
+			cf_warning(AS_SINDEX, "{%s} sindex %s still populating - no snapshot",
+					ns->name, si->imd->iname);
+			return false;
+		}
+		sis[n_sis++] = si;
+	}
+
+	sindex_snapshot_header header = {
+			.magic = SINDEX_SNAPSHOT_MAGIC,
+			.version = SINDEX_SNAPSHOT_VERSION,
+			.random = as_storage_header_random(ns),
+			.n_sindexes = n_sis
+	};
+	memset(header.ns_name, 0, sizeof(header.ns_name));
+	strncpy(header.ns_name, ns->name, sizeof(header.ns_name) - 1);
+
+	sindex_snapshot_dir *dirs = cf_malloc(n_sis * sizeof(sindex_snapshot_dir));
+	bool ok = false;
+
+	for (uint32_t i = 0; i < n_sis; i++) {
+		as_sindex__snapshot_dir_fill(sis[i]->imd, &dirs[i]);
+	}
+
+	// Directory is written again below, once the entry counts are known.
+	if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+			fwrite(dirs, sizeof(sindex_snapshot_dir), n_sis, fp) != n_sis) {
+		goto END;
+	}
+
+	for (uint32_t i = 0; i < n_sis; i++) {
+		as_sindex_metadata *imd = sis[i]->imd;
+		sindex_snapshot_write sw = {
+				.fp = fp,
+				.key_sz = as_sindex__snapshot_key_sz(imd),
+				.n_entries = 0
+		};
+
+		for (int j = 0; j < imd->nprts; j++) {
+			as_sindex_pmetadata *pimd = &imd->pimd[j];
+
+			PIMD_RLOCK(&pimd->slock);
+			bool reduced = ai_btree_reduce(imd, pimd, as_sindex__snapshot_write_entry, &sw);
+			PIMD_RUNLOCK(&pimd->slock);
+
+			if (!reduced) {
+				goto END;
+			}
+		}
+
+		dirs[i].n_entries = sw.n_entries;
+		*p_n_entries += sw.n_entries;
+	}
+
+	uint32_t magic = SINDEX_SNAPSHOT_MAGIC;
+
+	if (fwrite(&magic, sizeof(magic), 1, fp) != 1 ||
+			fseek(fp, sizeof(header), SEEK_SET) != 0 ||
+			fwrite(dirs, sizeof(sindex_snapshot_dir), n_sis, fp) != n_sis) {
+		goto END;
+	}
+
+	ok = true;
+
+END:
+	cf_free(dirs);
+	return ok;
+}
+
+static void
+as_sindex__snapshot_save(as_namespace *ns)
+{
+	char tmp_path[PATH_MAX];
+
+	if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", ns->sindex_snapshot_file) >=
+			(int)sizeof(tmp_path)) {
+		cf_warning(AS_SINDEX, "{%s} sindex snapshot path too long", ns->name);
+		return;
+	}
+
+	FILE *fp = fopen(tmp_path, "w");
+
+	if (!fp) {
+		cf_warning(AS_SINDEX, "{%s} failed to open sindex snapshot %s: %s",
+				ns->name, tmp_path, cf_strerror(errno));
+		return;
+	}
+
+	uint64_t start_ms = cf_getms();
+	uint64_t n_entries = 0;
+
+	SINDEX_GRLOCK();
+	bool ok = as_sindex__snapshot_write(ns, fp, &n_entries);
+	SINDEX_GRUNLOCK();
+
+	ok = ok && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+	ok = fclose(fp) == 0 && ok;
+
+	if (!ok || rename(tmp_path, ns->sindex_snapshot_file) != 0) {
+		cf_warning(AS_SINDEX, "{%s} failed to write sindex snapshot %s",
+				ns->name, ns->sindex_snapshot_file);
+		unlink(tmp_path);
+		return;
+	}
+
+	cf_info(AS_SINDEX, "{%s} wrote sindex snapshot - %"PRIu64" entries in %"PRIu64" ms",
+			ns->name, n_entries, cf_getms() - start_ms);
+}
+
+static bool
+as_sindex__snapshot_read(as_namespace *ns, FILE *fp)
+{
+	sindex_snapshot_header header;
+
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+			header.magic != SINDEX_SNAPSHOT_MAGIC ||
+			header.version != SINDEX_SNAPSHOT_VERSION ||
+			strncmp(header.ns_name, ns->name, sizeof(header.ns_name)) != 0) {
+		cf_warning(AS_SINDEX, "{%s} sindex snapshot has bad header", ns->name);
+		return false;
+	}
+
+	uint64_t prev_random = as_storage_prev_header_random(ns);
+
+	if (prev_random == 0 || header.random != prev_random) {
+		cf_warning(AS_SINDEX, "{%s} sindex snapshot does not match devices", ns->name);
+		return false;
+	}
+
+	// A cold start device sweep may bring back deleted records the snapshot
+	// does not have - only a primary index snapshot restores the same set.
+	if (ns->cold_start && ! ns->index_snapshot_loaded) {
+		cf_warning(AS_SINDEX, "{%s} primary index not loaded from snapshot",
+				ns->name);
+		return false;
+	}
+
+	uint32_t n_active = 0;
+
+	for (int i = 0; i < AS_SINDEX_MAX; i++) {
+		if (as_sindex_isactive(&ns->sindex[i])) {
+			n_active++;
+		}
+	}
+
+	if (header.n_sindexes != n_active) {
+		cf_warning(AS_SINDEX, "{%s} sindex snapshot has %u sindexes, expected %u",
+				ns->name, header.n_sindexes, n_active);
+		return false;
+	}
+
+	// Match every directory entry to an identically defined sindex, and check
+	// the file is complete before changing any tree.
+
+	sindex_snapshot_dir *dirs = cf_malloc(n_active * sizeof(sindex_snapshot_dir));
+	as_sindex *sis[AS_SINDEX_MAX];
+	uint64_t expected_sz = sizeof(header) + (n_active * sizeof(sindex_snapshot_dir)) +
+			sizeof(uint32_t);
+	bool ok = false;
+
+	if (fread(dirs, sizeof(sindex_snapshot_dir), n_active, fp) != n_active) {
+		cf_warning(AS_SINDEX, "{%s} sindex snapshot truncated", ns->name);
+		goto END;
+	}
+
+	for (uint32_t i = 0; i < n_active; i++) {
+		dirs[i].iname[AS_ID_INAME_SZ - 1] = 0;
+
+		as_sindex *si = as_sindex_lookup_by_iname_lockfree(ns, dirs[i].iname,
+				AS_SINDEX_LOOKUP_FLAG_ISACTIVE | AS_SINDEX_LOOKUP_FLAG_NORESERVE);
+		sindex_snapshot_dir cur;
+
+		if (si) {
+			as_sindex__snapshot_dir_fill(si->imd, &cur);
+			cur.n_entries = dirs[i].n_entries;
+		}
+
+		if (!si || memcmp(&cur, &dirs[i], sizeof(cur)) != 0) {
+			cf_warning(AS_SINDEX, "{%s} sindex snapshot definition of %s does not match",
+					ns->name, dirs[i].iname);
+			goto END;
+		}
+
+		sis[i] = si;
+		expected_sz += dirs[i].n_entries *
+				(as_sindex__snapshot_key_sz(si->imd) + sizeof(cf_digest));
+	}
+
+	struct stat st;
+	uint32_t magic = 0;
+	long entries_offset = ftell(fp);
+
+	if (fstat(fileno(fp), &st) != 0 || (uint64_t)st.st_size != expected_sz ||
+			fseek(fp, -(long)sizeof(magic), SEEK_END) != 0 ||
+			fread(&magic, sizeof(magic), 1, fp) != 1 ||
+			magic != SINDEX_SNAPSHOT_MAGIC ||
+			fseek(fp, entries_offset, SEEK_SET) != 0) {
+		cf_warning(AS_SINDEX, "{%s} sindex snapshot incomplete", ns->name);
+		goto END;
+	}
+
+	for (uint32_t i = 0; i < n_active; i++) {
+		as_sindex *si = sis[i];
+		as_sindex_metadata *imd = si->imd;
+		size_t key_sz = as_sindex__snapshot_key_sz(imd);
+
+		for (uint64_t n = 0; n < dirs[i].n_entries; n++) {
+			as_sindex_key skey;
+			cf_digest keyd;
+
+			if (fread(&skey.key, key_sz, 1, fp) != 1 ||
+					fread(&keyd, sizeof(keyd), 1, fp) != 1) {
+				// Size was checked - the sindex is now partially loaded.
+				cf_crash(AS_SINDEX, "{%s} failed reading sindex snapshot: %s",
+						ns->name, cf_strerror(errno));
+			}
+
+			as_sindex_pmetadata *pimd = &imd->pimd[ai_btree_key_hash(imd, &skey.key)];
+
+			PIMD_WLOCK(&pimd->slock);
+			int ret = ai_btree_put(imd, pimd, &skey.key, &keyd);
+			PIMD_WUNLOCK(&pimd->slock);
+
+			if (ret == AS_SINDEX_OK) {
+				cf_atomic64_incr(&si->stats.n_objects);
+			}
+		}
+	}
+
+	ok = true;
+
+END:
+	cf_free(dirs);
+	return ok;
+}
+
+static bool
+as_sindex__snapshot_load(as_namespace *ns)
+{
+	if (!ns->sindex_snapshot_file) {
+		return false;
+	}
+
+	FILE *fp = fopen(ns->sindex_snapshot_file, "r");
+
+	if (!fp) {
+		if (errno != ENOENT) {
+			cf_warning(AS_SINDEX, "{%s} failed to open sindex snapshot %s: %s",
+					ns->name, ns->sindex_snapshot_file, cf_strerror(errno));
+		}
+		else {
+			cf_info(AS_SINDEX, "{%s} no sindex snapshot - will rebuild", ns->name);
+		}
+		return false;
+	}
+
+	uint64_t start_ms = cf_getms();
+
+	SINDEX_GRLOCK();
+	bool ok = as_sindex__snapshot_read(ns, fp);
+	SINDEX_GRUNLOCK();
+
+	fclose(fp);
+
+	// Once this node takes writes the snapshot is stale - never use it twice.
+	unlink(ns->sindex_snapshot_file);
+
+	if (!ok) {
+		cf_warning(AS_SINDEX, "{%s} ignoring sindex snapshot - will rebuild", ns->name);
+		return false;
+	}
+
+	ns->sindex_snapshot_loaded = true;
+	ns->sindex_snapshot_load_ms = cf_getms() - start_ms;
+
+	cf_info(AS_SINDEX, "{%s} loaded sindex snapshot in %"PRIu64" ms", ns->name,
+			ns->sindex_snapshot_load_ms);
+
+	return true;
+}
+
+void
+as_sindex_shutdown()
+{
+	if (!g_sindex_boot_done) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < g_config.n_namespaces; i++) {
+		as_namespace *ns = g_config.namespaces[i];
+
+		if (ns->sindex_snapshot_file && ! ns->storage_data_in_memory &&
+				ns->sindex_cnt != 0) {
+			as_sindex__snapshot_save(ns);
+		}
+	}
+}
+
 /*
  * Client API to start namespace scan to populate secondary index. The scan
  * is only performed in the namespace is warm start or if its data is not in
@@ -1810,11 +2225,17 @@ as_sindex_boot_populateall()
 		}
 
 		if (! ns->storage_data_in_memory) {
-			// Data-not-in-memory (cold or warm restart) - have not yet built
-			// sindex, build it now.
-			as_sindex_populator_reserve_all(ns);
-			as_sbld_build_all(ns);
-			cf_info(AS_SINDEX, "Queuing namespace %s for sindex population ", ns->name);
+			if (as_sindex__snapshot_load(ns)) {
+				// Loaded the snapshot written at clean shutdown.
+				as_sindex_boot_populateall_done(ns);
+			}
+			else {
+				// Data-not-in-memory (cold or warm restart) - have not yet
+				// built sindex, build it now.
+				as_sindex_populator_reserve_all(ns);
+				as_sbld_build_all(ns);
+				cf_info(AS_SINDEX, "Queuing namespace %s for sindex population ", ns->name);
+			}
 		} else {
 			// Data-in-memory (cold or cool restart) - already built sindex.
 			as_sindex_boot_populateall_done(ns);
@@ -1834,7 +2255,7 @@ as_sindex_boot_populateall()
 			continue;
 		}
 
-		if (! ns->storage_data_in_memory) {
+		if (! ns->storage_data_in_memory && ! ns->sindex_snapshot_loaded) {
 			// Data-not-in-memory - finished sindex building job.
 			as_sindex_populator_release_all(ns);
 		}
@@ -2196,6 +2617,340 @@ END:
 //                                        END - SINDEX BIN PATH
 // ************************************************************************************************
 // ************************************************************************************************
+//                                         COMPOSITE INDEX
+// A composite index covers an ordered tuple of bins. Its keys are 20 byte
+// digests, ordered by ai_btree's u160 compare which treats bytes 4-19 as a
+// native uint128:
+//
+//   bytes 12-19 : hash of the leading bin values (equality only)
+//   bytes 4-11  : last bin value - integers sign-flipped so they sort as
+//                 unsigned, strings hashed (equality only)
+//   bytes 0-3   : zero
+//
+// So equality on the leading bins plus a range on the last bin is a single
+// contiguous key range. Hash collisions on the prefix are filtered out by the
+// query's record validation.
+
+#define COMPOSITE_INT_FLIP 0x8000000000000000UL
+
+// Value of one bin of the tuple - integers as is, strings as their digest.
+typedef struct composite_val_s {
+	as_sindex_ktype type;
+	int64_t         i64;
+	cf_digest       digest;
+} composite_val;
+
+static uint64_t
+composite_prefix(const composite_val *vals, uint32_t n_leading)
+{
+	uint8_t buf[AS_SINDEX_MAX_COMPOSITE_BINS * CF_DIGEST_KEY_SZ];
+	uint32_t sz = 0;
+
+	for (uint32_t i = 0; i < n_leading; i++) {
+		if (vals[i].type == COL_TYPE_LONG) {
+			memcpy(buf + sz, &vals[i].i64, sizeof(int64_t));
+			sz += sizeof(int64_t);
+		}
+		else {
+			memcpy(buf + sz, &vals[i].digest, CF_DIGEST_KEY_SZ);
+			sz += CF_DIGEST_KEY_SZ;
+		}
+	}
+
+	cf_digest d;
+	uint64_t prefix;
+
+	cf_digest_compute(buf, sz, &d);
+	memcpy(&prefix, &d, sizeof(uint64_t));
+
+	return prefix;
+}
+
+static uint64_t
+composite_last(const composite_val *val)
+{
+	if (val->type == COL_TYPE_LONG) {
+		return (uint64_t)val->i64 ^ COMPOSITE_INT_FLIP;
+	}
+
+	uint64_t last;
+
+	memcpy(&last, &val->digest, sizeof(uint64_t));
+
+	return last;
+}
+
+static void
+composite_key_make(uint64_t prefix, uint64_t last, cf_digest *key)
+{
+	memset(key, 0, sizeof(cf_digest));
+	memcpy(&key->digest[4], &last, sizeof(uint64_t));
+	memcpy(&key->digest[12], &prefix, sizeof(uint64_t));
+}
+
+/*
+ * Composite index bins are specified as "bin1,type1,bin2,type2[,...]" - plain
+ * bin names, types numeric or string. Sets imd->path_str to the canonical form.
+ */
+as_sindex_status
+as_sindex_extract_composite_bins(as_sindex_metadata * imd, const char * path_str)
+{
+	if (strlen(path_str) >= AS_SINDEX_MAX_PATH_LENGTH) {
+		cf_warning(AS_SINDEX, "Composite bin list length exceeds the maximum allowed.");
+		return AS_SINDEX_ERR;
+	}
+
+	char buf[AS_SINDEX_MAX_PATH_LENGTH];
+	strcpy(buf, path_str);
+
+	cf_vector *str_v = cf_vector_create(sizeof(void *), 2 * AS_SINDEX_MAX_COMPOSITE_BINS,
+			VECTOR_FLAG_INITZERO);
+	cf_str_split(",", buf, str_v);
+
+	as_sindex_status rv = AS_SINDEX_ERR;
+	uint32_t n_parts = cf_vector_size(str_v);
+
+	if (n_parts < 4 || (n_parts & 1) != 0 ||
+			n_parts > 2 * AS_SINDEX_MAX_COMPOSITE_BINS) {
+		cf_warning(AS_SINDEX, "Composite index needs 2 to %d bin,type pairs",
+				AS_SINDEX_MAX_COMPOSITE_BINS);
+		goto END;
+	}
+
+	char canon[AS_SINDEX_MAX_PATH_LENGTH];
+	size_t canon_len = 0;
+
+	for (uint32_t i = 0; i < n_parts / 2; i++) {
+		char *bname = NULL;
+		char *type_str = NULL;
+
+		cf_vector_get(str_v, 2 * i, &bname);
+		cf_vector_get(str_v, 2 * i + 1, &type_str);
+
+		size_t len = strlen(bname);
+
+		if (len == 0 || len >= AS_ID_BIN_SZ) {
+			cf_warning(AS_SINDEX, "Composite index bin name '%s' invalid", bname);
+			goto END;
+		}
+
+		for (uint32_t j = 0; j < i; j++) {
+			if (strcmp(imd->cbnames[j], bname) == 0) {
+				cf_warning(AS_SINDEX, "Composite index bin %s repeated", bname);
+				goto END;
+			}
+		}
+
+		as_sindex_ktype ktype = as_sindex_ktype_from_string(type_str);
+
+		if (ktype != COL_TYPE_LONG && ktype != COL_TYPE_DIGEST) {
+			cf_warning(AS_SINDEX, "Composite index bin %s must be numeric or string",
+					bname);
+			goto END;
+		}
+
+		imd->cbnames[i] = cf_strdup(bname);
+		imd->cbtypes[i] = ktype;
+		imd->n_cbins    = i + 1;
+
+		canon_len += snprintf(canon + canon_len, sizeof(canon) - canon_len,
+				"%s%s,%s", i == 0 ? "" : ",", bname, as_sindex_ktype_str(ktype));
+	}
+
+	if (imd->bname) {
+		cf_free(imd->bname);
+	}
+
+	if (imd->path_str) {
+		cf_free(imd->path_str);
+	}
+
+	imd->bname       = cf_strdup(imd->cbnames[0]);
+	imd->path_str    = cf_strdup(canon);
+	imd->path_length = 0;
+	imd->sktype      = COL_TYPE_DIGEST;
+	rv = AS_SINDEX_OK;
+
+END:
+	cf_vector_destroy(str_v);
+	return rv;
+}
+
+/*
+ * Builds the composite key from a record's bins. Returns false if the record
+ * doesn't have every bin of the tuple with the indexed type.
+ */
+bool
+as_sindex_composite_key_from_bins(as_sindex_metadata *imd, const as_bin *bins,
+		uint32_t n_bins, cf_digest *key)
+{
+	composite_val vals[AS_SINDEX_MAX_COMPOSITE_BINS];
+
+	for (uint32_t i = 0; i < imd->n_cbins; i++) {
+		const as_bin *b = NULL;
+
+		for (uint32_t j = 0; j < n_bins; j++) {
+			if (as_bin_inuse(&bins[j]) && bins[j].id == imd->cbinids[i]) {
+				b = &bins[j];
+				break;
+			}
+		}
+
+		if (! b) {
+			return false;
+		}
+
+		uint8_t type = as_bin_get_particle_type(b);
+
+		vals[i].type = imd->cbtypes[i];
+
+		if (imd->cbtypes[i] == COL_TYPE_LONG) {
+			if (type != AS_PARTICLE_TYPE_INTEGER) {
+				return false;
+			}
+
+			vals[i].i64 = as_bin_particle_integer_value(b);
+		}
+		else {
+			if (type != AS_PARTICLE_TYPE_STRING) {
+				return false;
+			}
+
+			char *str;
+			uint32_t len = as_bin_particle_string_ptr(b, &str);
+
+			if (len > AS_SINDEX_MAX_STRING_KSIZE) {
+				return false;
+			}
+
+			cf_digest_compute(str, len, &vals[i].digest);
+		}
+	}
+
+	composite_key_make(composite_prefix(vals, imd->n_cbins - 1),
+			composite_last(&vals[imd->n_cbins - 1]), key);
+
+	return true;
+}
+
+/*
+ * Reserves the active composite indexes over the set. Caller provides space
+ * for ns->n_composite_sindexes entries.
+ * Should happen under SINDEX_GRLOCK.
+ */
+int
+as_sindex_composite_lookup_lockfree(as_namespace *ns, const char *set,
+		as_sindex_composite_keys ckeys[])
+{
+	int n_ckeys = 0;
+	uint32_t n_seen = 0;
+
+	for (int i = 0; i < AS_SINDEX_MAX && n_seen < ns->n_composite_sindexes; i++) {
+		as_sindex *si = &ns->sindex[i];
+
+		if (si->state == AS_SINDEX_INACTIVE || ! si->imd ||
+				! as_sindex_is_composite(si->imd)) {
+			continue;
+		}
+
+		n_seen++;
+
+		// Reserve only active sindexes.
+		if (! as_sindex_isactive(si) || ! as_sindex__setname_match(si->imd, set)) {
+			continue;
+		}
+
+		AS_SINDEX_RESERVE(si);
+
+		as_sindex_composite_keys *ck = &ckeys[n_ckeys++];
+
+		ck->si        = si;
+		ck->old_valid = false;
+		ck->new_valid = false;
+	}
+
+	return n_ckeys;
+}
+
+void
+as_sindex_composite_keys_from_bins(as_sindex_composite_keys ckeys[], int n_ckeys,
+		const as_bin *bins, uint32_t n_bins, bool is_new)
+{
+	for (int i = 0; i < n_ckeys; i++) {
+		as_sindex_composite_keys *ck = &ckeys[i];
+
+		if (is_new) {
+			ck->new_valid = as_sindex_composite_key_from_bins(ck->si->imd, bins,
+					n_bins, &ck->new_key);
+		}
+		else {
+			ck->old_valid = as_sindex_composite_key_from_bins(ck->si->imd, bins,
+					n_bins, &ck->old_key);
+		}
+	}
+}
+
+static void
+as_sindex__composite_op(as_sindex *si, cf_digest *skey, cf_digest *keyd,
+		as_sindex_op op)
+{
+	as_sindex_metadata *imd = si->imd;
+	as_sindex_pmetadata *pimd = &imd->pimd[ai_btree_key_hash(imd, skey)];
+	uint64_t starttime = si->enable_histogram ? cf_getns() : 0;
+
+	PIMD_WLOCK(&pimd->slock);
+
+	int ret = op == AS_SINDEX_OP_DELETE ?
+			ai_btree_delete(imd, pimd, skey, keyd) :
+			ai_btree_put(imd, pimd, skey, keyd);
+
+	PIMD_WUNLOCK(&pimd->slock);
+
+	as_sindex__process_ret(si, ret, op, starttime, __LINE__);
+}
+
+/*
+ * Deletes old keys and inserts new keys which differ. Returns true if any
+ * composite index was touched.
+ */
+bool
+as_sindex_composite_update(as_sindex_composite_keys ckeys[], int n_ckeys,
+		cf_digest *keyd)
+{
+	bool touched = false;
+
+	for (int i = 0; i < n_ckeys; i++) {
+		as_sindex_composite_keys *ck = &ckeys[i];
+
+		if (ck->old_valid && ck->new_valid &&
+				memcmp(&ck->old_key, &ck->new_key, sizeof(cf_digest)) == 0) {
+			continue;
+		}
+
+		if (ck->old_valid) {
+			as_sindex__composite_op(ck->si, &ck->old_key, keyd, AS_SINDEX_OP_DELETE);
+			touched = true;
+		}
+
+		if (ck->new_valid) {
+			as_sindex__composite_op(ck->si, &ck->new_key, keyd, AS_SINDEX_OP_INSERT);
+			touched = true;
+		}
+	}
+
+	return touched;
+}
+
+void
+as_sindex_composite_release(as_sindex_composite_keys ckeys[], int n_ckeys)
+{
+	for (int i = 0; i < n_ckeys; i++) {
+		AS_SINDEX_RELEASE(ckeys[i].si);
+	}
+}
+//                                       END - COMPOSITE INDEX
+// ************************************************************************************************
+// ************************************************************************************************
 //                                                SINDEX QUERY
 /*
  * Returns -
@@ -2374,6 +3129,133 @@ as_sindex_binlist_from_msg(as_namespace *ns, as_msg *msgp, int * num_bins)
 	return binlist;
 }
 
+/*
+ * Returns -
+ *		AS_SINDEX_OK        - On success.
+ *		AS_SINDEX_ERR_PARAM - On failure.
+ *		AS_SINDEX_ERR_BIN_NOTFOUND - On failure.
+ *
+ * Description -
+ *		Frames the as_sindex_range of a composite index query from msg. Ranges
+ *		are on plain bins, in index order - all but the last must be equality,
+ *		the last may be an integer range. The srange carries the composite
+ *		index path and the encoded start and end keys.
+ */
+static int
+as_sindex__composite_range_from_msg(as_namespace *ns, const uint8_t *data, int numrange,
+		as_sindex_range *srange)
+{
+	if (srange->itype != AS_SINDEX_ITYPE_DEFAULT) {
+		cf_warning(AS_SINDEX, "Composite index query must have default index type");
+		return AS_SINDEX_ERR_PARAM;
+	}
+
+	composite_val vals[AS_SINDEX_MAX_COMPOSITE_BINS];
+	int64_t last_end = 0;
+	size_t path_len  = 0;
+
+	for (int i = 0; i < numrange; i++) {
+		uint8_t bin_path_len = *data++;
+		if (bin_path_len == 0 || bin_path_len >= AS_ID_BIN_SZ) {
+			cf_warning(AS_SINDEX, "Composite query bin name size %d invalid", bin_path_len);
+			return AS_SINDEX_ERR_PARAM;
+		}
+
+		char binname[AS_ID_BIN_SZ];
+		memcpy(binname, data, bin_path_len);
+		binname[bin_path_len] = '\0';
+		data += bin_path_len;
+
+		int16_t id = as_bin_get_id(ns, binname);
+		if (id == -1) {
+			return AS_SINDEX_ERR_BIN_NOTFOUND;
+		}
+
+		if (i == 0) {
+			srange->start.id = id;
+			srange->end.id   = id;
+		}
+
+		int type = *data++;
+
+		uint32_t startl = ntohl(*((uint32_t *)data));
+		data           += sizeof(uint32_t);
+		const uint8_t *start_binval = data;
+		data           += startl;
+
+		uint32_t endl   = ntohl(*((uint32_t *)data));
+		data           += sizeof(uint32_t);
+		const uint8_t *end_binval = data;
+		data           += endl;
+
+		if (type == AS_PARTICLE_TYPE_INTEGER) {
+			if (startl != 8 || endl != 8) {
+				cf_warning(AS_SINDEX, "Can only handle 8 byte numerics right now");
+				return AS_SINDEX_ERR_PARAM;
+			}
+
+			int64_t start = __cpu_to_be64(*((uint64_t *)start_binval));
+			int64_t end   = __cpu_to_be64(*((uint64_t *)end_binval));
+
+			if (start > end) {
+				cf_warning(AS_SINDEX, "Invalid range from %ld to %ld", start, end);
+				return AS_SINDEX_ERR_PARAM;
+			}
+
+			if (i != numrange - 1 && start != end) {
+				cf_warning(AS_SINDEX, "Only the last bin of a composite query can be a range");
+				return AS_SINDEX_ERR_PARAM;
+			}
+
+			vals[i].type = COL_TYPE_LONG;
+			vals[i].i64  = start;
+			last_end     = end;
+		}
+		else if (type == AS_PARTICLE_TYPE_STRING) {
+			if (startl >= AS_SINDEX_MAX_STRING_KSIZE) {
+				cf_warning(AS_SINDEX, "Query on bin %s fails. Value length %u too long.", binname, startl);
+				return AS_SINDEX_ERR_PARAM;
+			}
+
+			if (startl != endl || memcmp(start_binval, end_binval, startl) != 0) {
+				cf_warning(AS_SINDEX, "Only Equality Query Supported in Strings");
+				return AS_SINDEX_ERR_PARAM;
+			}
+
+			vals[i].type = COL_TYPE_DIGEST;
+			cf_digest_compute(start_binval, startl, &vals[i].digest);
+		}
+		else {
+			cf_warning(AS_SINDEX, "Composite query only handles String and Numeric type");
+			return AS_SINDEX_ERR_PARAM;
+		}
+
+		path_len += snprintf(srange->bin_path + path_len, AS_SINDEX_MAX_PATH_LENGTH - path_len,
+				"%s%s,%s", i == 0 ? "" : ",", binname, as_sindex_ktype_str(vals[i].type));
+	}
+
+	uint64_t prefix     = composite_prefix(vals, numrange - 1);
+	composite_val *last = &vals[numrange - 1];
+	uint64_t lo         = composite_last(last);
+
+	if (last->type == COL_TYPE_LONG) {
+		last->i64 = last_end;
+	}
+
+	uint64_t hi         = composite_last(last);
+
+	composite_key_make(prefix, lo, &srange->start.digest);
+	composite_key_make(prefix, hi, &srange->end.digest);
+
+	// Composite keys are digests - same as string indexes.
+	srange->start.type = AS_PARTICLE_TYPE_STRING;
+	srange->end.type   = AS_PARTICLE_TYPE_STRING;
+	srange->isrange    = lo != hi;
+	srange->num_binval = numrange;
+
+	return AS_SINDEX_OK;
+}
+
 /*
  * Returns -
  *		AS_SINDEX_OK        - On success.
@@ -2383,7 +3265,8 @@ as_sindex_binlist_from_msg(as_namespace *ns, as_msg *msgp, int * num_bins)
  * Description -
  *		Frames a sane as_sindex_range from msg.
  *
- *		We are not supporting multiranges right now. So numrange is always expected to be 1.
+ *		Multiple ranges are only supported for composite indexes - see
+ *		as_sindex__composite_range_from_msg().
  */
 int
 as_sindex_range_from_msg(as_namespace *ns, as_msg *msgp, as_sindex_range *srange)
@@ -2403,9 +3286,9 @@ as_sindex_range_from_msg(as_namespace *ns, as_msg *msgp, as_sindex_range *srange
 	const uint8_t *data = rfp->data;
 	int numrange        = *data++;
 
-	if (numrange != 1) {
+	if (numrange < 1 || numrange > AS_SINDEX_MAX_COMPOSITE_BINS) {
 		cf_warning(AS_SINDEX,
-					"can't handle multiple ranges right now %d", rfp->data[0]);
+					"can't handle %d ranges", rfp->data[0]);
 		return AS_SINDEX_ERR_PARAM;
 	}
 	// NOTE - to support geospatial queries the srange object is actually a vector
@@ -2419,6 +3302,11 @@ as_sindex_range_from_msg(as_namespace *ns, as_msg *msgp, as_sindex_range *srange
 	else {
 		srange->itype = AS_SINDEX_ITYPE_DEFAULT;
 	}
+
+	// Multiple ranges - served by a composite index over the ranges' bins.
+	if (numrange > 1) {
+		return as_sindex__composite_range_from_msg(ns, data, numrange, srange);
+	}
 	for (int i = 0; i < numrange; i++) {
 		as_sindex_bin_data *start = &(srange->start);
 		as_sindex_bin_data *end   = &(srange->end);
@@ -3648,8 +4536,7 @@ as_sindex_sbins_list_diff_populate(as_sindex_bin *sbins, as_namespace *ns, const
 		int simatch = si_ele->simatch;
 		as_sindex *si = &ns->sindex[simatch];
 
-		if (! as_sindex_isactive(si)) {
-			ele = ele->next;
+		if (! as_sindex_isactive(si) || as_sindex_is_composite(si->imd)) {
 			continue;
 		}
 
@@ -3849,7 +4736,8 @@ as_sindex_sbins_from_bin_buf(as_namespace *ns, const char *set, const as_bin *b,
 		si_ele                = (sindex_set_binid_hash_ele *) ele;
 		simatch               = si_ele->simatch;
 		si                    = &ns->sindex[simatch];
-		if (!as_sindex_isactive(si)) {
+		// Composite indexes are maintained via as_sindex_composite_update().
+		if (!as_sindex_isactive(si) || as_sindex_is_composite(si->imd)) {
 			ele = ele->next;
 			continue;
 		}
@@ -3965,6 +4853,17 @@ as_sindex_put_rd(as_sindex *si, as_storage_rd *rd)
 		return AS_SINDEX_OK;
 	}
 
+	if (as_sindex_is_composite(imd)) {
+		cf_digest ckey;
+		bool valid = as_sindex_composite_key_from_bins(imd, rd->bins, rd->n_bins, &ckey);
+		SINDEX_GRUNLOCK();
+
+		if (valid) {
+			as_sindex__composite_op(si, &ckey, &rd->r->keyd, AS_SINDEX_OP_INSERT);
+		}
+		return AS_SINDEX_OK;
+	}
+
 	// collect sbins
 	SINDEX_BINS_SETUP(sbins, 1);
 
@@ -4254,7 +5153,14 @@ smd_key_to_imd(const char *smd_key, as_sindex_metadata *imd)
 	memcpy(imd->path_str, read, path_len);
 	imd->path_str[path_len] = 0;
 
-	if (as_sindex_extract_bin_path(imd, imd->path_str) != AS_SINDEX_OK) {
+	// Composite index - path is the bin,type list.
+	if (strchr(imd->path_str, ',')) {
+		if (as_sindex_extract_composite_bins(imd, imd->path_str) != AS_SINDEX_OK) {
+			cf_warning(AS_SINDEX, "smd - can't parse composite bins");
+			return false;
+		}
+	}
+	else if (as_sindex_extract_bin_path(imd, imd->path_str) != AS_SINDEX_OK) {
 		cf_warning(AS_SINDEX, "smd - can't parse path");
 		return false;
 	}
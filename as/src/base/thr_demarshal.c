@@ -85,6 +85,10 @@ cf_tls_info *g_service_tls;
 
 static cf_sockets g_sockets;
 
+// Optional AF_UNIX listener for co-located clients.
+static cf_sock_cfg g_unix_cfg = { .owner = CF_SOCK_OWNER_SERVICE_UNIX };
+static cf_sockets g_unix_sockets = { .n_socks = 0 };
+
 //
 // File handle reaper.
 //
@@ -415,6 +419,11 @@ thr_demarshal(void *unused)
 
 		cf_poll_add_sockets(poll, &g_sockets, EPOLLIN | EPOLLERR | EPOLLHUP);
 		cf_socket_show_server(AS_DEMARSHAL, "client", &g_sockets);
+
+		if (g_unix_sockets.n_socks != 0) {
+			cf_poll_add_sockets(poll, &g_unix_sockets, EPOLLIN | EPOLLERR | EPOLLHUP);
+			cf_info(AS_DEMARSHAL, "Started client endpoint unix:%s", g_config.service_unix_path);
+		}
 	}
 
 	g_demarshal_args->polls[thr_id] = poll;
@@ -438,7 +447,8 @@ thr_demarshal(void *unused)
 		for (i = 0; i < nevents; i++) {
 			cf_socket *ssock = events[i].data;
 
-			if (cf_sockets_has_socket(&g_sockets, ssock)) {
+			if (cf_sockets_has_socket(&g_sockets, ssock) ||
+					cf_sockets_has_socket(&g_unix_sockets, ssock)) {
 				// Accept new connections on the service socket.
 				cf_socket csock;
 				cf_sock_addr sa;
@@ -458,13 +468,34 @@ thr_demarshal(void *unused)
 					cf_crash(AS_DEMARSHAL, "accept: %s (errno %d)", cf_strerror(errno), errno);
 				}
 
+				cf_sock_cfg *cfg = ssock->cfg;
+				bool is_unix = cfg->owner == CF_SOCK_OWNER_SERVICE_UNIX;
+
 				char sa_str[sizeof(((as_file_handle *)NULL)->client)];
-				cf_sock_addr_to_string_safe(&sa, sa_str, sizeof(sa_str));
+
+				if (is_unix) {
+					// Keyed like ip-addr:port - one identity per peer process,
+					// shared by its connections, as for one host's sockets.
+					int32_t pid;
+
+					if (cf_socket_peer_pid(&csock, &pid) == 0) {
+						snprintf(sa_str, sizeof(sa_str), "unix-%d:%d", pid,
+								CSFD(&csock));
+					}
+					else {
+						// Unknown process - at least don't share with others.
+						snprintf(sa_str, sizeof(sa_str), "unix-fd%d:%d",
+								CSFD(&csock), CSFD(&csock));
+					}
+				}
+				else {
+					cf_sock_addr_to_string_safe(&sa, sa_str, sizeof(sa_str));
+				}
+
 				cf_detail(AS_DEMARSHAL, "new connection: %s (fd %d)", sa_str, CSFD(&csock));
 
 				// Validate the limit of protocol connections we allow.
 				uint32_t conns_open = g_stats.proto_connections_opened - g_stats.proto_connections_closed;
-				cf_sock_cfg *cfg = ssock->cfg;
 				if (cfg->owner != CF_SOCK_OWNER_XDR && conns_open > g_config.n_proto_fd_max) {
 					if ((last_fd_print + 5000L) < cf_getms()) { // no more than 5 secs
 						cf_warning(AS_DEMARSHAL, "dropping incoming client connection: hit limit %d connections", conns_open);
@@ -492,7 +523,7 @@ thr_demarshal(void *unused)
 				fd_h->reap_me = false;
 				fd_h->proto = 0;
 				fd_h->proto_unread = (uint64_t)sizeof(as_proto);
-				fd_h->fh_info = 0;
+				fd_h->fh_info = is_unix ? FH_INFO_UNIX : 0;
 				fd_h->security_filter = as_security_filter_create();
 
 				// Insert into the global table so the reaper can manage it. Do
@@ -525,7 +556,8 @@ thr_demarshal(void *unused)
 				else {
 					int32_t id;
 
-					if (g_config.auto_pin == CF_TOPO_AUTO_PIN_NONE) {
+					// Unix domain connections never come through a NIC.
+					if (g_config.auto_pin == CF_TOPO_AUTO_PIN_NONE || is_unix) {
 						cf_detail(AS_DEMARSHAL, "no CPU pinning - dispatching incoming connection round-robin");
 						id = (id_cntr++) % g_demarshal_args->num_threads;
 					}
@@ -539,6 +571,10 @@ thr_demarshal(void *unused)
 					// Place the client socket in the event queue.
 					cf_poll_add_socket(fd_h->poll, &fd_h->sock, EPOLLIN | EPOLLONESHOT | EPOLLRDHUP, fd_h);
 					cf_atomic64_incr(&g_stats.proto_connections_opened);
+
+					if (is_unix) {
+						cf_atomic64_incr(&g_stats.unix_connections_opened);
+					}
 				}
 			}
 			else {
@@ -880,6 +916,13 @@ as_demarshal_start()
 		cf_crash(AS_DEMARSHAL, "Couldn't initialize service socket");
 	}
 
+	if (g_config.service_unix_path &&
+			cf_socket_init_server_unix(g_config.service_unix_path,
+					(mode_t)g_config.service_unix_mode, &g_unix_cfg,
+					&g_unix_sockets) < 0) {
+		cf_crash(AS_DEMARSHAL, "Couldn't initialize unix service socket");
+	}
+
 	// Create all the epoll_fds and wait for all the threads to come up.
 
 	cf_info(AS_DEMARSHAL, "starting %u demarshal threads",
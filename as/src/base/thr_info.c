@@ -54,6 +54,7 @@
 
 #include "base/batch.h"
 #include "base/cfg.h"
+#include "base/change_stream.h"
 #include "base/datamodel.h"
 #include "base/index.h"
 #include "base/monitor.h"
@@ -257,6 +258,13 @@ info_get_stats(char *name, cf_dyn_buf *db)
 	info_append_int(db, "heap_efficiency_pct", (int)(efficiency_pct + 0.5));
 	info_append_uint32(db, "heap_site_count", site_count);
 
+	uint64_t region_bytes;
+	uint64_t region_heap_bytes;
+
+	cf_alloc_region_stats(&region_bytes, &region_heap_bytes);
+	info_append_uint64(db, "txn_region_bytes", region_bytes);
+	info_append_uint64(db, "txn_region_heap_bytes", region_heap_bytes);
+
 	info_get_aggregated_namespace_stats(db);
 
 	info_append_int(db, "tsvc_queue", as_tsvc_queue_get_size());
@@ -267,9 +275,18 @@ info_get_stats(char *name, cf_dyn_buf *db)
 	info_append_int(db, "tree_gc_queue", as_index_tree_gc_queue_size());
 
 	info_append_uint64(db, "client_connections", g_stats.proto_connections_opened - g_stats.proto_connections_closed);
+	info_append_uint64(db, "client_connections_unix", g_stats.unix_connections_opened - g_stats.unix_connections_closed);
+	info_append_uint64(db, "client_connections_unix_opened", g_stats.unix_connections_opened);
 	info_append_uint64(db, "heartbeat_connections", g_stats.heartbeat_connections_opened - g_stats.heartbeat_connections_closed);
 	info_append_uint64(db, "fabric_connections", g_stats.fabric_connections_opened - g_stats.fabric_connections_closed);
 
+	info_append_uint64(db, "client_quota_read_tps_consumed", g_stats.client_quota_consumed[AS_QUOTA_READ_TPS]);
+	info_append_uint64(db, "client_quota_read_tps_rejected", g_stats.client_quota_rejected[AS_QUOTA_READ_TPS]);
+	info_append_uint64(db, "client_quota_write_tps_consumed", g_stats.client_quota_consumed[AS_QUOTA_WRITE_TPS]);
+	info_append_uint64(db, "client_quota_write_tps_rejected", g_stats.client_quota_rejected[AS_QUOTA_WRITE_TPS]);
+	info_append_uint64(db, "client_quota_write_bps_consumed", g_stats.client_quota_consumed[AS_QUOTA_WRITE_BPS]);
+	info_append_uint64(db, "client_quota_write_bps_rejected", g_stats.client_quota_rejected[AS_QUOTA_WRITE_BPS]);
+
 	info_append_uint64(db, "heartbeat_received_self", g_stats.heartbeat_received_self);
 	info_append_uint64(db, "heartbeat_received_foreign", g_stats.heartbeat_received_foreign);
 
@@ -333,6 +350,10 @@ info_get_stats(char *name, cf_dyn_buf *db)
 	info_append_uint64(db, "fabric_meta_recv_rate", g_stats.fabric_meta_r_rate);
 	info_append_uint64(db, "fabric_rw_send_rate", g_stats.fabric_rw_s_rate);
 	info_append_uint64(db, "fabric_rw_recv_rate", g_stats.fabric_rw_r_rate);
+	info_append_uint64(db, "fabric_rw_small_send_q_depth", g_stats.fabric_rw_q_depth[AS_FABRIC_SEND_CLASS_SMALL]);
+	info_append_uint64(db, "fabric_rw_small_send_q_wait_us", g_stats.fabric_rw_q_wait_avg_us[AS_FABRIC_SEND_CLASS_SMALL]);
+	info_append_uint64(db, "fabric_rw_large_send_q_depth", g_stats.fabric_rw_q_depth[AS_FABRIC_SEND_CLASS_LARGE]);
+	info_append_uint64(db, "fabric_rw_large_send_q_wait_us", g_stats.fabric_rw_q_wait_avg_us[AS_FABRIC_SEND_CLASS_LARGE]);
 
 	as_xdr_get_stats(db);
 
@@ -1481,6 +1502,9 @@ info_service_config_get(cf_dyn_buf *db)
 	info_append_uint32(db, "batch-max-unused-buffers", g_config.batch_max_unused_buffers);
 	info_append_uint32(db, "batch-priority", g_config.batch_priority);
 	info_append_uint32(db, "batch-index-threads", g_config.n_batch_index_threads);
+	info_append_uint64(db, "client-quota-read-tps", g_config.client_quota_read_tps);
+	info_append_uint64(db, "client-quota-write-bps", g_config.client_quota_write_bps);
+	info_append_uint64(db, "client-quota-write-tps", g_config.client_quota_write_tps);
 	info_append_int(db, "clock-skew-max-ms", g_config.clock_skew_max_ms);
 
 	char cluster_name[AS_CLUSTER_NAME_SZ];
@@ -1531,6 +1555,8 @@ info_service_config_get(cf_dyn_buf *db)
 	info_append_uint32(db, "sindex-builder-threads", g_config.sindex_builder_threads);
 	info_append_uint32(db, "sindex-gc-max-rate", g_config.sindex_gc_max_rate);
 	info_append_uint32(db, "sindex-gc-period", g_config.sindex_gc_period);
+	info_append_bool(db, "stale-map-hints", g_config.stale_map_hints);
+	info_append_bool(db, "stale-map-redirect", g_config.stale_map_redirect);
 	info_append_uint32(db, "ticker-interval", g_config.ticker_interval);
 	info_append_int(db, "transaction-max-ms", (int)(g_config.transaction_max_ns / 1000000));
 	info_append_uint32(db, "transaction-pending-limit", g_config.transaction_pending_limit);
@@ -1571,6 +1597,12 @@ info_network_config_get(cf_dyn_buf *db)
 	info_append_int(db, "service.tls-alternate-access-port", g_config.tls_service.alt_port);
 	append_addrs(db, "service.tls-alternate-access-address", &g_config.tls_service.alt);
 	info_append_string_safe(db, "service.tls-name", g_config.tls_service.tls_our_name);
+	info_append_string_safe(db, "service.unix-socket", g_config.service_unix_path);
+
+	char unix_mode[8];
+
+	sprintf(unix_mode, "%04o", g_config.service_unix_mode);
+	info_append_string(db, "service.unix-socket-mode", unix_mode);
 
 	for (uint32_t i = 0; i < g_config.tls_service.n_tls_peer_names; ++i) {
 		info_append_string(db, "service.tls-authenticate-client",
@@ -1668,7 +1700,10 @@ info_namespace_config_get(char* context, cf_dyn_buf *db)
 	cf_hist_track_get_settings(ns->udf_hist, db);
 	cf_hist_track_get_settings(ns->write_hist, db);
 
+	info_append_uint32(db, "change-stream-size", ns->change_stream_size);
+	info_append_bool(db, "cold-start-early-rejoin", ns->cold_start_early_rejoin);
 	info_append_uint32(db, "cold-start-evict-ttl", ns->cold_start_evict_ttl);
+	info_append_bool(db, "compact-index", ns->compact_index);
 
 	if (ns->conflict_resolution_policy == AS_NAMESPACE_CONFLICT_RESOLUTION_POLICY_GENERATION) {
 		info_append_string(db, "conflict-resolution-policy", "generation");
@@ -1700,9 +1735,11 @@ info_namespace_config_get(char* context, cf_dyn_buf *db)
 	info_append_uint32(db, "obj-size-hist-max", ns->obj_size_hist_max); // not original, may have been rounded
 	info_append_uint32(db, "partition-tree-locks", ns->tree_shared.n_lock_pairs);
 	info_append_uint32(db, "partition-tree-sprigs", ns->tree_shared.n_sprigs);
+	info_append_bool(db, "partition-tree-sprigs-auto", ns->partition_tree_sprigs_auto);
 	info_append_uint32(db, "rack-id", ns->rack_id);
 	info_append_string(db, "read-consistency-level-override", NS_READ_CONSISTENCY_LEVEL_NAME());
 	info_append_bool(db, "single-bin", ns->single_bin);
+	info_append_bool(db, "skip-unchanged-writes", ns->skip_unchanged_writes);
 	info_append_uint32(db, "stop-writes-pct", ns->stop_writes_pct);
 	info_append_uint32(db, "tomb-raider-eligible-age", ns->tomb_raider_eligible_age);
 	info_append_uint32(db, "tomb-raider-period", ns->tomb_raider_period);
@@ -1735,6 +1772,7 @@ info_namespace_config_get(char* context, cf_dyn_buf *db)
 		info_append_string_safe(db, "storage-engine.scheduler-mode", ns->storage_scheduler_mode);
 		info_append_uint32(db, "storage-engine.write-block-size", ns->storage_write_block_size);
 		info_append_bool(db, "storage-engine.data-in-memory", ns->storage_data_in_memory);
+		info_append_bool(db, "storage-engine.coalesce-reads", ns->storage_coalesce_reads);
 		info_append_bool(db, "storage-engine.cold-start-empty", ns->storage_cold_start_empty);
 		info_append_uint32(db, "storage-engine.defrag-lwm-pct", ns->storage_defrag_lwm_pct);
 		info_append_uint32(db, "storage-engine.defrag-queue-min", ns->storage_defrag_queue_min);
@@ -1746,14 +1784,17 @@ info_namespace_config_get(char* context, cf_dyn_buf *db)
 		info_append_string_safe(db, "storage-engine.encryption-key-file", ns->storage_encryption_key_file);
 		info_append_uint64(db, "storage-engine.flush-max-ms", ns->storage_flush_max_us / 1000);
 		info_append_uint64(db, "storage-engine.fsync-max-sec", ns->storage_fsync_max_us / 1000000);
+		info_append_string_safe(db, "storage-engine.index-snapshot-file", ns->storage_index_snapshot_file);
 		info_append_uint64(db, "storage-engine.max-write-cache", ns->storage_max_write_cache);
 		info_append_uint32(db, "storage-engine.min-avail-pct", ns->storage_min_avail_pct);
+		info_append_string(db, "storage-engine.placement-policy", ns->storage_placement_policy == AS_STORAGE_PLACEMENT_LOAD ? "load" : "digest");
 		info_append_uint32(db, "storage-engine.post-write-queue", ns->storage_post_write_queue);
 		info_append_uint32(db, "storage-engine.tomb-raider-sleep", ns->storage_tomb_raider_sleep);
 		info_append_uint32(db, "storage-engine.write-threads", ns->storage_write_threads);
 	}
 
 	info_append_uint32(db, "sindex.num-partitions", ns->sindex_num_partitions);
+	info_append_string_safe(db, "sindex.snapshot-file", ns->sindex_snapshot_file);
 
 	info_append_bool(db, "geo2dsphere-within.strict", ns->geo2dsphere_within_strict);
 	info_append_uint32(db, "geo2dsphere-within.min-level", (uint32_t)ns->geo2dsphere_within_min_level);
@@ -2011,6 +2052,27 @@ info_command_config_set_threadsafe(char *name, char *params, cf_dyn_buf *db)
 			cf_info(AS_INFO, "Changing value of nsup-period from %d to %d ", g_config.nsup_period, val);
 			g_config.nsup_period = val;
 		}
+		else if (0 == as_info_parameter_get(params, "client-quota-read-tps", context, &context_len)) {
+			uint64_t val;
+			if (0 != cf_str_atoi_u64(context, &val))
+				goto Error;
+			cf_info(AS_INFO, "Changing value of client-quota-read-tps from %lu to %lu ", g_config.client_quota_read_tps, val);
+			g_config.client_quota_read_tps = val;
+		}
+		else if (0 == as_info_parameter_get(params, "client-quota-write-bps", context, &context_len)) {
+			uint64_t val;
+			if (0 != cf_str_atoi_u64(context, &val))
+				goto Error;
+			cf_info(AS_INFO, "Changing value of client-quota-write-bps from %lu to %lu ", g_config.client_quota_write_bps, val);
+			g_config.client_quota_write_bps = val;
+		}
+		else if (0 == as_info_parameter_get(params, "client-quota-write-tps", context, &context_len)) {
+			uint64_t val;
+			if (0 != cf_str_atoi_u64(context, &val))
+				goto Error;
+			cf_info(AS_INFO, "Changing value of client-quota-write-tps from %lu to %lu ", g_config.client_quota_write_tps, val);
+			g_config.client_quota_write_tps = val;
+		}
 		else if (0 == as_info_parameter_get( params, "cluster-name", context, &context_len)){
 			if (!as_config_cluster_name_set(context)) {
 				goto Error;
@@ -2109,6 +2171,30 @@ info_command_config_set_threadsafe(char *name, char *params, cf_dyn_buf *db)
 			cf_info(AS_INFO, "Changing value of sindex-gc-period from %d to %d ", g_config.sindex_gc_period, val);
 			g_config.sindex_gc_period = (uint32_t)val;
 		}
+		else if (0 == as_info_parameter_get(params, "stale-map-hints", context, &context_len)) {
+			if (strncmp(context, "true", 4) == 0 || strncmp(context, "yes", 3) == 0) {
+				cf_info(AS_INFO, "Changing value of stale-map-hints from %s to %s", bool_val[g_config.stale_map_hints], context);
+				g_config.stale_map_hints = true;
+			}
+			else if (strncmp(context, "false", 5) == 0 || strncmp(context, "no", 2) == 0) {
+				cf_info(AS_INFO, "Changing value of stale-map-hints from %s to %s", bool_val[g_config.stale_map_hints], context);
+				g_config.stale_map_hints = false;
+			}
+			else
+				goto Error;
+		}
+		else if (0 == as_info_parameter_get(params, "stale-map-redirect", context, &context_len)) {
+			if (strncmp(context, "true", 4) == 0 || strncmp(context, "yes", 3) == 0) {
+				cf_info(AS_INFO, "Changing value of stale-map-redirect from %s to %s", bool_val[g_config.stale_map_redirect], context);
+				g_config.stale_map_redirect = true;
+			}
+			else if (strncmp(context, "false", 5) == 0 || strncmp(context, "no", 2) == 0) {
+				cf_info(AS_INFO, "Changing value of stale-map-redirect from %s to %s", bool_val[g_config.stale_map_redirect], context);
+				g_config.stale_map_redirect = false;
+			}
+			else
+				goto Error;
+		}
 		else if (0 == as_info_parameter_get(params, "query-threads", context, &context_len)) {
 			uint64_t val = atoll(context);
 			cf_info(AS_INFO, "query-threads = %"PRIu64, val);
@@ -2496,6 +2582,27 @@ info_command_config_set_threadsafe(char *name, char *params, cf_dyn_buf *db)
 				cf_info(AS_INFO, "Changing value of set-stop-writes-count of ns %s set %s to %lu", ns->name, p_set->name, val);
 				cf_atomic64_set(&p_set->stop_writes_count, val);
 			}
+			else if (0 == as_info_parameter_get(params, "set-device-group", context, &context_len)) {
+				cf_info(AS_INFO, "Changing value of set-device-group of ns %s set %s to %s", ns->name, p_set->name, context);
+				if (as_storage_set_device_group(ns, p_set, context) != 0) {
+					goto Error;
+				}
+			}
+			else if (0 == as_info_parameter_get(params, "set-quota-read-tps", context, &context_len)) {
+				uint64_t val = atoll(context);
+				cf_info(AS_INFO, "Changing value of set-quota-read-tps of ns %s set %s to %lu", ns->name, p_set->name, val);
+				cf_atomic64_set(&p_set->quotas.limits[AS_QUOTA_READ_TPS], val);
+			}
+			else if (0 == as_info_parameter_get(params, "set-quota-write-bps", context, &context_len)) {
+				uint64_t val = atoll(context);
+				cf_info(AS_INFO, "Changing value of set-quota-write-bps of ns %s set %s to %lu", ns->name, p_set->name, val);
+				cf_atomic64_set(&p_set->quotas.limits[AS_QUOTA_WRITE_BPS], val);
+			}
+			else if (0 == as_info_parameter_get(params, "set-quota-write-tps", context, &context_len)) {
+				uint64_t val = atoll(context);
+				cf_info(AS_INFO, "Changing value of set-quota-write-tps of ns %s set %s to %lu", ns->name, p_set->name, val);
+				cf_atomic64_set(&p_set->quotas.limits[AS_QUOTA_WRITE_TPS], val);
+			}
 			else {
 				goto Error;
 			}
@@ -2644,6 +2751,35 @@ info_command_config_set_threadsafe(char *name, char *params, cf_dyn_buf *db)
 			cf_info(AS_INFO, "Changing value of rack-id of ns %s from %u to %d", ns->name, ns->rack_id, val);
 			ns->rack_id = (uint32_t)val;
 		}
+		else if (0 == as_info_parameter_get(params, "partition-tree-sprigs", context, &context_len)) {
+			if (0 != cf_str_atoi(context, &val)) {
+				goto Error;
+			}
+			if (val < 16 || val > 4096 || (val & (val - 1)) != 0) {
+				cf_warning(AS_INFO, "partition-tree-sprigs %d must be a power of 2 >= 16 and <= 4096", val);
+				goto Error;
+			}
+			if ((uint32_t)val < ns->tree_shared.n_lock_pairs) {
+				cf_warning(AS_INFO, "partition-tree-sprigs %d can't be < partition-tree-locks %u", val, ns->tree_shared.n_lock_pairs);
+				goto Error;
+			}
+			// Existing trees are re-split by nsup.
+			cf_info(AS_INFO, "Changing value of partition-tree-sprigs of ns %s from %u to %d", ns->name, ns->tree_shared.n_sprigs, val);
+			ns->tree_shared.n_sprigs = (uint32_t)val;
+		}
+		else if (0 == as_info_parameter_get(params, "partition-tree-sprigs-auto", context, &context_len)) {
+			if (strncmp(context, "true", 4) == 0 || strncmp(context, "yes", 3) == 0) {
+				cf_info(AS_INFO, "Changing value of partition-tree-sprigs-auto of ns %s from %s to %s", ns->name, bool_val[ns->partition_tree_sprigs_auto], context);
+				ns->partition_tree_sprigs_auto = true;
+			}
+			else if (strncmp(context, "false", 5) == 0 || strncmp(context, "no", 2) == 0) {
+				cf_info(AS_INFO, "Changing value of partition-tree-sprigs-auto of ns %s from %s to %s", ns->name, bool_val[ns->partition_tree_sprigs_auto], context);
+				ns->partition_tree_sprigs_auto = false;
+			}
+			else {
+				goto Error;
+			}
+		}
 		else if (0 == as_info_parameter_get(params, "conflict-resolution-policy", context, &context_len)) {
 			if (strncmp(context, "generation", 10) == 0) {
 				cf_info(AS_INFO, "Changing value of conflict-resolution-policy of ns %s from %d to %s", ns->name, ns->conflict_resolution_policy, context);
@@ -2791,6 +2927,19 @@ info_command_config_set_threadsafe(char *name, char *params, cf_dyn_buf *db)
 				goto Error;
 			}
 		}
+		else if (0 == as_info_parameter_get(params, "skip-unchanged-writes", context, &context_len)) {
+			if (strncmp(context, "true", 4) == 0 || strncmp(context, "yes", 3) == 0) {
+				cf_info(AS_INFO, "Changing value of skip-unchanged-writes of ns %s from %s to %s", ns->name, bool_val[ns->skip_unchanged_writes], context);
+				ns->skip_unchanged_writes = true;
+			}
+			else if (strncmp(context, "false", 5) == 0 || strncmp(context, "no", 2) == 0) {
+				cf_info(AS_INFO, "Changing value of skip-unchanged-writes of ns %s from %s to %s", ns->name, bool_val[ns->skip_unchanged_writes], context);
+				ns->skip_unchanged_writes = false;
+			}
+			else {
+				goto Error;
+			}
+		}
 		else if (0 == as_info_parameter_get(params, "enable-benchmarks-batch-sub", context, &context_len)) {
 			if (strncmp(context, "true", 4) == 0 || strncmp(context, "yes", 3) == 0) {
 				cf_info(AS_INFO, "Changing value of enable-benchmarks-batch-sub of ns %s from %s to %s", ns->name, bool_val[ns->batch_sub_benchmarks_enabled], context);
@@ -2930,6 +3079,23 @@ info_command_config_set_threadsafe(char *name, char *params, cf_dyn_buf *db)
 			ns->storage_min_avail_pct = atoi(context);
 			cf_info(AS_INFO, "Changing value of min-avail-pct of ns %s from %u to %u ", ns->name, ns->storage_min_avail_pct, atoi(context));
 		}
+		else if (0 == as_info_parameter_get(params, "placement-policy", context, &context_len)) {
+			if (ns->storage_type != AS_STORAGE_ENGINE_SSD) {
+				cf_warning(AS_INFO, "ns %s, can't set placement-policy if not storage-engine device", ns->name);
+				goto Error;
+			}
+			if (strcmp(context, "digest") == 0) {
+				cf_info(AS_INFO, "Changing value of placement-policy of ns %s to %s", ns->name, context);
+				ns->storage_placement_policy = AS_STORAGE_PLACEMENT_DIGEST;
+			}
+			else if (strcmp(context, "load") == 0) {
+				cf_info(AS_INFO, "Changing value of placement-policy of ns %s to %s", ns->name, context);
+				ns->storage_placement_policy = AS_STORAGE_PLACEMENT_LOAD;
+			}
+			else {
+				goto Error;
+			}
+		}
 		else if (0 == as_info_parameter_get(params, "post-write-queue", context, &context_len)) {
 			if (ns->storage_data_in_memory) {
 				cf_warning(AS_INFO, "ns %s, can't set post-write-queue if data-in-memory", ns->name);
@@ -3394,6 +3560,98 @@ info_command_truncate(char *name, char *params, cf_dyn_buf *db)
 	return 0;
 }
 
+// Format is:
+//
+//	add-device:namespace=<ns-name>;path=<device-or-file-path>
+//
+int
+info_command_add_device(char *name, char *params, cf_dyn_buf *db)
+{
+	char ns_name[AS_ID_NAMESPACE_SZ];
+	int ns_name_len = (int)sizeof(ns_name);
+
+	if (as_info_parameter_get(params, "namespace", ns_name, &ns_name_len) != 0 ||
+			ns_name_len == 0) {
+		cf_warning(AS_INFO, "add-device command: missing or invalid namespace name in command");
+		cf_dyn_buf_append_string(db, "ERROR::namespace-name");
+		return 0;
+	}
+
+	as_namespace *ns = as_namespace_get_byname(ns_name);
+
+	if (! ns) {
+		cf_warning(AS_INFO, "add-device command: namespace %s not found", ns_name);
+		cf_dyn_buf_append_string(db, "ERROR::namespace-name");
+		return 0;
+	}
+
+	char path[512];
+	int path_len = (int)sizeof(path);
+
+	if (as_info_parameter_get(params, "path", path, &path_len) != 0 ||
+			path_len == 0) {
+		cf_warning(AS_INFO, "add-device command: missing or invalid path in command");
+		cf_dyn_buf_append_string(db, "ERROR::path");
+		return 0;
+	}
+
+	if (as_storage_add_device(ns, path) != 0) {
+		cf_dyn_buf_append_string(db, "ERROR::add-device");
+		return 0;
+	}
+
+	cf_dyn_buf_append_string(db, "ok");
+
+	return 0;
+}
+
+// Format is:
+//
+//	bulk-load:namespace=<ns-name>;path=<wblock-file-path>
+//
+// Load runs in the background - progress is in the namespace statistics.
+//
+int
+info_command_bulk_load(char *name, char *params, cf_dyn_buf *db)
+{
+	char ns_name[AS_ID_NAMESPACE_SZ];
+	int ns_name_len = (int)sizeof(ns_name);
+
+	if (as_info_parameter_get(params, "namespace", ns_name, &ns_name_len) != 0 ||
+			ns_name_len == 0) {
+		cf_warning(AS_INFO, "bulk-load command: missing or invalid namespace name in command");
+		cf_dyn_buf_append_string(db, "ERROR::namespace-name");
+		return 0;
+	}
+
+	as_namespace *ns = as_namespace_get_byname(ns_name);
+
+	if (! ns) {
+		cf_warning(AS_INFO, "bulk-load command: namespace %s not found", ns_name);
+		cf_dyn_buf_append_string(db, "ERROR::namespace-name");
+		return 0;
+	}
+
+	char path[512];
+	int path_len = (int)sizeof(path);
+
+	if (as_info_parameter_get(params, "path", path, &path_len) != 0 ||
+			path_len == 0) {
+		cf_warning(AS_INFO, "bulk-load command: missing or invalid path in command");
+		cf_dyn_buf_append_string(db, "ERROR::path");
+		return 0;
+	}
+
+	if (as_storage_bulk_load(ns, path) != 0) {
+		cf_dyn_buf_append_string(db, "ERROR::bulk-load");
+		return 0;
+	}
+
+	cf_dyn_buf_append_string(db, "ok");
+
+	return 0;
+}
+
 // Format is one of:
 //
 //	truncate-undo:namespace=<ns-name>;set=<set-name>
@@ -3436,6 +3694,73 @@ info_command_truncate_undo(char *name, char *params, cf_dyn_buf *db)
 	return 0;
 }
 
+// Format is one of:
+//
+//	change-stream:namespace=<ns-name>;from=<seq>;max=<n-changes>
+//
+//	change-stream:namespace=<ns-name>;from=<seq>
+//
+//	change-stream:namespace=<ns-name>
+//
+// Without 'from', reads from the oldest change still held.
+//
+int
+info_command_change_stream(char *name, char *params, cf_dyn_buf *db)
+{
+	// Get the namespace name.
+
+	char ns_name[AS_ID_NAMESPACE_SZ];
+	int ns_name_len = (int)sizeof(ns_name);
+	int ns_rv = as_info_parameter_get(params, "namespace", ns_name, &ns_name_len);
+
+	if (ns_rv != 0 || ns_name_len == 0) {
+		cf_warning(AS_INFO, "change-stream command: missing or invalid namespace name in command");
+		cf_dyn_buf_append_string(db, "ERROR::namespace-name");
+		return 0;
+	}
+
+	as_namespace *ns = as_namespace_get_byname(ns_name);
+
+	if (! ns) {
+		cf_warning(AS_INFO, "change-stream command: unknown namespace %s", ns_name);
+		cf_dyn_buf_append_string(db, "ERROR::unknown-namespace");
+		return 0;
+	}
+
+	// Get the starting position if there is one.
+
+	char from_str[24];
+	int from_str_len = (int)sizeof(from_str);
+	int from_rv = as_info_parameter_get(params, "from", from_str, &from_str_len);
+	uint64_t from = 0;
+
+	if (from_rv == -2 || (from_rv == 0 && cf_str_atoi_u64(from_str, &from) != 0)) {
+		cf_warning(AS_INFO, "change-stream command: invalid from position in command");
+		cf_dyn_buf_append_string(db, "ERROR::from");
+		return 0;
+	}
+
+	// Get the maximum number of changes if there is one.
+
+	char max_str[12];
+	int max_str_len = (int)sizeof(max_str);
+	int max_rv = as_info_parameter_get(params, "max", max_str, &max_str_len);
+	uint64_t max = 1000;
+
+	if (max_rv == -2 || (max_rv == 0 && (cf_str_atoi_u64(max_str, &max) != 0 ||
+			max == 0 || max > 100000))) {
+		cf_warning(AS_INFO, "change-stream command: max must be > 0 and <= 100000");
+		cf_dyn_buf_append_string(db, "ERROR::max");
+		return 0;
+	}
+
+	if (! as_change_stream_read(ns, from_rv == 0 ? &from : NULL, (uint32_t)max, db)) {
+		cf_dyn_buf_append_string(db, "ERROR::change-stream-disabled");
+	}
+
+	return 0;
+}
+
 //
 // Log a message to the server.
 // Limited to 2048 characters.
@@ -5370,11 +5695,26 @@ info_get_namespace_info(as_namespace *ns, cf_dyn_buf *db)
 	info_append_uint32(db, "nsup_cycle_duration", ns->nsup_cycle_duration);
 	info_append_uint32(db, "nsup_cycle_sleep_pct", ns->nsup_cycle_sleep_pct);
 
+	// Index tree stats.
+
+	info_append_uint32(db, "index_sprig_avg_depth", ns->index_sprig_avg_depth);
+	info_append_uint32(db, "index_sprig_max_depth", ns->index_sprig_max_depth);
+	info_append_uint64(db, "index_lock_waits", ns->tree_shared.n_lock_waits);
+	info_append_uint64(db, "index_lock_wait_us", ns->tree_shared.lock_wait_us);
+
 	// Truncate stats.
 
 	info_append_uint64(db, "truncate_lut", ns->truncate.lut);
 	info_append_uint64(db, "truncated_records", ns->truncate.n_records);
 
+	// Change stream stats.
+
+	if (ns->change_stream_size != 0) {
+		info_append_uint64(db, "change_stream_appended", ns->change_stream.next_seq);
+		info_append_uint64(db, "change_stream_lost", ns->change_stream.n_lost);
+		info_append_uint64(db, "change_stream_lag", as_change_stream_lag(ns));
+	}
+
 	// Memory usage stats.
 
 	uint64_t data_memory = ns->n_bytes_memory;
@@ -5387,6 +5727,24 @@ info_get_namespace_info(as_namespace *ns, cf_dyn_buf *db)
 	info_append_uint64(db, "memory_used_index_bytes", index_memory);
 	info_append_uint64(db, "memory_used_sindex_bytes", sindex_memory);
 
+	// Primary index startup stats.
+
+	info_append_bool(db, "index_snapshot_loaded", ns->index_snapshot_loaded);
+	info_append_uint64(db, "index_snapshot_load_ms", ns->index_snapshot_load_ms);
+	info_append_uint32(db, "cold_start_partitions_loaded", ns->cold_start_partitions_loaded);
+
+	// Secondary index startup stats.
+
+	info_append_bool(db, "sindex_snapshot_loaded", ns->sindex_snapshot_loaded);
+	info_append_uint64(db, "sindex_snapshot_load_ms", ns->sindex_snapshot_load_ms);
+	info_append_uint64(db, "sindex_rebuild_ms", ns->sindex_rebuild_ms);
+
+	// Index RAM not used thanks to compact-index.
+	uint64_t saved_index_memory = (sizeof(as_index) - as_index_size_get(ns)) * (ns->n_objects + ns->n_tombstones);
+
+	info_append_uint32(db, "index_entry_bytes", as_index_size_get(ns));
+	info_append_uint64(db, "memory_saved_index_bytes", saved_index_memory);
+
 	uint64_t free_pct = (ns->memory_size != 0 && (ns->memory_size > used_memory)) ?
 			((ns->memory_size - used_memory) * 100L) / ns->memory_size : 0;
 
@@ -5418,6 +5776,15 @@ info_get_namespace_info(as_namespace *ns, cf_dyn_buf *db)
 
 		if (! ns->storage_data_in_memory) {
 			info_append_int(db, "cache_read_pct", (int)(ns->cache_read_pct + 0.5));
+			info_append_uint64(db, "reads_coalesced", ns->n_reads_coalesced);
+
+			uint64_t load_total = ns->bulk_load_total_bytes;
+
+			info_append_bool(db, "bulk_loading", ns->bulk_loading != 0);
+			info_append_uint64(db, "bulk_load_pct", load_total == 0 ? 0 :
+					(ns->bulk_load_read_bytes * 100) / load_total);
+			info_append_uint64(db, "bulk_load_records", ns->n_bulk_load_records);
+			info_append_uint64(db, "bulk_load_skipped", ns->n_bulk_load_skipped);
 		}
 	}
 
@@ -5453,6 +5820,7 @@ info_get_namespace_info(as_namespace *ns, cf_dyn_buf *db)
 	info_append_uint64(db, "client_proxy_complete", ns->n_client_proxy_complete);
 	info_append_uint64(db, "client_proxy_error", ns->n_client_proxy_error);
 	info_append_uint64(db, "client_proxy_timeout", ns->n_client_proxy_timeout);
+	info_append_uint64(db, "client_proxy_redirect", ns->n_client_proxy_redirect);
 
 	info_append_uint64(db, "client_read_success", ns->n_client_read_success);
 	info_append_uint64(db, "client_read_error", ns->n_client_read_error);
@@ -5463,6 +5831,9 @@ info_get_namespace_info(as_namespace *ns, cf_dyn_buf *db)
 	info_append_uint64(db, "client_write_error", ns->n_client_write_error);
 	info_append_uint64(db, "client_write_timeout", ns->n_client_write_timeout);
 
+	// Subset of n_client_write_success above.
+	info_append_uint64(db, "client_write_unchanged", ns->n_client_write_unchanged);
+
 	// Subset of n_client_write_... above, respectively.
 	info_append_uint64(db, "xdr_write_success", ns->n_xdr_write_success);
 	info_append_uint64(db, "xdr_write_error", ns->n_xdr_write_error);
@@ -5590,6 +5961,8 @@ info_get_namespace_info(as_namespace *ns, cf_dyn_buf *db)
 	info_append_uint64(db, "geo_region_query_cells", ns->geo_region_query_cells);
 	info_append_uint64(db, "geo_region_query_points", ns->geo_region_query_points);
 	info_append_uint64(db, "geo_region_query_falsepos", ns->geo_region_query_falsepos);
+	info_append_uint64(db, "geo_near_query_reqs", ns->geo_near_query_count);
+	info_append_uint64(db, "geo_near_query_rings", ns->geo_near_query_rings);
 
 	// Special errors that deserve their own counters:
 
@@ -6048,15 +6421,34 @@ as_info_parse_params_to_sindex_imd(char* params, as_sindex_metadata *imd, cf_dyn
 		return AS_SINDEX_ERR_PARAM;
 	}
 
+	// Composite index - indexdata = bin1,keytype1,bin2,keytype2[,...]
+	char composite_str[AS_SINDEXDATA_STR_SIZE];
+	strcpy(composite_str, indexdata_str);
+
 	cf_vector *str_v = cf_vector_create(sizeof(void *), 10, VECTOR_FLAG_INITZERO);
 	cf_str_split(",", indexdata_str, str_v);
 	if ((cf_vector_size(str_v)) > 2) {
-		cf_warning(AS_INFO, "%s : Failed. >1 bins specified in indexdata.",
-				cmd);
-		INFO_COMMAND_SINDEX_FAILCODE(AS_PROTO_RESULT_FAIL_PARAMETER,
-				"Number of bins more than 1");
 		cf_vector_destroy(str_v);
-		return AS_SINDEX_ERR_PARAM;
+
+		if (imd->itype != AS_SINDEX_ITYPE_DEFAULT) {
+			cf_warning(AS_INFO, "%s : Failed. Composite index must have default indextype.",
+					cmd);
+			INFO_COMMAND_SINDEX_FAILCODE(AS_PROTO_RESULT_FAIL_PARAMETER,
+					"Composite index must have default indextype");
+			return AS_SINDEX_ERR_PARAM;
+		}
+
+		if (as_sindex_extract_composite_bins(imd, composite_str) != AS_SINDEX_OK) {
+			cf_warning(AS_INFO, "%s : Failed. Invalid composite indexdata '%s'.",
+					cmd, composite_str);
+			INFO_COMMAND_SINDEX_FAILCODE(AS_PROTO_RESULT_FAIL_PARAMETER,
+					"Invalid composite indexdata. Should be 2 to 4 pairs of bin,[Numeric|String]");
+			return AS_SINDEX_ERR_PARAM;
+		}
+
+		imd->ns_name = cf_strdup(ns->name);
+		imd->iname   = cf_strdup(indexname_str);
+		return AS_SINDEX_OK;
 	}
 
 	char *path_str = NULL;
@@ -6131,6 +6523,15 @@ int info_command_sindex_create(char *name, char *params, cf_dyn_buf *db)
 	}
 
 	as_namespace *ns = as_namespace_get_byname(imd.ns_name);
+
+	// Bulk loaded records bypass sindex updates.
+	if (cf_atomic32_get(ns->bulk_loading) != 0) {
+		cf_warning(AS_INFO, "SINDEX CREATE : Not allowed while namespace '%s' is bulk loading", imd.ns_name);
+		INFO_COMMAND_SINDEX_FAILCODE(AS_PROTO_RESULT_FAIL_FORBIDDEN,
+				"Namespace is bulk loading");
+		goto ERR;
+	}
+
 	res = as_sindex_create_check_params(ns, &imd);
 
 	if (res == AS_SINDEX_ERR_FOUND) {
@@ -6532,7 +6933,7 @@ as_info_init()
 	as_info_set( hb_mode == AS_HB_MODE_MESH ? "mesh" :  "mcast", istr, false);
 
 	// All commands accepted by asinfo/telnet
-	as_info_set("help", "alloc-info;asm;bins;build;build_os;build_time;cluster-name;config-get;config-set;"
+	as_info_set("help", "alloc-info;asm;bins;build;build_os;build_time;bulk-load;change-stream;cluster-name;config-get;config-set;"
 				"df;digests;dump-cluster;dump-fabric;dump-hb;dump-migrates;dump-msgs;dump-rw;"
 				"dump-si;dump-smd;dump-wb;dump-wb-summary;get-config;get-sl;hist-dump;"
 				"hist-track-start;hist-track-stop;jem-stats;jobs;latency;log;log-set;"
@@ -6598,6 +6999,9 @@ as_info_init()
 	as_info_set_tree("statistics", info_get_tree_statistics);
 
 	// Define commands
+	as_info_set_command("add-device", info_command_add_device, PERM_SERVICE_CTRL);            // Add a device (or file) to a running namespace.
+	as_info_set_command("bulk-load", info_command_bulk_load, PERM_SERVICE_CTRL);              // Load pre-built wblocks into a running namespace.
+	as_info_set_command("change-stream", info_command_change_stream, PERM_READ);              // Read changes from a namespace's change stream.
 	as_info_set_command("config-get", info_command_config_get, PERM_NONE);                    // Returns running config for specified context.
 	as_info_set_command("config-set", info_command_config_set, PERM_SET_CONFIG);              // Set a configuration parameter at run time, configuration parameter must be dynamic.
 	as_info_set_command("dump-cluster", info_command_dump_cluster, PERM_LOGGING_CTRL);        // Print debug information about clustering and exchange to the log file.
@@ -6645,6 +7049,7 @@ as_info_init()
 	// UDF
 	as_info_set_dynamic("udf-list", udf_cask_info_list, false);
 	as_info_set_command("udf-put", udf_cask_info_put, PERM_UDF_MANAGE);
+	as_info_set_command("udf-put-native", udf_cask_info_put, PERM_SERVICE_CTRL); // Uploads in-process code - privileged.
 	as_info_set_command("udf-get", udf_cask_info_get, PERM_NONE);
 	as_info_set_command("udf-remove", udf_cask_info_remove, PERM_UDF_MANAGE);
 	as_info_set_command("udf-clear-cache", udf_cask_info_clear_cache, PERM_UDF_MANAGE);
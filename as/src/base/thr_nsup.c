@@ -65,6 +65,10 @@
 
 #define EVAL_STOP_WRITES_PERIOD 10 // seconds
 
+// Automatic partition-tree-sprigs keeps average sprig depth in this range.
+#define SPRIG_AUTO_MIN_DEPTH 10 // ~1K elements per sprig
+#define SPRIG_AUTO_MAX_DEPTH 14 // ~16K elements per sprig
+
 
 //==========================================================
 // Forward declarations.
@@ -140,8 +144,12 @@ run_cold_start_evict_prep(void* udata)
 	int pid;
 
 	while ((pid = (int)cf_atomic32_incr(p_info->p_pid)) < AS_PARTITIONS) {
-		// Don't bother with partition reservations - it's startup.
-		as_index_reduce_live(ns->partitions[pid].vp, cold_start_evict_prep_reduce_cb, &cb_info);
+		// Reserve - node may have rejoined while cold start is still loading.
+		as_partition_reservation rsv;
+
+		as_partition_reserve(ns, (uint32_t)pid, &rsv);
+		as_index_reduce_live(rsv.tree, cold_start_evict_prep_reduce_cb, &cb_info);
+		as_partition_release(&rsv);
 	}
 
 	return NULL;
@@ -153,7 +161,7 @@ run_cold_start_evict_prep(void* udata)
 //
 typedef struct cold_start_evict_info_s {
 	as_namespace*	ns;
-	as_partition*	p_partition;
+	as_index_tree*	tree;
 	bool*			sets_not_evicting;
 	uint32_t		num_evicted;
 	uint32_t		num_0_void_time;
@@ -165,14 +173,13 @@ cold_start_evict_reduce_cb(as_index_ref* r_ref, void* udata)
 	as_index* r = r_ref->r;
 	cold_start_evict_info* p_info = (cold_start_evict_info*)udata;
 	as_namespace* ns = p_info->ns;
-	as_partition* p_partition = p_info->p_partition;
 	uint32_t set_id = as_index_get_set_id(r);
 	uint32_t void_time = r->void_time;
 
 	if (void_time != 0) {
 		if (! p_info->sets_not_evicting[set_id] &&
 				void_time < ns->cold_start_threshold_void_time) {
-			as_index_delete(p_partition->vp, &r->keyd);
+			as_index_delete(p_info->tree, &r->keyd);
 			p_info->num_evicted++;
 		}
 	}
@@ -214,11 +221,15 @@ run_cold_start_evict(void* udata)
 	int pid;
 
 	while ((pid = (int)cf_atomic32_incr(&p_info->pid)) < AS_PARTITIONS) {
-		// Don't bother with partition reservations - it's startup.
-		as_partition* p_partition = &ns->partitions[pid];
+		// Reserve - node may have rejoined while cold start is still loading.
+		as_partition_reservation rsv;
 
-		cb_info.p_partition = p_partition;
-		as_index_reduce_live(p_partition->vp, cold_start_evict_reduce_cb, &cb_info);
+		as_partition_reserve(ns, (uint32_t)pid, &rsv);
+
+		cb_info.tree = rsv.tree;
+		as_index_reduce_live(rsv.tree, cold_start_evict_reduce_cb, &cb_info);
+
+		as_partition_release(&rsv);
 	}
 
 	cf_atomic32_add(&p_info->total_evicted, cb_info.num_evicted);
@@ -864,6 +875,82 @@ get_threshold(as_namespace* ns, uint32_t* p_evict_void_time)
 	return true;
 }
 
+//------------------------------------------------
+// Refresh index tree stats, adjust sprigs if
+// automatic, and re-split any trees whose sprigs
+// don't match the configured number.
+//
+static void
+update_partition_trees(as_namespace* ns)
+{
+	as_partition_reservation rsv;
+	uint64_t total_depth = 0;
+	uint32_t n_trees = 0;
+	uint32_t max_depth = 0;
+
+	for (int n = 0; n < AS_PARTITIONS; n++) {
+		as_partition_reserve(ns, n, &rsv);
+
+		if (as_index_tree_size(rsv.tree) != 0) {
+			uint32_t avg_depth;
+			uint32_t tree_max_depth;
+
+			as_index_tree_sprig_stats(rsv.tree, &avg_depth, &tree_max_depth);
+
+			total_depth += avg_depth;
+			n_trees++;
+
+			if (tree_max_depth > max_depth) {
+				max_depth = tree_max_depth;
+			}
+		}
+
+		as_partition_release(&rsv);
+	}
+
+	uint32_t avg_depth = n_trees == 0 ? 0 : (uint32_t)(total_depth / n_trees);
+
+	ns->index_sprig_avg_depth = avg_depth;
+	ns->index_sprig_max_depth = max_depth;
+
+	uint32_t n_sprigs = ns->tree_shared.n_sprigs;
+
+	if (ns->partition_tree_sprigs_auto) {
+		uint32_t min_sprigs = MAX(16, ns->tree_shared.n_lock_pairs);
+
+		if (avg_depth > SPRIG_AUTO_MAX_DEPTH && n_sprigs < 4096) {
+			n_sprigs *= 2;
+		}
+		else if (avg_depth < SPRIG_AUTO_MIN_DEPTH && n_sprigs / 2 >= min_sprigs) {
+			n_sprigs /= 2;
+		}
+
+		if (n_sprigs != ns->tree_shared.n_sprigs) {
+			cf_info(AS_NSUP, "{%s} average sprig depth %u - changing partition-tree-sprigs from %u to %u",
+					ns->name, avg_depth, ns->tree_shared.n_sprigs, n_sprigs);
+			ns->tree_shared.n_sprigs = n_sprigs;
+		}
+	}
+
+	uint32_t n_skipped = 0;
+
+	// Trees already at n_sprigs return without taking pair locks.
+	for (int n = 0; n < AS_PARTITIONS; n++) {
+		as_partition_reserve(ns, n, &rsv);
+
+		if (! as_index_tree_resplit(rsv.tree, n_sprigs)) {
+			n_skipped++;
+		}
+
+		as_partition_release(&rsv);
+	}
+
+	if (n_skipped != 0) {
+		cf_info(AS_NSUP, "{%s} %u partition trees busy reducing - will re-split sprigs when reduces finish",
+				ns->name, n_skipped);
+	}
+}
+
 //------------------------------------------------
 // Stats per namespace at the end of an nsup lap.
 //
@@ -1081,6 +1168,9 @@ run_nsup(void *arg)
 					n_expired_records, n_evicted_records, evict_ttl,
 					n_general_waits, n_clear_waits, start_ms);
 
+			// Adjust partition tree sprigs, online.
+			update_partition_trees(ns);
+
 			// Garbage-collect long-expired proles, one partition per loop.
 			if (g_config.prole_extra_ttl != 0) {
 				prole_pids[i] = garbage_collect_next_prole_partition(ns, prole_pids[i]);
@@ -90,6 +90,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 #include <unistd.h>
@@ -106,12 +107,14 @@
 #include "aerospike/as_rec.h"
 #include "aerospike/as_val.h"
 #include "aerospike/mod_lua.h"
+#include "citrusleaf/cf_byte_order.h"
 #include "citrusleaf/cf_ll.h"
 #include "citrusleaf/cf_rchash.h"
 
 #include "ai_btree.h"
 #include "bt.h"
 #include "bt_iterator.h"
+#include "shash.h"
 
 #include "base/aggr.h"
 #include "base/as_stap.h"
@@ -158,6 +161,66 @@ typedef enum {
 
 
 
+/*
+ * Query Order-By Top-N
+ *
+ * Ordered queries keep each node's best N records (by the order-by bin) in a
+ * binary heap whose root is the worst record kept, so a candidate is admitted
+ * only if it beats the root. Records are sent in order when the query ends.
+ * Records whose order-by bin is missing or not numeric rank after all others,
+ * so they fill out the result (last) only when too few records are ranked.
+ */
+// **************************************************************************************************
+typedef struct query_sort_key_s {
+	bool                     is_missing; // order-by bin missing or not numeric
+	bool                     is_float;
+	union {
+		int64_t              i;
+		double               d;
+	} u;
+} query_sort_key;
+
+typedef struct query_topn_ele_s {
+	query_sort_key           key;
+	cf_digest                keyd;
+	as_sindex_key            skey;
+} query_topn_ele;
+
+typedef struct query_topn_s {
+	pthread_mutex_t          lock;
+	bool                     flushing;  // set while sending the sorted result
+	uint32_t                 n_eles;
+	uint32_t                 max_eles;
+	query_topn_ele           eles[];
+} query_topn;
+
+#define QUERY_ORDER_BY_MAX_LIMIT (100 * 1000)
+
+typedef struct query_geo_range_s {
+	uint64_t                 min;
+	uint64_t                 max;
+} query_geo_range;
+
+// k-nearest-neighbor query state - rings of S2 cells are searched outward
+// from the query point, each covering a cap twice as wide as the last.
+typedef struct query_geo_near_s {
+	uint64_t                 cellid;       // query point
+	double                   radius;       // meters covered by rings so far
+	double                   max_radius;   // meters - never search beyond
+	uint32_t                 n_rings;
+	query_geo_range        * searched;     // sorted and merged
+	uint32_t                 n_searched;
+	uint32_t                 sz_searched;
+	query_geo_range        * pending;      // current ring less searched cells
+	uint32_t                 n_pending;
+	uint32_t                 sz_pending;
+	uint32_t                 next_pending;
+} query_geo_near;
+
+#define QUERY_GEO_NEAR_FIRST_RADIUS 100.0 // meters
+// **************************************************************************************************
+
+
 /*
  * Query Transaction Structure
  */
@@ -178,6 +241,16 @@ typedef struct as_query_transaction_s {
 	predexp_eval_t         * predexp_eval;
 	cf_vector              * binlist;
 	as_file_handle         * fd_h;      // ref counted nonetheless
+	uint64_t                 limit;     // 0 means no limit
+	query_topn             * topn;      // non-NULL for order-by queries
+	query_geo_near         * geo_near;  // non-NULL for nearest-neighbor queries
+	int32_t                  order_binid;   // -1 if bin is unknown on this node
+	bool                     order_desc;
+	bool                     order_by_skey; // order-by bin is the indexed numeric bin
+	bool                     count_only;    // answer with a count from index entries
+	bool                     count_verify;  // count only records that still match
+	cf_shash               * counted_digests; // non-NULL if records may repeat in index
+	as_msg_read_ops        * read_ops;  // non-NULL if ops must be evaluated per record
 	/************************** Run Time Data *********************************/
 	bool                     blocking;
 	uint32_t                 priority;
@@ -206,6 +279,7 @@ typedef struct as_query_transaction_s {
 												   // being touched.
 	cf_atomic64              net_io_bytes;
 	cf_atomic64              n_read_success;
+	cf_atomic64              n_counted;            // Count-only queries
 
 	/********************** Query Progress ***********************************/
 	cf_atomic32              n_qwork_active;
@@ -340,6 +414,7 @@ extern cf_vector * as_sindex_binlist_from_msg(as_namespace *ns, as_msg *msgp, in
 // **************************************************************************************************
 
 static void qtr_finish_work(as_query_transaction *qtr, cf_atomic32 *stat, char *fname, int lineno, bool release);
+static void query_geo_near_destroy(query_geo_near *gn);
 
 // **************************************************************************************************
 
@@ -799,6 +874,13 @@ query_teardown(as_query_transaction *qtr)
 	if (qtr->binlist)     cf_vector_destroy(qtr->binlist);
 	if (qtr->setname)     cf_free(qtr->setname);
 	if (qtr->predexp_eval) predexp_destroy(qtr->predexp_eval);
+	if (qtr->read_ops)    as_msg_read_ops_destroy(qtr->read_ops);
+	if (qtr->topn) {
+		pthread_mutex_destroy(&qtr->topn->lock);
+		cf_free(qtr->topn);
+	}
+	if (qtr->geo_near)    query_geo_near_destroy(qtr->geo_near);
+	if (qtr->counted_digests) cf_shash_destroy(qtr->counted_digests);
 	if (qtr->job_type == QUERY_TYPE_AGGR && qtr->agg_call.def.arglist) {
 		as_list_destroy(qtr->agg_call.def.arglist);
 	}
@@ -1167,6 +1249,12 @@ query_add_response(void *void_qtr, as_storage_rd *rd)
 		return AS_QUERY_ERR;
 	}
 
+	// Workers race past query_limit_reached() - enforce the limit exactly here.
+	if (qtr->limit != 0 && (uint64_t)cf_atomic64_get(qtr->n_result_records) >= qtr->limit) {
+		pthread_mutex_unlock(&qtr->buf_mutex);
+		return 0;
+	}
+
 	if (msg_sz > (bb_r->alloc_sz - bb_r->used_sz) && bb_r->used_sz != 0) {
 		query_netio(qtr);
 	}
@@ -1185,6 +1273,51 @@ query_add_response(void *void_qtr, as_storage_rd *rd)
 	return ret;
 }
 
+/*
+ * Function query_add_read_ops_response
+ *
+ * Notes -
+ *	Like query_add_response(), but evaluates the query's read ops against the
+ *	record and returns only their results. The ops are evaluated once, packing
+ *	straight into qtr->bb_r, which is sent on once it passes its usual size.
+ *	Records for which no op has a result are not returned.
+ *
+ * Synchronization -
+ * 		Takes a lock over qtr->buf
+ */
+static int
+query_add_read_ops_response(as_query_transaction *qtr, as_storage_rd *rd)
+{
+	pthread_mutex_lock(&qtr->buf_mutex);
+	cf_buf_builder *bb_r = qtr->bb_r;
+	if (bb_r == NULL) {
+		// Assert that query is aborted if bb_r is found to be null
+		pthread_mutex_unlock(&qtr->buf_mutex);
+		return AS_QUERY_ERR;
+	}
+
+	if (qtr->limit != 0 && (uint64_t)cf_atomic64_get(qtr->n_result_records) >= qtr->limit) {
+		pthread_mutex_unlock(&qtr->buf_mutex);
+		return 0;
+	}
+
+	int32_t result = as_msg_make_read_ops_response_bufbuilder(&qtr->bb_r, rd,
+			qtr->read_ops);
+
+	if (result > 0) {
+		cf_atomic64_incr(&qtr->n_result_records);
+
+		if (qtr->bb_r->used_sz >= g_config.query_buf_size) {
+			query_netio(qtr);
+		}
+	}
+	pthread_mutex_unlock(&qtr->buf_mutex);
+
+	// A failed CDT read (e.g. wrong bin type) skips the record, as a predexp
+	// mismatch would.
+	return 0;
+}
+
 
 static int
 query_add_fin(as_query_transaction *qtr)
@@ -1370,6 +1503,254 @@ query_match_listele_foreach(as_val * val, void * udata)
 		return true;
 	}
 }
+
+/*
+ * Nearest-neighbor helpers - the srange vector holds the cell ranges of the
+ * ring being searched, refilled from gn->pending MAX_REGION_CELLS at a time.
+ */
+static void
+query_geo_ranges_push(query_geo_range **ranges, uint32_t *n_ranges,
+		uint32_t *sz_ranges, uint64_t min, uint64_t max)
+{
+	if (*n_ranges == *sz_ranges) {
+		*sz_ranges = *sz_ranges == 0 ? MAX_REGION_CELLS : *sz_ranges * 2;
+		*ranges = cf_realloc(*ranges, *sz_ranges * sizeof(query_geo_range));
+
+		if (! *ranges) {
+			cf_crash(AS_QUERY, "failed to allocate geo-near ranges");
+		}
+	}
+
+	(*ranges)[*n_ranges].min = min;
+	(*ranges)[*n_ranges].max = max;
+	(*n_ranges)++;
+}
+
+static int
+query_geo_range_cmp(const void *pa, const void *pb)
+{
+	uint64_t a = ((const query_geo_range *)pa)->min;
+	uint64_t b = ((const query_geo_range *)pb)->min;
+
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+// Queue the parts of [min, max] not covered by an earlier ring.
+static void
+query_geo_near_add_pending(query_geo_near *gn, uint64_t min, uint64_t max)
+{
+	for (uint32_t i = 0; i < gn->n_searched; i++) {
+		const query_geo_range *r = &gn->searched[i];
+
+		if (r->max < min) {
+			continue;
+		}
+		if (r->min > max) {
+			break;
+		}
+		if (r->min > min) {
+			query_geo_ranges_push(&gn->pending, &gn->n_pending,
+					&gn->sz_pending, min, r->min - 1);
+		}
+		if (r->max >= max) {
+			return;
+		}
+		min = r->max + 1;
+	}
+
+	query_geo_ranges_push(&gn->pending, &gn->n_pending, &gn->sz_pending,
+			min, max);
+}
+
+static void
+query_geo_near_add_searched(query_geo_near *gn, const uint64_t *cellmin,
+		const uint64_t *cellmax, int numcells)
+{
+	for (int i = 0; i < numcells; i++) {
+		query_geo_ranges_push(&gn->searched, &gn->n_searched,
+				&gn->sz_searched, cellmin[i], cellmax[i]);
+	}
+
+	qsort(gn->searched, gn->n_searched, sizeof(query_geo_range),
+			query_geo_range_cmp);
+
+	uint32_t n = 0;
+
+	for (uint32_t i = 1; i < gn->n_searched; i++) {
+		query_geo_range *last = &gn->searched[n];
+
+		if (gn->searched[i].min <= last->max + 1) {
+			if (gn->searched[i].max > last->max) {
+				last->max = gn->searched[i].max;
+			}
+		}
+		else {
+			gn->searched[++n] = gn->searched[i];
+		}
+	}
+
+	gn->n_searched = n + 1;
+}
+
+// Cover the next ring. Returns false if there's nothing left to search.
+static bool
+query_geo_near_next_ring(query_geo_near *gn, as_namespace *ns)
+{
+	gn->n_pending = 0;
+	gn->next_pending = 0;
+
+	while (gn->n_pending == 0) {
+		if (gn->radius >= gn->max_radius) {
+			return false;
+		}
+
+		gn->radius = gn->n_rings == 0 ?
+				QUERY_GEO_NEAR_FIRST_RADIUS : gn->radius * 2;
+
+		if (gn->radius > gn->max_radius) {
+			gn->radius = gn->max_radius;
+		}
+
+		uint64_t cellmin[MAX_REGION_CELLS];
+		uint64_t cellmax[MAX_REGION_CELLS];
+		int numcells;
+
+		if (! geo_cap_cover(ns, gn->cellid, gn->radius, MAX_REGION_CELLS,
+				cellmin, cellmax, &numcells)) {
+			cf_warning(AS_GEO, "geo-near query failed to cover ring");
+			return false;
+		}
+
+		gn->n_rings++;
+		cf_atomic64_incr(&ns->geo_near_query_rings);
+
+		for (int i = 0; i < numcells; i++) {
+			query_geo_near_add_pending(gn, cellmin[i], cellmax[i]);
+		}
+
+		query_geo_near_add_searched(gn, cellmin, cellmax, numcells);
+	}
+
+	return true;
+}
+
+// Move the next pending ranges into srange - template is srange[0].
+static void
+query_geo_near_fill_srange(query_geo_near *gn, as_sindex_range *srange)
+{
+	uint32_t n = gn->n_pending - gn->next_pending;
+
+	if (n > MAX_REGION_CELLS) {
+		n = MAX_REGION_CELLS;
+	}
+
+	for (uint32_t i = 0; i < MAX_REGION_CELLS; i++) {
+		if (i >= n) {
+			srange[i].num_binval = 0;
+			continue;
+		}
+
+		const query_geo_range *r = &gn->pending[gn->next_pending + i];
+
+		if (i != 0) {
+			srange[i] = srange[0];
+			srange[i].region = NULL;
+		}
+
+		srange[i].start.u.i64 = (int64_t)r->min;
+		srange[i].end.u.i64 = (int64_t)r->max;
+	}
+
+	gn->next_pending += n;
+}
+
+static query_geo_near *
+query_geo_near_create(as_namespace *ns, as_sindex_range *srange,
+		uint64_t max_meters)
+{
+	query_geo_near *gn = cf_malloc(sizeof(query_geo_near));
+
+	if (! gn) {
+		cf_crash(AS_QUERY, "failed to allocate geo-near query state");
+	}
+
+	memset(gn, 0, sizeof(query_geo_near));
+
+	double max_radius = geo_max_distance(ns);
+
+	gn->cellid = srange->cellid;
+	gn->max_radius = max_meters != 0 && (double)max_meters < max_radius ?
+			(double)max_meters : max_radius;
+
+	if (! query_geo_near_next_ring(gn, ns)) {
+		query_geo_near_destroy(gn);
+		return NULL;
+	}
+
+	query_geo_near_fill_srange(gn, srange);
+	cf_atomic64_incr(&ns->geo_near_query_count);
+
+	return gn;
+}
+
+static void
+query_geo_near_destroy(query_geo_near *gn)
+{
+	if (gn->searched) {
+		cf_free(gn->searched);
+	}
+	if (gn->pending) {
+		cf_free(gn->pending);
+	}
+	cf_free(gn);
+}
+
+// Called when the ranges in srange are all searched. Once the k-th best
+// distance is within the radius covered, no unsearched point can beat it.
+// Records still queued to workers are already seen, so a partial heap only
+// delays the stop.
+static bool
+query_geo_near_next_ranges(as_query_transaction *qtr)
+{
+	query_geo_near *gn = qtr->geo_near;
+
+	if (gn->next_pending == gn->n_pending) {
+		query_topn *topn = qtr->topn;
+		bool done;
+
+		pthread_mutex_lock(&topn->lock);
+		done = topn->n_eles == topn->max_eles &&
+				topn->eles[0].key.u.d <= gn->radius;
+		pthread_mutex_unlock(&topn->lock);
+
+		if (done || ! query_geo_near_next_ring(gn, qtr->ns)) {
+			cf_detail(AS_QUERY, "geo-near query done after %u rings, radius %f",
+					gn->n_rings, gn->radius);
+			return false;
+		}
+	}
+
+	query_geo_near_fill_srange(gn, qtr->srange);
+
+	return true;
+}
+
+// Returns false if the bin isn't a point within the max distance.
+static bool
+query_geo_near_distance(as_query_transaction *qtr, as_bin *b, double *distance)
+{
+	uint64_t cellid;
+
+	if (as_bin_get_particle_type(b) != AS_PARTICLE_TYPE_GEOJSON ||
+			! as_particle_geojson_point(b->particle, &cellid)) {
+		return false;
+	}
+
+	*distance = geo_point_distance(qtr->ns, qtr->geo_near->cellid, cellid);
+
+	return *distance <= qtr->geo_near->max_radius;
+}
+
 /*
  * Validate record based on its content and query make sure it indeed should
  * be selected. Secondary index does lazy delete for the entries for the record
@@ -1384,7 +1765,20 @@ query_record_matches(as_query_transaction *qtr, as_storage_rd *rd, as_sindex_key
 	as_sindex_bin_data *start = &qtr->srange->start;
 	as_sindex_bin_data *end   = &qtr->srange->end;
 
-	//TODO: Make it more general to support sindex over multiple bins	
+	// Composite index - the record's bins must still build the found key.
+	if (as_sindex_is_composite(qtr->si->imd)) {
+		cf_digest ckey;
+
+		if (! as_sindex_composite_key_from_bins(qtr->si->imd, rd->bins,
+				rd->n_bins, &ckey)) {
+			cf_debug(AS_QUERY, "query_record_matches: composite index %s bins "
+					"not found", qtr->si->imd->iname);
+			return false;
+		}
+
+		return memcmp(&ckey, &skey->key.str_key, AS_DIGEST_KEY_SZ) == 0;
+	}
+
 	as_bin * b = as_bin_get_by_id(rd, qtr->si->imd->binid);
 
 	if (!b) {
@@ -1457,6 +1851,11 @@ query_record_matches(as_query_transaction *qtr, as_storage_rd *rd, as_sindex_key
 				return false;
 			}
 
+			if (qtr->geo_near) {
+				double distance;
+				return query_geo_near_distance(qtr, b, &distance);
+			}
+
 			bool iswithin = as_particle_geojson_match(b->particle,
 					qtr->srange->cellid, qtr->srange->region,
 					qtr->ns->geo2dsphere_within_strict);
@@ -1556,6 +1955,286 @@ query_record_matches(as_query_transaction *qtr, as_storage_rd *rd, as_sindex_key
 
 
 
+/*
+ * Order-By helpers - heap root is the worst record kept.
+ */
+static int
+query_sort_key_cmp(const query_sort_key *a, const query_sort_key *b)
+{
+	if (a->is_float || b->is_float) {
+		double da = a->is_float ? a->u.d : (double)a->u.i;
+		double db = b->is_float ? b->u.d : (double)b->u.i;
+		return da < db ? -1 : (da > db ? 1 : 0);
+	}
+	return a->u.i < b->u.i ? -1 : (a->u.i > b->u.i ? 1 : 0);
+}
+
+// Unranked keys are worse than any ranked key, whichever the order.
+static inline bool
+query_sort_key_better(const as_query_transaction *qtr, const query_sort_key *a,
+		const query_sort_key *b)
+{
+	if (a->is_missing || b->is_missing) {
+		return ! a->is_missing;
+	}
+
+	int cmp = query_sort_key_cmp(a, b);
+	return qtr->order_desc ? cmp > 0 : cmp < 0;
+}
+
+static bool
+query_sort_key_from_rd(as_query_transaction *qtr, as_storage_rd *rd,
+		query_sort_key *key)
+{
+	if (qtr->geo_near) {
+		as_bin *b = as_bin_get_by_id(rd, qtr->si->imd->binid);
+
+		key->is_missing = false;
+		key->is_float = true;
+		return b && query_geo_near_distance(qtr, b, &key->u.d);
+	}
+
+	key->is_missing = true;
+
+	if (qtr->order_binid < 0) {
+		return true;
+	}
+
+	as_bin *b = as_bin_get_by_id(rd, (uint32_t)qtr->order_binid);
+	if (! b) {
+		return true;
+	}
+
+	key->is_missing = false;
+
+	switch (as_bin_get_particle_type(b)) {
+	case AS_PARTICLE_TYPE_INTEGER:
+		key->is_float = false;
+		key->u.i = as_bin_particle_integer_value(b);
+		return true;
+	case AS_PARTICLE_TYPE_FLOAT:
+		key->is_float = true;
+		key->u.d = as_bin_particle_float_value(b);
+		return true;
+	default:
+		// Records whose order-by bin isn't numeric are not ranked.
+		key->is_missing = true;
+		return true;
+	}
+}
+
+// Returns true if a record with this key can't make it into the top N.
+static bool
+query_topn_rejects(as_query_transaction *qtr, const query_sort_key *key)
+{
+	query_topn *topn = qtr->topn;
+	bool rejects = false;
+
+	pthread_mutex_lock(&topn->lock);
+	if (topn->n_eles == topn->max_eles) {
+		rejects = ! query_sort_key_better(qtr, key, &topn->eles[0].key);
+	}
+	pthread_mutex_unlock(&topn->lock);
+
+	return rejects;
+}
+
+static void
+query_topn_add(as_query_transaction *qtr, const query_topn_ele *ele)
+{
+	query_topn *topn = qtr->topn;
+	query_topn_ele *eles = topn->eles;
+
+	pthread_mutex_lock(&topn->lock);
+
+	uint32_t i;
+
+	if (topn->n_eles < topn->max_eles) {
+		// Sift up - better parents move down.
+		i = topn->n_eles++;
+
+		while (i != 0) {
+			uint32_t parent = (i - 1) / 2;
+
+			if (! query_sort_key_better(qtr, &eles[parent].key, &ele->key)) {
+				break;
+			}
+			eles[i] = eles[parent];
+			i = parent;
+		}
+	}
+	else if (query_sort_key_better(qtr, &ele->key, &eles[0].key)) {
+		// Replace root and sift down - worse children move up.
+		i = 0;
+
+		while (true) {
+			uint32_t c = 2 * i + 1;
+
+			if (c >= topn->n_eles) {
+				break;
+			}
+			if (c + 1 < topn->n_eles &&
+					query_sort_key_better(qtr, &eles[c].key, &eles[c + 1].key)) {
+				c++;
+			}
+			if (! query_sort_key_better(qtr, &ele->key, &eles[c].key)) {
+				break;
+			}
+			eles[i] = eles[c];
+			i = c;
+		}
+	}
+	else {
+		pthread_mutex_unlock(&topn->lock);
+		return;
+	}
+
+	eles[i] = *ele;
+	pthread_mutex_unlock(&topn->lock);
+}
+
+static int
+query_topn_ele_cmp_asc(const void *pa, const void *pb)
+{
+	const query_sort_key *a = &((const query_topn_ele *)pa)->key;
+	const query_sort_key *b = &((const query_topn_ele *)pb)->key;
+
+	if (a->is_missing || b->is_missing) {
+		return (int)a->is_missing - (int)b->is_missing; // unranked last
+	}
+	return query_sort_key_cmp(a, b);
+}
+
+static int
+query_topn_ele_cmp_desc(const void *pa, const void *pb)
+{
+	const query_sort_key *a = &((const query_topn_ele *)pa)->key;
+	const query_sort_key *b = &((const query_topn_ele *)pb)->key;
+
+	if (a->is_missing || b->is_missing) {
+		return (int)a->is_missing - (int)b->is_missing; // unranked last
+	}
+	return query_sort_key_cmp(b, a);
+}
+
+static bool
+query_limit_reached(as_query_transaction *qtr)
+{
+	return qtr->limit != 0 && qtr->topn == NULL &&
+			(uint64_t)cf_atomic64_get(qtr->n_result_records) >= qtr->limit;
+}
+
+/*
+ * Count-only queries count records with index entries in partitions this node
+ * owns. Storage is never read - unless asked to verify, in which case each
+ * record must be live in the primary index and must still match the query.
+ */
+static bool
+query_count_verify(as_query_transaction *qtr, as_partition_reservation *rsv,
+		cf_digest *dig, as_sindex_key *skey)
+{
+	as_namespace * ns = qtr->ns;
+	as_index_ref r_ref;
+	r_ref.skip_lock = false;
+
+	if (as_record_get_live(rsv->tree, dig, &r_ref, ns) != 0) {
+		return false;
+	}
+
+	if (as_record_is_doomed(r_ref.r, ns)) {
+		as_record_done(&r_ref, ns);
+		return false;
+	}
+
+	as_storage_rd rd;
+	as_storage_record_open(ns, r_ref.r, &rd);
+
+	// A record we can't read can't be shown to match - don't count it.
+	if (as_storage_rd_load_n_bins(&rd) < 0) {
+		cf_warning_digest(AS_QUERY, dig, "{%s} count verify: failed load n-bins ",
+				ns->name);
+		as_storage_record_close(&rd);
+		as_record_done(&r_ref, ns);
+		return false;
+	}
+
+	as_bin stack_bins[ns->storage_data_in_memory ? 0 : rd.n_bins];
+
+	if (as_storage_rd_load_bins(&rd, stack_bins) < 0) {
+		cf_warning_digest(AS_QUERY, dig, "{%s} count verify: failed load bins ",
+				ns->name);
+		as_storage_record_close(&rd);
+		as_record_done(&r_ref, ns);
+		return false;
+	}
+
+	bool matches = query_record_matches(qtr, &rd, skey);
+
+	as_storage_record_close(&rd);
+	as_record_done(&r_ref, ns);
+
+	if (! matches) {
+		cf_atomic64_incr(&g_stats.query_false_positives);
+	}
+
+	return matches;
+}
+
+static int
+query_count(as_query_transaction *qtr, cf_digest *dig, as_sindex_key *skey)
+{
+	// Indexes on CDT elements or geo regions may hold several entries for one
+	// record - count each record once.
+	if (qtr->counted_digests &&
+			cf_shash_put_unique(qtr->counted_digests, dig, NULL) !=
+					CF_SHASH_OK) {
+		return AS_QUERY_OK;
+	}
+
+	as_namespace * ns = qtr->ns;
+	as_partition_reservation rsv_stack;
+	as_partition_reservation * rsv = query_reserve_partition(ns, qtr,
+			as_partition_getid(dig), &rsv_stack);
+
+	if (!rsv) {
+		return AS_QUERY_OK;
+	}
+
+	bool counts = ! qtr->count_verify ||
+			query_count_verify(qtr, rsv, dig, skey);
+
+	query_release_partition(qtr, rsv);
+
+	if (! counts) {
+		return AS_QUERY_OK;
+	}
+
+	if (qtr->limit == 0) {
+		cf_atomic64_incr(&qtr->n_counted);
+		return AS_QUERY_OK;
+	}
+
+	// With a limit (e.g. 1 for an existence check) stop once it's reached -
+	// never count past it.
+	uint64_t n_counted = (uint64_t)cf_atomic64_get(qtr->n_counted);
+
+	while (n_counted < qtr->limit) {
+		if (__sync_bool_compare_and_swap(&qtr->n_counted, n_counted,
+				n_counted + 1)) {
+			n_counted++;
+			break;
+		}
+
+		n_counted = (uint64_t)cf_atomic64_get(qtr->n_counted);
+	}
+
+	if (n_counted >= qtr->limit) {
+		qtr_set_done(qtr, AS_PROTO_RESULT_OK, __FILE__, __LINE__);
+	}
+
+	return AS_QUERY_OK;
+}
+
 static int
 query_io(as_query_transaction *qtr, cf_digest *dig, as_sindex_key * skey)
 {
@@ -1566,6 +2245,26 @@ query_io(as_query_transaction *qtr, cf_digest *dig, as_sindex_key * skey)
 	as_namespace * ns = qtr->ns;
 	as_partition_reservation rsv_stack;
 	as_partition_reservation * rsv = &rsv_stack;
+	bool to_topn = qtr->topn && ! qtr->topn->flushing;
+
+	if (qtr->count_only) {
+		return query_count(qtr, dig, skey);
+	}
+
+	if (query_limit_reached(qtr)) {
+		qtr_set_done(qtr, AS_PROTO_RESULT_OK, __FILE__, __LINE__);
+		return AS_QUERY_OK;
+	}
+
+	// When ordering by the indexed numeric bin, the sindex key is the sort
+	// key - skip the record I/O if it can't make the top N.
+	if (to_topn && qtr->order_by_skey) {
+		query_sort_key key = { .is_float = false, .u.i = (int64_t)skey->key.int_key };
+
+		if (query_topn_rejects(qtr, &key)) {
+			return AS_QUERY_OK;
+		}
+	}
 
 	// We make sure while making digest list that current partition is query-able
 	// Attempt the query reservation here as well. If this partition is not
@@ -1645,7 +2344,22 @@ query_io(as_query_transaction *qtr, cf_digest *dig, as_sindex_key * skey)
 			return AS_QUERY_OK;
 		}
 
-		int ret = query_add_response(qtr, &rd);
+		if (to_topn) {
+			query_topn_ele ele;
+
+			if (query_sort_key_from_rd(qtr, &rd, &ele.key)) {
+				ele.keyd = *dig;
+				ele.skey = *skey;
+				query_topn_add(qtr, &ele);
+			}
+			as_storage_record_close(&rd);
+			as_record_done(&r_ref, ns);
+			goto CLEANUP;
+		}
+
+		int ret = qtr->read_ops ?
+				query_add_read_ops_response(qtr, &rd) :
+				query_add_response(qtr, &rd);
 		if (ret != 0) {
 			as_storage_record_close(&rd);
 			as_record_done(&r_ref, ns);
@@ -1671,6 +2385,28 @@ CLEANUP :
 
 	return AS_QUERY_OK;
 }
+
+/*
+ * Sends the top N records of an order-by query, best first. Records are
+ * re-read, so ones deleted or changed to no longer match are dropped.
+ */
+static void
+query_topn_send(as_query_transaction *qtr)
+{
+	query_topn *topn = qtr->topn;
+
+	qsort(topn->eles, topn->n_eles, sizeof(query_topn_ele),
+			qtr->order_desc ? query_topn_ele_cmp_desc : query_topn_ele_cmp_asc);
+
+	topn->flushing = true;
+
+	for (uint32_t i = 0; i < topn->n_eles; i++) {
+		if (query_io(qtr, &topn->eles[i].keyd, &topn->eles[i].skey) !=
+				AS_QUERY_OK) {
+			break;
+		}
+	}
+}
 // **************************************************************************************************
 
 /*
@@ -1718,6 +2454,16 @@ query_add_result(char *res, as_query_transaction *qtr, bool success)
 	as_val_destroy(v);
 }
 
+static void
+query_add_count_response(as_query_transaction *qtr)
+{
+	as_integer count;
+
+	as_integer_init(&count, (int64_t)cf_atomic64_get(qtr->n_counted));
+	query_add_val_response(qtr, (as_val *)&count, true);
+	as_integer_destroy(&count);
+}
+
 
 static int
 query_process_aggreq(query_work *qagg)
@@ -2216,6 +2962,13 @@ query_get_nextbatch(as_query_transaction *qtr)
 			//
 			if (qctx->range_index == (MAX_REGION_CELLS - 1) ||
 				qtr->srange[qctx->range_index+1].num_binval == 0) {
+				// Nearest-neighbor queries go on to the next ring.
+				if (qtr->geo_near && query_geo_near_next_ranges(qtr)) {
+					qctx->range_index = 0;
+					qctx->pimd_idx = -1;
+					ret = AS_QUERY_CONTINUE;
+					goto batchout;
+				}
 				qtr->result_code = AS_PROTO_RESULT_OK;
 				ret              = AS_QUERY_DONE;
 				goto batchout;
@@ -2569,6 +3322,13 @@ query_generator(as_query_transaction *qtr)
 		}
 	}
 
+	if (qtr->count_only && !qtr_failed(qtr)) {
+		query_add_count_response(qtr);
+	}
+	else if (qtr->topn && !qtr_failed(qtr)) {
+		query_topn_send(qtr);
+	}
+
 	if (!qtr_is_abort(qtr)) {
 		// Send the fin packet in it is NOT a shutdown
 		query_send_fin(qtr);
@@ -2737,10 +3497,20 @@ query_setup(as_transaction *tr, as_namespace *ns, as_query_transaction **qtrp)
 	uint64_t start_time     = cf_getns();
 	as_sindex *si           = NULL;
 	cf_vector *binlist      = 0;
+	as_msg_read_ops *read_ops = NULL;
 	as_sindex_range *srange = 0;
 	predexp_eval_t *predexp_eval = NULL;
 	char *setname           = NULL;
 	as_query_transaction *qtr = NULL;
+	uint64_t limit          = 0;
+	bool order_by           = false;
+	bool order_desc         = false;
+	char order_bname[AS_ID_BIN_SZ];
+	bool count_only         = false;
+	bool count_verify       = false;
+	bool geo_near           = false;
+	uint64_t geo_near_max   = 0;
+	query_geo_near *gn      = NULL;
 
 	bool has_sindex   = as_sindex_ns_has_sindex(ns);
 	if (!has_sindex) {
@@ -2807,6 +3577,99 @@ query_setup(as_transaction *tr, as_namespace *ns, as_query_transaction **qtrp)
 		}
 	}
 	
+	if (as_transaction_has_query_limit(tr)) {
+		as_msg_field *lfp = as_msg_field_get(m, AS_MSG_FIELD_TYPE_QUERY_LIMIT);
+
+		if (as_msg_field_get_value_sz(lfp) != sizeof(uint64_t)) {
+			cf_warning(AS_QUERY, "query limit field has bad size");
+			tr->result_code = AS_PROTO_RESULT_FAIL_PARAMETER;
+			goto Cleanup;
+		}
+
+		limit = cf_swap_from_be64(*(uint64_t *)lfp->data);
+	}
+
+	// Order-by field is a direction byte (0 ascending, 1 descending) followed
+	// by the bin name.
+	if (as_transaction_has_query_order_by(tr)) {
+		as_msg_field *ofp = as_msg_field_get(m, AS_MSG_FIELD_TYPE_QUERY_ORDER_BY);
+		uint32_t value_sz = as_msg_field_get_value_sz(ofp);
+
+		if (value_sz < 2 || value_sz - 1 >= AS_ID_BIN_SZ || ofp->data[0] > 1) {
+			cf_warning(AS_QUERY, "query order-by field is malformed");
+			tr->result_code = AS_PROTO_RESULT_FAIL_PARAMETER;
+			goto Cleanup;
+		}
+
+		if (limit == 0 || limit > QUERY_ORDER_BY_MAX_LIMIT) {
+			cf_warning(AS_QUERY, "query order-by needs a limit from 1 to %u",
+					QUERY_ORDER_BY_MAX_LIMIT);
+			tr->result_code = AS_PROTO_RESULT_FAIL_PARAMETER;
+			goto Cleanup;
+		}
+
+		order_by = true;
+		order_desc = ofp->data[0] == 1;
+		memcpy(order_bname, ofp->data + 1, value_sz - 1);
+		order_bname[value_sz - 1] = 0;
+	}
+
+	if (as_transaction_has_query_count(tr)) {
+		as_msg_field *cfp = as_msg_field_get(m, AS_MSG_FIELD_TYPE_QUERY_COUNT);
+
+		if (as_msg_field_get_value_sz(cfp) != 1) {
+			cf_warning(AS_QUERY, "query count field has bad size");
+			tr->result_code = AS_PROTO_RESULT_FAIL_PARAMETER;
+			goto Cleanup;
+		}
+
+		if (order_by || predexp_eval) {
+			cf_warning(AS_QUERY, "count queries do not support order-by or predexp filters");
+			tr->result_code = AS_PROTO_RESULT_FAIL_UNSUPPORTED_FEATURE;
+			goto Cleanup;
+		}
+
+		count_only = true;
+		count_verify = (cfp->data[0] & AS_MSG_QUERY_COUNT_VERIFY) != 0;
+	}
+
+	// Nearest-neighbor queries need a point filter on a geo2dsphere index of a
+	// plain bin - the limit is k.
+	if (as_transaction_has_query_geo_near(tr)) {
+		as_msg_field *gfp = as_msg_field_get(m, AS_MSG_FIELD_TYPE_QUERY_GEO_NEAR);
+
+		if (as_msg_field_get_value_sz(gfp) != sizeof(uint64_t)) {
+			cf_warning(AS_QUERY, "query geo-near field has bad size");
+			tr->result_code = AS_PROTO_RESULT_FAIL_PARAMETER;
+			goto Cleanup;
+		}
+
+		if (limit == 0 || limit > QUERY_ORDER_BY_MAX_LIMIT) {
+			cf_warning(AS_QUERY, "query geo-near needs a limit from 1 to %u",
+					QUERY_ORDER_BY_MAX_LIMIT);
+			tr->result_code = AS_PROTO_RESULT_FAIL_PARAMETER;
+			goto Cleanup;
+		}
+
+		if (order_by || count_only) {
+			cf_warning(AS_QUERY, "geo-near queries do not support order-by or count");
+			tr->result_code = AS_PROTO_RESULT_FAIL_UNSUPPORTED_FEATURE;
+			goto Cleanup;
+		}
+
+		if (si && (as_sindex_pktype(si->imd) != AS_PARTICLE_TYPE_GEOJSON ||
+				si->imd->itype != AS_SINDEX_ITYPE_DEFAULT ||
+				si->imd->path_length != 0 ||
+				srange->cellid == 0)) {
+			cf_warning(AS_QUERY, "geo-near query needs a point on a geo2dsphere bin index");
+			tr->result_code = AS_PROTO_RESULT_FAIL_PARAMETER;
+			goto Cleanup;
+		}
+
+		geo_near = true;
+		geo_near_max = cf_swap_from_be64(*(uint64_t *)gfp->data);
+	}
+
 	int numbins = 0;
 	// Populate binlist to be Projected by the Query
 	binlist = as_sindex_binlist_from_msg(ns, m, &numbins);
@@ -2846,6 +3709,35 @@ query_setup(as_transaction *tr, as_namespace *ns, as_query_transaction **qtrp)
 		goto Cleanup;
 	}
 
+	if ((order_by || limit != 0 || count_only) && qtype != QUERY_TYPE_LOOKUP) {
+		cf_warning(AS_QUERY, "only lookup queries support order-by, limit and count");
+		tr->result_code = AS_PROTO_RESULT_FAIL_UNSUPPORTED_FEATURE;
+		rv              = AS_QUERY_ERR;
+		goto Cleanup;
+	}
+
+	// Lookups may carry read ops (including CDT reads) evaluated per record.
+	if (qtype == QUERY_TYPE_LOOKUP && ! count_only &&
+			(m->info1 & AS_MSG_INFO1_GET_NO_BINS) == 0) {
+		int result;
+
+		read_ops = as_msg_read_ops_create(m, &result);
+
+		if (! read_ops && result != AS_PROTO_RESULT_OK) {
+			tr->result_code = result;
+			rv              = AS_QUERY_ERR;
+			goto Cleanup;
+		}
+	}
+
+	if (geo_near) {
+		if (! (gn = query_geo_near_create(ns, srange, geo_near_max))) {
+			tr->result_code = AS_PROTO_RESULT_FAIL_PARAMETER;
+			rv              = AS_QUERY_ERR;
+			goto Cleanup;
+		}
+	}
+
 	ASD_QUERY_QTRSETUP_STARTING(nodeid, trid);
 	qtr = qtr_alloc();
 	if (!qtr) {
@@ -2873,6 +3765,44 @@ query_setup(as_transaction *tr, as_namespace *ns, as_query_transaction **qtrp)
 	if (qtr->job_type == QUERY_TYPE_LOOKUP) {
 		qtr->predexp_eval = predexp_eval;
 		qtr->no_bin_data = (m->info1 & AS_MSG_INFO1_GET_NO_BINS) != 0;
+		qtr->limit = limit;
+		qtr->count_only = count_only;
+		qtr->count_verify = count_verify;
+
+		if (count_only && (si->imd->itype != AS_SINDEX_ITYPE_DEFAULT ||
+				as_sindex_pktype(si->imd) == AS_PARTICLE_TYPE_GEOJSON)) {
+			qtr->counted_digests = cf_shash_create(cf_shash_fn_u32,
+					CF_DIGEST_KEY_SZ, 0, 1024, CF_SHASH_MANY_LOCK);
+		}
+		qtr->read_ops = read_ops;
+
+		if (order_by || gn) {
+			as_sindex_metadata *imd = si->imd;
+
+			if (gn) {
+				// Ranked by distance, nearest first.
+				qtr->geo_near = gn;
+				gn = NULL;
+				qtr->order_binid = -1;
+			}
+			else {
+				qtr->order_binid = as_bin_get_id(ns, order_bname);
+				qtr->order_desc = order_desc;
+				qtr->order_by_skey = qtr->order_binid >= 0 &&
+						(uint32_t)qtr->order_binid == imd->binid &&
+						imd->sktype == COL_TYPE_LONG &&
+						imd->itype == AS_SINDEX_ITYPE_DEFAULT &&
+						imd->path_length == 0;
+			}
+
+			qtr->topn = cf_malloc(sizeof(query_topn) +
+					limit * sizeof(query_topn_ele));
+
+			pthread_mutex_init(&qtr->topn->lock, NULL);
+			qtr->topn->flushing = false;
+			qtr->topn->n_eles = 0;
+			qtr->topn->max_eles = (uint32_t)limit;
+		}
 	}
 	else if (qtr->job_type == QUERY_TYPE_UDF_BG) {
 		qtr->origin.predexp = predexp_eval;
@@ -2908,6 +3838,8 @@ Cleanup:
 	if (predexp_eval) predexp_destroy(predexp_eval);
 	if (srange)      as_sindex_range_free(&srange);
 	if (binlist)     cf_vector_destroy(binlist);
+	if (read_ops)    as_msg_read_ops_destroy(read_ops);
+	if (gn)          query_geo_near_destroy(gn);
 	return rv;
 }
 
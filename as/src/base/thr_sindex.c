@@ -191,6 +191,10 @@ as_sindex__destroy_fn(void *param)
 			si->ns->n_setless_sindexes--;
 		}
 
+		if (as_sindex_is_composite(si->imd)) {
+			si->ns->n_composite_sindexes--;
+		}
+
 		as_sindex_metadata *imd = si->imd;
 		si->imd = NULL;
 
@@ -740,6 +744,9 @@ sbld_job_create(as_namespace* ns, uint16_t set_id, as_sindex* si)
 void
 sbld_job_slice(as_job* _job, as_partition_reservation* rsv)
 {
+	// An early-rejoined cold start may still be loading this partition.
+	as_partition_wait_loaded(rsv->p);
+
 	as_index_reduce_live(rsv->tree, sbld_job_reduce_cb, (void*)_job);
 }
 
@@ -756,6 +763,7 @@ sbld_job_finish(as_job* _job)
 		AS_SINDEX_RELEASE(job->si);
 	}
 	else {
+		_job->ns->sindex_rebuild_ms = cf_getms() - _job->start_ms;
 		as_sindex_boot_populateall_done(_job->ns);
 	}
 }
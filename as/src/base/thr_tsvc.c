@@ -47,6 +47,7 @@
 #include "base/cfg.h"
 #include "base/datamodel.h"
 #include "base/proto.h"
+#include "base/quota.h"
 #include "base/scan.h"
 #include "base/secondary_index.h"
 #include "base/security.h"
@@ -215,6 +216,9 @@ as_tsvc_process_transaction(as_transaction *tr)
 	cl_msg *msgp = tr->msgp;
 	as_msg *m = &msgp->msg;
 
+	// Transient buffers for this transaction come from the thread's region.
+	cf_alloc_region_enter();
+
 	as_transaction_init_body(tr);
 
 	// Check that the socket is authenticated.
@@ -376,6 +380,12 @@ as_tsvc_process_transaction(as_transaction *tr)
 	// write reservation, replica writes, etc. Writes quickly get split into
 	// write, delete, or UDF after the reservation.
 
+	// Enforce rate quotas before doing any real work.
+	if (! as_transaction_is_restart(tr) && ! as_quota_admit(tr, ns, is_write)) {
+		as_transaction_error(tr, ns, AS_PROTO_RESULT_FAIL_QUOTA_EXCEEDED);
+		goto Cleanup;
+	}
+
 	uint32_t pid = as_partition_getid(&tr->keyd);
 	cf_node dest;
 
@@ -405,7 +415,7 @@ as_tsvc_process_transaction(as_transaction *tr)
 	}
 
 	if (rv == -2) {
-		// Partition is frozen.
+		// Partition is frozen or not yet loaded.
 		as_transaction_error(tr, ns, AS_PROTO_RESULT_FAIL_UNAVAILABLE);
 		goto Cleanup;
 	}
@@ -465,6 +475,10 @@ as_tsvc_process_transaction(as_transaction *tr)
 		switch (tr->origin) {
 		case FROM_CLIENT:
 		case FROM_BATCH:
+			if (tr->origin == FROM_CLIENT && g_config.stale_map_redirect) {
+				as_proxy_redirect(dest, tr, ns);
+				break;
+			}
 			as_proxy_divert(dest, tr, ns);
 			// CLIENT: fabric owns msgp, BATCH: it's shared, don't free it.
 			free_msgp = false;
@@ -491,6 +505,8 @@ Cleanup:
 	if (free_msgp && tr->origin != FROM_BATCH) {
 		cf_free(msgp);
 	}
+
+	cf_alloc_region_exit();
 } // end process_transaction()
 
 
@@ -49,6 +49,7 @@
 #include "base/cfg.h"
 #include "base/datamodel.h"
 #include "base/index.h"
+#include "base/quota.h"
 #include "base/secondary_index.h"
 #include "base/stats.h"
 #include "base/thr_info.h"
@@ -86,6 +87,7 @@ void log_line_objects(as_namespace* ns, uint64_t n_objects,
 void log_line_tombstones(as_namespace* ns, uint64_t n_tombstones,
 		repl_stats* mp);
 void log_line_migrations(as_namespace* ns);
+void log_line_cold_start(as_namespace* ns);
 void log_line_memory_usage(as_namespace* ns, size_t total_mem, size_t index_mem,
 		size_t sindex_mem, size_t data_mem);
 void log_line_device_usage(as_namespace* ns);
@@ -150,6 +152,9 @@ run_ticker(void* arg)
 			break;
 		}
 
+		// Not output - just piggy-backs on the ticker period.
+		as_quota_reap_clients();
+
 		log_ticker_frame(delta_time);
 	}
 
@@ -196,6 +201,7 @@ log_ticker_frame(uint64_t delta_time)
 		log_line_objects(ns, n_objects, &mp);
 		log_line_tombstones(ns, n_tombstones, &mp);
 		log_line_migrations(ns);
+		log_line_cold_start(ns);
 		log_line_memory_usage(ns, total_mem, index_mem, sindex_mem, data_mem);
 		log_line_device_usage(ns);
 
@@ -318,6 +324,18 @@ log_fabric_rate(uint64_t delta_time)
 			g_stats.fabric_ctrl_s_rate, g_stats.fabric_ctrl_r_rate,
 			g_stats.fabric_meta_s_rate, g_stats.fabric_meta_r_rate,
 			g_stats.fabric_rw_s_rate, g_stats.fabric_rw_r_rate);
+
+	for (uint32_t c = 0; c < AS_FABRIC_N_SEND_CLASSES; c++) {
+		g_stats.fabric_rw_q_depth[c] = rate.rw_q_depth[c];
+		g_stats.fabric_rw_q_wait_avg_us[c] = rate.rw_q_msgs[c] == 0 ?
+				0 : rate.rw_q_wait_us[c] / rate.rw_q_msgs[c];
+	}
+
+	cf_info(AS_INFO, "   fabric-rw-send-queue: small (%lu,%lu) large (%lu,%lu)",
+			g_stats.fabric_rw_q_depth[AS_FABRIC_SEND_CLASS_SMALL],
+			g_stats.fabric_rw_q_wait_avg_us[AS_FABRIC_SEND_CLASS_SMALL],
+			g_stats.fabric_rw_q_depth[AS_FABRIC_SEND_CLASS_LARGE],
+			g_stats.fabric_rw_q_wait_avg_us[AS_FABRIC_SEND_CLASS_LARGE]);
 }
 
 
@@ -422,6 +440,19 @@ log_line_migrations(as_namespace* ns)
 }
 
 
+void
+log_line_cold_start(as_namespace* ns)
+{
+	// Only while cold start loads the index after the node rejoined.
+	if (! ns->loading_records) {
+		return;
+	}
+
+	cf_info(AS_INFO, "{%s} cold-start: loaded-partitions %u of %u",
+			ns->name, ns->cold_start_partitions_loaded, AS_PARTITIONS);
+}
+
+
 void
 log_line_memory_usage(as_namespace* ns, size_t total_mem, size_t index_mem,
 		size_t sindex_mem, size_t data_mem)
@@ -197,6 +197,18 @@ as_transaction_set_msg_field_flag(as_transaction *tr, uint8_t type)
 	case AS_MSG_FIELD_TYPE_PREDEXP:
 		tr->msg_fields |= AS_MSG_FIELD_BIT_PREDEXP;
 		break;
+	case AS_MSG_FIELD_TYPE_QUERY_ORDER_BY:
+		tr->msg_fields |= AS_MSG_FIELD_BIT_QUERY_ORDER_BY;
+		break;
+	case AS_MSG_FIELD_TYPE_QUERY_LIMIT:
+		tr->msg_fields |= AS_MSG_FIELD_BIT_QUERY_LIMIT;
+		break;
+	case AS_MSG_FIELD_TYPE_QUERY_COUNT:
+		tr->msg_fields |= AS_MSG_FIELD_BIT_QUERY_COUNT;
+		break;
+	case AS_MSG_FIELD_TYPE_QUERY_GEO_NEAR:
+		tr->msg_fields |= AS_MSG_FIELD_BIT_QUERY_GEO_NEAR;
+		break;
 	default:
 		return false;
 	}
@@ -443,6 +455,10 @@ as_release_file_handle(as_file_handle *proto_fd_h)
 		proto_fd_h->security_filter = NULL;
 	}
 
+	if ((proto_fd_h->fh_info & FH_INFO_UNIX) != 0) {
+		cf_atomic64_incr(&g_stats.unix_connections_closed);
+	}
+
 	cf_rc_free(proto_fd_h);
 	cf_atomic64_incr(&g_stats.proto_connections_closed);
 }
@@ -120,11 +120,15 @@ udf_aerospike_delbin(udf_record * urecord, const char * bname)
 	bool has_sindex = record_has_sindex(rd->r, ns);
 	SINDEX_BINS_SETUP(sbins, ns->sindex_cnt);
 	as_sindex * si_arr[ns->sindex_cnt];
+	as_sindex_composite_keys ckeys[ns->n_composite_sindexes];
 	int si_arr_index = 0;
 	int sbins_populated  = 0;
+	int n_ckeys = 0;
 	if (has_sindex) {
 		si_arr_index += as_sindex_arr_lookup_by_set_binid_lockfree(ns, set_name, b->id, &si_arr[si_arr_index]);
 		sbins_populated += as_sindex_sbins_from_bin(ns, set_name, b, sbins, AS_SINDEX_OP_DELETE);
+		n_ckeys = as_sindex_composite_lookup_lockfree(ns, set_name, ckeys);
+		as_sindex_composite_keys_from_bins(ckeys, n_ckeys, rd->bins, rd->n_bins, false);
 	}
 
 	int32_t i = as_bin_get_index(rd, bname);
@@ -136,6 +140,13 @@ udf_aerospike_delbin(udf_record * urecord, const char * bname)
 			}
 		}
 		as_bin_destroy(rd, i);
+
+		if (has_sindex) {
+			as_sindex_composite_keys_from_bins(ckeys, n_ckeys, rd->bins, rd->n_bins, true);
+			if (as_sindex_composite_update(ckeys, n_ckeys, &rd->r->keyd)) {
+				urecord->tr->flags |= AS_TRANSACTION_FLAG_SINDEX_TOUCHED;
+			}
+		}
 	} else {
 		cf_warning(AS_UDF, "udf_aerospike_delbin: Internal Error [Deleting non-existing bin %s]... Fail", bname);
 	}
@@ -143,6 +154,7 @@ udf_aerospike_delbin(udf_record * urecord, const char * bname)
 	if (has_sindex) {
 		as_sindex_sbin_freeall(sbins, sbins_populated);
 		as_sindex_release_arr(si_arr, si_arr_index);
+		as_sindex_composite_release(ckeys, n_ckeys);
 	}
 
 	return 0;
@@ -270,13 +282,17 @@ udf_aerospike_setbin(udf_record * urecord, int offset, const char * bname, const
 	bool has_sindex = record_has_sindex(rd->r, ns);
 	SINDEX_BINS_SETUP(sbins, 2 * ns->sindex_cnt);
 	as_sindex * si_arr[2 * ns->sindex_cnt];
+	as_sindex_composite_keys ckeys[ns->n_composite_sindexes];
 	int sbins_populated = 0;
 	int si_arr_index = 0;
+	int n_ckeys = 0;
 	const char * set_name = as_index_get_set_name(rd->r, ns);
 
 	if (has_sindex ) {
 		si_arr_index += as_sindex_arr_lookup_by_set_binid_lockfree(ns, set_name, b->id, &si_arr[si_arr_index]);
 		sbins_populated += as_sindex_sbins_from_bin(ns, set_name, b, &sbins[sbins_populated], AS_SINDEX_OP_DELETE);
+		n_ckeys = as_sindex_composite_lookup_lockfree(ns, set_name, ckeys);
+		as_sindex_composite_keys_from_bins(ckeys, n_ckeys, rd->bins, rd->n_bins, false);
 	}
 
 	// we know we are doing an update now, make sure there is particle data,
@@ -311,6 +327,7 @@ udf_aerospike_setbin(udf_record * urecord, int offset, const char * bname, const
 				as_sindex_sbin_freeall(sbins, sbins_populated);
 			}
 			as_sindex_release_arr(si_arr, si_arr_index);
+			as_sindex_composite_release(ckeys, n_ckeys);
 			return ret;
 		}
 
@@ -322,6 +339,12 @@ udf_aerospike_setbin(udf_record * urecord, int offset, const char * bname, const
 			as_sindex_sbin_freeall(sbins, sbins_populated);
 		}
 		as_sindex_release_arr(si_arr, si_arr_index);
+
+		as_sindex_composite_keys_from_bins(ckeys, n_ckeys, rd->bins, rd->n_bins, true);
+		if (as_sindex_composite_update(ckeys, n_ckeys, &rd->r->keyd)) {
+			urecord->tr->flags |= AS_TRANSACTION_FLAG_SINDEX_TOUCHED;
+		}
+		as_sindex_composite_release(ckeys, n_ckeys);
 	}
 
 	return ret;
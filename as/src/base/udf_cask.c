@@ -47,10 +47,11 @@
 #include "base/cfg.h"
 #include "base/thr_info.h"
 #include "base/system_metadata.h"
+#include "base/udf_native.h"
 #include <sys/stat.h>
 
 char udf_smd_module_name[] = "UDF";
-char *as_udf_type_name[] = {"LUA", 0};
+char *as_udf_type_name[] = {"LUA", "NATIVE", 0};
 
 static bool g_udf_smd_loaded = false;
 
@@ -89,8 +90,8 @@ static inline int file_resolve(char * filepath, char * filename, char * ext) {
 static int file_read(char * filename, uint8_t ** content, size_t * content_len, unsigned char * hash) {
 
 	char    filepath[256]   = {0};
-	char    line[1024]      = {0};
-	size_t  line_len        = sizeof(line);
+	uint8_t chunk[1024];
+	size_t  chunk_len       = 0;
 
 	file_resolve(filepath, filename, NULL);
 
@@ -100,8 +101,9 @@ static int file_read(char * filename, uint8_t ** content, size_t * content_len,
 
 	if ( file ) {
 
-		while( fgets(line, line_len, file) != NULL ) {
-			cf_dyn_buf_append_string(&buf, line);
+		// Native modules are binary - don't read line by line.
+		while( (chunk_len = fread(chunk, 1, sizeof(chunk), file)) > 0 ) {
+			cf_dyn_buf_append_buf(&buf, chunk, chunk_len);
 		}
 
 		fclose(file);
@@ -192,6 +194,18 @@ static int udf_type_getid(char *type) {
 	return(-1);
 }
 
+// return the type of a UDF SMD item's JSON value - LUA if not given or unknown
+static uint8_t udf_smd_item_type(const char *value) {
+	json_t *item_obj = json_loads(value, 0 /*flags*/, NULL);
+	if (!item_obj) {
+		return AS_UDF_TYPE_LUA;
+	}
+	const char *type = json_string_value(json_object_get(item_obj, "type"));
+	int type_id = type ? udf_type_getid((char *)type) : -1;
+	json_decref(item_obj);
+	return type_id == -1 ? AS_UDF_TYPE_LUA : (uint8_t)type_id;
+}
+
 /*
  * Type for user data passed to the get metadata callback.
  */
@@ -213,11 +227,10 @@ static int udf_cask_get_metadata_cb(char *module, as_smd_item_list_t *items, voi
 	unsigned char   hash[SHA_DIGEST_LENGTH];
 	// hex string to be returned to the client
 	unsigned char   sha1_hex_buff[CF_SHA_HEX_BUFF_LEN];
-	// Currently just return directly for LUA
-	uint8_t udf_type = AS_UDF_TYPE_LUA;
 
 	for (int index = 0; index < items->num_items; index++) {
 		as_smd_item_t *item = items->item[index];
+		uint8_t udf_type = udf_smd_item_type(item->value);
 		cf_debug(AS_UDF, "UDF metadata item[%d]:  module \"%s\" ; key \"%s\" ; value \"%s\" ; generation %u ; timestamp %lu",
 				 index, item->module_name, item->key, item->value, item->generation, item->timestamp);
 		cf_dyn_buf_append_string(out, "filename=");
@@ -394,18 +407,35 @@ int udf_cask_info_put(char *name, char * params, cf_dyn_buf * out) {
 		return 0;
 	}
 
+	// Native modules come in only through udf-put-native, which requires a
+	// stronger permission than udf-put - they run with the server's rights.
+	bool native_cmd = strcmp(name, "udf-put-native") == 0;
+
 	if ( as_info_parameter_get(params, "udf-type", type, &type_len) ) {
-		// Replace with DEFAULT IS LUA
-		strcpy(type, as_udf_type_name[0]);
+		// Replace with DEFAULT IS LUA (NATIVE for udf-put-native)
+		strcpy(type, as_udf_type_name[native_cmd ? AS_UDF_TYPE_NATIVE : 0]);
 	}
 
 	// check type field
-	if (-1 == udf_type_getid(type)) {
+	int udf_type = udf_type_getid(type);
+	if (-1 == udf_type) {
 		cf_info(AS_INFO, "invalid or missing udf-type : %s not valid", type);
 		cf_dyn_buf_append_string(out, "error=invalid_udf_type");
 		return 0;
 	}
 
+	if ( (udf_type == AS_UDF_TYPE_NATIVE) != native_cmd ) {
+		cf_warning(AS_UDF, "%s: udf-type %s not allowed - native modules must use udf-put-native", name, type);
+		cf_dyn_buf_append_string(out, "error=invalid_udf_type");
+		return 0;
+	}
+
+	if ( native_cmd && ! g_config.udf_native_enabled ) {
+		cf_warning(AS_UDF, "udf-put-native: native modules not enabled");
+		cf_dyn_buf_append_string(out, "error=native_udf_not_enabled");
+		return 0;
+	}
+
 	// get b64 encoded script
 	udf_content_len = atoi(content_len) + 1;
 	udf_content = (char *) cf_malloc(udf_content_len);
@@ -427,13 +457,20 @@ int udf_cask_info_put(char *name, char * params, cf_dyn_buf * out) {
 	uint32_t decoded_len = cf_b64_decoded_buf_size(encoded_len) + 1;
 	
 	// Don't allow UDF file size > 1MB 
-	if ( decoded_len > MAX_UDF_CONTENT_LENGTH) {
+	if ( udf_type == AS_UDF_TYPE_LUA && decoded_len > MAX_UDF_CONTENT_LENGTH) {
 		cf_info(AS_INFO, "lua file size:%d > 1MB", decoded_len);
 		cf_dyn_buf_append_string(out, "error=invalid_udf_content_len, lua file size > 1MB");
 		cf_free(udf_content);
 		return 0;
 	}
 
+	if ( udf_type == AS_UDF_TYPE_NATIVE && decoded_len > UDF_NATIVE_MAX_CONTENT_LENGTH) {
+		cf_info(AS_INFO, "native module size:%d > 16MB", decoded_len);
+		cf_dyn_buf_append_string(out, "error=invalid_udf_content_len, native module size > 16MB");
+		cf_free(udf_content);
+		return 0;
+	}
+
 	char * decoded_str = cf_malloc(decoded_len);
 
 	if ( ! cf_b64_validate_and_decode(udf_content, encoded_len, (uint8_t*)decoded_str, &decoded_len) ) {
@@ -446,32 +483,51 @@ int udf_cask_info_put(char *name, char * params, cf_dyn_buf * out) {
 
 	decoded_str[decoded_len] = '\0';
 
-	as_module_error err;
-	rc = as_module_validate(&mod_lua, NULL, filename, decoded_str, decoded_len, &err);
+	if ( udf_type == AS_UDF_TYPE_NATIVE ) {
+		char native_err[256];
+
+		// Loads the module privately - it's only registered on accept.
+		if ( ! udf_native_validate(filename, (uint8_t *)decoded_str, decoded_len, native_err, sizeof(native_err)) ) {
+			cf_warning(AS_UDF, "udf-put: invalid native module %s: %s", filename, native_err);
+			cf_dyn_buf_append_string(out, "error=invalid_native_module;message=");
+			cf_dyn_buf_append_string(out, native_err);
+			cf_free(decoded_str);
+			cf_free(udf_content);
+			return 0;
+		}
+
+		cf_free(decoded_str);
+		decoded_str = NULL;
+		decoded_len = 0;
+	}
+	else {
+		as_module_error err;
+		rc = as_module_validate(&mod_lua, NULL, filename, decoded_str, decoded_len, &err);
 
-	cf_free(decoded_str);
-	decoded_str = NULL;
-	decoded_len = 0;
+		cf_free(decoded_str);
+		decoded_str = NULL;
+		decoded_len = 0;
 
-	if ( rc ) {
-		cf_warning(AS_UDF, "udf-put: compile error: [%s:%d] %s", err.file, err.line, err.message);
-		cf_dyn_buf_append_string(out, "error=compile_error");
-		cf_dyn_buf_append_string(out, ";file=");
-		cf_dyn_buf_append_string(out, err.file);
-		cf_dyn_buf_append_string(out, ";line=");
-		cf_dyn_buf_append_uint32(out, err.line);
+		if ( rc ) {
+			cf_warning(AS_UDF, "udf-put: compile error: [%s:%d] %s", err.file, err.line, err.message);
+			cf_dyn_buf_append_string(out, "error=compile_error");
+			cf_dyn_buf_append_string(out, ";file=");
+			cf_dyn_buf_append_string(out, err.file);
+			cf_dyn_buf_append_string(out, ";line=");
+			cf_dyn_buf_append_uint32(out, err.line);
 
-		uint32_t message_len = strlen(err.message);
-		uint32_t enc_message_len = cf_b64_encoded_len(message_len);
-		char enc_message[enc_message_len];
+			uint32_t message_len = strlen(err.message);
+			uint32_t enc_message_len = cf_b64_encoded_len(message_len);
+			char enc_message[enc_message_len];
 
-		cf_b64_encode((const uint8_t*)err.message, message_len, enc_message);
+			cf_b64_encode((const uint8_t*)err.message, message_len, enc_message);
 
-		cf_dyn_buf_append_string(out, ";message=");
-		cf_dyn_buf_append_buf(out, (uint8_t *)enc_message, enc_message_len);
+			cf_dyn_buf_append_string(out, ";message=");
+			cf_dyn_buf_append_buf(out, (uint8_t *)enc_message, enc_message_len);
 
-		cf_free(udf_content);
-		return 0;
+			cf_free(udf_content);
+			return 0;
+		}
 	}
 
 	// Create an empty JSON object
@@ -641,6 +697,8 @@ udf_cask_smd_accept_fn(char *module, as_smd_item_list_t *items, void *udata, uin
 			/*item->key is name */
 			json_t *content64_obj = json_object_get(item_obj, "content64");
 			const char *content64_str = json_string_value(content64_obj);
+			const char *type_str = json_string_value(json_object_get(item_obj, "type"));
+			bool is_native = type_str && udf_type_getid((char *)type_str) == AS_UDF_TYPE_NATIVE;
 
 			// base 64 decode it
 			uint32_t encoded_len = strlen(content64_str);
@@ -656,6 +714,19 @@ udf_cask_smd_accept_fn(char *module, as_smd_item_list_t *items, void *udata, uin
 
 			content_str[decoded_len] = 0;
 
+			if (is_native) {
+				// Keep the file for udf-get - the module is loaded from its own copy.
+				unsigned char       content_gen[256]    = {0};
+				file_write(item->key, (uint8_t *) content_str, decoded_len, content_gen);
+				udf_native_load(item->key, (uint8_t *) content_str, decoded_len);
+				cf_free(content_str);
+				json_decref(item_obj);
+				continue;
+			}
+
+			// A Lua module may replace a native one of the same name.
+			udf_native_unload_same_name(item->key);
+
 			cf_debug(AS_UDF, "pushing to %s, %d bytes [%s]", item->key, decoded_len, content_str);
 			mod_lua_wrlock(&mod_lua);
 
@@ -680,6 +751,8 @@ udf_cask_smd_accept_fn(char *module, as_smd_item_list_t *items, void *udata, uin
 		else if (item->action == AS_SMD_ACTION_DELETE) {
 			cf_debug(AS_UDF, "received DELETE SMD action %d key %s", item->action, item->key);
 
+			udf_native_unload(item->key);
+
 			mod_lua_wrlock(&mod_lua);
 			file_remove(item->key);
 
@@ -0,0 +1,593 @@
+/*
+ * udf_native.c
+ *
+ * Copyright (C) 2018 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+//==========================================================
+// Includes.
+//
+
+#include "base/udf_native.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "aerospike/as_double.h"
+#include "aerospike/as_integer.h"
+#include "aerospike/as_string.h"
+#include "aerospike/as_val.h"
+#include "citrusleaf/alloc.h"
+#include "citrusleaf/cf_atomic.h"
+
+#include "fault.h"
+
+#include "base/cfg.h"
+#include "base/datamodel.h"
+#include "base/udf_native_abi.h"
+#include "base/udf_record.h"
+
+
+//==========================================================
+// Typedefs & constants.
+//
+
+// A loaded module. Each apply holds a reference, as does the registry - the
+// module is unloaded when the last reference goes, so a module removed or
+// replaced while functions are running is unloaded when they finish.
+#define MODULE_NAME_SZ 128
+
+typedef struct udf_native_module_s {
+	char filename[MODULE_NAME_SZ]; // as registered, e.g. "mymod.so"
+	char name[MODULE_NAME_SZ]; // as called, e.g. "mymod"
+	void* handle;
+	const as_udf_native_module* def;
+	cf_atomic32 rc;
+} udf_native_module;
+
+
+//==========================================================
+// Globals.
+//
+
+static pthread_rwlock_t g_lock = PTHREAD_RWLOCK_INITIALIZER;
+static udf_native_module* g_modules[UDF_NATIVE_MAX_MODULES];
+
+static cf_atomic32 g_load_seq = 0;
+
+
+//==========================================================
+// Forward declarations.
+//
+
+static bool api_bin_get_int(as_rec* rec, const char* name, int64_t* value);
+static bool api_bin_get_float(as_rec* rec, const char* name, double* value);
+static bool api_bin_get_str(as_rec* rec, const char* name, const char** value,
+		uint32_t* size);
+
+static const as_udf_native_api g_api = {
+		.abi_version	= AS_UDF_NATIVE_ABI_VERSION,
+		.bin_get_int	= api_bin_get_int,
+		.bin_get_float	= api_bin_get_float,
+		.bin_get_str	= api_bin_get_str
+};
+
+static udf_native_module* module_open(const char* filename,
+		const uint8_t* content, size_t size, char* err, size_t err_sz);
+static void module_close(udf_native_module* mod);
+static void unload(const char* filename, bool by_name);
+static void module_name(const char* filename, char* name);
+static udf_native_module* module_reserve(const char* filename);
+static void module_release(udf_native_module* mod);
+static const as_udf_native_function* module_find_function(
+		const udf_native_module* mod, const char* function);
+static bool bin_get(as_rec* rec, const char* name, as_bin** p_b,
+		as_val** p_val);
+
+
+//==========================================================
+// Public API.
+//
+
+bool
+udf_native_validate(const char* filename, const uint8_t* content, size_t size,
+		char* err, size_t err_sz)
+{
+	udf_native_module* mod = module_open(filename, content, size, err, err_sz);
+
+	if (! mod) {
+		return false;
+	}
+
+	module_close(mod);
+
+	return true;
+}
+
+bool
+udf_native_load(const char* filename, const uint8_t* content, size_t size)
+{
+	char err[256];
+	udf_native_module* mod = module_open(filename, content, size, err,
+			sizeof(err));
+
+	if (! mod) {
+		cf_warning(AS_UDF, "native module %s not loaded: %s", filename, err);
+		return false;
+	}
+
+	if (mod->def->init && mod->def->init(&g_api) != 0) {
+		cf_warning(AS_UDF, "native module %s not loaded: init failed",
+				filename);
+		dlclose(mod->handle);
+		cf_free(mod);
+		return false;
+	}
+
+	udf_native_module* old = NULL;
+	int free_ix = -1;
+	char name[MODULE_NAME_SZ];
+
+	module_name(filename, name);
+
+	pthread_rwlock_wrlock(&g_lock);
+
+	for (int i = 0; i < UDF_NATIVE_MAX_MODULES; i++) {
+		if (! g_modules[i]) {
+			if (free_ix == -1) {
+				free_ix = i;
+			}
+		}
+		else if (strcmp(g_modules[i]->name, name) == 0) {
+			old = g_modules[i];
+			free_ix = i;
+			break;
+		}
+	}
+
+	if (free_ix != -1) {
+		g_modules[free_ix] = mod;
+	}
+
+	pthread_rwlock_unlock(&g_lock);
+
+	if (free_ix == -1) {
+		cf_warning(AS_UDF, "native module %s not loaded: already have %d modules",
+				filename, UDF_NATIVE_MAX_MODULES);
+		module_release(mod);
+		return false;
+	}
+
+	if (old) {
+		module_release(old);
+	}
+
+	cf_info(AS_UDF, "native module %s loaded - %u functions", filename,
+			mod->def->n_functions);
+
+	return true;
+}
+
+void
+udf_native_unload(const char* filename)
+{
+	unload(filename, false);
+}
+
+// For a Lua module registered under the same module name.
+void
+udf_native_unload_same_name(const char* filename)
+{
+	unload(filename, true);
+}
+
+bool
+udf_native_apply_record(as_udf_context* ctx, const char* filename,
+		const char* function, as_rec* rec, as_list* args, as_result* res,
+		int* rv)
+{
+	udf_native_module* mod = module_reserve(filename);
+
+	if (! mod) {
+		return false;
+	}
+
+	const as_udf_native_function* fn = module_find_function(mod, function);
+
+	if (! fn || ! fn->record_fn) {
+		cf_warning(AS_UDF, "native module %s has no record function %s",
+				filename, function);
+		*rv = UDF_NATIVE_ERR_FUNCTION_NOT_FOUND;
+	}
+	else {
+		*rv = fn->record_fn(&g_api, ctx, rec, args, res);
+	}
+
+	module_release(mod);
+
+	return true;
+}
+
+bool
+udf_native_apply_stream(as_udf_context* ctx, const char* filename,
+		const char* function, as_stream* istream, as_list* args,
+		as_stream* ostream, as_result* res, int* rv)
+{
+	udf_native_module* mod = module_reserve(filename);
+
+	if (! mod) {
+		return false;
+	}
+
+	const as_udf_native_function* fn = module_find_function(mod, function);
+
+	if (! fn || ! fn->stream_fn) {
+		cf_warning(AS_UDF, "native module %s has no stream function %s",
+				filename, function);
+		*rv = UDF_NATIVE_ERR_FUNCTION_NOT_FOUND;
+	}
+	else {
+		*rv = fn->stream_fn(&g_api, ctx, istream, args, ostream, res);
+	}
+
+	module_release(mod);
+
+	return true;
+}
+
+
+//==========================================================
+// Local helpers - api accessors.
+//
+
+static bool
+api_bin_get_int(as_rec* rec, const char* name, int64_t* value)
+{
+	as_bin* b;
+	as_val* val;
+
+	if (! bin_get(rec, name, &b, &val)) {
+		return false;
+	}
+
+	if (val) {
+		as_integer* i = as_integer_fromval(val);
+
+		if (! i) {
+			return false;
+		}
+
+		*value = as_integer_get(i);
+		return true;
+	}
+
+	if (as_bin_get_particle_type(b) != AS_PARTICLE_TYPE_INTEGER) {
+		return false;
+	}
+
+	*value = as_bin_particle_integer_value(b);
+	return true;
+}
+
+static bool
+api_bin_get_float(as_rec* rec, const char* name, double* value)
+{
+	as_bin* b;
+	as_val* val;
+
+	if (! bin_get(rec, name, &b, &val)) {
+		return false;
+	}
+
+	if (val) {
+		as_double* d = as_double_fromval(val);
+
+		if (! d) {
+			return false;
+		}
+
+		*value = as_double_get(d);
+		return true;
+	}
+
+	if (as_bin_get_particle_type(b) != AS_PARTICLE_TYPE_FLOAT) {
+		return false;
+	}
+
+	*value = as_bin_particle_float_value(b);
+	return true;
+}
+
+static bool
+api_bin_get_str(as_rec* rec, const char* name, const char** value,
+		uint32_t* size)
+{
+	as_bin* b;
+	as_val* val;
+
+	if (! bin_get(rec, name, &b, &val)) {
+		return false;
+	}
+
+	if (val) {
+		as_string* s = as_string_fromval(val);
+
+		if (! s) {
+			return false;
+		}
+
+		*value = as_string_get(s);
+		*size = (uint32_t)as_string_len(s);
+		return true;
+	}
+
+	if (as_bin_get_particle_type(b) != AS_PARTICLE_TYPE_STRING) {
+		return false;
+	}
+
+	char* p;
+
+	*size = as_bin_particle_string_ptr(b, &p);
+	*value = p;
+	return true;
+}
+
+
+//==========================================================
+// Local helpers - modules.
+//
+
+static udf_native_module*
+module_open(const char* filename, const uint8_t* content, size_t size,
+		char* err, size_t err_sz)
+{
+	if (! g_config.udf_native_enabled) {
+		snprintf(err, err_sz, "native modules not enabled");
+		return NULL;
+	}
+
+	if (strlen(filename) >= MODULE_NAME_SZ) {
+		snprintf(err, err_sz, "filename too long");
+		return NULL;
+	}
+
+	// dlopen() caches by path, and the loader maps the file - load each
+	// version from a private copy, unlinked once mapped.
+	char path[1024];
+
+	snprintf(path, sizeof(path), "%s/.native-%u-%s", g_config.mod_lua.user_path,
+			cf_atomic32_incr(&g_load_seq), filename);
+
+	int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+
+	if (fd == -1) {
+		snprintf(err, err_sz, "can't create %s: %s", path, cf_strerror(errno));
+		return NULL;
+	}
+
+	ssize_t w_sz = write(fd, content, size);
+
+	close(fd);
+
+	if (w_sz != (ssize_t)size) {
+		snprintf(err, err_sz, "can't write %s", path);
+		unlink(path);
+		return NULL;
+	}
+
+	void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+
+	unlink(path);
+
+	if (! handle) {
+		snprintf(err, err_sz, "dlopen failed: %s", dlerror());
+		return NULL;
+	}
+
+	const as_udf_native_module* def = (const as_udf_native_module*)
+			dlsym(handle, AS_UDF_NATIVE_MODULE_SYMBOL);
+
+	if (! def) {
+		snprintf(err, err_sz, "no %s symbol", AS_UDF_NATIVE_MODULE_SYMBOL);
+		dlclose(handle);
+		return NULL;
+	}
+
+	if (def->abi_version != AS_UDF_NATIVE_ABI_VERSION) {
+		snprintf(err, err_sz, "abi version %u, expected %u", def->abi_version,
+				AS_UDF_NATIVE_ABI_VERSION);
+		dlclose(handle);
+		return NULL;
+	}
+
+	if (def->n_functions == 0 || def->n_functions > UDF_NATIVE_MAX_FUNCTIONS ||
+			! def->functions) {
+		snprintf(err, err_sz, "bad function count %u", def->n_functions);
+		dlclose(handle);
+		return NULL;
+	}
+
+	for (uint32_t i = 0; i < def->n_functions; i++) {
+		if (! def->functions[i].name ||
+				(! def->functions[i].record_fn &&
+						! def->functions[i].stream_fn)) {
+			snprintf(err, err_sz, "bad function at index %u", i);
+			dlclose(handle);
+			return NULL;
+		}
+	}
+
+	udf_native_module* mod = cf_malloc(sizeof(udf_native_module));
+
+	strcpy(mod->filename, filename);
+	module_name(filename, mod->name);
+	mod->handle = handle;
+	mod->def = def;
+	mod->rc = 1;
+
+	return mod;
+}
+
+// For modules that were never initialized.
+static void
+module_close(udf_native_module* mod)
+{
+	dlclose(mod->handle);
+	cf_free(mod);
+}
+
+static void
+unload(const char* filename, bool by_name)
+{
+	udf_native_module* mod = NULL;
+	char name[MODULE_NAME_SZ];
+
+	module_name(filename, name);
+
+	pthread_rwlock_wrlock(&g_lock);
+
+	for (int i = 0; i < UDF_NATIVE_MAX_MODULES; i++) {
+		if (g_modules[i] && (by_name ?
+				strcmp(g_modules[i]->name, name) == 0 :
+				strcmp(g_modules[i]->filename, filename) == 0)) {
+			mod = g_modules[i];
+			g_modules[i] = NULL;
+			break;
+		}
+	}
+
+	pthread_rwlock_unlock(&g_lock);
+
+	if (mod) {
+		cf_info(AS_UDF, "native module %s unloaded", mod->filename);
+		module_release(mod);
+	}
+}
+
+// Modules are registered as filenames (e.g. "mymod.so") but called by module
+// name (e.g. "mymod") - name both sides the same way. Length already checked.
+static void
+module_name(const char* filename, char* name)
+{
+	const char* dot = strrchr(filename, '.');
+	size_t len = dot ? (size_t)(dot - filename) : strlen(filename);
+
+	if (len >= MODULE_NAME_SZ) {
+		len = MODULE_NAME_SZ - 1;
+	}
+
+	memcpy(name, filename, len);
+	name[len] = '\0';
+}
+
+static udf_native_module*
+module_reserve(const char* filename)
+{
+	udf_native_module* mod = NULL;
+	char name[MODULE_NAME_SZ];
+
+	module_name(filename, name);
+
+	pthread_rwlock_rdlock(&g_lock);
+
+	for (int i = 0; i < UDF_NATIVE_MAX_MODULES; i++) {
+		if (g_modules[i] && strcmp(g_modules[i]->name, name) == 0) {
+			mod = g_modules[i];
+			cf_atomic32_incr(&mod->rc);
+			break;
+		}
+	}
+
+	pthread_rwlock_unlock(&g_lock);
+
+	return mod;
+}
+
+static void
+module_release(udf_native_module* mod)
+{
+	if (cf_atomic32_decr(&mod->rc) != 0) {
+		return;
+	}
+
+	if (mod->def->destroy) {
+		mod->def->destroy();
+	}
+
+	module_close(mod);
+}
+
+static const as_udf_native_function*
+module_find_function(const udf_native_module* mod, const char* function)
+{
+	for (uint32_t i = 0; i < mod->def->n_functions; i++) {
+		if (strcmp(mod->def->functions[i].name, function) == 0) {
+			return &mod->def->functions[i];
+		}
+	}
+
+	return NULL;
+}
+
+// Finds a bin in the udf_record's update cache (val) or else in the record
+// itself (b). Bins aren't converted to as_vals here.
+static bool
+bin_get(as_rec* rec, const char* name, as_bin** p_b, as_val** p_val)
+{
+	if (udf_record_param_check(rec, __FILE__, __LINE__) != 0 || ! name) {
+		return false;
+	}
+
+	udf_record* urecord = (udf_record*)as_rec_source(rec);
+	as_val* val = udf_record_cache_get(urecord, name);
+
+	if (val) {
+		*p_b = NULL;
+		*p_val = val;
+		return true;
+	}
+
+	if ((urecord->flag & UDF_RECORD_FLAG_STORAGE_OPEN) == 0 &&
+			udf_record_open(urecord) != 0) {
+		return false;
+	}
+
+	if (! urecord->rd->ns) {
+		return false;
+	}
+
+	as_bin* b = as_bin_get(urecord->rd, name);
+
+	if (! b) {
+		return false;
+	}
+
+	*p_b = b;
+	*p_val = NULL;
+	return true;
+}
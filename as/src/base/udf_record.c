@@ -351,7 +351,7 @@ static int print_buffer(as_buffer * buff) {
  * 		udf_record_close               (finally closing record)
  * 		udf_rw_commit                  (commit the udf record)
  */
-static as_val *
+as_val *
 udf_record_cache_get(udf_record * urecord, const char * name)
 {
 	cf_debug(AS_UDF, "[ENTER] BinName(%s) ", name );
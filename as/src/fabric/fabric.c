@@ -90,6 +90,11 @@
 #define FABRIC_EPOLL_SEND_EVENTS	16
 #define FABRIC_EPOLL_RECV_EVENTS	1
 
+// On the rw channel, messages bigger than this queue behind smaller ones.
+#define FABRIC_SEND_LARGE_MSG_SZ	(8 * 1024) // bytes
+// Small messages sent in a row before a waiting large message gets a turn.
+#define FABRIC_SEND_SMALL_BURST		8
+
 typedef enum {
 	// These values go on the wire, so mind backward compatibility if changing.
 	FS_FIELD_NODE,
@@ -133,6 +138,18 @@ typedef struct send_entry_s {
 	cf_poll poll;
 } send_entry;
 
+typedef struct fabric_send_item_s {
+	msg			*m;
+	uint64_t	enq_us;
+	uint32_t	send_class;
+} fabric_send_item;
+
+typedef struct fabric_send_queue_s {
+	cf_queue	q[AS_FABRIC_N_SEND_CLASSES]; // element is fabric_send_item
+	bool		use_classes; // if false, everything goes in the small queue
+	cf_atomic32	n_small_run; // small messages sent while large ones waited
+} fabric_send_queue;
+
 typedef struct fabric_state_s {
 	as_fabric_msg_fn	msg_cb[M_TYPE_MAX];
 	void 				*msg_udata[M_TYPE_MAX];
@@ -171,7 +188,7 @@ typedef struct fabric_node_s {
 	pthread_mutex_t		send_idle_fc_queue_lock;
 	cf_queue			send_idle_fc_queue[AS_FABRIC_N_CHANNELS];
 
-	cf_queue			send_queue[AS_FABRIC_N_CHANNELS];
+	fabric_send_queue	send_queue[AS_FABRIC_N_CHANNELS];
 
 	uint8_t	send_counts[];
 } fabric_node;
@@ -238,6 +255,12 @@ static bool g_published_endpoint_list_ipv4_only;
 // Max connections formed via connect. Others are formed via accept.
 static uint32_t g_fabric_connect_limit[AS_FABRIC_N_CHANNELS];
 
+// Cumulative rw channel send queue stats, per class.
+static cf_atomic64 g_rw_q_msgs[AS_FABRIC_N_SEND_CLASSES];
+static cf_atomic64 g_rw_q_wait_us[AS_FABRIC_N_SEND_CLASSES];
+static uint64_t g_rw_q_msgs_last[AS_FABRIC_N_SEND_CLASSES];
+static uint64_t g_rw_q_wait_us_last[AS_FABRIC_N_SEND_CLASSES];
+
 
 //==========================================================
 // Forward declarations.
@@ -249,6 +272,16 @@ static void send_entry_insert(send_entry **se_pp, send_entry *se);
 static void fabric_published_serv_cfg_fill(const cf_serv_cfg *bind_cfg, cf_serv_cfg *published_cfg, bool ipv4_only);
 static bool fabric_published_endpoints_refresh(void);
 
+// fabric_send_queue
+static void fabric_send_queue_init(fabric_send_queue *sq, bool use_classes);
+static void fabric_send_queue_destroy(fabric_send_queue *sq);
+static void fabric_send_queue_push(fabric_send_queue *sq, msg *m);
+static void fabric_send_queue_push_head(fabric_send_queue *sq, const fabric_send_item *item);
+static bool fabric_send_queue_pop(fabric_send_queue *sq, fabric_send_item *item);
+static msg *fabric_send_queue_take(fabric_send_queue *sq, const fabric_send_item *item);
+static msg *fabric_send_queue_pop_msg(fabric_send_queue *sq);
+inline static uint32_t fabric_send_queue_sz(fabric_send_queue *sq);
+
 // fabric_node
 static fabric_node *fabric_node_create(cf_node node_id);
 static fabric_node *fabric_node_get(cf_node node_id);
@@ -320,6 +353,7 @@ static void *run_fabric_accept(void *arg);
 // Ticker helpers.
 static int fabric_rate_node_reduce_fn(const void *key, uint32_t keylen, void *data, void *udata);
 static int fabric_rate_fc_reduce_fn(const void *key, void *data, void *udata);
+static void fabric_rate_capture_rw_q(fabric_rate *rate);
 
 // Heartbeat.
 static void fabric_hb_plugin_set_fn(msg *m);
@@ -652,6 +686,8 @@ as_fabric_rate_capture(fabric_rate *rate)
 	pthread_mutex_lock(&g_fabric.node_hash_lock);
 	cf_rchash_reduce(g_fabric.node_hash, fabric_rate_node_reduce_fn, rate);
 	pthread_mutex_unlock(&g_fabric.node_hash_lock);
+
+	fabric_rate_capture_rw_q(rate);
 }
 
 void
@@ -682,9 +718,9 @@ as_fabric_dump(bool verbose)
 				node->connect_count[AS_FABRIC_CHANNEL_RW],
 				node->connect_count[AS_FABRIC_CHANNEL_BULK],
 				cf_shash_get_size(node->fc_hash), node->live,
-				cf_queue_sz(&node->send_queue[AS_FABRIC_CHANNEL_CTRL]),
-				cf_queue_sz(&node->send_queue[AS_FABRIC_CHANNEL_RW]),
-				cf_queue_sz(&node->send_queue[AS_FABRIC_CHANNEL_BULK]));
+				fabric_send_queue_sz(&node->send_queue[AS_FABRIC_CHANNEL_CTRL]),
+				fabric_send_queue_sz(&node->send_queue[AS_FABRIC_CHANNEL_RW]),
+				fabric_send_queue_sz(&node->send_queue[AS_FABRIC_CHANNEL_BULK]));
 		pthread_mutex_unlock(&node->fc_hash_lock);
 
 		fabric_node_release(node); // node_get
@@ -801,6 +837,133 @@ fabric_published_endpoints_refresh()
 }
 
 
+//==========================================================
+// fabric_send_queue
+//
+
+static void
+fabric_send_queue_init(fabric_send_queue *sq, bool use_classes)
+{
+	for (uint32_t c = 0; c < AS_FABRIC_N_SEND_CLASSES; c++) {
+		cf_queue_init(&sq->q[c], sizeof(fabric_send_item), CF_QUEUE_ALLOCSZ,
+				true);
+	}
+
+	sq->use_classes = use_classes;
+	sq->n_small_run = 0;
+}
+
+static void
+fabric_send_queue_destroy(fabric_send_queue *sq)
+{
+	for (uint32_t c = 0; c < AS_FABRIC_N_SEND_CLASSES; c++) {
+		fabric_send_item item;
+
+		while (cf_queue_pop(&sq->q[c], &item, CF_QUEUE_NOWAIT) ==
+				CF_QUEUE_OK) {
+			as_fabric_msg_put(item.m);
+		}
+
+		cf_queue_destroy(&sq->q[c]);
+	}
+}
+
+static void
+fabric_send_queue_push(fabric_send_queue *sq, msg *m)
+{
+	fabric_send_item item = {
+			.m = m,
+			.enq_us = sq->use_classes ? cf_getus() : 0,
+			.send_class = AS_FABRIC_SEND_CLASS_SMALL
+	};
+
+	if (sq->use_classes && msg_get_wire_size(m) > FABRIC_SEND_LARGE_MSG_SZ) {
+		item.send_class = AS_FABRIC_SEND_CLASS_LARGE;
+	}
+
+	cf_queue_push(&sq->q[item.send_class], &item);
+}
+
+// Return an item got via fabric_send_queue_pop() which was not sent.
+static void
+fabric_send_queue_push_head(fabric_send_queue *sq,
+		const fabric_send_item *item)
+{
+	cf_queue_push_head(&sq->q[item->send_class], item);
+}
+
+// Small messages go first, but after FABRIC_SEND_SMALL_BURST of them in a row
+// a waiting large message gets its turn.
+static bool
+fabric_send_queue_pop(fabric_send_queue *sq, fabric_send_item *item)
+{
+	uint32_t first = AS_FABRIC_SEND_CLASS_SMALL;
+
+	if (sq->use_classes &&
+			cf_atomic32_get(sq->n_small_run) >= FABRIC_SEND_SMALL_BURST) {
+		first = AS_FABRIC_SEND_CLASS_LARGE;
+	}
+
+	for (uint32_t i = 0; i < AS_FABRIC_N_SEND_CLASSES; i++) {
+		uint32_t c = (first + i) % AS_FABRIC_N_SEND_CLASSES;
+
+		if (cf_queue_pop(&sq->q[c], item, CF_QUEUE_NOWAIT) == CF_QUEUE_OK) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Commit to sending a popped item - does the round-robin and stats accounting.
+static msg *
+fabric_send_queue_take(fabric_send_queue *sq, const fabric_send_item *item)
+{
+	if (! sq->use_classes) {
+		return item->m;
+	}
+
+	if (item->send_class == AS_FABRIC_SEND_CLASS_SMALL &&
+			cf_queue_sz(&sq->q[AS_FABRIC_SEND_CLASS_LARGE]) != 0) {
+		cf_atomic32_incr(&sq->n_small_run);
+	}
+	else {
+		cf_atomic32_set(&sq->n_small_run, 0);
+	}
+
+	uint64_t now = cf_getus();
+
+	cf_atomic64_incr(&g_rw_q_msgs[item->send_class]);
+
+	if (now > item->enq_us) {
+		cf_atomic64_add(&g_rw_q_wait_us[item->send_class], now - item->enq_us);
+	}
+
+	return item->m;
+}
+
+static msg *
+fabric_send_queue_pop_msg(fabric_send_queue *sq)
+{
+	fabric_send_item item;
+
+	return fabric_send_queue_pop(sq, &item) ?
+			fabric_send_queue_take(sq, &item) : NULL;
+}
+
+inline static uint32_t
+fabric_send_queue_sz(fabric_send_queue *sq)
+{
+	uint32_t sz = 0;
+
+	for (uint32_t c = 0; c < AS_FABRIC_N_SEND_CLASSES; c++) {
+		sz += cf_queue_sz(&sq->q[c]);
+	}
+
+	return sz;
+}
+
+
 //==========================================================
 // fabric_node
 //
@@ -825,8 +988,8 @@ fabric_node_create(cf_node node_id)
 		cf_queue_init(&node->send_idle_fc_queue[i], sizeof(fabric_connection *),
 				CF_QUEUE_ALLOCSZ, false);
 
-		cf_queue_init(&node->send_queue[i], sizeof(msg *), CF_QUEUE_ALLOCSZ,
-				true);
+		fabric_send_queue_init(&node->send_queue[i],
+				i == AS_FABRIC_CHANNEL_RW);
 	}
 
 	if (pthread_mutex_init(&node->connect_lock, NULL) != 0) {
@@ -1081,7 +1244,7 @@ fabric_node_send(fabric_node *node, msg *m, as_fabric_channel channel)
 				CF_QUEUE_NOWAIT);
 
 		if (rv != CF_QUEUE_OK) {
-			cf_queue_push(&node->send_queue[(int)channel], &m);
+			fabric_send_queue_push(&node->send_queue[(int)channel], m);
 			pthread_mutex_unlock(&node->send_idle_fc_queue_lock);
 
 			if (! node->connect_full) {
@@ -1156,18 +1319,7 @@ fabric_node_destructor(void *pnode)
 		cf_queue_destroy(&node->send_idle_fc_queue[i]);
 
 		// send_queue section.
-		while (true) {
-			msg *m;
-
-			if (cf_queue_pop(&node->send_queue[i], &m, CF_QUEUE_NOWAIT) !=
-					CF_QUEUE_OK) {
-				break;
-			}
-
-			as_fabric_msg_put(m);
-		}
-
-		cf_queue_destroy(&node->send_queue[i]);
+		fabric_send_queue_destroy(&node->send_queue[i]);
 	}
 
 	pthread_mutex_destroy(&node->send_idle_fc_queue_lock);
@@ -1435,8 +1587,8 @@ fabric_connection_release(fabric_connection *fc)
 			// First message (s_count == 0) is initial M_TYPE_FABRIC message
 			// and does not need to be saved.
 			if (! fc->started_via_connect || fc->s_count != 0) {
-				cf_queue_push(&fc->node->send_queue[fc->pool->pool_id],
-						&fc->s_msg_in_progress);
+				fabric_send_queue_push(&fc->node->send_queue[fc->pool->pool_id],
+						fc->s_msg_in_progress);
 			}
 			else {
 				as_fabric_msg_put(fc->s_msg_in_progress);
@@ -1711,7 +1863,7 @@ fabric_connection_process_writable(fabric_connection *fc)
 	//    All messages get sent with MSG_MORE but because buffer full, small
 	//    packets still won't happen.
 	fabric_node *node = fc->node;
-	uint32_t pool = fc->pool->pool_id;
+	fabric_send_queue *sq = &node->send_queue[fc->pool->pool_id];
 
 	if (! fc->s_msg_in_progress) {
 		// TODO - Change to load op when atomic API is ready.
@@ -1721,21 +1873,22 @@ fabric_connection_process_writable(fabric_connection *fc)
 	}
 
 	while (fc->s_msg_in_progress) {
-		msg *pending = NULL;
+		fabric_send_item pending;
+		bool has_pending = fabric_send_queue_pop(sq, &pending);
 
-		cf_queue_pop(&node->send_queue[pool], &pending, CF_QUEUE_NOWAIT);
-		fabric_connection_send_progress(fc, ! pending);
+		fabric_connection_send_progress(fc, ! has_pending);
 
 		if (fc->s_msg_in_progress) {
-			if (pending) {
-				cf_queue_push_head(&node->send_queue[pool], &pending);
+			if (has_pending) {
+				fabric_send_queue_push_head(sq, &pending);
 			}
 
 			fabric_connection_send_rearm(fc);
 			return true;
 		}
 
-		fc->s_msg_in_progress = pending;
+		fc->s_msg_in_progress = has_pending ?
+				fabric_send_queue_take(sq, &pending) : NULL;
 	}
 
 	if (! fc->node->live || fc->failed) {
@@ -1750,9 +1903,8 @@ fabric_connection_process_writable(fabric_connection *fc)
 		return false;
 	}
 
-	if (cf_queue_pop(&node->send_queue[pool], &fc->s_msg_in_progress,
-			CF_QUEUE_NOWAIT) == CF_QUEUE_EMPTY) {
-		cf_queue_push(&node->send_idle_fc_queue[pool], &fc);
+	if ((fc->s_msg_in_progress = fabric_send_queue_pop_msg(sq)) == NULL) {
+		cf_queue_push(&node->send_idle_fc_queue[fc->pool->pool_id], &fc);
 		pthread_mutex_unlock(&node->send_idle_fc_queue_lock);
 		return true;
 	}
@@ -1810,8 +1962,10 @@ fabric_connection_process_fabric_msg(fabric_connection *fc, const msg *m)
 		if (node->live && ! fc->failed) {
 			fabric_connection_reserve(fc); // for send poll & idleQ
 
-			if (cf_queue_pop(&node->send_queue[pool_id], &fc->s_msg_in_progress,
-					CF_QUEUE_NOWAIT) == CF_QUEUE_EMPTY) {
+			fc->s_msg_in_progress =
+					fabric_send_queue_pop_msg(&node->send_queue[pool_id]);
+
+			if (! fc->s_msg_in_progress) {
 				cf_queue_push(&node->send_idle_fc_queue[pool_id], &fc);
 			}
 			else {
@@ -2365,6 +2519,12 @@ fabric_rate_node_reduce_fn(const void *key, uint32_t keylen, void *data,
 	cf_shash_reduce(node->fc_hash, fabric_rate_fc_reduce_fn, rate);
 	pthread_mutex_unlock(&node->fc_hash_lock);
 
+	fabric_send_queue *sq = &node->send_queue[AS_FABRIC_CHANNEL_RW];
+
+	for (uint32_t c = 0; c < AS_FABRIC_N_SEND_CLASSES; c++) {
+		rate->rw_q_depth[c] += cf_queue_sz(&sq->q[c]);
+	}
+
 	return 0;
 }
 
@@ -2391,6 +2551,21 @@ fabric_rate_fc_reduce_fn(const void *key, void *data, void *udata)
 	return 0;
 }
 
+static void
+fabric_rate_capture_rw_q(fabric_rate *rate)
+{
+	for (uint32_t c = 0; c < AS_FABRIC_N_SEND_CLASSES; c++) {
+		uint64_t msgs = cf_atomic64_get(g_rw_q_msgs[c]);
+		uint64_t wait_us = cf_atomic64_get(g_rw_q_wait_us[c]);
+
+		rate->rw_q_msgs[c] = msgs - g_rw_q_msgs_last[c];
+		rate->rw_q_wait_us[c] = wait_us - g_rw_q_wait_us_last[c];
+
+		g_rw_q_msgs_last[c] = msgs;
+		g_rw_q_wait_us_last[c] = wait_us;
+	}
+}
+
 
 //==========================================================
 // Heartbeat.
@@ -625,6 +625,16 @@ emigration_hash_delete(emigration *emig)
 bool
 emigrate_transfer(emigration *emig)
 {
+	// Cold start hasn't loaded this partition's index - don't send what we
+	// don't have yet, requeue and fetch another.
+	if (emig->rsv.p->loading) {
+		emig->wait_until_ms = cf_getms() + EMIGRATION_SLOW_Q_WAIT_MS;
+
+		cf_queue_push(&g_emigration_slow_q, &emig);
+
+		return true; // requeued
+	}
+
 	//--------------------------------------------
 	// Send START request.
 	//
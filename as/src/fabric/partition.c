@@ -58,6 +58,15 @@ char partition_descriptor(const as_partition* p);
 int partition_get_replica_self_lockfree(const as_namespace* ns, uint32_t pid);
 
 
+//==========================================================
+// Globals.
+//
+
+// Signaled as cold start finishes loading partitions.
+static pthread_mutex_t g_loaded_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_loaded_cond = PTHREAD_COND_INITIALIZER;
+
+
 //==========================================================
 // Public API.
 //
@@ -96,6 +105,39 @@ as_partition_shutdown(as_namespace* ns, uint32_t pid)
 }
 
 
+// Called as cold start finishes loading a partition's index - transactions and
+// migrations may now use it.
+void
+as_partition_loaded(as_namespace* ns, uint32_t pid)
+{
+	as_partition* p = &ns->partitions[pid];
+
+	pthread_mutex_lock(&p->lock);
+
+	p->loading = false;
+
+	pthread_mutex_unlock(&p->lock);
+
+	pthread_mutex_lock(&g_loaded_lock);
+	pthread_cond_broadcast(&g_loaded_cond);
+	pthread_mutex_unlock(&g_loaded_lock);
+}
+
+
+// Block until cold start has loaded the partition's index.
+void
+as_partition_wait_loaded(as_partition* p)
+{
+	pthread_mutex_lock(&g_loaded_lock);
+
+	while (p->loading) {
+		pthread_cond_wait(&g_loaded_cond, &g_loaded_lock);
+	}
+
+	pthread_mutex_unlock(&g_loaded_lock);
+}
+
+
 void
 as_partition_freeze(as_partition* p)
 {
@@ -357,6 +399,13 @@ as_partition_reserve_replica(as_namespace* ns, uint32_t pid,
 		return AS_PROTO_RESULT_FAIL_CLUSTER_KEY_MISMATCH;
 	}
 
+	// Applying a replica write or delete before cold start adds the record's
+	// entry would let the stale entry win - master will retransmit.
+	if (p->loading) {
+		pthread_mutex_unlock(&p->lock);
+		return AS_PROTO_RESULT_FAIL_UNAVAILABLE;
+	}
+
 	partition_reserve_lockfree(p, ns, rsv);
 
 	pthread_mutex_unlock(&p->lock);
@@ -368,7 +417,8 @@ as_partition_reserve_replica(as_namespace* ns, uint32_t pid,
 // Returns:
 //  0 - reserved - node parameter returns self node
 // -1 - not reserved - node parameter returns other "better" node
-// -2 - not reserved - node parameter not filled - partition is "frozen"
+// -2 - not reserved - node parameter not filled - partition is "frozen" or
+//      not yet loaded
 int
 as_partition_reserve_write(as_namespace* ns, uint32_t pid,
 		as_partition_reservation* rsv, cf_node* node)
@@ -399,6 +449,16 @@ as_partition_reserve_write(as_namespace* ns, uint32_t pid,
 		return -1;
 	}
 
+	// If this node should handle it but hasn't loaded it yet, return.
+	if (p->loading) {
+		if (node) {
+			*node = (cf_node)0;
+		}
+
+		pthread_mutex_unlock(&p->lock);
+		return -2;
+	}
+
 	partition_reserve_lockfree(p, ns, rsv);
 
 	pthread_mutex_unlock(&p->lock);
@@ -410,7 +470,8 @@ as_partition_reserve_write(as_namespace* ns, uint32_t pid,
 // Returns:
 //  0 - reserved - node parameter returns self node
 // -1 - not reserved - node parameter returns other "better" node
-// -2 - not reserved - node parameter not filled - partition is "frozen"
+// -2 - not reserved - node parameter not filled - partition is "frozen" or
+//      not yet loaded
 int
 as_partition_reserve_read(as_namespace* ns, uint32_t pid,
 		as_partition_reservation* rsv, bool would_dup_res, cf_node* node)
@@ -441,6 +502,16 @@ as_partition_reserve_read(as_namespace* ns, uint32_t pid,
 		return -1;
 	}
 
+	// If this node should handle it but hasn't loaded it yet, return.
+	if (p->loading) {
+		if (node) {
+			*node = (cf_node)0;
+		}
+
+		pthread_mutex_unlock(&p->lock);
+		return -2;
+	}
+
 	partition_reserve_lockfree(p, ns, rsv);
 
 	pthread_mutex_unlock(&p->lock);
@@ -494,7 +565,7 @@ as_partition_reserve_xdr_read(as_namespace* ns, uint32_t pid,
 
 	int res = -1;
 
-	if (! as_partition_version_is_null(&p->version)) {
+	if (! as_partition_version_is_null(&p->version) && ! p->loading) {
 		partition_reserve_lockfree(p, ns, rsv);
 		res = 0;
 	}
@@ -534,7 +605,7 @@ as_partition_getinfo_str(cf_dyn_buf* db)
 
 	cf_dyn_buf_append_string(db, "namespace:partition:state:n_replicas:replica:"
 			"n_dupl:working_master:emigrates:immigrates:records:tombstones:"
-			"version:final_version;");
+			"version:final_version:loading;");
 
 	for (uint32_t ns_ix = 0; ns_ix < g_config.n_namespaces; ns_ix++) {
 		as_namespace* ns = g_config.namespaces[ns_ix];
@@ -569,6 +640,8 @@ as_partition_getinfo_str(cf_dyn_buf* db)
 			cf_dyn_buf_append_string(db, VERSION_AS_STRING(&p->version));
 			cf_dyn_buf_append_char(db, ':');
 			cf_dyn_buf_append_string(db, VERSION_AS_STRING(&p->final_version));
+			cf_dyn_buf_append_char(db, ':');
+			cf_dyn_buf_append_bool(db, p->loading);
 
 			cf_dyn_buf_append_char(db, ';');
 
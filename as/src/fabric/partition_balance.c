@@ -220,6 +220,7 @@ as_partition_balance_init()
 		as_namespace* ns = g_config.namespaces[ns_ix];
 
 		uint32_t n_stored = 0;
+		uint32_t n_loading = 0;
 
 		for (uint32_t pid = 0; pid < AS_PARTITIONS; pid++) {
 			if (ns->storage_type != AS_STORAGE_ENGINE_SSD) {
@@ -234,12 +235,20 @@ as_partition_balance_init()
 				p->version.master = 0;
 				p->version.subset = 1;
 
+				// Cold start is still loading it - any other node's copy is
+				// preferred as working master and migration source.
+				if (p->loading) {
+					p->version.evade = 1;
+					n_loading++;
+				}
+
 				n_stored++;
 			}
 		}
 
-		cf_info(AS_PARTITION, "{%s} %u partitions: found %u absent, %u stored",
-				ns->name, AS_PARTITIONS, AS_PARTITIONS - n_stored, n_stored);
+		cf_info(AS_PARTITION, "{%s} %u partitions: found %u absent, %u stored (%u loading)",
+				ns->name, AS_PARTITIONS, AS_PARTITIONS - n_stored, n_stored,
+				n_loading);
 	}
 }
 
@@ -459,6 +468,12 @@ as_partition_immigrate_start(as_namespace* ns, uint32_t pid,
 		return AS_MIGRATE_AGAIN;
 	}
 
+	// Cold start hasn't loaded this partition's index - retry when it has.
+	if (p->loading) {
+		pthread_mutex_unlock(&p->lock);
+		return AS_MIGRATE_AGAIN;
+	}
+
 	uint32_t num_incoming = (uint32_t)cf_atomic32_incr(&g_migrate_num_incoming);
 
 	if (num_incoming > g_config.migrate_max_num_incoming) {
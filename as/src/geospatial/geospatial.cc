@@ -22,10 +22,12 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <math.h>
 #include <string.h>
 
 #include <stdexcept>
 
+#include <s2cap.h>
 #include <s2regioncoverer.h>
 
 extern "C" {
@@ -38,6 +40,12 @@ extern "C" {
 
 using namespace std;
 
+static inline double
+ns_earth_radius_meters(as_namespace * ns)
+{
+	return ns ? double(ns->geo2dsphere_within_earth_radius_meters) : 6371000;
+}
+
 class PointRegionHandler: public GeoJSON::GeometryHandler
 {
 public:
@@ -45,8 +53,7 @@ public:
 		: m_cellid(0)
 		, m_regionp(NULL)
 	{
-		m_earth_radius_meters =
-			ns ? double(ns->geo2dsphere_within_earth_radius_meters) : 6371000;
+		m_earth_radius_meters = ns_earth_radius_meters(ns);
 	}
 
 	virtual void handle_point(S2CellId const & cellid) {
@@ -218,6 +225,57 @@ geo_point_within(uint64_t cellidval, geo_region_t region)
 	}
 }
 
+bool
+geo_cap_cover(as_namespace * ns,
+			  uint64_t cellidval,
+			  double radius_meters,
+			  int maxnumcells,
+			  uint64_t * cellminp,
+			  uint64_t * cellmaxp,
+			  int * numcellsp)
+{
+	try
+	{
+		S2CellId cellid(cellidval);
+		if (! cellid.is_valid()) {
+			cf_warning(AS_GEO, (char *) "geo_cap_cover: invalid cellid");
+			return false;
+		}
+
+		double radians = min(radius_meters / ns_earth_radius_meters(ns), M_PI);
+		S2Cap cap = S2Cap::FromAxisAngle(cellid.ToPoint(),
+										 S1Angle::Radians(radians));
+
+		return geo_region_cover(ns, (geo_region_t) &cap, maxnumcells, NULL,
+								cellminp, cellmaxp, numcellsp);
+	}
+	catch (exception const & ex)
+	{
+		cf_warning(AS_GEO, (char *) "geo_cap_cover failed: %s", ex.what());
+		return false;
+	}
+}
+
+double
+geo_point_distance(as_namespace * ns,
+				   uint64_t cellidval1,
+				   uint64_t cellidval2)
+{
+	S2CellId cellid1(cellidval1);
+	S2CellId cellid2(cellidval2);
+
+	S1Angle angle(cellid1.ToPoint(), cellid2.ToPoint());
+
+	return angle.radians() * ns_earth_radius_meters(ns);
+}
+
+// Half the circumference - a cap this big covers the whole sphere.
+double
+geo_max_distance(as_namespace * ns)
+{
+	return M_PI * ns_earth_radius_meters(ns);
+}
+
 void
 geo_region_destroy(geo_region_t region)
 {
@@ -29,6 +29,7 @@
 
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -40,6 +41,7 @@
 #include <linux/fs.h> // for BLKGETSIZE64
 #include <sys/ioctl.h>
 #include <sys/param.h> // for MAX()
+#include <sys/stat.h>
 
 #include "citrusleaf/alloc.h"
 #include "citrusleaf/cf_atomic.h"
@@ -82,6 +84,12 @@ extern bool as_cold_start_evict_if_needed(as_namespace* ns);
 #define DEFRAG_STARTUP_RESERVE	4
 #define DEFRAG_RUNTIME_RESERVE	4
 
+#define INDEX_SNAPSHOT_MAGIC	0x49584E53 // "SNXI"
+#define INDEX_SNAPSHOT_VERSION	2
+#define INDEX_SNAPSHOT_NAME_SZ	256
+
+#define INDEX_SNAPSHOT_READ_ENTRIES	1024
+
 
 //==========================================================
 // Typedefs.
@@ -93,6 +101,51 @@ typedef struct info_buf_s {
 	as_partition_version version;
 } __attribute__ ((__packed__)) info_buf;
 
+// Primary index snapshot file layout - header, device names, set names, entry
+// count per partition, wblock count and used size per wblock for each device,
+// entries in partition order, then the magic again.
+typedef struct index_snapshot_header_s {
+	uint32_t	magic;
+	uint32_t	version;
+	char		ns_name[AS_ID_NAMESPACE_SZ];
+	uint64_t	random; // device header random of the run that wrote it
+	uint32_t	write_block_size;
+	uint32_t	n_ssds;
+	uint32_t	n_sets;
+} __attribute__ ((__packed__)) index_snapshot_header;
+
+typedef struct index_snapshot_entry_s {
+	cf_digest	keyd;
+	uint64_t	last_update_time;
+	uint32_t	void_time;
+	uint16_t	generation;
+	uint16_t	set_id; // 1-based index into snapshot's set names, 0 if none
+	uint64_t	rblock_id;
+	uint16_t	n_rblocks;
+	uint8_t		file_id;
+	uint8_t		key_stored;
+} __attribute__ ((__packed__)) index_snapshot_entry;
+
+typedef struct index_snapshot_write_s {
+	drv_ssds*		ssds;
+	FILE*			fp;
+	uint32_t**		wblock_inuse; // per device, indexed by wblock-id
+	uint32_t		n_entries;
+	bool			ok;
+} index_snapshot_write;
+
+typedef struct index_snapshot_load_info_s {
+	drv_ssds*	ssds;
+	FILE*		fp;
+	uint32_t	n_sets;
+	char		(*set_names)[AS_SET_NAME_MAX_SIZE];
+	uint32_t	n_entries[AS_PARTITIONS];
+	bool		rejoined; // node may already serve loaded partitions
+	cf_queue*	complete_q;
+	void*		complete_udata;
+	uint64_t	start_ms;
+} index_snapshot_load_info;
+
 
 //==========================================================
 // Miscellaneous utility functions.
@@ -156,7 +209,10 @@ ssd_shadow_fd_put(drv_ssd *ssd, int fd)
 static inline uint32_t
 ssd_get_file_id(drv_ssds *ssds, cf_digest *keyd)
 {
-	return *(uint32_t*)&keyd->digest[DIGEST_STORAGE_BASE_BYTE] % ssds->n_ssds;
+	// Devices may be added concurrently.
+	int n_ssds = __atomic_load_n(&ssds->n_ssds, __ATOMIC_ACQUIRE);
+
+	return *(uint32_t*)&keyd->digest[DIGEST_STORAGE_BASE_BYTE] % n_ssds;
 }
 
 
@@ -232,6 +288,112 @@ min_free_wblocks(as_namespace *ns)
 }
 
 
+// Relative cost of putting a new record version on a device - roughly the time
+// to drain its write queue, inflated as the device fills up. UINT64_MAX means
+// the device is too full to take more writes.
+static uint64_t
+ssd_placement_cost(drv_ssd *ssd)
+{
+	int n_free_wblocks = cf_queue_sz(ssd->free_wblock_q);
+
+	if (n_free_wblocks <= min_free_wblocks(ssd->ns)) {
+		return UINT64_MAX;
+	}
+
+	uint64_t free_pct = ((uint64_t)n_free_wblocks * 100) /
+			ssd->alloc_table->n_wblocks;
+	uint64_t write_q_sz = (uint64_t)cf_queue_sz(ssd->swb_write_q);
+	uint64_t write_us = cf_atomic64_get(ssd->write_latency_us);
+
+	return ((write_q_sz + 1) * (write_us + 1) * 100) / (free_pct + 1);
+}
+
+
+// Devices a record's set may be placed on - a null group means all devices.
+// Records of sets in an empty group (e.g. the default group when all devices
+// are named) may go anywhere.
+static inline const ssd_device_group *
+ssd_record_device_group(drv_ssds *ssds, as_index *r)
+{
+	if (! ssds->has_device_groups) {
+		return NULL;
+	}
+
+	as_set *p_set = as_namespace_get_record_set(ssds->ns, r);
+	uint32_t group_id = p_set ? cf_atomic32_get(p_set->device_group) : 0;
+	const ssd_device_group *group = &ssds->groups[group_id];
+
+	return group->n_ssds != 0 ? group : NULL;
+}
+
+
+static inline drv_ssd *
+ssd_group_device(drv_ssds *ssds, const ssd_device_group *group, uint32_t i)
+{
+	return &ssds->ssds[group ? group->file_ids[i] : i];
+}
+
+
+// Decide which device a new record version goes on. For load placement, use
+// "power of two choices" - compare the digest's device with one other random
+// device and take the cheaper one. Candidates are limited to the devices of
+// the record's set's device group. Reads follow the index's file-id, so the
+// record may end up on any device.
+static drv_ssd *
+ssd_pick_device(drv_ssds *ssds, as_index *r)
+{
+	const ssd_device_group *group = ssd_record_device_group(ssds, r);
+	// Devices may be added concurrently.
+	int n_ssds = group ?
+			(int)__atomic_load_n(&group->n_ssds, __ATOMIC_ACQUIRE) :
+			__atomic_load_n(&ssds->n_ssds, __ATOMIC_ACQUIRE);
+
+	uint32_t home_id = *(uint32_t*)&r->keyd.digest[DIGEST_STORAGE_BASE_BYTE] %
+			n_ssds;
+	drv_ssd *home_ssd = ssd_group_device(ssds, group, home_id);
+
+	if (ssds->ns->storage_placement_policy != AS_STORAGE_PLACEMENT_LOAD ||
+			n_ssds == 1) {
+		return home_ssd;
+	}
+
+	uint32_t alt_id =
+			(home_id + 1 + (cf_get_rand32() % (n_ssds - 1))) % n_ssds;
+	drv_ssd *alt_ssd = ssd_group_device(ssds, group, alt_id);
+
+	uint64_t home_cost = ssd_placement_cost(home_ssd);
+	uint64_t alt_cost = ssd_placement_cost(alt_ssd);
+
+	if (home_cost != UINT64_MAX || alt_cost != UINT64_MAX) {
+		return alt_cost < home_cost ? alt_ssd : home_ssd;
+	}
+
+	// Both candidates are full - look for any device in the group with space.
+	for (int i = 0; i < n_ssds; i++) {
+		drv_ssd *ssd = ssd_group_device(ssds, group, (uint32_t)i);
+
+		if (ssd_placement_cost(ssd) != UINT64_MAX) {
+			return ssd;
+		}
+	}
+
+	return home_ssd;
+}
+
+
+// Smooth the swb flush latency used by load placement. Concurrent write
+// threads may occasionally lose an update - doesn't matter.
+static inline void
+ssd_update_write_latency(drv_ssd *ssd, uint64_t start_ns)
+{
+	uint64_t write_us = (cf_getns() - start_ns) / 1000;
+	uint64_t prev_us = cf_atomic64_get(ssd->write_latency_us);
+
+	cf_atomic64_set(&ssd->write_latency_us,
+			prev_us == 0 ? write_us : ((prev_us * 7) + write_us) / 8);
+}
+
+
 void
 ssd_release_vacated_wblock(drv_ssd *ssd, uint32_t wblock_id,
 		ssd_wblock_state* p_wblock_state)
@@ -605,10 +767,10 @@ defrag_move_record(drv_ssd *src_ssd, uint32_t src_wblock_id,
 
 	drv_ssds *ssds = (drv_ssds*)src_ssd->ns->storage_private;
 
-	// Figure out which device to write to. When replacing an old record, it's
-	// possible this is different from the old device (e.g. if we've added a
-	// fresh device), so derive it from the digest each time.
-	drv_ssd *ssd = &ssds->ssds[ssd_get_file_id(ssds, &block->keyd)];
+	// Figure out which device to write to. It's possible this is different
+	// from the old device (e.g. if we've added a fresh device, for load
+	// placement, or the set moved device group), so pick it each time.
+	drv_ssd *ssd = ssd_pick_device(ssds, r);
 
 	if (! ssd) {
 		cf_warning(AS_DRV_SSD, "{%s} defrag_move_record: no drv_ssd for file_id %u",
@@ -1150,6 +1312,125 @@ ssd_wblock_init(drv_ssd *ssd)
 // Record reading utilities.
 //
 
+static inline ssd_read_flight_stripe *
+ssd_read_flight_stripe_get(drv_ssds *ssds, const cf_digest *keyd)
+{
+	uint32_t i = *(uint32_t*)&keyd->digest[8] & (SSD_READ_FLIGHT_N_STRIPES - 1);
+
+	return &ssds->read_flights[i];
+}
+
+
+static inline uint32_t *
+ssd_read_active_get(drv_ssds *ssds, const cf_digest *keyd)
+{
+	uint32_t i = *(uint32_t*)&keyd->digest[12] & (SSD_READ_ACTIVE_N_SLOTS - 1);
+
+	return &ssds->read_active[i];
+}
+
+
+static ssd_read_flight **
+ssd_read_flight_find(ssd_read_flight_stripe *stripe, const cf_digest *keyd)
+{
+	ssd_read_flight **p_flight = &stripe->head;
+
+	while (*p_flight && cf_digest_compare(&(*p_flight)->keyd, keyd) != 0) {
+		p_flight = &(*p_flight)->next;
+	}
+
+	return p_flight;
+}
+
+
+// Use the buffer of a device read made by a reader queued ahead of us on the
+// record lock, if it holds the current record version. Only flight members
+// may share - the flight frees the buffer when its last member leaves.
+static bool
+ssd_read_flight_share(as_storage_rd *rd)
+{
+	drv_ssds *ssds = (drv_ssds*)rd->ns->storage_private;
+	as_record *r = rd->r;
+	ssd_read_flight_stripe *stripe = ssd_read_flight_stripe_get(ssds, &r->keyd);
+	bool shared = false;
+
+	cf_mutex_lock(&stripe->lock);
+
+	ssd_read_flight *flight = *ssd_read_flight_find(stripe, &r->keyd);
+
+	// Storage location alone isn't enough - a durable-delete or re-write can
+	// land a new version at a freed location.
+	if (flight && flight->buf && flight->file_id == r->file_id &&
+			flight->rblock_id == r->rblock_id &&
+			flight->n_rblocks == r->n_rblocks &&
+			flight->generation == r->generation &&
+			flight->last_update_time == r->last_update_time) {
+		// The flight owns the buffer - it outlives us since we're a reader.
+		rd->block = flight->block;
+		rd->must_free_block = NULL;
+		shared = true;
+	}
+
+	cf_mutex_unlock(&stripe->lock);
+
+	if (shared) {
+		cf_atomic64_incr(&rd->ns->n_reads_coalesced);
+	}
+
+	return shared;
+}
+
+
+// If other readers are queued behind us, hand our buffer to the flight.
+static void
+ssd_read_flight_publish(as_storage_rd *rd)
+{
+	drv_ssds *ssds = (drv_ssds*)rd->ns->storage_private;
+
+	if (! ssds->read_flights) {
+		return;
+	}
+
+	as_record *r = rd->r;
+
+	// Nobody else joined - no flight to look for.
+	if (__atomic_load_n(ssd_read_active_get(ssds, &r->keyd),
+			__ATOMIC_ACQUIRE) < 2) {
+		return;
+	}
+
+	ssd_read_flight_stripe *stripe = ssd_read_flight_stripe_get(ssds, &r->keyd);
+	uint8_t *stale_buf = NULL;
+
+	cf_mutex_lock(&stripe->lock);
+
+	ssd_read_flight *flight = *ssd_read_flight_find(stripe, &r->keyd);
+
+	// Publish if any flight member other than us may want the buffer.
+	if (flight && flight->n_readers > (rd->in_read_flight ? 1 : 0)) {
+		// Any previous buffer holds an older version - only used under the
+		// record lock, which we hold, so nobody else is using it.
+		stale_buf = flight->buf;
+
+		flight->file_id = r->file_id;
+		flight->rblock_id = r->rblock_id;
+		flight->n_rblocks = r->n_rblocks;
+		flight->generation = r->generation;
+		flight->last_update_time = r->last_update_time;
+		flight->buf = rd->must_free_block;
+		flight->block = rd->block;
+
+		rd->must_free_block = NULL;
+	}
+
+	cf_mutex_unlock(&stripe->lock);
+
+	if (stale_buf) {
+		cf_free(stale_buf);
+	}
+}
+
+
 int
 ssd_read_record(as_storage_rd *rd)
 {
@@ -1162,6 +1443,10 @@ ssd_read_record(as_storage_rd *rd)
 		return -1;
 	}
 
+	if (rd->in_read_flight && ssd_read_flight_share(rd)) {
+		return 0;
+	}
+
 	uint64_t record_offset = RBLOCKS_TO_BYTES(r->rblock_id);
 	uint64_t record_size = RBLOCKS_TO_BYTES(r->n_rblocks);
 
@@ -1272,6 +1557,10 @@ ssd_read_record(as_storage_rd *rd)
 	rd->block = block;
 	rd->must_free_block = read_buf;
 
+	if (rd->is_joined_read) {
+		ssd_read_flight_publish(rd);
+	}
+
 	return 0;
 }
 
@@ -1374,7 +1663,8 @@ ssd_flush_swb(drv_ssd *ssd, ssd_write_buf *swb)
 	int fd = ssd_fd_get(ssd);
 	off_t write_offset = (off_t)WBLOCK_ID_TO_BYTES(ssd, swb->wblock_id);
 
-	uint64_t start_ns = ssd->ns->storage_benchmarks_enabled ? cf_getns() : 0;
+	// Always timed - load placement needs the latency.
+	uint64_t start_ns = cf_getns();
 
 	if (lseek(fd, write_offset, SEEK_SET) != write_offset) {
 		cf_crash(AS_DRV_SSD, "%s: DEVICE FAILED seek: offset %ld: errno %d (%s)",
@@ -1388,10 +1678,12 @@ ssd_flush_swb(drv_ssd *ssd, ssd_write_buf *swb)
 				ssd->name, errno, cf_strerror(errno));
 	}
 
-	if (start_ns != 0) {
+	if (ssd->ns->storage_benchmarks_enabled) {
 		histogram_insert_data_point(ssd->hist_write, start_ns);
 	}
 
+	ssd_update_write_latency(ssd, start_ns);
+
 	ssd_fd_put(ssd, fd);
 }
 
@@ -1599,7 +1891,10 @@ as_storage_record_size(as_storage_rd *rd)
 
 		// TODO: could factor out sizeof(drv_ssd_bin) and multiply by i, but
 		// for now let's favor the low bin-count case and leave it this way.
-		write_size += sizeof(drv_ssd_bin) + as_bin_particle_flat_size(bin);
+		write_size += sizeof(drv_ssd_bin) +
+				(rd->client_ops && rd->client_ops[i] ?
+						as_particle_client_ref_flat_size(rd->client_ops[i]) :
+						as_bin_particle_flat_size(bin));
 	}
 
 	return write_size;
@@ -1720,7 +2015,12 @@ ssd_write_bins(as_storage_rd *rd)
 
 		ssd_bin->offset = buf - buf_start;
 
-		uint32_t particle_flat_size = as_bin_particle_to_flat(bin, buf);
+		// Copy-free replace writes flatten straight from the client message.
+		uint32_t particle_flat_size =
+				rd->client_ops && rd->client_ops[n_bins_written] ?
+						as_particle_client_ref_to_flat(
+								rd->client_ops[n_bins_written], buf) :
+						as_bin_particle_to_flat(bin, buf);
 
 		buf += particle_flat_size;
 		ssd_bin->len = particle_flat_size;
@@ -1779,8 +2079,9 @@ ssd_write(as_storage_rd *rd)
 
 	// Figure out which device to write to. When replacing an old record, it's
 	// possible this is different from the old device (e.g. if we've added a
-	// fresh device), so derive it from the digest each time.
-	rd->ssd = &ssds->ssds[ssd_get_file_id(ssds, &r->keyd)];
+	// fresh device, for load placement, or the set moved device group), so
+	// pick it each time.
+	rd->ssd = ssd_pick_device(ssds, r);
 
 	drv_ssd *ssd = rd->ssd;
 
@@ -2154,14 +2455,32 @@ ssd_log_stats(drv_ssd *ssd, uint64_t *p_prev_n_total_writes,
 				cf_queue_sz(ssd->swb_shadow_q));
 	}
 
-	cf_info(AS_DRV_SSD, "{%s} %s: used-bytes %lu free-wblocks %d write-q %d write (%lu,%.1f) defrag-q %d defrag-read (%lu,%.1f) defrag-write (%lu,%.1f)%s%s",
-			ssd->ns->name, ssd->name,
+	char placement_str[64];
+
+	*placement_str = 0;
+
+	if (ssd->ns->storage_placement_policy == AS_STORAGE_PLACEMENT_LOAD) {
+		sprintf(placement_str, " write-latency-us %lu",
+				cf_atomic64_get(ssd->write_latency_us));
+	}
+
+	char group_str[64];
+
+	*group_str = 0;
+
+	if (ssd->device_group != 0) {
+		snprintf(group_str, sizeof(group_str), " device-group %s",
+				ssd->ns->storage_device_group_names[ssd->device_group]);
+	}
+
+	cf_info(AS_DRV_SSD, "{%s} %s%s: used-bytes %lu free-wblocks %d write-q %d write (%lu,%.1f) defrag-q %d defrag-read (%lu,%.1f) defrag-write (%lu,%.1f)%s%s%s",
+			ssd->ns->name, ssd->name, group_str,
 			ssd->inuse_size, cf_queue_sz(ssd->free_wblock_q),
 			cf_queue_sz(ssd->swb_write_q),
 			n_total_writes, total_write_rate,
 			cf_queue_sz(ssd->defrag_wblock_q), n_defrag_reads, defrag_read_rate,
 			n_defrag_writes, defrag_write_rate,
-			shadow_str, tomb_raider_str);
+			shadow_str, tomb_raider_str, placement_str);
 
 	*p_prev_n_total_writes = n_total_writes;
 	*p_prev_n_defrag_reads = n_defrag_reads;
@@ -2675,16 +2994,9 @@ prefer_existing_record(drv_ssd* ssd, uint32_t wblock_id, drv_ssd_block* block,
 
 
 bool
-is_set_evictable(as_namespace* ns, const as_rec_props* p_props)
+is_set_evictable(as_namespace* ns, const char* set_name)
 {
-	if (p_props->size == 0) {
-		return true;
-	}
-
-	const char* set_name;
-
-	if (as_rec_props_get_value(p_props, CL_REC_PROPS_FIELD_SET_NAME, NULL,
-			(uint8_t**)&set_name) != 0) {
+	if (! set_name) {
 		return true;
 	}
 
@@ -2708,9 +3020,20 @@ is_record_expired(as_namespace* ns, const drv_ssd_block* block,
 		return false;
 	}
 
+	if (block->void_time < as_record_void_time_get()) {
+		return true;
+	}
+
 	// If set is not evictable, may have expired but wasn't evicted.
-	return block->void_time < as_record_void_time_get() ||
-			is_set_evictable(ns, p_props);
+	const char* set_name = NULL;
+
+	if (p_props->size != 0 &&
+			as_rec_props_get_value(p_props, CL_REC_PROPS_FIELD_SET_NAME, NULL,
+					(uint8_t**)&set_name) != 0) {
+		set_name = NULL;
+	}
+
+	return is_set_evictable(ns, set_name);
 }
 
 
@@ -2887,13 +3210,18 @@ ssd_cold_start_add_record(drv_ssds* ssds, drv_ssd* ssd, drv_ssd_block* block,
 
 		SINDEX_BINS_SETUP(sbins, 2 * ns->sindex_cnt);
 		as_sindex* si_arr[2 * ns->sindex_cnt];
+		as_sindex_composite_keys ckeys[ns->n_composite_sindexes];
 		int si_arr_index = 0;
+		int n_ckeys = 0;
 		const char* set_name = as_index_get_set_name(r, ns);
 
 		if (has_sindex) {
 			for (uint16_t i = 0; i < old_n_bins; i++) {
 				si_arr_index += as_sindex_arr_lookup_by_set_binid_lockfree(ns, set_name, rd.bins[i].id, &si_arr[si_arr_index]);
 			}
+
+			n_ckeys = as_sindex_composite_lookup_lockfree(ns, set_name, ckeys);
+			as_sindex_composite_keys_from_bins(ckeys, n_ckeys, rd.bins, old_n_bins, false);
 		}
 
 		int32_t delta_bins = (int32_t)block->n_bins - (int32_t)old_n_bins;
@@ -2941,6 +3269,8 @@ ssd_cold_start_add_record(drv_ssds* ssds, drv_ssd* ssd, drv_ssd_block* block,
 		}
 
 		if (has_sindex) {
+			as_sindex_composite_keys_from_bins(ckeys, n_ckeys, rd.bins, rd.n_bins, true);
+
 			SINDEX_GRUNLOCK();
 
 			if (sbins_populated > 0) {
@@ -2948,7 +3278,10 @@ ssd_cold_start_add_record(drv_ssds* ssds, drv_ssd* ssd, drv_ssd_block* block,
 				as_sindex_sbin_freeall(sbins, sbins_populated);
 			}
 
+			as_sindex_composite_update(ckeys, n_ckeys, &r->keyd);
+
 			as_sindex_release_arr(si_arr, si_arr_index);
+			as_sindex_composite_release(ckeys, n_ckeys);
 		}
 
 		as_storage_record_adjust_mem_stats(&rd, bytes_memory);
@@ -3102,6 +3435,51 @@ ssd_cold_start_sweep(drv_ssds *ssds, drv_ssd *ssd)
 }
 
 
+// Called once the whole index is loaded - by device sweeps or from snapshot.
+// A NULL complete_q means the snapshot load already signaled completion.
+void
+ssd_cold_start_finish(drv_ssds *ssds, cf_queue *complete_q,
+		void *complete_udata)
+{
+	as_namespace* ns = ssds->ns;
+
+	ssd_cold_start_drop_cenotaphs(ns);
+
+	// Snapshot load set up queues and writing before adding entries.
+	if (! ssds->loading_index_snapshot) {
+		ssd_load_wblock_queues(ssds);
+
+		ssd_start_maintenance_threads(ssds);
+		ssd_start_write_worker_threads(ssds);
+	}
+
+	// A device sweep completes all partitions at once - only now may they
+	// take writes.
+	for (uint32_t pid = 0; pid < AS_PARTITIONS; pid++) {
+		if (ns->partitions[pid].loading) {
+			as_partition_loaded(ns, pid);
+			cf_atomic32_incr(&ns->cold_start_partitions_loaded);
+		}
+	}
+
+	ns->loading_records = false;
+
+	pthread_mutex_destroy(&ns->cold_start_evict_lock);
+
+	if (complete_q) {
+		cf_queue_push(complete_q, &complete_udata);
+	}
+
+	as_truncate_list_cenotaphs(ns);
+	as_truncate_done_startup(ns); // set truncate last-update-times in sets' vmap
+
+	ssds->loading_index_snapshot = false;
+
+	// Defrag relocates records by index lookup - only once all are loaded.
+	ssd_start_defrag_threads(ssds);
+}
+
+
 // Thread "run" function to read a storage device and rebuild the index.
 void *
 run_ssd_cold_start(void *udata)
@@ -3130,22 +3508,8 @@ run_ssd_cold_start(void *udata)
 
 	if (cf_rc_release(complete_rc) == 0) {
 		// All drives are done reading.
-
-		ns->loading_records = false;
-		ssd_cold_start_drop_cenotaphs(ns);
-		ssd_load_wblock_queues(ssds);
-
-		pthread_mutex_destroy(&ns->cold_start_evict_lock);
-
-		cf_queue_push(complete_q, &complete_udata);
 		cf_rc_free(complete_rc);
-
-		as_truncate_list_cenotaphs(ns);
-		as_truncate_done_startup(ns); // set truncate last-update-times in sets' vmap
-
-		ssd_start_maintenance_threads(ssds);
-		ssd_start_write_worker_threads(ssds);
-		ssd_start_defrag_threads(ssds);
+		ssd_cold_start_finish(ssds, complete_q, complete_udata);
 	}
 
 	return NULL;
@@ -3188,884 +3552,2460 @@ start_loading_records(drv_ssds *ssds, cf_queue *complete_q, void *udata)
 
 
 //==========================================================
-// Generic startup utilities.
+// Index snapshot utilities.
+//
+// At clean shutdown of a data-not-in-memory namespace, the primary index is
+// written to storage-engine index-snapshot-file, grouped by partition. The
+// next cold start loads the index from this file instead of sweeping every
+// device - only index entries are read, and each partition is complete as soon
+// as its entries are added. The file is only used if it was written by the
+// run that last stamped the device headers, and is removed when loaded.
 //
 
-static int
-first_used_device(ssd_device_header *headers[], int n_ssds)
+static bool
+index_snapshot_is_supported(drv_ssds *ssds)
 {
-	for (int i = 0; i < n_ssds; i++) {
-		if (headers[i]->random != 0) {
-			return i;
+	as_namespace *ns = ssds->ns;
+
+	if (ns->storage_data_in_memory || ns->n_tombstones != 0) {
+		return false;
+	}
+
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		drv_ssd *ssd = &ssds->ssds[i];
+
+		// Shadow devices are synced by the device sweep.
+		if (ssd->shadow_name || strlen(ssd->name) >= INDEX_SNAPSHOT_NAME_SZ) {
+			return false;
 		}
 	}
 
-	return -1;
+	return true;
 }
 
 
-static bool
-stored_version_has_data(drv_ssds *ssds, uint32_t pid)
+static void
+index_snapshot_write_reduce_cb(as_index_ref *r_ref, void *udata)
 {
-	info_buf *b = (info_buf*)
-			(ssds->header->info_data + (SSD_HEADER_INFO_STRIDE * pid));
+	index_snapshot_write *sw = (index_snapshot_write*)udata;
+	as_index *r = r_ref->r;
+
+	if (sw->ok && STORAGE_RBLOCK_IS_VALID(r->rblock_id)) {
+		drv_ssd *ssd = &sw->ssds->ssds[r->file_id];
+		uint32_t wblock_id = RBLOCK_ID_TO_WBLOCK_ID(ssd, r->rblock_id);
+
+		sw->wblock_inuse[r->file_id][wblock_id] +=
+				(uint32_t)RBLOCKS_TO_BYTES(r->n_rblocks);
+
+		index_snapshot_entry e = {
+				.keyd = r->keyd,
+				.last_update_time = r->last_update_time,
+				.void_time = r->void_time,
+				.generation = r->generation,
+				.set_id = as_index_get_set_id(r),
+				.rblock_id = r->rblock_id,
+				.n_rblocks = r->n_rblocks,
+				.file_id = r->file_id,
+				.key_stored = r->key_stored
+		};
+
+		if (fwrite(&e, sizeof(e), 1, sw->fp) == 1) {
+			sw->n_entries++;
+		}
+		else {
+			sw->ok = false;
+		}
+	}
 
-	return ! as_partition_version_is_null(&b->version);
+	as_record_done(r_ref, sw->ssds->ns);
 }
 
 
-bool
-ssd_load_records(drv_ssds *ssds, cf_queue *complete_q, void *udata)
+static bool
+index_snapshot_write_usage(drv_ssds *ssds, FILE *fp, uint32_t **wblock_inuse)
 {
-	uint64_t random = cf_get_rand64();
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		uint32_t n_wblocks = ssds->ssds[i].alloc_table->n_wblocks;
 
-	int n_ssds = ssds->n_ssds;
+		if (fwrite(&n_wblocks, sizeof(n_wblocks), 1, fp) != 1 ||
+				fwrite(wblock_inuse[i], sizeof(uint32_t), n_wblocks, fp) !=
+						n_wblocks) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// Caller holds all record locks and has flushed all writes to devices.
+static bool
+index_snapshot_write_file(drv_ssds *ssds, FILE *fp, uint64_t *p_n_entries)
+{
 	as_namespace *ns = ssds->ns;
+	uint32_t n_sets = cf_vmapx_count(ns->p_sets_vmap);
 
-	ssd_device_header *headers[n_ssds];
+	index_snapshot_header header = {
+			.magic = INDEX_SNAPSHOT_MAGIC,
+			.version = INDEX_SNAPSHOT_VERSION,
+			.random = ssds->header->random,
+			.write_block_size = ns->storage_write_block_size,
+			.n_ssds = (uint32_t)ssds->n_ssds,
+			.n_sets = n_sets
+	};
 
-	// Check all the headers. Pick one as the representative.
-	for (int i = 0; i < n_ssds; i++) {
-		drv_ssd *ssd = &ssds->ssds[i];
-		int rvh = ssd_read_header(ssd, ns, &headers[i]);
+	memset(header.ns_name, 0, sizeof(header.ns_name));
+	strncpy(header.ns_name, ns->name, sizeof(header.ns_name) - 1);
 
-		if (rvh == -1) {
-			cf_crash(AS_DRV_SSD, "unable to read disk header %s", ssd->name);
-		}
+	if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+		return false;
+	}
 
-		if (rvh == -2) {
-			headers[i] = ssd_init_header(ns);
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		char name[INDEX_SNAPSHOT_NAME_SZ] = { 0 };
+
+		strcpy(name, ssds->ssds[i].name);
+
+		if (fwrite(name, sizeof(name), 1, fp) != 1) {
+			return false;
 		}
 	}
 
-	int first_used = first_used_device(headers, n_ssds);
+	for (uint32_t i = 0; i < n_sets; i++) {
+		char name[AS_SET_NAME_MAX_SIZE] = { 0 };
+		as_set *p_set;
 
-	if (first_used == -1) {
-		// Shouldn't find all fresh headers here during warm or cool restart.
-		if (! ns->cold_start) {
-			// There's no going back to cold start now - do so the harsh way.
-			cf_crash(AS_DRV_SSD, "{%s}: found all %d devices fresh during %s restart",
-					ns->name, n_ssds, as_namespace_start_mode_str(ns));
+		if (cf_vmapx_get_by_index(ns->p_sets_vmap, i, (void**)&p_set) !=
+				CF_VMAPX_OK) {
+			return false;
 		}
 
-		cf_info(AS_DRV_SSD, "namespace %s: found all %d devices fresh, initializing to random %lu",
-				ns->name, n_ssds, random);
-
-		ssds->header = headers[0];
+		strncpy(name, p_set->name, sizeof(name) - 1);
 
-		for (int i = 1; i < n_ssds; i++) {
-			cf_free(headers[i]);
+		if (fwrite(name, sizeof(name), 1, fp) != 1) {
+			return false;
 		}
+	}
 
-		ssds->header->random = random;
-		ssds->header->devices_n = n_ssds;
-		as_storage_info_flush_ssd(ns);
-
-		as_truncate_list_cenotaphs(ns); // all will show as cenotaph
-		as_truncate_done_startup(ns);
+	// Counts and wblock usage are written again below, once known - a loading
+	// node can then allocate wblocks before all entries are added.
+	uint32_t n_entries[AS_PARTITIONS] = { 0 };
+	uint32_t *wblock_inuse[ssds->n_ssds];
 
-		return true;
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		wblock_inuse[i] = cf_calloc(ssds->ssds[i].alloc_table->n_wblocks,
+				sizeof(uint32_t));
 	}
 
-	// At least one device is not fresh. Check that all non-fresh devices match.
+	bool ok = false;
+	long counts_offset = ftell(fp);
 
-	for (int i = 0; i < n_ssds; i++) {
-		drv_ssd *ssd = &ssds->ssds[i];
+	if (counts_offset < 0 ||
+			fwrite(n_entries, sizeof(n_entries), 1, fp) != 1 ||
+			! index_snapshot_write_usage(ssds, fp, wblock_inuse)) {
+		goto END;
+	}
 
-		// Skip fresh devices.
-		if (headers[i]->random == 0) {
-			ssd->started_fresh = true; // warm or cool restart needs to know
-			continue;
-		}
+	for (uint32_t pid = 0; pid < AS_PARTITIONS; pid++) {
+		index_snapshot_write sw = {
+				.ssds = ssds,
+				.fp = fp,
+				.wblock_inuse = wblock_inuse,
+				.n_entries = 0,
+				.ok = true
+		};
 
-		if (headers[first_used]->random != headers[i]->random) {
-			cf_crash(AS_DRV_SSD, "namespace %s: drive set with unmatched headers - devices %s & %s have different signatures",
-					ns->name, ssds->ssds[first_used].name, ssd->name);
-		}
+		as_index_reduce_skip_lock(ns->partitions[pid].vp,
+				index_snapshot_write_reduce_cb, &sw);
 
-		if (headers[first_used]->devices_n != headers[i]->devices_n) {
-			cf_crash(AS_DRV_SSD, "namespace %s: drive set with unmatched headers - devices %s & %s have different device counts",
-					ns->name, ssds->ssds[first_used].name, ssd->name);
+		if (! sw.ok) {
+			goto END;
 		}
 
-		if (headers[first_used]->last_evict_void_time !=
-				headers[i]->last_evict_void_time) {
-			cf_warning(AS_DRV_SSD, "namespace %s: devices have inconsistent evict-void-times - ignoring",
-					ns->name);
-			headers[first_used]->last_evict_void_time = 0;
-		}
+		n_entries[pid] = sw.n_entries;
+		*p_n_entries += sw.n_entries;
 	}
 
-	// Drive set OK - fix up header set.
-	ssds->header = headers[first_used];
-	headers[first_used] = 0;
+	uint32_t magic = INDEX_SNAPSHOT_MAGIC;
 
-	for (int i = 0; i < n_ssds; i++) {
-		if (headers[i]) {
-			cf_free(headers[i]);
-			headers[i] = 0;
-		}
-	}
+	ok = fwrite(&magic, sizeof(magic), 1, fp) == 1 &&
+			fseek(fp, counts_offset, SEEK_SET) == 0 &&
+			fwrite(n_entries, sizeof(n_entries), 1, fp) == 1 &&
+			index_snapshot_write_usage(ssds, fp, wblock_inuse);
 
-	ssds->header->random = random;
-	ssds->header->devices_n = n_ssds; // may have added fresh drives
-	as_storage_info_flush_ssd(ns);
+END:
 
-	// Cache booleans indicating whether partitions are owned or not.
-	for (uint32_t pid = 0; pid < AS_PARTITIONS; pid++) {
-		ssds->get_state_from_storage[pid] =
-				stored_version_has_data(ssds, pid);
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		cf_free(wblock_inuse[i]);
 	}
 
-	// Warm or cool restart.
-	if (! ns->cold_start) {
-		as_truncate_done_startup(ns); // set truncate last-update-times in sets' vmap
-		ssd_resume_devices(ssds);
+	return ok;
+}
 
-		if (as_namespace_cool_restarts(ns)) {
-			// Cool restart - fire off threads to load record data - will signal
-			// completion when threads are all done.
-			start_loading_records(ssds, complete_q, udata);
 
-			// Make sure caller doesn't signal completion.
-			return false;
-		}
+static void
+ssd_index_snapshot_save(drv_ssds *ssds)
+{
+	as_namespace *ns = ssds->ns;
 
-		return true; // warm restart (done)
+	if (ns->loading_records || ! index_snapshot_is_supported(ssds)) {
+		cf_warning(AS_DRV_SSD, "{%s} can't write index snapshot", ns->name);
+		return;
 	}
 
-	// Initialize the cold start eviction machinery.
+	char tmp_path[PATH_MAX];
 
-	if (0 != pthread_mutex_init(&ns->cold_start_evict_lock, NULL)) {
-		cf_crash(AS_DRV_SSD, "failed cold start eviction mutex init");
+	if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp",
+			ns->storage_index_snapshot_file) >= (int)sizeof(tmp_path)) {
+		cf_warning(AS_DRV_SSD, "{%s} index snapshot path too long", ns->name);
+		return;
 	}
 
-	uint32_t now = as_record_void_time_get();
-
-	if (ns->cold_start_evict_ttl == 0xFFFFffff) {
-		// Config file did NOT specify cold-start-evict-ttl.
-		ns->cold_start_threshold_void_time = ssds->header->last_evict_void_time;
+	FILE *fp = fopen(tmp_path, "w");
 
-		// Check that it's not already in the past. (Note - includes 0.)
-		if (ns->cold_start_threshold_void_time < now) {
-			ns->cold_start_threshold_void_time = now;
-		}
-		else {
-			cf_info(AS_DRV_SSD, "namespace %s: using saved cold start evict-ttl %u",
-					ns->name, ns->cold_start_threshold_void_time - now);
-		}
+	if (! fp) {
+		cf_warning(AS_DRV_SSD, "{%s} failed to open index snapshot %s: %s",
+				ns->name, tmp_path, cf_strerror(errno));
+		return;
 	}
-	else {
-		// Config file specified cold-start-evict-ttl. (0 is a valid value.)
-		ns->cold_start_threshold_void_time = now + ns->cold_start_evict_ttl;
 
-		cf_info(AS_DRV_SSD, "namespace %s: using config-specified cold start evict-ttl %u",
-				ns->name, ns->cold_start_evict_ttl);
-	}
+	uint64_t start_ms = cf_getms();
+	uint64_t n_entries = 0;
 
-	ns->cold_start_max_void_time = now + (uint32_t)ns->max_ttl;
+	bool ok = index_snapshot_write_file(ssds, fp, &n_entries);
 
-	// Fire off threads to load record data - will signal completion when
-	// threads are all done.
-	start_loading_records(ssds, complete_q, udata);
+	ok = ok && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+	ok = fclose(fp) == 0 && ok;
 
-	// Make sure caller doesn't signal completion.
-	return false;
+	if (! ok || rename(tmp_path, ns->storage_index_snapshot_file) != 0) {
+		cf_warning(AS_DRV_SSD, "{%s} failed to write index snapshot %s",
+				ns->name, ns->storage_index_snapshot_file);
+		unlink(tmp_path);
+		return;
+	}
+
+	cf_info(AS_DRV_SSD, "{%s} wrote index snapshot - %lu entries in %lu ms",
+			ns->name, n_entries, cf_getms() - start_ms);
 }
 
 
-// Set a device's system block scheduler mode.
-static int
-ssd_set_scheduler_mode(const char* device_name, const char* mode)
+static bool
+index_snapshot_read_header(drv_ssds *ssds, uint64_t prev_random,
+		index_snapshot_load_info *info)
 {
-	if (strncmp(device_name, "/dev/", 5)) {
-		cf_warning(AS_DRV_SSD, "storage: invalid device name %s, did not set scheduler mode",
-				device_name);
-		return -1;
+	as_namespace *ns = ssds->ns;
+	FILE *fp = info->fp;
+	index_snapshot_header header;
+
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+			header.magic != INDEX_SNAPSHOT_MAGIC ||
+			header.version != INDEX_SNAPSHOT_VERSION ||
+			strncmp(header.ns_name, ns->name, sizeof(header.ns_name)) != 0) {
+		cf_warning(AS_DRV_SSD, "{%s} index snapshot has bad header", ns->name);
+		return false;
 	}
 
-	char device_tag[(strlen(device_name) - 5) + 1];
+	// Devices may have been written since the snapshot - or not by this
+	// namespace's last run.
+	if (header.random != prev_random) {
+		cf_warning(AS_DRV_SSD, "{%s} index snapshot is stale", ns->name);
+		return false;
+	}
 
-	strcpy(device_tag, device_name + 5);
+	if (header.write_block_size != ns->storage_write_block_size ||
+			header.n_ssds != (uint32_t)ssds->n_ssds ||
+			header.n_sets > AS_SET_MAX_COUNT) {
+		cf_warning(AS_DRV_SSD, "{%s} index snapshot storage config does not match",
+				ns->name);
+		return false;
+	}
 
-	// Replace any slashes in the device tag with '!' - this is the naming
-	// convention in /sys/block.
-	char* p_char = device_tag;
+	// Device order must match - entries refer to devices by position.
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		drv_ssd *ssd = &ssds->ssds[i];
+		char name[INDEX_SNAPSHOT_NAME_SZ];
 
-	while (*p_char) {
-		if (*p_char == '/') {
-			*p_char = '!';
+		if (fread(name, sizeof(name), 1, fp) != 1 ||
+				strncmp(name, ssd->name, sizeof(name)) != 0 ||
+				ssd->started_fresh) {
+			cf_warning(AS_DRV_SSD, "{%s} index snapshot device %d does not match %s",
+					ns->name, i, ssd->name);
+			return false;
 		}
-
-		p_char++;
 	}
 
-	char scheduler_file_name[17 + strlen(device_tag) + 3 + 16 + 1];
+	info->n_sets = header.n_sets;
+	info->set_names = cf_malloc(header.n_sets * AS_SET_NAME_MAX_SIZE);
 
-	strcpy(scheduler_file_name, "/sys/class/block/");
-	strcat(scheduler_file_name, device_tag);
+	if (fread(info->set_names, AS_SET_NAME_MAX_SIZE, header.n_sets, fp) !=
+			header.n_sets ||
+			fread(info->n_entries, sizeof(info->n_entries), 1, fp) != 1) {
+		cf_warning(AS_DRV_SSD, "{%s} index snapshot truncated", ns->name);
+		return false;
+	}
 
-	// Determine if this device is a partition.
-	char partition_file_name[strlen(scheduler_file_name) + 10 + 1];
+	for (uint32_t i = 0; i < header.n_sets; i++) {
+		info->set_names[i][AS_SET_NAME_MAX_SIZE - 1] = 0;
+	}
 
-	strcpy(partition_file_name, scheduler_file_name);
-	strcat(partition_file_name, "/partition");
+	long usage_offset = ftell(fp);
+	uint64_t usage_sz = 0;
 
-	FILE* partition_file = fopen(partition_file_name, "r");
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		drv_ssd *ssd = &ssds->ssds[i];
+		uint32_t n_wblocks;
 
-	if (partition_file) {
-		fclose(partition_file);
+		if (fread(&n_wblocks, sizeof(n_wblocks), 1, fp) != 1 ||
+				n_wblocks != ssd->alloc_table->n_wblocks ||
+				fseek(fp, (long)n_wblocks * sizeof(uint32_t), SEEK_CUR) != 0) {
+			cf_warning(AS_DRV_SSD, "{%s} index snapshot device %d size does not match %s",
+					ns->name, i, ssd->name);
+			return false;
+		}
 
-		// This device is a partition, get parent device.
-		strcat(scheduler_file_name, "/..");
+		usage_sz += sizeof(n_wblocks) + ((uint64_t)n_wblocks * sizeof(uint32_t));
 	}
 
-	strcat(scheduler_file_name, "/queue/scheduler");
+	// Check the file is complete before changing any tree.
 
-	FILE* scheduler_file = fopen(scheduler_file_name, "w");
+	uint64_t expected_sz = sizeof(header) +
+			((uint64_t)ssds->n_ssds * INDEX_SNAPSHOT_NAME_SZ) +
+			((uint64_t)header.n_sets * AS_SET_NAME_MAX_SIZE) +
+			sizeof(info->n_entries) + usage_sz + sizeof(uint32_t);
 
-	if (! scheduler_file) {
-		cf_warning(AS_DRV_SSD, "storage: couldn't open %s, did not set scheduler mode: %s",
-				scheduler_file_name, cf_strerror(errno));
-		return -1;
+	for (uint32_t pid = 0; pid < AS_PARTITIONS; pid++) {
+		expected_sz += (uint64_t)info->n_entries[pid] *
+				sizeof(index_snapshot_entry);
 	}
 
-	if (fwrite(mode, strlen(mode), 1, scheduler_file) != 1) {
-		fclose(scheduler_file);
+	struct stat st;
+	uint32_t magic = 0;
 
-		cf_warning(AS_DRV_SSD, "storage: couldn't write %s to %s, did not set scheduler mode",
-				mode, scheduler_file_name);
-		return -1;
+	if (fstat(fileno(fp), &st) != 0 || (uint64_t)st.st_size != expected_sz ||
+			fseek(fp, -(long)sizeof(magic), SEEK_END) != 0 ||
+			fread(&magic, sizeof(magic), 1, fp) != 1 ||
+			magic != INDEX_SNAPSHOT_MAGIC ||
+			fseek(fp, usage_offset, SEEK_SET) != 0) {
+		cf_warning(AS_DRV_SSD, "{%s} index snapshot incomplete", ns->name);
+		return false;
 	}
 
-	fclose(scheduler_file);
-
-	cf_info(AS_DRV_SSD, "storage: set device %s scheduler mode to %s",
-			device_name, mode);
-
-	return 0;
-}
-
+	// Take wblock usage for all entries now - entries which are not kept are
+	// freed as they're added.
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		drv_ssd *ssd = &ssds->ssds[i];
+		ssd_alloc_table *at = ssd->alloc_table;
+		uint32_t n_wblocks;
 
-static uint64_t
-check_file_size(as_namespace *ns, uint64_t file_size, const char *tag)
-{
-	cf_assert(sizeof(off_t) > 4, AS_DRV_SSD, "this OS supports only 32-bit (4g) files - compile with 64 bit offsets");
+		// Size was checked - devices' usage is now partially set.
+		if (fread(&n_wblocks, sizeof(n_wblocks), 1, fp) != 1) {
+			cf_crash(AS_DRV_SSD, "{%s} failed reading index snapshot: %s",
+					ns->name, cf_strerror(errno));
+		}
 
-	if (file_size > SSD_HEADER_SIZE) {
-		off_t unusable_size =
-				(file_size - SSD_HEADER_SIZE) % ns->storage_write_block_size;
+		for (uint32_t wblock_id = 0; wblock_id < n_wblocks; wblock_id++) {
+			uint32_t inuse_sz;
 
-		if (unusable_size != 0) {
-			cf_info(AS_DRV_SSD, "%s size must be header size %u + multiple of %u, rounding down",
-					tag, SSD_HEADER_SIZE, ns->storage_write_block_size);
-			file_size -= unusable_size;
-		}
+			if (fread(&inuse_sz, sizeof(inuse_sz), 1, fp) != 1) {
+				cf_crash(AS_DRV_SSD, "{%s} failed reading index snapshot: %s",
+						ns->name, cf_strerror(errno));
+			}
 
-		if (file_size > AS_STORAGE_MAX_DEVICE_SIZE) {
-			cf_warning(AS_DRV_SSD, "%s size must be <= %ld, trimming original size %ld",
-					tag, AS_STORAGE_MAX_DEVICE_SIZE, file_size);
-			file_size = AS_STORAGE_MAX_DEVICE_SIZE;
+			at->wblock_state[wblock_id].inuse_sz = inuse_sz;
+			ssd->inuse_size += inuse_sz;
 		}
 	}
 
-	if (file_size <= SSD_HEADER_SIZE) {
-		cf_crash(AS_DRV_SSD, "%s size %ld must be greater than header size %d",
-				tag, file_size, SSD_HEADER_SIZE);
-	}
-
-	return file_size;
+	return true;
 }
 
 
-static uint64_t
-find_io_min_size(int fd, const char *ssd_name)
+static void
+index_snapshot_add_entry(drv_ssds *ssds, const index_snapshot_load_info *info,
+		uint32_t pid, const index_snapshot_entry *e)
 {
-	off_t off = lseek(fd, 0, SEEK_SET);
+	as_namespace *ns = ssds->ns;
 
-	if (off != 0) {
-		cf_crash(AS_DRV_SSD, "%s: seek error %s", ssd_name, cf_strerror(errno));
+	if (e->file_id >= ssds->n_ssds || STORAGE_RBLOCK_IS_INVALID(e->rblock_id) ||
+			e->n_rblocks == 0) {
+		cf_warning_digest(AS_DRV_SSD, &e->keyd, "invalid index snapshot entry - ignoring ");
+		return;
 	}
 
-	uint8_t *buf = cf_valloc(HI_IO_MIN_SIZE);
-	size_t read_sz = LO_IO_MIN_SIZE;
+	drv_ssd *ssd = &ssds->ssds[e->file_id];
 
-	while (read_sz <= HI_IO_MIN_SIZE) {
-		if (read(fd, (void*)buf, read_sz) == (ssize_t)read_sz) {
-			cf_free(buf);
-			return read_sz;
-		}
+	// The entry's space was taken with the snapshot's wblock usage - give it
+	// back unless the entry is kept.
 
-		read_sz <<= 1; // LO_IO_MIN_SIZE and HI_IO_MIN_SIZE are powers of 2
+	if (as_partition_getid(&e->keyd) != pid || e->set_id > info->n_sets) {
+		cf_warning_digest(AS_DRV_SSD, &e->keyd, "invalid index snapshot entry - ignoring ");
+		ssd_block_free(ssd, e->rblock_id, e->n_rblocks, "snapshot-load");
+		return;
 	}
 
-	cf_crash(AS_DRV_SSD, "%s: read failed at all sizes from %u to %u bytes",
-			ssd_name, LO_IO_MIN_SIZE, HI_IO_MIN_SIZE);
-
-	return 0;
-}
+	if (! ssds->get_state_from_storage[pid]) {
+		ssd_block_free(ssd, e->rblock_id, e->n_rblocks, "snapshot-load");
+		return;
+	}
 
+	// As for the device sweep - evict if necessary, may block for a long time.
+	// Once rejoined, client writes may also reach stop-writes - keep loading.
+	if (! as_cold_start_evict_if_needed(ns) && ! info->rejoined) {
+		cf_crash(AS_DRV_SSD, "hit stop-writes limit before index snapshot load completed");
+	}
 
-int
-ssd_init_devices(as_namespace *ns, drv_ssds **ssds_p)
-{
-	int n_ssds;
+	const char *set_name = e->set_id == 0 ?
+			NULL : info->set_names[e->set_id - 1];
 
-	for (n_ssds = 0; n_ssds < AS_STORAGE_MAX_DEVICES; n_ssds++) {
-		if (! ns->storage_devices[n_ssds]) {
-			break;
-		}
+	// Skip records that have expired.
+	if (e->void_time != 0 &&
+			e->void_time <= ns->cold_start_threshold_void_time &&
+			(e->void_time < as_record_void_time_get() ||
+					is_set_evictable(ns, set_name))) {
+		ssd_block_free(ssd, e->rblock_id, e->n_rblocks, "snapshot-load");
+		ssd->record_add_expired_counter++;
+		return;
 	}
 
-	size_t ssds_size = sizeof(drv_ssds) + (n_ssds * sizeof(drv_ssd));
-	drv_ssds *ssds = cf_malloc(ssds_size);
-
-	memset(ssds, 0, ssds_size);
-	ssds->n_ssds = n_ssds;
-	ssds->ns = ns;
+	as_partition_reservation rsv;
 
-	// Raw device-specific initialization of drv_ssd structures.
-	for (int i = 0; i < n_ssds; i++) {
-		drv_ssd *ssd = &ssds->ssds[i];
+	as_partition_reserve(ns, pid, &rsv);
 
-		ssd->name = ns->storage_devices[i];
+	as_index_ref r_ref;
 
-		ssd->open_flag = O_RDWR |
-				(ns->storage_disable_odirect ? 0 : O_DIRECT) |
-				(ns->storage_enable_osync ? O_SYNC : 0);
+	r_ref.skip_lock = false;
 
-		int fd = open(ssd->name, ssd->open_flag, S_IRUSR | S_IWUSR);
+	int rv = as_record_get_create(rsv.tree, &e->keyd, &r_ref, ns);
 
-		if (-1 == fd) {
-			cf_warning(AS_DRV_SSD, "unable to open device %s: %s", ssd->name,
-					cf_strerror(errno));
-			return -1;
-		}
+	if (rv < 0) {
+		cf_warning_digest(AS_DRV_SSD, &e->keyd, "record-add as_record_get_create() failed ");
+		ssd_block_free(ssd, e->rblock_id, e->n_rblocks, "snapshot-load");
+		as_partition_release(&rsv);
+		return;
+	}
 
-		uint64_t size = 0;
+	// Snapshot has one entry per digest.
+	if (rv != 1) {
+		cf_warning_digest(AS_DRV_SSD, &e->keyd, "duplicate index snapshot entry - ignoring ");
+		ssd_block_free(ssd, e->rblock_id, e->n_rblocks, "snapshot-load");
+		as_record_done(&r_ref, ns);
+		as_partition_release(&rsv);
+		return;
+	}
 
-		ioctl(fd, BLKGETSIZE64, &size); // gets the number of bytes
+	as_index *r = r_ref.r;
 
-		ssd->file_size = check_file_size(ns, size, "usable device");
-		ssd->io_min_size = find_io_min_size(fd, ssd->name);
+	r->last_update_time = e->last_update_time;
+	r->generation = e->generation;
 
-		if (ns->cold_start && ns->storage_cold_start_empty) {
-			if (! ssd_empty_header(fd, ssd->name)) {
-				close(fd);
+	// Set the record's void-time, truncating it if beyond max-ttl.
+	if (e->void_time > ns->cold_start_max_void_time) {
+		r->void_time = ns->cold_start_max_void_time;
+		ssd->record_add_max_ttl_counter++;
+	}
+	else {
+		r->void_time = e->void_time;
+	}
+
+	cf_atomic64_setmax(&rsv.p->max_void_time, r->void_time);
+
+	if (set_name) {
+		as_index_set_set(r, ns, set_name, false);
+	}
+
+	// Once rejoined, a truncate may have run before this entry was added.
+	if (info->rejoined && as_truncate_record_is_truncated(r, ns)) {
+		as_index_delete(rsv.tree, &e->keyd);
+		ssd_block_free(ssd, e->rblock_id, e->n_rblocks, "snapshot-load");
+		as_record_done(&r_ref, ns);
+		as_partition_release(&rsv);
+		return;
+	}
+
+	r->key_stored = e->key_stored;
+
+	r->file_id = e->file_id;
+	r->rblock_id = e->rblock_id;
+	r->n_rblocks = e->n_rblocks;
+
+	ssd->record_add_unique_counter++;
+
+	as_record_done(&r_ref, ns);
+	as_partition_release(&rsv);
+}
+
+
+static void
+index_snapshot_info_free(index_snapshot_load_info *info)
+{
+	fclose(info->fp);
+
+	if (info->set_names) {
+		cf_free(info->set_names);
+	}
+
+	cf_free(info);
+}
+
+
+// Thread "run" function to load the index from snapshot, partition by
+// partition.
+void *
+run_ssd_index_snapshot_load(void *udata)
+{
+	index_snapshot_load_info *info = (index_snapshot_load_info*)udata;
+	drv_ssds *ssds = info->ssds;
+	as_namespace *ns = ssds->ns;
+
+	CF_ALLOC_SET_NS_ARENA(ns);
+
+	index_snapshot_entry *entries =
+			cf_malloc(INDEX_SNAPSHOT_READ_ENTRIES * sizeof(index_snapshot_entry));
+
+	for (uint32_t pid = 0; pid < AS_PARTITIONS; pid++) {
+		uint32_t n_entries = info->n_entries[pid];
+
+		// Entries of partitions no longer owned are read to free their space.
+		while (n_entries != 0) {
+			uint32_t n_read = n_entries < INDEX_SNAPSHOT_READ_ENTRIES ?
+					n_entries : INDEX_SNAPSHOT_READ_ENTRIES;
+
+			// Size was checked - the index is now partially loaded.
+			if (fread(entries, sizeof(index_snapshot_entry), n_read, info->fp) !=
+					n_read) {
+				cf_crash(AS_DRV_SSD, "{%s} failed reading index snapshot: %s",
+						ns->name, cf_strerror(errno));
+			}
+
+			for (uint32_t i = 0; i < n_read; i++) {
+				index_snapshot_add_entry(ssds, info, pid, &entries[i]);
+			}
+
+			n_entries -= n_read;
+		}
+
+		// Others were counted as loaded before the load started.
+		if (ssds->get_state_from_storage[pid]) {
+			as_partition_loaded(ns, pid);
+			cf_atomic32_incr(&ns->cold_start_partitions_loaded);
+		}
+	}
+
+	cf_free(entries);
+
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		drv_ssd *ssd = &ssds->ssds[i];
+
+		cf_info(AS_DRV_SSD, "device %s: snapshot load complete: UNIQUE %lu (EXPIRED %lu) (MAX-TTL %lu) records",
+				ssd->name, ssd->record_add_unique_counter,
+				ssd->record_add_expired_counter,
+				ssd->record_add_max_ttl_counter);
+	}
+
+	ns->index_snapshot_loaded = true;
+	ns->index_snapshot_load_ms = cf_getms() - info->start_ms;
+
+	cf_info(AS_DRV_SSD, "{%s} loaded index snapshot in %lu ms", ns->name,
+			ns->index_snapshot_load_ms);
+
+	cf_queue *complete_q = info->complete_q;
+	void *complete_udata = info->complete_udata;
+
+	index_snapshot_info_free(info);
+
+	ssd_cold_start_finish(ssds, complete_q, complete_udata);
+
+	return NULL;
+}
+
+
+// Returns false if there's no usable snapshot - caller should sweep devices.
+bool
+start_loading_index_snapshot(drv_ssds *ssds, uint64_t prev_random,
+		cf_queue *complete_q, void *udata)
+{
+	as_namespace *ns = ssds->ns;
+
+	if (! ns->storage_index_snapshot_file) {
+		return false;
+	}
+
+	FILE *fp = fopen(ns->storage_index_snapshot_file, "r");
+
+	if (! fp) {
+		if (errno != ENOENT) {
+			cf_warning(AS_DRV_SSD, "{%s} failed to open index snapshot %s: %s",
+					ns->name, ns->storage_index_snapshot_file,
+					cf_strerror(errno));
+		}
+		else {
+			cf_info(AS_DRV_SSD, "{%s} no index snapshot - will read devices",
+					ns->name);
+		}
+
+		return false;
+	}
+
+	// Once this node takes writes the snapshot is stale - never use it twice.
+	unlink(ns->storage_index_snapshot_file);
+
+	index_snapshot_load_info *info =
+			cf_malloc(sizeof(index_snapshot_load_info));
+
+	info->ssds = ssds;
+	info->fp = fp;
+	info->n_sets = 0;
+	info->set_names = NULL;
+	info->rejoined = false;
+	info->complete_q = complete_q;
+	info->complete_udata = udata;
+	info->start_ms = cf_getms();
+
+	if (! index_snapshot_is_supported(ssds) ||
+			! index_snapshot_read_header(ssds, prev_random, info)) {
+		cf_warning(AS_DRV_SSD, "{%s} ignoring index snapshot - will read devices",
+				ns->name);
+		index_snapshot_info_free(info);
+		return false;
+	}
+
+	cf_info(AS_DRV_SSD, "{%s} loading index from snapshot %s", ns->name,
+			ns->storage_index_snapshot_file);
+
+	ns->loading_records = true;
+	ssds->loading_index_snapshot = true;
+
+	// Wblock usage is known from the snapshot - loaded partitions may take
+	// writes before the rest are added.
+	ssd_load_wblock_queues(ssds);
+
+	ssd_start_maintenance_threads(ssds);
+	ssd_start_write_worker_threads(ssds);
+
+	if (ns->cold_start_early_rejoin) {
+		// Building sindexes needs every record - a partial index is no use.
+		if (ns->sindex_cnt != 0) {
+			cf_info(AS_DRV_SSD, "{%s} has secondary indexes - will rejoin when index is loaded",
+					ns->name);
+		}
+		else {
+			cf_info(AS_DRV_SSD, "{%s} rejoining cluster while loading index",
+					ns->name);
+
+			info->rejoined = true;
+			info->complete_q = NULL;
+
+			cf_queue_push(complete_q, &udata);
+		}
+	}
+
+	pthread_t thread;
+	pthread_attr_t attrs;
+
+	pthread_attr_init(&attrs);
+	pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_DETACHED);
+
+	pthread_create(&thread, &attrs, run_ssd_index_snapshot_load, info);
+
+	return true;
+}
+
+
+//==========================================================
+// Generic startup utilities.
+//
+
+static int
+first_used_device(ssd_device_header *headers[], int n_ssds)
+{
+	for (int i = 0; i < n_ssds; i++) {
+		if (headers[i]->random != 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+static bool
+stored_version_has_data(drv_ssds *ssds, uint32_t pid)
+{
+	info_buf *b = (info_buf*)
+			(ssds->header->info_data + (SSD_HEADER_INFO_STRIDE * pid));
+
+	return ! as_partition_version_is_null(&b->version);
+}
+
+
+bool
+ssd_load_records(drv_ssds *ssds, cf_queue *complete_q, void *udata)
+{
+	uint64_t random = cf_get_rand64();
+
+	int n_ssds = ssds->n_ssds;
+	as_namespace *ns = ssds->ns;
+
+	ssd_device_header *headers[n_ssds];
+
+	// Check all the headers. Pick one as the representative.
+	for (int i = 0; i < n_ssds; i++) {
+		drv_ssd *ssd = &ssds->ssds[i];
+		int rvh = ssd_read_header(ssd, ns, &headers[i]);
+
+		if (rvh == -1) {
+			cf_crash(AS_DRV_SSD, "unable to read disk header %s", ssd->name);
+		}
+
+		if (rvh == -2) {
+			headers[i] = ssd_init_header(ns);
+		}
+	}
+
+	int first_used = first_used_device(headers, n_ssds);
+
+	if (first_used == -1) {
+		// Shouldn't find all fresh headers here during warm or cool restart.
+		if (! ns->cold_start) {
+			// There's no going back to cold start now - do so the harsh way.
+			cf_crash(AS_DRV_SSD, "{%s}: found all %d devices fresh during %s restart",
+					ns->name, n_ssds, as_namespace_start_mode_str(ns));
+		}
+
+		cf_info(AS_DRV_SSD, "namespace %s: found all %d devices fresh, initializing to random %lu",
+				ns->name, n_ssds, random);
+
+		ssds->header = headers[0];
+
+		for (int i = 1; i < n_ssds; i++) {
+			cf_free(headers[i]);
+		}
+
+		ssds->header->random = random;
+		ssds->header->devices_n = n_ssds;
+		as_storage_info_flush_ssd(ns);
+
+		as_truncate_list_cenotaphs(ns); // all will show as cenotaph
+		as_truncate_done_startup(ns);
+
+		return true;
+	}
+
+	// At least one device is not fresh. Check that all non-fresh devices match.
+
+	for (int i = 0; i < n_ssds; i++) {
+		drv_ssd *ssd = &ssds->ssds[i];
+
+		// Skip fresh devices.
+		if (headers[i]->random == 0) {
+			ssd->started_fresh = true; // warm or cool restart needs to know
+			continue;
+		}
+
+		if (headers[first_used]->random != headers[i]->random) {
+			cf_crash(AS_DRV_SSD, "namespace %s: drive set with unmatched headers - devices %s & %s have different signatures",
+					ns->name, ssds->ssds[first_used].name, ssd->name);
+		}
+
+		if (headers[first_used]->devices_n != headers[i]->devices_n) {
+			cf_crash(AS_DRV_SSD, "namespace %s: drive set with unmatched headers - devices %s & %s have different device counts",
+					ns->name, ssds->ssds[first_used].name, ssd->name);
+		}
+
+		if (headers[first_used]->last_evict_void_time !=
+				headers[i]->last_evict_void_time) {
+			cf_warning(AS_DRV_SSD, "namespace %s: devices have inconsistent evict-void-times - ignoring",
+					ns->name);
+			headers[first_used]->last_evict_void_time = 0;
+		}
+	}
+
+	// Records on a device dropped from the config (e.g. one added at runtime
+	// but never configured) would be lost - refuse to start.
+	if (headers[first_used]->devices_n > n_ssds) {
+		cf_crash_nostack(AS_DRV_SSD, "namespace %s: devices were last used as a set of %u but only %d configured - add missing devices to the end of the list",
+				ns->name, headers[first_used]->devices_n, n_ssds);
+	}
+
+	// Drive set OK - fix up header set.
+	ssds->header = headers[first_used];
+	headers[first_used] = 0;
+
+	for (int i = 0; i < n_ssds; i++) {
+		if (headers[i]) {
+			cf_free(headers[i]);
+			headers[i] = 0;
+		}
+	}
+
+	uint64_t prev_random = ssds->header->random;
+
+	// Files the previous run wrote (e.g. sindex snapshot) describe the devices'
+	// contents only if none was wiped or replaced since.
+	ssds->prev_random = prev_random;
+
+	for (int i = 0; i < n_ssds; i++) {
+		if (ssds->ssds[i].started_fresh) {
+			ssds->prev_random = 0;
+			break;
+		}
+	}
+
+	ssds->header->random = random;
+	ssds->header->devices_n = n_ssds; // may have added fresh drives
+	as_storage_info_flush_ssd(ns);
+
+	// Cache booleans indicating whether partitions are owned or not.
+	for (uint32_t pid = 0; pid < AS_PARTITIONS; pid++) {
+		ssds->get_state_from_storage[pid] =
+				stored_version_has_data(ssds, pid);
+	}
+
+	if (ns->cold_start) {
+		// Partitions not owned have nothing to load.
+		for (uint32_t pid = 0; pid < AS_PARTITIONS; pid++) {
+			if (ssds->get_state_from_storage[pid]) {
+				ns->partitions[pid].loading = true;
+			}
+			else {
+				ns->cold_start_partitions_loaded++;
+			}
+		}
+	}
+
+	// Warm or cool restart.
+	if (! ns->cold_start) {
+		as_truncate_done_startup(ns); // set truncate last-update-times in sets' vmap
+		ssd_resume_devices(ssds);
+
+		if (as_namespace_cool_restarts(ns)) {
+			// Cool restart - fire off threads to load record data - will signal
+			// completion when threads are all done.
+			start_loading_records(ssds, complete_q, udata);
+
+			// Make sure caller doesn't signal completion.
+			return false;
+		}
+
+		return true; // warm restart (done)
+	}
+
+	// Initialize the cold start eviction machinery.
+
+	if (0 != pthread_mutex_init(&ns->cold_start_evict_lock, NULL)) {
+		cf_crash(AS_DRV_SSD, "failed cold start eviction mutex init");
+	}
+
+	uint32_t now = as_record_void_time_get();
+
+	if (ns->cold_start_evict_ttl == 0xFFFFffff) {
+		// Config file did NOT specify cold-start-evict-ttl.
+		ns->cold_start_threshold_void_time = ssds->header->last_evict_void_time;
+
+		// Check that it's not already in the past. (Note - includes 0.)
+		if (ns->cold_start_threshold_void_time < now) {
+			ns->cold_start_threshold_void_time = now;
+		}
+		else {
+			cf_info(AS_DRV_SSD, "namespace %s: using saved cold start evict-ttl %u",
+					ns->name, ns->cold_start_threshold_void_time - now);
+		}
+	}
+	else {
+		// Config file specified cold-start-evict-ttl. (0 is a valid value.)
+		ns->cold_start_threshold_void_time = now + ns->cold_start_evict_ttl;
+
+		cf_info(AS_DRV_SSD, "namespace %s: using config-specified cold start evict-ttl %u",
+				ns->name, ns->cold_start_evict_ttl);
+	}
+
+	ns->cold_start_max_void_time = now + (uint32_t)ns->max_ttl;
+
+	// Fire off thread(s) to load index from snapshot if possible, otherwise
+	// record data - will signal completion when threads are all done.
+	if (! start_loading_index_snapshot(ssds, prev_random, complete_q, udata)) {
+		start_loading_records(ssds, complete_q, udata);
+	}
+
+	// Make sure caller doesn't signal completion.
+	return false;
+}
+
+
+// Set a device's system block scheduler mode.
+static int
+ssd_set_scheduler_mode(const char* device_name, const char* mode)
+{
+	if (strncmp(device_name, "/dev/", 5)) {
+		cf_warning(AS_DRV_SSD, "storage: invalid device name %s, did not set scheduler mode",
+				device_name);
+		return -1;
+	}
+
+	char device_tag[(strlen(device_name) - 5) + 1];
+
+	strcpy(device_tag, device_name + 5);
+
+	// Replace any slashes in the device tag with '!' - this is the naming
+	// convention in /sys/block.
+	char* p_char = device_tag;
+
+	while (*p_char) {
+		if (*p_char == '/') {
+			*p_char = '!';
+		}
+
+		p_char++;
+	}
+
+	char scheduler_file_name[17 + strlen(device_tag) + 3 + 16 + 1];
+
+	strcpy(scheduler_file_name, "/sys/class/block/");
+	strcat(scheduler_file_name, device_tag);
+
+	// Determine if this device is a partition.
+	char partition_file_name[strlen(scheduler_file_name) + 10 + 1];
+
+	strcpy(partition_file_name, scheduler_file_name);
+	strcat(partition_file_name, "/partition");
+
+	FILE* partition_file = fopen(partition_file_name, "r");
+
+	if (partition_file) {
+		fclose(partition_file);
+
+		// This device is a partition, get parent device.
+		strcat(scheduler_file_name, "/..");
+	}
+
+	strcat(scheduler_file_name, "/queue/scheduler");
+
+	FILE* scheduler_file = fopen(scheduler_file_name, "w");
+
+	if (! scheduler_file) {
+		cf_warning(AS_DRV_SSD, "storage: couldn't open %s, did not set scheduler mode: %s",
+				scheduler_file_name, cf_strerror(errno));
+		return -1;
+	}
+
+	if (fwrite(mode, strlen(mode), 1, scheduler_file) != 1) {
+		fclose(scheduler_file);
+
+		cf_warning(AS_DRV_SSD, "storage: couldn't write %s to %s, did not set scheduler mode",
+				mode, scheduler_file_name);
+		return -1;
+	}
+
+	fclose(scheduler_file);
+
+	cf_info(AS_DRV_SSD, "storage: set device %s scheduler mode to %s",
+			device_name, mode);
+
+	return 0;
+}
+
+
+static uint64_t
+check_file_size(as_namespace *ns, uint64_t file_size, const char *tag)
+{
+	cf_assert(sizeof(off_t) > 4, AS_DRV_SSD, "this OS supports only 32-bit (4g) files - compile with 64 bit offsets");
+
+	if (file_size > SSD_HEADER_SIZE) {
+		off_t unusable_size =
+				(file_size - SSD_HEADER_SIZE) % ns->storage_write_block_size;
+
+		if (unusable_size != 0) {
+			cf_info(AS_DRV_SSD, "%s size must be header size %u + multiple of %u, rounding down",
+					tag, SSD_HEADER_SIZE, ns->storage_write_block_size);
+			file_size -= unusable_size;
+		}
+
+		if (file_size > AS_STORAGE_MAX_DEVICE_SIZE) {
+			cf_warning(AS_DRV_SSD, "%s size must be <= %ld, trimming original size %ld",
+					tag, AS_STORAGE_MAX_DEVICE_SIZE, file_size);
+			file_size = AS_STORAGE_MAX_DEVICE_SIZE;
+		}
+	}
+
+	if (file_size <= SSD_HEADER_SIZE) {
+		cf_crash(AS_DRV_SSD, "%s size %ld must be greater than header size %d",
+				tag, file_size, SSD_HEADER_SIZE);
+	}
+
+	return file_size;
+}
+
+
+static uint64_t
+find_io_min_size(int fd, const char *ssd_name)
+{
+	off_t off = lseek(fd, 0, SEEK_SET);
+
+	if (off != 0) {
+		cf_crash(AS_DRV_SSD, "%s: seek error %s", ssd_name, cf_strerror(errno));
+	}
+
+	uint8_t *buf = cf_valloc(HI_IO_MIN_SIZE);
+	size_t read_sz = LO_IO_MIN_SIZE;
+
+	while (read_sz <= HI_IO_MIN_SIZE) {
+		if (read(fd, (void*)buf, read_sz) == (ssize_t)read_sz) {
+			cf_free(buf);
+			return read_sz;
+		}
+
+		read_sz <<= 1; // LO_IO_MIN_SIZE and HI_IO_MIN_SIZE are powers of 2
+	}
+
+	cf_crash(AS_DRV_SSD, "%s: read failed at all sizes from %u to %u bytes",
+			ssd_name, LO_IO_MIN_SIZE, HI_IO_MIN_SIZE);
+
+	return 0;
+}
+
+
+int
+ssd_init_devices(as_namespace *ns, drv_ssds **ssds_p)
+{
+	int n_ssds;
+
+	for (n_ssds = 0; n_ssds < AS_STORAGE_MAX_DEVICES; n_ssds++) {
+		if (! ns->storage_devices[n_ssds]) {
+			break;
+		}
+	}
+
+	// Leave room for devices added at runtime.
+	size_t ssds_size = sizeof(drv_ssds) +
+			(AS_STORAGE_MAX_DEVICES * sizeof(drv_ssd));
+	drv_ssds *ssds = cf_malloc(ssds_size);
+
+	memset(ssds, 0, ssds_size);
+	ssds->n_ssds = n_ssds;
+	ssds->ns = ns;
+
+	// Raw device-specific initialization of drv_ssd structures.
+	for (int i = 0; i < n_ssds; i++) {
+		drv_ssd *ssd = &ssds->ssds[i];
+
+		ssd->name = ns->storage_devices[i];
+
+		ssd->open_flag = O_RDWR |
+				(ns->storage_disable_odirect ? 0 : O_DIRECT) |
+				(ns->storage_enable_osync ? O_SYNC : 0);
+
+		int fd = open(ssd->name, ssd->open_flag, S_IRUSR | S_IWUSR);
+
+		if (-1 == fd) {
+			cf_warning(AS_DRV_SSD, "unable to open device %s: %s", ssd->name,
+					cf_strerror(errno));
+			return -1;
+		}
+
+		uint64_t size = 0;
+
+		ioctl(fd, BLKGETSIZE64, &size); // gets the number of bytes
+
+		ssd->file_size = check_file_size(ns, size, "usable device");
+		ssd->io_min_size = find_io_min_size(fd, ssd->name);
+
+		if (ns->cold_start && ns->storage_cold_start_empty) {
+			if (! ssd_empty_header(fd, ssd->name)) {
+				close(fd);
+				return -1;
+			}
+
+			cf_info(AS_DRV_SSD, "cold-start-empty - erased header of %s",
+					ssd->name);
+		}
+
+		close(fd);
+
+		ns->ssd_size += ssd->file_size; // increment total storage size
+
+		cf_info(AS_DRV_SSD, "opened device %s: usable size %lu, io-min-size %lu",
+				ssd->name, ssd->file_size, ssd->io_min_size);
+
+		if (ns->storage_scheduler_mode) {
+			// Set scheduler mode specified in config file.
+			ssd_set_scheduler_mode(ssd->name, ns->storage_scheduler_mode);
+		}
+	}
+
+	*ssds_p = ssds;
+
+	return 0;
+}
+
+
+int
+ssd_init_shadows(as_namespace *ns, drv_ssds *ssds)
+{
+	int n_shadows = 0;
+
+	for (int n = 0; n < ssds->n_ssds; n++) {
+		if (ns->storage_shadows[n]) {
+			n_shadows++;
+		}
+	}
+
+	if (n_shadows == 0) {
+		// No shadows - a normal deployment.
+		return 0;
+	}
+
+	if (n_shadows != ssds->n_ssds) {
+		cf_warning(AS_DRV_SSD, "configured %d devices but only %d shadows",
+				ssds->n_ssds, n_shadows);
+		return -1;
+	}
+
+	// Check shadow devices.
+	for (int i = 0; i < n_shadows; i++) {
+		drv_ssd *ssd = &ssds->ssds[i];
+
+		ssd->shadow_name = ns->storage_shadows[i];
+
+		int fd = open(ssd->shadow_name, ssd->open_flag, S_IRUSR | S_IWUSR);
+
+		if (-1 == fd) {
+			cf_warning(AS_DRV_SSD, "unable to open shadow device %s: %s",
+					ssd->shadow_name, cf_strerror(errno));
+			return -1;
+		}
+
+		uint64_t size = 0;
+
+		ioctl(fd, BLKGETSIZE64, &size); // gets the number of bytes
+
+		if (size < ssd->file_size) {
+			cf_warning(AS_DRV_SSD, "shadow device %s is smaller than main device - %lu < %lu",
+					ssd->shadow_name, size, ssd->file_size);
+			close(fd);
+			return -1;
+		}
+
+		if (ns->cold_start && ns->storage_cold_start_empty) {
+			if (! ssd_empty_header(fd, ssd->shadow_name)) {
+				close(fd);
+				return -1;
+			}
+
+			cf_info(AS_DRV_SSD, "cold-start-empty - erased header of %s",
+					ssd->shadow_name);
+		}
+
+		close(fd);
+
+		cf_info(AS_DRV_SSD, "shadow device %s is compatible with main device",
+				ssd->shadow_name);
+
+		if (ns->storage_scheduler_mode) {
+			// Set scheduler mode specified in config file.
+			ssd_set_scheduler_mode(ssd->shadow_name,
+					ns->storage_scheduler_mode);
+		}
+	}
+
+	return 0;
+}
+
+
+int
+ssd_init_files(as_namespace *ns, drv_ssds **ssds_p)
+{
+	int n_ssds;
+
+	for (n_ssds = 0; n_ssds < AS_STORAGE_MAX_FILES; n_ssds++) {
+		if (! ns->storage_files[n_ssds]) {
+			break;
+		}
+	}
+
+	// Leave room for files added at runtime.
+	size_t ssds_size = sizeof(drv_ssds) +
+			(AS_STORAGE_MAX_FILES * sizeof(drv_ssd));
+	drv_ssds *ssds = cf_malloc(ssds_size);
+
+	memset(ssds, 0, ssds_size);
+	ssds->n_ssds = n_ssds;
+	ssds->ns = ns;
+
+	// File-specific initialization of drv_ssd structures.
+	for (int i = 0; i < n_ssds; i++) {
+		drv_ssd *ssd = &ssds->ssds[i];
+
+		ssd->name = ns->storage_files[i];
+
+		if (ns->cold_start && ns->storage_cold_start_empty) {
+			if (0 == remove(ssd->name)) {
+				cf_info(AS_DRV_SSD, "cold-start-empty - removed %s", ssd->name);
+			}
+			else if (errno == ENOENT) {
+				cf_info(AS_DRV_SSD, "cold-start-empty - no file %s", ssd->name);
+			}
+			else {
+				cf_warning(AS_DRV_SSD, "failed remove: errno %d", errno);
 				return -1;
 			}
+		}
+
+		ssd->open_flag = O_RDWR;
+
+		// Validate that file can be opened, create it if it doesn't exist.
+		int fd = open(ssd->name, ssd->open_flag | O_CREAT, S_IRUSR | S_IWUSR);
+
+		if (-1 == fd) {
+			cf_warning(AS_DRV_SSD, "unable to open file %s: %s", ssd->name,
+					cf_strerror(errno));
+			return -1;
+		}
+
+		ssd->file_size = check_file_size(ns, ns->storage_filesize, "file");
+		ssd->io_min_size = LO_IO_MIN_SIZE;
+
+		// Truncate will grow or shrink the file to the correct size.
+		if (0 != ftruncate(fd, (off_t)ssd->file_size)) {
+			cf_warning(AS_DRV_SSD, "unable to truncate file: errno %d", errno);
+			close(fd);
+			return -1;
+		}
+
+		close(fd);
+
+		ns->ssd_size += ssd->file_size; // increment total storage size
+
+		cf_info(AS_DRV_SSD, "opened file %s: usable size %lu", ssd->name,
+				ssd->file_size);
+	}
+
+	*ssds_p = ssds;
+
+	return 0;
+}
+
+
+// Initialize non-zero-value members of a drv_ssd whose name, size, etc. are
+// already set up.
+static void
+ssd_init_device(as_namespace *ns, drv_ssd *ssd, int file_id)
+{
+	char histname[HISTOGRAM_NAME_SIZE];
+
+	ssd->ns = ns;
+	ssd->file_id = file_id;
+	ssd->device_group = ns->storage_device_groups[file_id];
+
+	pthread_mutex_init(&ssd->write_lock, 0);
+	pthread_mutex_init(&ssd->defrag_lock, 0);
+
+	ssd->running = true;
+
+	ssd->data_in_memory = ns->storage_data_in_memory;
+	ssd->write_block_size = ns->storage_write_block_size;
+
+	ssd_wblock_init(ssd);
+
+	// Note: free_wblock_q, defrag_wblock_q created after loading devices.
+
+	ssd->fd_q = cf_queue_create(sizeof(int), true);
+
+	if (ssd->shadow_name) {
+		ssd->shadow_fd_q = cf_queue_create(sizeof(int), true);
+	}
+
+	ssd->swb_write_q = cf_queue_create(sizeof(void*), true);
+
+	if (ssd->shadow_name) {
+		ssd->swb_shadow_q = cf_queue_create(sizeof(void*), true);
+	}
+
+	ssd->swb_free_q = cf_queue_create(sizeof(void*), true);
+
+	if (! ns->storage_data_in_memory) {
+		ssd->post_write_q = cf_queue_create(sizeof(void*), false);
+	}
+
+	snprintf(histname, sizeof(histname), "{%s}-%s-read", ns->name, ssd->name);
+	ssd->hist_read = histogram_create(histname, HIST_MILLISECONDS);
+
+	snprintf(histname, sizeof(histname), "{%s}-%s-large-block-read", ns->name, ssd->name);
+	ssd->hist_large_block_read = histogram_create(histname, HIST_MILLISECONDS);
+
+	snprintf(histname, sizeof(histname), "{%s}-%s-write", ns->name, ssd->name);
+	ssd->hist_write = histogram_create(histname, HIST_MILLISECONDS);
+
+	if (ssd->shadow_name) {
+		snprintf(histname, sizeof(histname), "{%s}-%s-shadow-write", ns->name, ssd->name);
+		ssd->hist_shadow_write = histogram_create(histname, HIST_MILLISECONDS);
+	}
+
+	snprintf(histname, sizeof(histname), "{%s}-%s-fsync", ns->name, ssd->name);
+	ssd->hist_fsync = histogram_create(histname, HIST_MILLISECONDS);
+}
+
+
+// Make a device available to writers of its device group's sets.
+static void
+ssd_add_to_device_group(drv_ssds *ssds, drv_ssd *ssd)
+{
+	ssd_device_group *group = &ssds->groups[ssd->device_group];
+
+	group->file_ids[group->n_ssds] = (uint8_t)ssd->file_id;
+
+	// Make sure the file-id is set before writers can pick it.
+	__atomic_store_n(&group->n_ssds, group->n_ssds + 1, __ATOMIC_RELEASE);
+}
+
+
+//==========================================================
+// Storage API implementation: startup, shutdown, etc.
+//
+
+int
+as_storage_namespace_init_ssd(as_namespace *ns, cf_queue *complete_q,
+		void *udata)
+{
+	drv_ssds *ssds;
+
+	if (ns->storage_devices[0]) {
+		if (0 != ssd_init_devices(ns, &ssds)) {
+			cf_warning(AS_DRV_SSD, "{%s} can't initialize devices", ns->name);
+			return -1;
+		}
+
+		if (0 != ssd_init_shadows(ns, ssds)) {
+			cf_warning(AS_DRV_SSD, "{%s} can't initialize shadows", ns->name);
+			return -1;
+		}
+	}
+	else if (ns->storage_files[0]) {
+		if (0 != ssd_init_files(ns, &ssds)) {
+			cf_warning(AS_DRV_SSD, "{%s} can't initialize files", ns->name);
+			return -1;
+		}
+	}
+	else {
+		cf_warning(AS_DRV_SSD, "{%s} has no devices or files", ns->name);
+		return -1;
+	}
+
+	// Allow defrag to go full speed during startup - restore the configured
+	// settings when startup is done.
+	ns->saved_defrag_sleep = ns->storage_defrag_sleep;
+	ns->storage_defrag_sleep = 0;
+
+	// The queue limit is more efficient to work with.
+	ns->storage_max_write_q = (int)
+			(ns->storage_max_write_cache / ns->storage_write_block_size);
+
+	// Minimize how often we recalculate this.
+	ns->defrag_lwm_size =
+			(ns->storage_write_block_size * ns->storage_defrag_lwm_pct) / 100;
+
+	ns->storage_private = (void*)ssds;
+
+	// Coalescing is for device reads - not needed if data is in memory.
+	if (ns->storage_coalesce_reads && ! ns->storage_data_in_memory) {
+		ssds->read_flights = cf_malloc(SSD_READ_FLIGHT_N_STRIPES *
+				sizeof(ssd_read_flight_stripe));
+
+		memset(ssds->read_flights, 0,
+				SSD_READ_FLIGHT_N_STRIPES * sizeof(ssd_read_flight_stripe));
+
+		ssds->read_active = cf_malloc(SSD_READ_ACTIVE_N_SLOTS *
+				sizeof(uint32_t));
+
+		memset(ssds->read_active, 0,
+				SSD_READ_ACTIVE_N_SLOTS * sizeof(uint32_t));
+	}
+
+	char histname[HISTOGRAM_NAME_SIZE];
+
+	snprintf(histname, sizeof(histname), "{%s}-device-read-size", ns->name);
+	ns->device_read_size_hist = histogram_create(histname, HIST_SIZE);
+
+	snprintf(histname, sizeof(histname), "{%s}-device-write-size", ns->name);
+	ns->device_write_size_hist = histogram_create(histname, HIST_SIZE);
+
+	// Finish initializing drv_ssd structures (non-zero-value members).
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		ssd_init_device(ns, &ssds->ssds[i], i);
+		ssd_add_to_device_group(ssds, &ssds->ssds[i]);
+	}
+
+	ssds->has_device_groups = ns->storage_device_group_names[1] != NULL;
+
+	// Attempt to load the data.
+	//
+	// Return value 'false' means it's going to take a long time and will later
+	// asynchronously signal completion via the complete_q, 'true' means it's
+	// finished, signal here.
+
+	if (ssd_load_records(ssds, complete_q, udata)) {
+		ssd_load_wblock_queues(ssds);
+
+		cf_queue_push(complete_q, &udata);
+
+		ssd_start_maintenance_threads(ssds);
+		ssd_start_write_worker_threads(ssds);
+		ssd_start_defrag_threads(ssds);
+	}
+
+	return 0;
+}
+
+
+void
+as_storage_loading_records_ticker_ssd()
+{
+	for (uint32_t i = 0; i < g_config.n_namespaces; i++) {
+		as_namespace *ns = g_config.namespaces[i];
+
+		if (ns->loading_records) {
+			char buf[2048];
+			int pos = 0;
+			drv_ssds *ssds = (drv_ssds*)ns->storage_private;
+
+			if (ssds->loading_index_snapshot) {
+				sprintf(buf, ", snapshot %u/%u partitions",
+						ns->cold_start_partitions_loaded, AS_PARTITIONS);
+			}
+			else {
+				for (int j = 0; j < ssds->n_ssds; j++) {
+					drv_ssd *ssd = &ssds->ssds[j];
+					uint32_t pct = (uint32_t)((ssd->sweep_wblock_id * 100UL) /
+							(ssd->file_size / ssd->write_block_size));
+
+					pos += sprintf(buf + pos, ", %s %u%%", ssd->name, pct);
+				}
+			}
+
+			// TODO - conform with new log standard?
+			if (ns->n_tombstones == 0) {
+				cf_info(AS_DRV_SSD, "{%s} loaded %lu objects%s", ns->name,
+						ns->n_objects, buf);
+			}
+			else {
+				cf_info(AS_DRV_SSD, "{%s} loaded %lu objects, %lu tombstones%s",
+						ns->name, ns->n_objects, ns->n_tombstones, buf);
+			}
+		}
+	}
+}
+
+
+int
+as_storage_namespace_destroy_ssd(as_namespace *ns)
+{
+	// This is not called - for now we don't bother unwinding.
+	return 0;
+}
+
+
+// Note that this is *NOT* the counterpart to as_storage_record_create_ssd()!
+// That would be as_storage_record_close_ssd(). This is what gets called when a
+// record is destroyed, to dereference storage.
+int
+as_storage_record_destroy_ssd(as_namespace *ns, as_record *r)
+{
+	if (STORAGE_RBLOCK_IS_VALID(r->rblock_id) && r->n_rblocks != 0) {
+		drv_ssds *ssds = (drv_ssds*)ns->storage_private;
+		drv_ssd *ssd = &ssds->ssds[r->file_id];
+
+		ssd_block_free(ssd, r->rblock_id, r->n_rblocks, "destroy");
+
+		r->rblock_id = 0;
+		r->n_rblocks = 0;
+	}
+
+	return 0;
+}
+
+
+//==========================================================
+// Storage API implementation: as_storage_rd cycle.
+//
+
+int
+as_storage_record_create_ssd(as_storage_rd *rd)
+{
+	rd->block = NULL;
+	rd->must_free_block = NULL;
+	rd->ssd = NULL;
+
+	cf_assert(rd->r->rblock_id == 0, AS_DRV_SSD, "unexpected - uninitialized rblock-id");
+
+	return 0;
+}
+
+
+int
+as_storage_record_open_ssd(as_storage_rd *rd)
+{
+	drv_ssds *ssds = (drv_ssds*)rd->ns->storage_private;
+
+	rd->block = NULL;
+	rd->must_free_block = NULL;
+	rd->ssd = &ssds->ssds[rd->r->file_id];
+
+	return 0;
+}
+
+
+int
+as_storage_record_close_ssd(as_storage_rd *rd)
+{
+	if (rd->must_free_block) {
+		cf_free(rd->must_free_block);
+		rd->must_free_block = NULL;
+	}
+
+	rd->block = NULL; // may have pointed into a shared read buffer
+
+	return 0;
+}
+
+
+// Returns true if we joined a flight - a lone reader doesn't create one.
+bool
+as_storage_read_join_ssd(as_namespace *ns, const cf_digest *keyd)
+{
+	drv_ssds *ssds = (drv_ssds*)ns->storage_private;
+
+	if (! ssds->read_flights) {
+		return false;
+	}
+
+	// A reader that finds its slot idle won't share, but may still publish
+	// its device read for readers that join after it.
+	if (__atomic_add_fetch(ssd_read_active_get(ssds, keyd), 1,
+			__ATOMIC_ACQ_REL) == 1) {
+		return false;
+	}
+
+	ssd_read_flight_stripe *stripe = ssd_read_flight_stripe_get(ssds, keyd);
+
+	cf_mutex_lock(&stripe->lock);
+
+	ssd_read_flight **p_flight = ssd_read_flight_find(stripe, keyd);
+	ssd_read_flight *flight = *p_flight;
+
+	if (! flight) {
+		flight = cf_malloc(sizeof(ssd_read_flight));
+
+		memset(flight, 0, sizeof(ssd_read_flight));
+		flight->keyd = *keyd;
+		*p_flight = flight;
+	}
+
+	flight->n_readers++;
+
+	cf_mutex_unlock(&stripe->lock);
+
+	return true;
+}
+
+
+void
+as_storage_read_leave_ssd(as_namespace *ns, const cf_digest *keyd,
+		bool in_flight)
+{
+	drv_ssds *ssds = (drv_ssds*)ns->storage_private;
+
+	if (! ssds->read_flights) {
+		return;
+	}
+
+	uint32_t *p_active = ssd_read_active_get(ssds, keyd);
+
+	if (! in_flight) {
+		__atomic_sub_fetch(p_active, 1, __ATOMIC_ACQ_REL);
+		return;
+	}
+
+	ssd_read_flight_stripe *stripe = ssd_read_flight_stripe_get(ssds, keyd);
+
+	cf_mutex_lock(&stripe->lock);
+
+	ssd_read_flight **p_flight = ssd_read_flight_find(stripe, keyd);
+	ssd_read_flight *flight = *p_flight;
+
+	cf_assert(flight, AS_DRV_SSD, "leaving read flight that wasn't joined");
+
+	if (--flight->n_readers != 0) {
+		cf_mutex_unlock(&stripe->lock);
+		__atomic_sub_fetch(p_active, 1, __ATOMIC_ACQ_REL);
+		return;
+	}
+
+	*p_flight = flight->next;
+
+	cf_mutex_unlock(&stripe->lock);
+	__atomic_sub_fetch(p_active, 1, __ATOMIC_ACQ_REL);
+
+	if (flight->buf) {
+		cf_free(flight->buf);
+	}
+
+	cf_free(flight);
+}
+
+
+// These are near the top of this file:
+//		as_storage_record_get_n_bins_ssd()
+//		as_storage_record_read_ssd()
+//		as_storage_particle_read_all_ssd()
+//		as_storage_particle_read_and_size_all_ssd()
+
+
+bool
+as_storage_record_size_and_check_ssd(as_storage_rd *rd)
+{
+	return rd->ns->storage_write_block_size >= as_storage_record_size(rd);
+}
+
+
+//==========================================================
+// Storage API implementation: storage capacity monitoring.
+//
+
+void
+as_storage_wait_for_defrag_ssd(as_namespace *ns)
+{
+	if (ns->storage_defrag_startup_minimum > 0) {
+		while (true) {
+			int avail_pct;
+
+			if (0 != as_storage_stats_ssd(ns, &avail_pct, 0)) {
+				cf_crash(AS_DRV_SSD, "namespace %s storage stats failed",
+						ns->name);
+			}
 
-			cf_info(AS_DRV_SSD, "cold-start-empty - erased header of %s",
-					ssd->name);
+			if (avail_pct >= ns->storage_defrag_startup_minimum) {
+				break;
+			}
+
+			cf_info(AS_DRV_SSD, "namespace %s waiting for defrag: %d pct available, waiting for %d ...",
+					ns->name, avail_pct, ns->storage_defrag_startup_minimum);
+
+			sleep(2);
 		}
+	}
 
-		close(fd);
+	// Restore configured defrag throttling values.
+	ns->storage_defrag_sleep = ns->saved_defrag_sleep;
+}
 
-		ns->ssd_size += ssd->file_size; // increment total storage size
 
-		cf_info(AS_DRV_SSD, "opened device %s: usable size %lu, io-min-size %lu",
-				ssd->name, ssd->file_size, ssd->io_min_size);
+bool
+as_storage_overloaded_ssd(as_namespace *ns)
+{
+	drv_ssds *ssds = (drv_ssds*)ns->storage_private;
+	int max_write_q = ns->storage_max_write_q;
 
-		if (ns->storage_scheduler_mode) {
-			// Set scheduler mode specified in config file.
-			ssd_set_scheduler_mode(ssd->name, ns->storage_scheduler_mode);
+	// TODO - would be nice to not do this loop every single write transaction!
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		drv_ssd *ssd = &ssds->ssds[i];
+		int qsz = cf_queue_sz(ssd->swb_write_q);
+
+		if (qsz > max_write_q) {
+			cf_ticker_warning(AS_DRV_SSD, "{%s} write fail: queue too deep: exceeds max %d",
+					ns->name, max_write_q);
+			return true;
+		}
+
+		if (ssd->shadow_name) {
+			qsz = cf_queue_sz(ssd->swb_shadow_q);
+
+			if (qsz > max_write_q) {
+				cf_ticker_warning(AS_DRV_SSD, "{%s} write fail: shadow queue too deep: exceeds max %d",
+						ns->name, max_write_q);
+				return true;
+			}
 		}
 	}
 
-	*ssds_p = ssds;
+	return false;
+}
 
-	return 0;
+
+bool
+as_storage_has_space_ssd(as_namespace *ns)
+{
+	// Shortcut - assume we can't go from 5% to 0% in 1 ticker interval.
+	if (ns->storage_last_avail_pct > 5) {
+		return true;
+	}
+	// else - running low on available percent, check rigorously...
+
+	drv_ssds* ssds = (drv_ssds*)ns->storage_private;
+
+	// Load placement steers writes away from full devices, so only one device
+	// needs space.
+	bool any_device = ns->storage_placement_policy == AS_STORAGE_PLACEMENT_LOAD;
+
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		bool has_space = cf_queue_sz(ssds->ssds[i].free_wblock_q) >=
+				min_free_wblocks(ns);
+
+		if (has_space == any_device) {
+			return has_space;
+		}
+	}
+
+	return ! any_device;
+}
+
+
+void
+as_storage_defrag_sweep_ssd(as_namespace *ns)
+{
+	cf_info(AS_DRV_SSD, "{%s} sweeping all devices for wblocks to defrag ...", ns->name);
+
+	drv_ssds* ssds = (drv_ssds*)ns->storage_private;
+
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		cf_atomic32_incr(&ssds->ssds[i].defrag_sweep);
+	}
+}
+
+
+//==========================================================
+// Storage API implementation: adding devices at runtime.
+//
+
+static pthread_mutex_t g_add_device_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool
+ssd_open_added_device(as_namespace *ns, drv_ssd *ssd, bool is_file)
+{
+	ssd->open_flag = is_file ? O_RDWR :
+			O_RDWR |
+			(ns->storage_disable_odirect ? 0 : O_DIRECT) |
+			(ns->storage_enable_osync ? O_SYNC : 0);
+
+	int fd = open(ssd->name, ssd->open_flag | (is_file ? O_CREAT : 0),
+			S_IRUSR | S_IWUSR);
+
+	if (-1 == fd) {
+		cf_warning(AS_DRV_SSD, "unable to open %s: %s", ssd->name,
+				cf_strerror(errno));
+		return false;
+	}
+
+	uint64_t size = ns->storage_filesize;
+
+	if (! is_file && ioctl(fd, BLKGETSIZE64, &size) != 0) {
+		cf_warning(AS_DRV_SSD, "unable to get size of %s: %s", ssd->name,
+				cf_strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	// Don't let check_file_size() crash a running server.
+	if (size <= SSD_HEADER_SIZE + ns->storage_write_block_size) {
+		cf_warning(AS_DRV_SSD, "%s size %lu too small", ssd->name, size);
+		close(fd);
+		return false;
+	}
+
+	ssd->file_size = check_file_size(ns, size, is_file ? "file" : "usable device");
+	ssd->io_min_size = is_file ? LO_IO_MIN_SIZE : find_io_min_size(fd, ssd->name);
+
+	if (is_file && 0 != ftruncate(fd, (off_t)ssd->file_size)) {
+		cf_warning(AS_DRV_SSD, "unable to truncate file: errno %d", errno);
+		close(fd);
+		return false;
+	}
+
+	// Only accept a device that holds no Aerospike data.
+	ssd_device_header *header = cf_valloc(ssd->io_min_size);
+	ssize_t sz = pread(fd, (void*)header, ssd->io_min_size, 0);
+	bool is_fresh = sz == (ssize_t)ssd->io_min_size &&
+			header->magic != SSD_HEADER_MAGIC;
+
+	cf_free(header);
+	close(fd);
+
+	if (! is_fresh) {
+		cf_warning(AS_DRV_SSD, "%s is not empty or can't be read - erase it first",
+				ssd->name);
+		return false;
+	}
+
+	return true;
 }
 
 
+// Add a fresh device (or file) to a running namespace. Existing records stay
+// where the index says they are - new writes and defrag gradually move data
+// onto the new device.
 int
-ssd_init_shadows(as_namespace *ns, drv_ssds *ssds)
+as_storage_add_device_ssd(as_namespace *ns, const char *name)
 {
-	int n_shadows = 0;
+	drv_ssds *ssds = (drv_ssds*)ns->storage_private;
+	bool is_file = ns->storage_files[0] != NULL;
+	int max_ssds = is_file ? AS_STORAGE_MAX_FILES : AS_STORAGE_MAX_DEVICES;
 
-	for (int n = 0; n < ssds->n_ssds; n++) {
-		if (ns->storage_shadows[n]) {
-			n_shadows++;
-		}
-	}
+	pthread_mutex_lock(&g_add_device_lock);
 
-	if (n_shadows == 0) {
-		// No shadows - a normal deployment.
-		return 0;
-	}
+	int n_ssds = ssds->n_ssds;
 
-	if (n_shadows != ssds->n_ssds) {
-		cf_warning(AS_DRV_SSD, "configured %d devices but only %d shadows",
-				ssds->n_ssds, n_shadows);
+	if (n_ssds >= max_ssds) {
+		cf_warning(AS_DRV_SSD, "{%s} add device: already have max %d devices",
+				ns->name, max_ssds);
+		pthread_mutex_unlock(&g_add_device_lock);
 		return -1;
 	}
 
-	// Check shadow devices.
-	for (int i = 0; i < n_shadows; i++) {
-		drv_ssd *ssd = &ssds->ssds[i];
-
-		ssd->shadow_name = ns->storage_shadows[i];
+	if (! ssds->ssds[0].free_wblock_q) {
+		cf_warning(AS_DRV_SSD, "{%s} add device: devices not loaded yet",
+				ns->name);
+		pthread_mutex_unlock(&g_add_device_lock);
+		return -1;
+	}
 
-		int fd = open(ssd->shadow_name, ssd->open_flag, S_IRUSR | S_IWUSR);
+	if (ssds->ssds[0].shadow_name) {
+		cf_warning(AS_DRV_SSD, "{%s} add device: not supported with shadow devices",
+				ns->name);
+		pthread_mutex_unlock(&g_add_device_lock);
+		return -1;
+	}
 
-		if (-1 == fd) {
-			cf_warning(AS_DRV_SSD, "unable to open shadow device %s: %s",
-					ssd->shadow_name, cf_strerror(errno));
+	for (int i = 0; i < n_ssds; i++) {
+		if (strcmp(ssds->ssds[i].name, name) == 0) {
+			cf_warning(AS_DRV_SSD, "{%s} add device: %s already in use",
+					ns->name, name);
+			pthread_mutex_unlock(&g_add_device_lock);
 			return -1;
 		}
+	}
 
-		uint64_t size = 0;
+	drv_ssd *ssd = &ssds->ssds[n_ssds];
 
-		ioctl(fd, BLKGETSIZE64, &size); // gets the number of bytes
+	memset(ssd, 0, sizeof(drv_ssd));
+	ssd->name = cf_strdup(name);
 
-		if (size < ssd->file_size) {
-			cf_warning(AS_DRV_SSD, "shadow device %s is smaller than main device - %lu < %lu",
-					ssd->shadow_name, size, ssd->file_size);
-			close(fd);
-			return -1;
-		}
+	if (! ssd_open_added_device(ns, ssd, is_file)) {
+		cf_free(ssd->name);
+		ssd->name = NULL;
+		pthread_mutex_unlock(&g_add_device_lock);
+		return -1;
+	}
 
-		if (ns->cold_start && ns->storage_cold_start_empty) {
-			if (! ssd_empty_header(fd, ssd->shadow_name)) {
-				close(fd);
-				return -1;
-			}
+	ssd_init_device(ns, ssd, n_ssds);
 
-			cf_info(AS_DRV_SSD, "cold-start-empty - erased header of %s",
-					ssd->shadow_name);
-		}
+	// All wblocks are free.
+	run_load_queues((void*)ssd);
 
-		close(fd);
+	// Stamp the new device with the namespace's header.
+	ssds->header->devices_n = n_ssds + 1;
+	ssd_write_header(ssd, ssds->header, 0, SSD_HEADER_SIZE);
 
-		cf_info(AS_DRV_SSD, "shadow device %s is compatible with main device",
-				ssd->shadow_name);
+	pthread_create(&ssd->maintenance_thread, 0, run_ssd_maintenance, ssd);
 
-		if (ns->storage_scheduler_mode) {
-			// Set scheduler mode specified in config file.
-			ssd_set_scheduler_mode(ssd->shadow_name,
-					ns->storage_scheduler_mode);
-		}
+	for (uint32_t j = 0; j < ns->storage_write_threads; j++) {
+		pthread_create(&ssd->write_worker_thread[j], 0, ssd_write_worker,
+				(void*)ssd);
+	}
+
+	if (pthread_create(&ssd->defrag_thread, NULL, run_defrag,
+			(void*)ssd) != 0) {
+		cf_crash(AS_DRV_SSD, "%s defrag thread failed", ssd->name);
+	}
+
+	if (is_file) {
+		ns->storage_files[n_ssds] = ssd->name;
+	}
+	else {
+		ns->storage_devices[n_ssds] = ssd->name;
 	}
 
+	ns->ssd_size += ssd->file_size;
+
+	// Make sure the device is fully set up before writers can pick it.
+	__atomic_store_n(&ssds->n_ssds, n_ssds + 1, __ATOMIC_RELEASE);
+
+	// Added devices always join the default device group.
+	ssd_add_to_device_group(ssds, ssd);
+
+	// Update the device count on all the old devices.
+	as_storage_info_flush_ssd(ns);
+
+	pthread_mutex_unlock(&g_add_device_lock);
+
+	cf_info(AS_DRV_SSD, "{%s} added %s %s: usable size %lu", ns->name,
+			is_file ? "file" : "device", ssd->name, ssd->file_size);
+
+	cf_warning(AS_DRV_SSD, "{%s} append %s to the namespace's devices in the configuration file - server won't restart without it",
+			ns->name, ssd->name);
+
 	return 0;
 }
 
 
-int
-ssd_init_files(as_namespace *ns, drv_ssds **ssds_p)
+//==========================================================
+// Storage API implementation: moving sets between device groups.
+//
+
+typedef struct ssd_move_set_info_s {
+	as_namespace	*ns;
+	as_set			*p_set;
+	uint16_t		set_id;
+	uint32_t		group_id;
+	uint64_t		n_queued;
+	uint64_t		n_skipped;
+} ssd_move_set_info;
+
+
+// Queue the wblock holding a record that's in the wrong device group - defrag
+// rewrites its live records, and ssd_pick_device() puts them in the set's
+// current group.
+static void
+move_set_reduce_cb(as_index_ref *r_ref, void *udata)
 {
-	int n_ssds;
+	as_index *r = r_ref->r;
+	ssd_move_set_info *msi = (ssd_move_set_info*)udata;
+	as_namespace *ns = msi->ns;
 
-	for (n_ssds = 0; n_ssds < AS_STORAGE_MAX_FILES; n_ssds++) {
-		if (! ns->storage_files[n_ssds]) {
-			break;
-		}
+	if (as_index_get_set_id(r) != msi->set_id ||
+			! STORAGE_RBLOCK_IS_VALID(r->rblock_id)) {
+		as_record_done(r_ref, ns);
+		return;
 	}
 
-	size_t ssds_size = sizeof(drv_ssds) + (n_ssds * sizeof(drv_ssd));
-	drv_ssds *ssds = cf_malloc(ssds_size);
+	drv_ssds *ssds = (drv_ssds*)ns->storage_private;
+	drv_ssd *ssd = &ssds->ssds[r->file_id];
 
-	memset(ssds, 0, ssds_size);
-	ssds->n_ssds = n_ssds;
-	ssds->ns = ns;
+	if (ssd->device_group == msi->group_id) {
+		as_record_done(r_ref, ns);
+		return;
+	}
 
-	// File-specific initialization of drv_ssd structures.
-	for (int i = 0; i < n_ssds; i++) {
-		drv_ssd *ssd = &ssds->ssds[i];
+	uint32_t wblock_id = RBLOCK_ID_TO_WBLOCK_ID(ssd, r->rblock_id);
+	ssd_wblock_state *p_wblock_state = &ssd->alloc_table->wblock_state[wblock_id];
 
-		ssd->name = ns->storage_files[i];
+	cf_mutex_lock(&p_wblock_state->LOCK);
 
-		if (ns->cold_start && ns->storage_cold_start_empty) {
-			if (0 == remove(ssd->name)) {
-				cf_info(AS_DRV_SSD, "cold-start-empty - removed %s", ssd->name);
-			}
-			else if (errno == ENOENT) {
-				cf_info(AS_DRV_SSD, "cold-start-empty - no file %s", ssd->name);
-			}
-			else {
-				cf_warning(AS_DRV_SSD, "failed remove: errno %d", errno);
-				return -1;
-			}
-		}
+	if (p_wblock_state->state == WBLOCK_STATE_DEFRAG) {
+		// Already queued, by us or by defrag - nothing to do.
+	}
+	else if (p_wblock_state->swb) {
+		// Still being written - a later move will pick it up.
+		msi->n_skipped++;
+	}
+	else {
+		push_wblock_to_defrag_q(ssd, wblock_id);
+		msi->n_queued++;
+	}
 
-		ssd->open_flag = O_RDWR;
+	cf_mutex_unlock(&p_wblock_state->LOCK);
 
-		// Validate that file can be opened, create it if it doesn't exist.
-		int fd = open(ssd->name, ssd->open_flag | O_CREAT, S_IRUSR | S_IWUSR);
+	as_record_done(r_ref, ns);
+}
 
-		if (-1 == fd) {
-			cf_warning(AS_DRV_SSD, "unable to open file %s: %s", ssd->name,
-					cf_strerror(errno));
-			return -1;
-		}
 
-		ssd->file_size = check_file_size(ns, ns->storage_filesize, "file");
-		ssd->io_min_size = LO_IO_MIN_SIZE;
+static void *
+run_move_set(void *udata)
+{
+	ssd_move_set_info *msi = (ssd_move_set_info*)udata;
+	as_namespace *ns = msi->ns;
 
-		// Truncate will grow or shrink the file to the correct size.
-		if (0 != ftruncate(fd, (off_t)ssd->file_size)) {
-			cf_warning(AS_DRV_SSD, "unable to truncate file: errno %d", errno);
-			close(fd);
-			return -1;
+	for (uint32_t pid = 0; pid < AS_PARTITIONS; pid++) {
+		// Stop if the set was moved again - that move takes over.
+		if (cf_atomic32_get(msi->p_set->device_group) != msi->group_id) {
+			cf_info(AS_DRV_SSD, "{%s} set %s moved again - abandoning move to group %u",
+					ns->name, msi->p_set->name, msi->group_id);
+			break;
 		}
 
-		close(fd);
-
-		ns->ssd_size += ssd->file_size; // increment total storage size
+		as_partition_reservation rsv;
 
-		cf_info(AS_DRV_SSD, "opened file %s: usable size %lu", ssd->name,
-				ssd->file_size);
+		as_partition_reserve(ns, pid, &rsv);
+		as_index_reduce(rsv.tree, move_set_reduce_cb, (void*)msi);
+		as_partition_release(&rsv);
 	}
 
-	*ssds_p = ssds;
+	cf_info(AS_DRV_SSD, "{%s} set %s move to device group %u queued %lu wblocks for defrag, skipped %lu in write buffers",
+			ns->name, msi->p_set->name, msi->group_id, msi->n_queued,
+			msi->n_skipped);
 
-	return 0;
-}
+	cf_free(msi);
 
+	return NULL;
+}
 
-//==========================================================
-// Storage API implementation: startup, shutdown, etc.
-//
 
 int
-as_storage_namespace_init_ssd(as_namespace *ns, cf_queue *complete_q,
-		void *udata)
+as_storage_set_device_group_ssd(as_namespace *ns, as_set *p_set,
+		const char *group_name)
 {
-	drv_ssds *ssds;
+	drv_ssds *ssds = (drv_ssds*)ns->storage_private;
+	uint32_t group_id;
 
-	if (ns->storage_devices[0]) {
-		if (0 != ssd_init_devices(ns, &ssds)) {
-			cf_warning(AS_DRV_SSD, "{%s} can't initialize devices", ns->name);
-			return -1;
+	if (strcmp(group_name, "default") == 0) {
+		group_id = 0;
+	}
+	else {
+		for (group_id = 1; group_id < AS_STORAGE_MAX_DEVICE_GROUPS; group_id++) {
+			const char *name = ns->storage_device_group_names[group_id];
+
+			if (name && strcmp(name, group_name) == 0) {
+				break;
+			}
 		}
 
-		if (0 != ssd_init_shadows(ns, ssds)) {
-			cf_warning(AS_DRV_SSD, "{%s} can't initialize shadows", ns->name);
+		if (group_id == AS_STORAGE_MAX_DEVICE_GROUPS ||
+				ssds->groups[group_id].n_ssds == 0) {
+			cf_warning(AS_DRV_SSD, "{%s} set %s: no device group %s", ns->name,
+					p_set->name, group_name);
 			return -1;
 		}
 	}
-	else if (ns->storage_files[0]) {
-		if (0 != ssd_init_files(ns, &ssds)) {
-			cf_warning(AS_DRV_SSD, "{%s} can't initialize files", ns->name);
-			return -1;
-		}
+
+	if (! ssds->ssds[0].defrag_wblock_q) {
+		cf_warning(AS_DRV_SSD, "{%s} set %s: devices not loaded yet", ns->name,
+				p_set->name);
+		return -1;
 	}
-	else {
-		cf_warning(AS_DRV_SSD, "{%s} has no devices or files", ns->name);
+
+	uint16_t set_id = as_namespace_get_set_id(ns, p_set->name);
+
+	if (set_id == INVALID_SET_ID) {
 		return -1;
 	}
 
-	// Allow defrag to go full speed during startup - restore the configured
-	// settings when startup is done.
-	ns->saved_defrag_sleep = ns->storage_defrag_sleep;
-	ns->storage_defrag_sleep = 0;
+	uint32_t old_group_id = cf_atomic32_get(p_set->device_group);
 
-	// The queue limit is more efficient to work with.
-	ns->storage_max_write_q = (int)
-			(ns->storage_max_write_cache / ns->storage_write_block_size);
+	// New record versions go to the new group from here on.
+	cf_atomic32_set(&p_set->device_group, group_id);
 
-	// Minimize how often we recalculate this.
-	ns->defrag_lwm_size =
-			(ns->storage_write_block_size * ns->storage_defrag_lwm_pct) / 100;
+	// Nothing to move if the set was already there, or may now go anywhere.
+	if (old_group_id == group_id || ssds->groups[group_id].n_ssds == 0) {
+		return 0;
+	}
 
-	ns->storage_private = (void*)ssds;
+	ssd_move_set_info *msi = cf_malloc(sizeof(ssd_move_set_info));
 
-	char histname[HISTOGRAM_NAME_SIZE];
+	msi->ns = ns;
+	msi->p_set = p_set;
+	msi->set_id = set_id;
+	msi->group_id = group_id;
+	msi->n_queued = 0;
+	msi->n_skipped = 0;
 
-	snprintf(histname, sizeof(histname), "{%s}-device-read-size", ns->name);
-	ns->device_read_size_hist = histogram_create(histname, HIST_SIZE);
+	pthread_t thread;
+	pthread_attr_t attrs;
 
-	snprintf(histname, sizeof(histname), "{%s}-device-write-size", ns->name);
-	ns->device_write_size_hist = histogram_create(histname, HIST_SIZE);
+	pthread_attr_init(&attrs);
+	pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_DETACHED);
+
+	if (pthread_create(&thread, &attrs, run_move_set, (void*)msi) != 0) {
+		cf_crash(AS_DRV_SSD, "failed to create move set thread");
+	}
+
+	cf_info(AS_DRV_SSD, "{%s} moving set %s from device group %u to %u ...",
+			ns->name, p_set->name, old_group_id, group_id);
+
+	return 0;
+}
 
-	// Finish initializing drv_ssd structures (non-zero-value members).
-	for (int i = 0; i < ssds->n_ssds; i++) {
-		drv_ssd *ssd = &ssds->ssds[i];
 
-		ssd->ns = ns;
-		ssd->file_id = i;
+//==========================================================
+// Storage API implementation: bulk load.
+//
 
-		pthread_mutex_init(&ssd->write_lock, 0);
-		pthread_mutex_init(&ssd->defrag_lock, 0);
+#define BULK_LOAD_LOG_INTERVAL_MS (10 * 1000)
+
+typedef struct ssd_bulk_load_info_s {
+	as_namespace	*ns;
+	char			*path;
+	int				fd;
+	ssd_write_buf	*swbs[AS_STORAGE_MAX_DEVICES]; // being filled, per device
+	uint32_t		pid; // partition currently reserved, AS_PARTITIONS if none
+	as_partition_reservation rsv;
+	bool			is_replica; // we're a replica of the reserved partition
+} ssd_bulk_load_info;
 
-		ssd->running = true;
+static pthread_mutex_t g_bulk_load_lock = PTHREAD_MUTEX_INITIALIZER;
 
-		ssd->data_in_memory = ns->storage_data_in_memory;
-		ssd->write_block_size = ns->storage_write_block_size;
 
-		ssd_wblock_init(ssd);
+// Queue a bulk load swb for writing. Throttles so client writes still find
+// room in the write queue.
+static void
+bulk_load_flush_swb(ssd_bulk_load_info *bli, drv_ssd *ssd)
+{
+	ssd_write_buf *swb = bli->swbs[ssd->file_id];
 
-		// Note: free_wblock_q, defrag_wblock_q created after loading devices.
+	if (! swb) {
+		return;
+	}
 
-		ssd->fd_q = cf_queue_create(sizeof(int), true);
+	if (ssd->write_block_size != swb->pos) {
+		// Clean the end of the buffer before pushing to write queue.
+		memset(swb->buf + swb->pos, 0, ssd->write_block_size - swb->pos);
+	}
 
-		if (ssd->shadow_name) {
-			ssd->shadow_fd_q = cf_queue_create(sizeof(int), true);
-		}
+	while (cf_queue_sz(ssd->swb_write_q) > bli->ns->storage_max_write_q / 2) {
+		usleep(1000);
+	}
 
-		ssd->swb_write_q = cf_queue_create(sizeof(void*), true);
+	// Don't let loaded wblocks push client writes out of the post-write cache.
+	swb->skip_post_write_q = true;
+	cf_queue_push(ssd->swb_write_q, &swb);
 
-		if (ssd->shadow_name) {
-			ssd->swb_shadow_q = cf_queue_create(sizeof(void*), true);
-		}
+	bli->swbs[ssd->file_id] = NULL;
+}
 
-		ssd->swb_free_q = cf_queue_create(sizeof(void*), true);
 
-		if (! ns->storage_data_in_memory) {
-			ssd->post_write_q = cf_queue_create(sizeof(void*), false);
+static ssd_write_buf *
+bulk_load_get_swb(ssd_bulk_load_info *bli, drv_ssd *ssd, uint32_t write_size)
+{
+	ssd_write_buf *swb = bli->swbs[ssd->file_id];
+
+	if (swb && write_size > ssd->write_block_size - swb->pos) {
+		bulk_load_flush_swb(bli, ssd);
+		swb = NULL;
+	}
+
+	if (! swb) {
+		if (! (swb = swb_get(ssd))) {
+			cf_warning(AS_DRV_SSD, "{%s} bulk load: %s out of free wblocks",
+					bli->ns->name, ssd->name);
+			return NULL;
 		}
 
-		snprintf(histname, sizeof(histname), "{%s}-%s-read", ns->name, ssd->name);
-		ssd->hist_read = histogram_create(histname, HIST_MILLISECONDS);
+		bli->swbs[ssd->file_id] = swb;
+	}
+
+	return swb;
+}
 
-		snprintf(histname, sizeof(histname), "{%s}-%s-large-block-read", ns->name, ssd->name);
-		ssd->hist_large_block_read = histogram_create(histname, HIST_MILLISECONDS);
 
-		snprintf(histname, sizeof(histname), "{%s}-%s-write", ns->name, ssd->name);
-		ssd->hist_write = histogram_create(histname, HIST_MILLISECONDS);
+// Copy a pre-built record straight into a wblock and index it. Returns false
+// if the load can't continue.
+static bool
+bulk_load_add_record(ssd_bulk_load_info *bli, drv_ssd_block *block,
+		uint32_t write_size)
+{
+	as_namespace *ns = bli->ns;
+	uint32_t pid = as_partition_getid(&block->keyd);
 
-		if (ssd->shadow_name) {
-			snprintf(histname, sizeof(histname), "{%s}-%s-shadow-write", ns->name, ssd->name);
-			ssd->hist_shadow_write = histogram_create(histname, HIST_MILLISECONDS);
+	// Input is sorted by partition - reserve each partition once.
+	if (pid != bli->pid) {
+		if (bli->pid != AS_PARTITIONS) {
+			as_partition_release(&bli->rsv);
 		}
 
-		snprintf(histname, sizeof(histname), "{%s}-%s-fsync", ns->name, ssd->name);
-		ssd->hist_fsync = histogram_create(histname, HIST_MILLISECONDS);
+		as_partition_reserve(ns, pid, &bli->rsv);
+		bli->pid = pid;
+
+		pthread_mutex_lock(&bli->rsv.p->lock);
+		bli->is_replica = is_self_replica(bli->rsv.p);
+		pthread_mutex_unlock(&bli->rsv.p->lock);
 	}
 
-	// Attempt to load the data.
-	//
-	// Return value 'false' means it's going to take a long time and will later
-	// asynchronously signal completion via the complete_q, 'true' means it's
-	// finished, signal here.
+	// Not ours - the replicas load it from their own copy of the input.
+	if (! bli->is_replica) {
+		return true;
+	}
 
-	if (ssd_load_records(ssds, complete_q, udata)) {
-		ssd_load_wblock_queues(ssds);
+	if (block->bins_offset > block->length ||
+			! is_valid_record(block, ns->name)) {
+		cf_warning_digest(AS_DRV_SSD, &block->keyd, "{%s} bulk load: invalid record ",
+				ns->name);
+		cf_atomic64_incr(&ns->n_bulk_load_skipped);
+		return true;
+	}
 
-		cf_queue_push(complete_q, &udata);
+	uint32_t now = as_record_void_time_get();
 
-		ssd_start_maintenance_threads(ssds);
-		ssd_start_write_worker_threads(ssds);
-		ssd_start_defrag_threads(ssds);
+	if (block->void_time != 0 && block->void_time < now) {
+		cf_atomic64_incr(&ns->n_bulk_load_skipped);
+		return true;
 	}
 
-	return 0;
-}
+	as_rec_props props = { .p_data = block->data, .size = block->bins_offset };
 
+	if (ssd_cold_start_is_record_truncated(ns, block, &props)) {
+		cf_atomic64_incr(&ns->n_bulk_load_skipped);
+		return true;
+	}
 
-void
-as_storage_loading_records_ticker_ssd()
-{
-	for (uint32_t i = 0; i < g_config.n_namespaces; i++) {
-		as_namespace *ns = g_config.namespaces[i];
+	as_index_ref r_ref;
+	r_ref.skip_lock = false;
 
-		if (ns->loading_records) {
-			char buf[2048];
-			int pos = 0;
-			drv_ssds *ssds = (drv_ssds*)ns->storage_private;
+	int rv = as_record_get_create(bli->rsv.tree, &block->keyd, &r_ref, ns);
 
-			for (int j = 0; j < ssds->n_ssds; j++) {
-				drv_ssd *ssd = &ssds->ssds[j];
-				uint32_t pct = (uint32_t)((ssd->sweep_wblock_id * 100UL) /
-						(ssd->file_size / ssd->write_block_size));
+	if (rv < 0) {
+		cf_warning_digest(AS_DRV_SSD, &block->keyd, "{%s} bulk load: as_record_get_create() failed ",
+				ns->name);
+		cf_atomic64_incr(&ns->n_bulk_load_skipped);
+		return true;
+	}
 
-				pos += sprintf(buf + pos, ", %s %u%%", ssd->name, pct);
-			}
+	as_index *r = r_ref.r;
 
-			// TODO - conform with new log standard?
-			if (ns->n_tombstones == 0) {
-				cf_info(AS_DRV_SSD, "{%s} loaded %lu objects%s", ns->name,
-						ns->n_objects, buf);
-			}
-			else {
-				cf_info(AS_DRV_SSD, "{%s} loaded %lu objects, %lu tombstones%s",
-						ns->name, ns->n_objects, ns->n_tombstones, buf);
-			}
+	// Never overwrite a live record - it was written since the input was
+	// built. An expired or truncated one is fair game.
+	if (rv == 0) {
+		if (! as_record_is_doomed(r, ns)) {
+			as_record_done(&r_ref, ns);
+			cf_atomic64_incr(&ns->n_bulk_load_skipped);
+			return true;
 		}
+
+		as_record_rescue(&r_ref, ns);
 	}
-}
 
+	r->generation = block->generation == 0 ? 1 : block->generation;
+	r->last_update_time = block->last_update_time;
 
-int
-as_storage_namespace_destroy_ssd(as_namespace *ns)
-{
-	// This is not called - for now we don't bother unwinding.
-	return 0;
-}
+	// Input may have been built with a longer max-ttl.
+	uint32_t max_void_time = now + (uint32_t)ns->max_ttl;
 
+	r->void_time = block->void_time > max_void_time ?
+			max_void_time : block->void_time;
 
-// Note that this is *NOT* the counterpart to as_storage_record_create_ssd()!
-// That would be as_storage_record_close_ssd(). This is what gets called when a
-// record is destroyed, to dereference storage.
-int
-as_storage_record_destroy_ssd(as_namespace *ns, as_record *r)
-{
-	if (STORAGE_RBLOCK_IS_VALID(r->rblock_id) && r->n_rblocks != 0) {
-		drv_ssds *ssds = (drv_ssds*)ns->storage_private;
-		drv_ssd *ssd = &ssds->ssds[r->file_id];
+	// Do this before picking a device - set determines device group.
+	apply_rec_props(r, ns, &props);
 
-		ssd_block_free(ssd, r->rblock_id, r->n_rblocks, "destroy");
+	// Catches set truncation, which needs the set-id.
+	if (as_truncate_record_is_truncated(r, ns)) {
+		as_index_delete(bli->rsv.tree, &block->keyd);
+		as_record_done(&r_ref, ns);
+		cf_atomic64_incr(&ns->n_bulk_load_skipped);
+		return true;
+	}
 
-		r->rblock_id = 0;
-		r->n_rblocks = 0;
+	drv_ssd *ssd = ssd_pick_device((drv_ssds*)ns->storage_private, r);
+	ssd_write_buf *swb = ssd ? bulk_load_get_swb(bli, ssd, write_size) : NULL;
+
+	if (! swb) {
+		as_index_delete(bli->rsv.tree, &block->keyd);
+		as_record_done(&r_ref, ns);
+		return false;
 	}
 
-	return 0;
-}
+	memcpy(swb->buf + swb->pos, (const uint8_t*)block, write_size);
 
+	uint64_t write_offset = WBLOCK_ID_TO_BYTES(ssd, swb->wblock_id) + swb->pos;
 
-//==========================================================
-// Storage API implementation: as_storage_rd cycle.
-//
+	ssd_encrypt(ssd, write_offset, (drv_ssd_block *)(swb->buf + swb->pos));
 
-int
-as_storage_record_create_ssd(as_storage_rd *rd)
-{
-	rd->block = NULL;
-	rd->must_free_block = NULL;
-	rd->ssd = NULL;
+	r->file_id = ssd->file_id;
+	r->rblock_id = BYTES_TO_RBLOCKS(write_offset);
+	r->n_rblocks = BYTES_TO_RBLOCKS(write_size);
 
-	cf_assert(rd->r->rblock_id == 0, AS_DRV_SSD, "unexpected - uninitialized rblock-id");
+	swb->pos += write_size;
 
-	return 0;
-}
+	cf_atomic64_add(&ssd->inuse_size, (int64_t)write_size);
+	cf_atomic32_add(&ssd->alloc_table->wblock_state[swb->wblock_id].inuse_sz, (int32_t)write_size);
 
+	cf_atomic64_setmax(&bli->rsv.p->max_void_time, r->void_time);
 
-int
-as_storage_record_open_ssd(as_storage_rd *rd)
-{
-	drv_ssds *ssds = (drv_ssds*)rd->ns->storage_private;
+	as_record_done(&r_ref, ns);
 
-	rd->block = NULL;
-	rd->must_free_block = NULL;
-	rd->ssd = &ssds->ssds[rd->r->file_id];
+	cf_atomic64_incr(&ns->n_bulk_load_records);
 
-	return 0;
+	return true;
 }
 
 
-int
-as_storage_record_close_ssd(as_storage_rd *rd)
+static void *
+run_bulk_load(void *udata)
 {
-	if (rd->must_free_block) {
-		cf_free(rd->must_free_block);
-		rd->must_free_block = NULL;
-		rd->block = NULL;
-	}
+	ssd_bulk_load_info *bli = (ssd_bulk_load_info*)udata;
+	as_namespace *ns = bli->ns;
+	drv_ssds *ssds = (drv_ssds*)ns->storage_private;
+	size_t wblock_size = ns->storage_write_block_size;
+	uint8_t *buf = cf_valloc(wblock_size);
 
-	return 0;
-}
+	uint64_t start_ms = cf_getms();
+	uint64_t last_log_ms = start_ms;
+	bool ok = true;
 
+	while (ok) {
+		ssize_t sz = read(bli->fd, buf, wblock_size);
 
-// These are near the top of this file:
-//		as_storage_record_get_n_bins_ssd()
-//		as_storage_record_read_ssd()
-//		as_storage_particle_read_all_ssd()
-//		as_storage_particle_read_and_size_all_ssd()
+		if (sz == 0) {
+			break; // done
+		}
 
+		if (sz != (ssize_t)wblock_size) {
+			cf_warning(AS_DRV_SSD, "{%s} bulk load: %s read failed: errno %d (%s)",
+					ns->name, bli->path, errno, cf_strerror(errno));
+			ok = false;
+			break;
+		}
 
-bool
-as_storage_record_size_and_check_ssd(as_storage_rd *rd)
-{
-	return rd->ns->storage_write_block_size >= as_storage_record_size(rd);
-}
+		size_t indent = 0; // current offset within wblock, in bytes
 
+		while (indent < wblock_size) {
+			drv_ssd_block *block = (drv_ssd_block*)&buf[indent];
 
-//==========================================================
-// Storage API implementation: storage capacity monitoring.
-//
+			// Builder zero-fills the end of each wblock.
+			if (block->magic != SSD_BLOCK_MAGIC) {
+				break;
+			}
 
-void
-as_storage_wait_for_defrag_ssd(as_namespace *ns)
-{
-	if (ns->storage_defrag_startup_minimum > 0) {
-		while (true) {
-			int avail_pct;
+			size_t next_indent = indent +
+					BYTES_TO_RBLOCK_BYTES(block->length + LENGTH_BASE);
 
-			if (0 != as_storage_stats_ssd(ns, &avail_pct, 0)) {
-				cf_crash(AS_DRV_SSD, "namespace %s storage stats failed",
-						ns->name);
+			if (block->length + LENGTH_BASE < sizeof(drv_ssd_block) ||
+					next_indent > wblock_size) {
+				cf_warning(AS_DRV_SSD, "{%s} bulk load: bad record length %u - skipping rest of wblock",
+						ns->name, block->length);
+				cf_atomic64_incr(&ns->n_bulk_load_skipped);
+				break;
 			}
 
-			if (avail_pct >= ns->storage_defrag_startup_minimum) {
+			if (! bulk_load_add_record(bli, block,
+					(uint32_t)(next_indent - indent))) {
+				ok = false;
 				break;
 			}
 
-			cf_info(AS_DRV_SSD, "namespace %s waiting for defrag: %d pct available, waiting for %d ...",
-					ns->name, avail_pct, ns->storage_defrag_startup_minimum);
+			indent = next_indent;
+		}
 
-			sleep(2);
+		cf_atomic64_add(&ns->bulk_load_read_bytes, (int64_t)wblock_size);
+
+		if (cf_atomic32_get(ns->stop_writes) != 0) {
+			cf_warning(AS_DRV_SSD, "{%s} bulk load: hit stop-writes", ns->name);
+			ok = false;
+		}
+
+		// Loaded records bypass sindex updates - a sindex created elsewhere
+		// and distributed via SMD since we started would miss them.
+		if (ns->sindex_cnt != 0) {
+			cf_warning(AS_DRV_SSD, "{%s} bulk load: secondary index created", ns->name);
+			ok = false;
+		}
+
+		uint64_t now_ms = cf_getms();
+
+		if (now_ms > last_log_ms + BULK_LOAD_LOG_INTERVAL_MS) {
+			cf_info(AS_DRV_SSD, "{%s} bulk load: %lu%% - loaded %lu skipped %lu",
+					ns->name, (cf_atomic64_get(ns->bulk_load_read_bytes) * 100) /
+							ns->bulk_load_total_bytes,
+					cf_atomic64_get(ns->n_bulk_load_records),
+					cf_atomic64_get(ns->n_bulk_load_skipped));
+
+			last_log_ms = now_ms;
 		}
 	}
 
-	// Restore configured defrag throttling values.
-	ns->storage_defrag_sleep = ns->saved_defrag_sleep;
+	for (int i = 0; i < ssds->n_ssds; i++) {
+		bulk_load_flush_swb(bli, &ssds->ssds[i]);
+	}
+
+	if (bli->pid != AS_PARTITIONS) {
+		as_partition_release(&bli->rsv);
+	}
+
+	cf_info(AS_DRV_SSD, "{%s} bulk load of %s %s in %lu ms - loaded %lu skipped %lu",
+			ns->name, bli->path, ok ? "done" : "abandoned",
+			cf_getms() - start_ms, cf_atomic64_get(ns->n_bulk_load_records),
+			cf_atomic64_get(ns->n_bulk_load_skipped));
+
+	close(bli->fd);
+	cf_free(buf);
+	cf_free(bli->path);
+	cf_free(bli);
+
+	cf_atomic32_set(&ns->bulk_loading, 0);
+
+	return NULL;
 }
 
 
-bool
-as_storage_overloaded_ssd(as_namespace *ns)
+// Load a file of pre-built wblocks - records in device format, sorted by
+// partition, each wblock zero-filled at the end. Records are copied into
+// wblocks and indexed directly, bypassing the transaction path. Every node
+// loads the same input and keeps only partitions it's a replica for, so no
+// records cross the fabric.
+int
+as_storage_bulk_load_ssd(as_namespace *ns, const char *path)
 {
 	drv_ssds *ssds = (drv_ssds*)ns->storage_private;
-	int max_write_q = ns->storage_max_write_q;
-
-	// TODO - would be nice to not do this loop every single write transaction!
-	for (int i = 0; i < ssds->n_ssds; i++) {
-		drv_ssd *ssd = &ssds->ssds[i];
-		int qsz = cf_queue_sz(ssd->swb_write_q);
 
-		if (qsz > max_write_q) {
-			cf_ticker_warning(AS_DRV_SSD, "{%s} write fail: queue too deep: exceeds max %d",
-					ns->name, max_write_q);
-			return true;
-		}
+	if (ns->storage_data_in_memory) {
+		cf_warning(AS_DRV_SSD, "{%s} bulk load: not supported with data-in-memory",
+				ns->name);
+		return -1;
+	}
 
-		if (ssd->shadow_name) {
-			qsz = cf_queue_sz(ssd->swb_shadow_q);
+	if (ns->sindex_cnt != 0) {
+		cf_warning(AS_DRV_SSD, "{%s} bulk load: not supported with secondary indexes",
+				ns->name);
+		return -1;
+	}
 
-			if (qsz > max_write_q) {
-				cf_ticker_warning(AS_DRV_SSD, "{%s} write fail: shadow queue too deep: exceeds max %d",
-						ns->name, max_write_q);
-				return true;
-			}
-		}
+	if (! ssds->ssds[0].free_wblock_q) {
+		cf_warning(AS_DRV_SSD, "{%s} bulk load: devices not loaded yet",
+				ns->name);
+		return -1;
 	}
 
-	return false;
-}
+	int fd = open(path, O_RDONLY);
 
+	if (fd == -1) {
+		cf_warning(AS_DRV_SSD, "{%s} bulk load: unable to open %s: %s",
+				ns->name, path, cf_strerror(errno));
+		return -1;
+	}
 
-bool
-as_storage_has_space_ssd(as_namespace *ns)
-{
-	// Shortcut - assume we can't go from 5% to 0% in 1 ticker interval.
-	if (ns->storage_last_avail_pct > 5) {
-		return true;
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0 ||
+			st.st_size % ns->storage_write_block_size != 0) {
+		cf_warning(AS_DRV_SSD, "{%s} bulk load: %s size is not a multiple of write-block-size %u",
+				ns->name, path, ns->storage_write_block_size);
+		close(fd);
+		return -1;
 	}
-	// else - running low on available percent, check rigorously...
 
-	drv_ssds* ssds = (drv_ssds*)ns->storage_private;
+	pthread_mutex_lock(&g_bulk_load_lock);
 
-	for (int i = 0; i < ssds->n_ssds; i++) {
-		if (cf_queue_sz(ssds->ssds[i].free_wblock_q) < min_free_wblocks(ns)) {
-			return false;
-		}
+	if (cf_atomic32_get(ns->bulk_loading) != 0) {
+		pthread_mutex_unlock(&g_bulk_load_lock);
+		cf_warning(AS_DRV_SSD, "{%s} bulk load: already loading", ns->name);
+		close(fd);
+		return -1;
 	}
 
-	return true;
-}
+	cf_atomic32_set(&ns->bulk_loading, 1);
 
+	pthread_mutex_unlock(&g_bulk_load_lock);
 
-void
-as_storage_defrag_sweep_ssd(as_namespace *ns)
-{
-	cf_info(AS_DRV_SSD, "{%s} sweeping all devices for wblocks to defrag ...", ns->name);
+	ns->bulk_load_total_bytes = (uint64_t)st.st_size;
+	cf_atomic64_set(&ns->bulk_load_read_bytes, 0);
+	cf_atomic64_set(&ns->n_bulk_load_records, 0);
+	cf_atomic64_set(&ns->n_bulk_load_skipped, 0);
 
-	drv_ssds* ssds = (drv_ssds*)ns->storage_private;
+	ssd_bulk_load_info *bli = cf_calloc(1, sizeof(ssd_bulk_load_info));
 
-	for (int i = 0; i < ssds->n_ssds; i++) {
-		cf_atomic32_incr(&ssds->ssds[i].defrag_sweep);
+	bli->ns = ns;
+	bli->path = cf_strdup(path);
+	bli->fd = fd;
+	bli->pid = AS_PARTITIONS;
+
+	pthread_t thread;
+	pthread_attr_t attrs;
+
+	pthread_attr_init(&attrs);
+	pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_DETACHED);
+
+	if (pthread_create(&thread, &attrs, run_bulk_load, (void*)bli) != 0) {
+		cf_crash(AS_DRV_SSD, "failed to create bulk load thread");
 	}
+
+	cf_info(AS_DRV_SSD, "{%s} bulk loading %s (%lu bytes) ...", ns->name, path,
+			ns->bulk_load_total_bytes);
+
+	return 0;
 }
 
 
@@ -4149,6 +6089,24 @@ as_storage_save_evict_void_time_ssd(as_namespace *ns, uint32_t evict_void_time)
 }
 
 
+uint64_t
+as_storage_header_random_ssd(as_namespace *ns)
+{
+	drv_ssds* ssds = (drv_ssds*)ns->storage_private;
+
+	return ssds->header->random;
+}
+
+
+uint64_t
+as_storage_prev_header_random_ssd(as_namespace *ns)
+{
+	drv_ssds* ssds = (drv_ssds*)ns->storage_private;
+
+	return ssds->prev_random;
+}
+
+
 //==========================================================
 // Storage API implementation: statistics.
 //
@@ -4159,7 +6117,25 @@ as_storage_stats_ssd(as_namespace *ns, int *available_pct,
 {
 	drv_ssds *ssds = (drv_ssds*)ns->storage_private;
 
-	if (available_pct) {
+	if (available_pct && ns->storage_placement_policy ==
+			AS_STORAGE_PLACEMENT_LOAD) {
+		uint64_t avail_sz = 0;
+		uint64_t total_sz = 0;
+
+		// Load placement fills devices evenly - use overall available percent.
+		for (int i = 0; i < ssds->n_ssds; i++) {
+			drv_ssd *ssd = &ssds->ssds[i];
+
+			avail_sz += available_size(ssd);
+			total_sz += ssd->file_size;
+		}
+
+		*available_pct = (int)((avail_sz * 100) / total_sz);
+
+		// Used for shortcut in as_storage_has_space_ssd().
+		ns->storage_last_avail_pct = *available_pct;
+	}
+	else if (available_pct) {
 		*available_pct = 100;
 
 		// Find the device with the lowest available percent.
@@ -4309,4 +6285,8 @@ as_storage_shutdown_ssd(as_namespace *ns)
 			pthread_join(ssd->shadow_worker_thread, &p_void);
 		}
 	}
+
+	if (ns->storage_index_snapshot_file) {
+		ssd_index_snapshot_save(ssds);
+	}
 }
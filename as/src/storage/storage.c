@@ -175,6 +175,9 @@ as_storage_record_create(as_namespace *ns, as_record *r, as_storage_rd *rd)
 	rd->key_size = 0;
 	rd->key = NULL;
 	rd->is_durable_delete = false;
+	rd->is_joined_read = false;
+	rd->in_read_flight = false;
+	rd->client_ops = NULL;
 
 	if (as_storage_record_create_table[ns->storage_type]) {
 		return as_storage_record_create_table[ns->storage_type](rd);
@@ -206,6 +209,9 @@ as_storage_record_open(as_namespace *ns, as_record *r, as_storage_rd *rd)
 	rd->key_size = 0;
 	rd->key = NULL;
 	rd->is_durable_delete = false;
+	rd->is_joined_read = false;
+	rd->in_read_flight = false;
+	rd->client_ops = NULL;
 
 	if (as_storage_record_open_table[ns->storage_type]) {
 		return as_storage_record_open_table[ns->storage_type](rd);
@@ -234,6 +240,44 @@ as_storage_record_close(as_storage_rd *rd)
 	return 0;
 }
 
+//--------------------------------------
+// as_storage_read_join
+//
+
+typedef bool (*as_storage_read_join_fn)(as_namespace *ns, const cf_digest *keyd);
+static const as_storage_read_join_fn as_storage_read_join_table[AS_NUM_STORAGE_ENGINES] = {
+	NULL, // memory has no device reads to share
+	as_storage_read_join_ssd
+};
+
+bool
+as_storage_read_join(as_namespace *ns, const cf_digest *keyd)
+{
+	if (as_storage_read_join_table[ns->storage_type]) {
+		return as_storage_read_join_table[ns->storage_type](ns, keyd);
+	}
+
+	return false;
+}
+
+//--------------------------------------
+// as_storage_read_leave
+//
+
+typedef void (*as_storage_read_leave_fn)(as_namespace *ns, const cf_digest *keyd, bool in_flight);
+static const as_storage_read_leave_fn as_storage_read_leave_table[AS_NUM_STORAGE_ENGINES] = {
+	NULL, // memory has no device reads to share
+	as_storage_read_leave_ssd
+};
+
+void
+as_storage_read_leave(as_namespace *ns, const cf_digest *keyd, bool in_flight)
+{
+	if (as_storage_read_leave_table[ns->storage_type]) {
+		as_storage_read_leave_table[ns->storage_type](ns, keyd, in_flight);
+	}
+}
+
 //--------------------------------------
 // as_storage_record_load_n_bins
 //
@@ -394,6 +438,66 @@ as_storage_defrag_sweep(as_namespace *ns)
 	}
 }
 
+//--------------------------------------
+// as_storage_add_device
+//
+
+typedef int (*as_storage_add_device_fn)(as_namespace *ns, const char *name);
+static const as_storage_add_device_fn as_storage_add_device_table[AS_NUM_STORAGE_ENGINES] = {
+	NULL, // memory has no devices
+	as_storage_add_device_ssd
+};
+
+int
+as_storage_add_device(as_namespace *ns, const char *name)
+{
+	if (as_storage_add_device_table[ns->storage_type]) {
+		return as_storage_add_device_table[ns->storage_type](ns, name);
+	}
+
+	return -1;
+}
+
+//--------------------------------------
+// as_storage_bulk_load
+//
+
+typedef int (*as_storage_bulk_load_fn)(as_namespace *ns, const char *path);
+static const as_storage_bulk_load_fn as_storage_bulk_load_table[AS_NUM_STORAGE_ENGINES] = {
+	NULL, // memory has no wblocks
+	as_storage_bulk_load_ssd
+};
+
+int
+as_storage_bulk_load(as_namespace *ns, const char *path)
+{
+	if (as_storage_bulk_load_table[ns->storage_type]) {
+		return as_storage_bulk_load_table[ns->storage_type](ns, path);
+	}
+
+	return -1;
+}
+
+//--------------------------------------
+// as_storage_set_device_group
+//
+
+typedef int (*as_storage_set_device_group_fn)(as_namespace *ns, as_set *p_set, const char *group_name);
+static const as_storage_set_device_group_fn as_storage_set_device_group_table[AS_NUM_STORAGE_ENGINES] = {
+	NULL, // memory has no devices
+	as_storage_set_device_group_ssd
+};
+
+int
+as_storage_set_device_group(as_namespace *ns, as_set *p_set, const char *group_name)
+{
+	if (as_storage_set_device_group_table[ns->storage_type]) {
+		return as_storage_set_device_group_table[ns->storage_type](ns, p_set, group_name);
+	}
+
+	return -1;
+}
+
 //--------------------------------------
 // as_storage_info_set
 //
@@ -468,6 +572,46 @@ as_storage_save_evict_void_time(as_namespace *ns, uint32_t evict_void_time)
 	}
 }
 
+//--------------------------------------
+// as_storage_header_random
+//
+
+typedef uint64_t (*as_storage_header_random_fn)(as_namespace *ns);
+static const as_storage_header_random_fn as_storage_header_random_table[AS_NUM_STORAGE_ENGINES] = {
+	NULL, // memory has no header
+	as_storage_header_random_ssd
+};
+
+uint64_t
+as_storage_header_random(as_namespace *ns)
+{
+	if (as_storage_header_random_table[ns->storage_type]) {
+		return as_storage_header_random_table[ns->storage_type](ns);
+	}
+
+	return 0;
+}
+
+//--------------------------------------
+// as_storage_prev_header_random
+//
+
+typedef uint64_t (*as_storage_prev_header_random_fn)(as_namespace *ns);
+static const as_storage_prev_header_random_fn as_storage_prev_header_random_table[AS_NUM_STORAGE_ENGINES] = {
+	NULL, // memory has no header
+	as_storage_prev_header_random_ssd
+};
+
+uint64_t
+as_storage_prev_header_random(as_namespace *ns)
+{
+	if (as_storage_prev_header_random_table[ns->storage_type]) {
+		return as_storage_prev_header_random_table[ns->storage_type](ns);
+	}
+
+	return 0;
+}
+
 //--------------------------------------
 // as_storage_stats
 //
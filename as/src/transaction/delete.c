@@ -39,6 +39,7 @@
 #include "fault.h"
 
 #include "base/cfg.h"
+#include "base/change_stream.h"
 #include "base/datamodel.h"
 #include "base/index.h"
 #include "base/proto.h"
@@ -442,6 +443,9 @@ drop_master(as_transaction* tr, as_index_ref* r_ref, rw_request* rw)
 	as_index_delete(tree, &tr->keyd);
 	as_record_done(r_ref, ns);
 
+	as_change_stream_append(ns, &tr->keyd, set_id, 0,
+			cf_clepoch_milliseconds(), AS_CHANGE_OP_DELETE);
+
 	if (xdr_must_ship_delete(ns, as_transaction_is_nsup_delete(tr),
 			as_msg_is_xdr(m))) {
 		xdr_write(ns, &tr->keyd, 0, 0, XDR_OP_TYPE_DROP, set_id, NULL);
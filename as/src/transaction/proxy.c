@@ -46,6 +46,7 @@
 #include "socket.h"
 
 #include "base/batch.h"
+#include "base/cfg.h"
 #include "base/datamodel.h"
 #include "base/proto.h"
 #include "base/thr_tsvc.h"
@@ -294,6 +295,26 @@ as_proxy_divert(cf_node dst, as_transaction* tr, as_namespace* ns)
 }
 
 
+// Proxyer - tell the client which node to use instead of diverting.
+void
+as_proxy_redirect(cf_node dst, as_transaction* tr, as_namespace* ns)
+{
+	cf_assert(tr->origin == FROM_CLIENT, AS_PROXY,
+			"unexpected transaction origin %u", tr->origin);
+
+	cf_detail_digest(AS_PROXY_DIVERT, &tr->keyd,
+			"{%s} redirecting client %s to node %lx ",
+			ns->name, tr->from.proto_fd_h->client, dst);
+
+	as_msg_send_partition_redirect(tr->from.proto_fd_h, dst,
+			as_exchange_cluster_key(), as_transaction_trid(tr));
+
+	tr->from.proto_fd_h = NULL; // pattern, not needed
+
+	cf_atomic64_incr(&ns->n_client_proxy_redirect);
+}
+
+
 // Proxyee - transaction reservation failed here, tell proxyer to try again.
 void
 as_proxy_return_to_sender(const as_transaction* tr, as_namespace* ns)
@@ -353,6 +374,9 @@ as_proxy_send_ops_response(cf_node dst, uint32_t proxy_tid, cf_dyn_buf* db)
 		msg_set_buf(m, PROXY_FIELD_AS_PROTO, msgp, msg_sz, MSG_SET_COPY);
 	}
 	else {
+		// The fabric frees the buffer later - it can't stay in the region.
+		msgp = cf_region_escape(msgp, msg_sz);
+
 		msg_set_buf(m, PROXY_FIELD_AS_PROTO, msgp, msg_sz,
 				MSG_SET_HANDOFF_MALLOC);
 		db->buf = NULL; // the fabric owns the buffer now
@@ -420,6 +444,11 @@ proxyer_handle_client_response(msg* m, proxy_request* pr)
 		return AS_PROTO_RESULT_FAIL_UNKNOWN;
 	}
 
+	// The client's partition map is stale - hint it to refresh now.
+	if (g_config.stale_map_hints && proto_sz >= sizeof(cl_msg)) {
+		((cl_msg*)proto)->msg.info3 |= AS_MSG_INFO3_PARTITION_MOVED;
+	}
+
 	as_file_handle* fd_h = pr->from.proto_fd_h;
 
 	if (cf_socket_send_all(&fd_h->sock, proto, proto_sz, MSG_NOSIGNAL,
@@ -301,6 +301,17 @@ read_local(as_transaction* tr)
 	as_msg* m = &tr->msgp->msg;
 	as_namespace* ns = tr->rsv.ns;
 
+	// Join before queuing on the record lock, to share any device read made
+	// while we wait.
+	bool in_read_flight = as_storage_read_join(ns, &tr->keyd);
+
+	if (in_read_flight) {
+		tr->flags |= AS_TRANSACTION_FLAG_READ_FLIGHT;
+	}
+	else {
+		tr->flags &= ~AS_TRANSACTION_FLAG_READ_FLIGHT;
+	}
+
 	as_index_ref r_ref;
 	r_ref.skip_lock = false;
 
@@ -320,6 +331,8 @@ read_local(as_transaction* tr)
 	as_storage_rd rd;
 
 	as_storage_record_open(ns, r, &rd);
+	rd.is_joined_read = true;
+	rd.in_read_flight = in_read_flight;
 
 	// Check the key if required.
 	// Note - for data-not-in-memory "exists" ops, key check is expensive!
@@ -426,6 +439,39 @@ read_local(as_transaction* tr)
 					response_bins[n_bins++] = NULL;
 				}
 			}
+			else if (op->op == AS_MSG_OP_HLL_READ ||
+					op->op == AS_MSG_OP_TIMESERIES_READ) {
+				as_bin* b = as_bin_get_from_buf(&rd, op->name, op->name_sz);
+
+				if (b) {
+					bool is_hll = op->op == AS_MSG_OP_HLL_READ;
+					as_bin* rb = &result_bins[n_result_bins];
+					as_bin_set_empty(rb);
+
+					if ((result = is_hll ?
+							as_bin_hll_read_from_client(b, op, rb) :
+							as_bin_timeseries_read_from_client(b, op, rb)) < 0) {
+						cf_warning_digest(AS_RW, &tr->keyd, "{%s} read_local: failed %s read ", ns->name, is_hll ? "hll" : "timeseries");
+						destroy_stack_bins(result_bins, n_result_bins);
+						read_local_done(tr, &r_ref, &rd, -result);
+						return TRANS_DONE_ERROR;
+					}
+
+					if (as_bin_inuse(rb)) {
+						n_result_bins++;
+						ops[n_bins] = op;
+						response_bins[n_bins++] = rb;
+					}
+					else if (respond_all_ops) {
+						ops[n_bins] = op;
+						response_bins[n_bins++] = NULL;
+					}
+				}
+				else if (respond_all_ops) {
+					ops[n_bins] = op;
+					response_bins[n_bins++] = NULL;
+				}
+			}
 			else {
 				cf_warning_digest(AS_RW, &tr->keyd, "{%s} read_local: unexpected bin op %u ", ns->name, op->op);
 				destroy_stack_bins(result_bins, n_result_bins);
@@ -439,7 +485,7 @@ read_local(as_transaction* tr)
 
 	if (tr->origin != FROM_BATCH) {
 		db.used_sz = db.alloc_sz;
-		db.buf = (uint8_t*)as_msg_make_response_msg(tr->result_code,
+		db.buf = (uint8_t*)as_msg_make_transient_response_msg(tr->result_code,
 				r->generation, r->void_time, p_ops, response_bins, n_bins, ns,
 				(cl_msg*)dyn_bufdb, &db.used_sz, as_transaction_trid(tr));
 
@@ -459,12 +505,15 @@ read_local(as_transaction* tr)
 	destroy_stack_bins(result_bins, n_result_bins);
 	as_storage_record_close(&rd);
 	as_record_done(&r_ref, ns);
+	as_storage_read_leave(ns, &tr->keyd, in_read_flight);
 
 	// Now that we're not under the record lock, send the message we just built.
 	if (db.used_sz != 0) {
 		send_read_response(tr, NULL, NULL, 0, &db);
 
-		cf_dyn_buf_free(&db);
+		if (! db.is_stack) {
+			cf_region_free(db.buf); // NULL if the proxy took it
+		}
 		tr->from.proto_fd_h = NULL;
 	}
 
@@ -484,6 +533,9 @@ read_local_done(as_transaction* tr, as_index_ref* r_ref, as_storage_rd* rd,
 		as_record_done(r_ref, tr->rsv.ns);
 	}
 
+	as_storage_read_leave(tr->rsv.ns, &tr->keyd,
+			(tr->flags & AS_TRANSACTION_FLAG_READ_FLIGHT) != 0);
+
 	tr->result_code = (uint8_t)result_code;
 
 	send_read_response(tr, NULL, NULL, 0, NULL);
@@ -291,6 +291,15 @@ write_sindex_update(as_namespace* ns, const char* set_name, cf_digest* keyd,
 	as_sindex* si_arr[2 * ns->sindex_cnt];
 	int si_arr_index = 0;
 
+	// Composite indexes span bins - diff their keys across the whole record.
+	as_sindex_composite_keys ckeys[ns->n_composite_sindexes];
+	int n_ckeys = as_sindex_composite_lookup_lockfree(ns, set_name, ckeys);
+
+	as_sindex_composite_keys_from_bins(ckeys, n_ckeys, old_bins, n_old_bins,
+			false);
+	as_sindex_composite_keys_from_bins(ckeys, n_ckeys, new_bins, n_new_bins,
+			true);
+
 	// Reserve matching SIs.
 
 	for (int i = 0; i < n_old_bins; i++) {
@@ -370,9 +379,12 @@ write_sindex_update(as_namespace* ns, const char* set_name, cf_digest* keyd,
 		as_sindex_sbin_freeall(sbins, n_populated);
 	}
 
+	bool composite_touched = as_sindex_composite_update(ckeys, n_ckeys, keyd);
+
 	as_sindex_release_arr(si_arr, si_arr_index);
+	as_sindex_composite_release(ckeys, n_ckeys);
 
-	return n_populated != 0;
+	return n_populated != 0 || composite_touched;
 }
 
 
@@ -447,6 +459,11 @@ remove_from_sindex(as_namespace* ns, const char* set_name, cf_digest* keyd,
 				&sbins[sbins_populated], AS_SINDEX_OP_DELETE);
 	}
 
+	as_sindex_composite_keys ckeys[ns->n_composite_sindexes];
+	int n_ckeys = as_sindex_composite_lookup_lockfree(ns, set_name, ckeys);
+
+	as_sindex_composite_keys_from_bins(ckeys, n_ckeys, bins, n_bins, false);
+
 	SINDEX_GRUNLOCK();
 
 	if (sbins_populated) {
@@ -454,7 +471,10 @@ remove_from_sindex(as_namespace* ns, const char* set_name, cf_digest* keyd,
 		as_sindex_sbin_freeall(sbins, sbins_populated);
 	}
 
+	as_sindex_composite_update(ckeys, n_ckeys, keyd);
+
 	as_sindex_release_arr(si_arr, si_arr_index);
+	as_sindex_composite_release(ckeys, n_ckeys);
 }
 
 
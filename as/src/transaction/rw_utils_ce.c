@@ -151,6 +151,8 @@ repl_write_should_retransmit_replicas(rw_request* rw, uint32_t result_code)
 	case AS_PROTO_RESULT_FAIL_CLUSTER_KEY_MISMATCH:
 		rw->xmit_ms = 0; // force retransmit on next cycle
 		return true;
+	case AS_PROTO_RESULT_FAIL_UNAVAILABLE:
+		return true; // replica is still loading - retransmit on usual cycle
 	default:
 		return false;
 	}
@@ -50,6 +50,7 @@
 #include "fault.h"
 
 #include "base/cfg.h"
+#include "base/change_stream.h"
 #include "base/datamodel.h"
 #include "base/proto.h"
 #include "base/secondary_index.h"
@@ -58,6 +59,7 @@
 #include "base/udf_aerospike.h"
 #include "base/udf_arglist.h"
 #include "base/udf_cask.h"
+#include "base/udf_native.h"
 #include "base/udf_record.h"
 #include "base/udf_timer.h"
 #include "fabric/partition.h"
@@ -787,8 +789,13 @@ udf_apply_record(udf_call* call, as_rec* rec, as_result* result)
 		.memtracker	= NULL
 	};
 
-	int apply_rv = as_module_apply_record(&mod_lua, &ctx, call->def->filename,
-			call->def->function, rec, call->def->arglist, result);
+	int apply_rv;
+
+	if (! udf_native_apply_record(&ctx, call->def->filename,
+			call->def->function, rec, call->def->arglist, result, &apply_rv)) {
+		apply_rv = as_module_apply_record(&mod_lua, &ctx, call->def->filename,
+				call->def->function, rec, call->def->arglist, result);
+	}
 
 	udf_timer_cleanup();
 
@@ -916,16 +923,22 @@ udf_post_processing(udf_record* urecord, rw_request* rw, udf_optype urecord_op)
 	// Close the record for all the cases.
 	udf_record_close(urecord);
 
-	// Write to XDR pipe.
+	// Write to XDR pipe and change stream.
 	if (urecord_op == UDF_OPTYPE_WRITE) {
 		xdr_write(tr->rsv.ns, &tr->keyd, generation, 0, XDR_OP_TYPE_WRITE,
 				set_id, &dirty_bins);
+		as_change_stream_append(tr->rsv.ns, &tr->keyd, set_id, generation,
+				tr->last_update_time, AS_CHANGE_OP_WRITE);
 	}
 	else if (urecord_op == UDF_OPTYPE_DELETE) {
 		xdr_write(tr->rsv.ns, &tr->keyd, 0, 0,
 				as_transaction_is_durable_delete(tr) ?
 						XDR_OP_TYPE_DURABLE_DELETE : XDR_OP_TYPE_DROP,
 				set_id, NULL);
+		as_change_stream_append(tr->rsv.ns, &tr->keyd, set_id, 0,
+				tr->last_update_time,
+				as_transaction_is_durable_delete(tr) ?
+						AS_CHANGE_OP_DURABLE_DELETE : AS_CHANGE_OP_DELETE);
 	}
 }
 
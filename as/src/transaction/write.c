@@ -39,6 +39,7 @@
 #include "fault.h"
 
 #include "base/cfg.h"
+#include "base/change_stream.h"
 #include "base/datamodel.h"
 #include "base/index.h"
 #include "base/proto.h"
@@ -91,24 +92,28 @@ bool check_msg_set_name(as_transaction* tr, const char* set_name);
 
 int write_master_dim_single_bin(as_transaction* tr, as_storage_rd* rd,
 		bool increment_generation, rw_request* rw, bool* is_delete,
-		xdr_dirty_bins* dirty_bins);
+		bool* is_unchanged, xdr_dirty_bins* dirty_bins);
 int write_master_dim(as_transaction* tr, const char* set_name,
 		as_storage_rd* rd, bool record_level_replace, bool increment_generation,
-		rw_request* rw, bool* is_delete, xdr_dirty_bins* dirty_bins);
+		rw_request* rw, bool* is_delete, bool* is_unchanged,
+		xdr_dirty_bins* dirty_bins);
 int write_master_ssd_single_bin(as_transaction* tr, as_storage_rd* rd,
 		bool must_fetch_data, bool increment_generation, rw_request* rw,
-		bool* is_delete, xdr_dirty_bins* dirty_bins);
+		bool* is_delete, bool* is_unchanged, xdr_dirty_bins* dirty_bins);
 int write_master_ssd(as_transaction* tr, const char* set_name,
 		as_storage_rd* rd, bool must_fetch_data, bool record_level_replace,
 		bool increment_generation, rw_request* rw, bool* is_delete,
-		xdr_dirty_bins* dirty_bins);
+		bool* is_unchanged, xdr_dirty_bins* dirty_bins);
 
 void write_master_update_index_metadata(as_transaction* tr,
 		bool increment_generation, index_metadata* old, as_record* r);
 int write_master_bin_ops(as_transaction* tr, as_storage_rd* rd,
 		cf_ll_buf* particles_llb, as_bin* cleanup_bins,
 		uint32_t* p_n_cleanup_bins, cf_dyn_buf* db, uint32_t* p_n_final_bins,
-		xdr_dirty_bins* dirty_bins);
+		xdr_dirty_bins* dirty_bins, as_bin* old_bins, uint32_t n_old_bins,
+		index_metadata* old_metadata, bool* is_unchanged);
+bool write_master_bins_unchanged(as_storage_rd* rd, const index_metadata* old,
+		as_bin* old_bins, uint32_t n_old_bins);
 int write_master_bin_ops_loop(as_transaction* tr, as_storage_rd* rd,
 		as_msg_op** ops, as_bin* response_bins, uint32_t* p_n_response_bins,
 		as_bin* result_bins, uint32_t* p_n_result_bins,
@@ -152,6 +157,13 @@ client_write_update_stats(as_namespace* ns, uint8_t result_code, bool is_xdr_op)
 	}
 }
 
+static inline bool
+skip_unchanged_write(const as_transaction* tr)
+{
+	return tr->rsv.ns->skip_unchanged_writes ||
+			(tr->msgp->msg.info2 & AS_MSG_INFO2_SKIP_UNCHANGED) != 0;
+}
+
 static inline void
 append_bin_to_destroy(as_bin* b, as_bin* bins, uint32_t* p_n_bins)
 {
@@ -160,6 +172,23 @@ append_bin_to_destroy(as_bin* b, as_bin* bins, uint32_t* p_n_bins)
 	}
 }
 
+// Bins may reference client message values only if no op reads them back.
+static inline bool
+ops_only_write_bins(as_msg* m)
+{
+	as_msg_op* op = NULL;
+	int i = 0;
+
+	while ((op = as_msg_op_iterate(m, op, &i)) != NULL) {
+		if (! OP_IS_TOUCH(op->op) && (op->op != AS_MSG_OP_WRITE ||
+				op->particle_type == AS_PARTICLE_TYPE_NULL)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 
 //==========================================================
 // Public API.
@@ -231,8 +260,9 @@ as_write_start(as_transaction* tr)
 		return status;
 	}
 
-	// If we don't need replica writes, transaction is finished.
-	if (rw->n_dest_nodes == 0) {
+	// If we don't need replica writes, transaction is finished. (Writes that
+	// changed nothing leave replicas as they are.)
+	if (rw->n_dest_nodes == 0 || (tr->flags & AS_TRANSACTION_FLAG_UNCHANGED) != 0) {
 		send_write_response(tr, &rw->response_db);
 		rw_request_hash_delete(&hkey, rw);
 		return TRANS_DONE_SUCCESS;
@@ -325,8 +355,9 @@ write_dup_res_cb(rw_request* rw)
 	rw->n_dest_nodes = as_partition_get_other_replicas(tr.rsv.p,
 			rw->dest_nodes);
 
-	// If we don't need replica writes, transaction is finished.
-	if (rw->n_dest_nodes == 0) {
+	// If we don't need replica writes, transaction is finished. (Writes that
+	// changed nothing leave replicas as they are.)
+	if (rw->n_dest_nodes == 0 || (tr.flags & AS_TRANSACTION_FLAG_UNCHANGED) != 0) {
 		send_write_response(&tr, &rw->response_db);
 		return true;
 	}
@@ -637,29 +668,33 @@ write_master(rw_request* rw, as_transaction* tr)
 	xdr_clear_dirty_bins(&dirty_bins);
 
 	bool is_delete = false;
+	bool is_unchanged = false;
+
+	// Only look for no-op writes if configured or requested.
+	bool* p_is_unchanged = skip_unchanged_write(tr) ? &is_unchanged : NULL;
 
 	if (ns->storage_data_in_memory) {
 		if (ns->single_bin) {
 			result = write_master_dim_single_bin(tr, &rd,
 					increment_generation,
-					rw, &is_delete, &dirty_bins);
+					rw, &is_delete, p_is_unchanged, &dirty_bins);
 		}
 		else {
 			result = write_master_dim(tr, set_name, &rd,
 					record_level_replace, increment_generation,
-					rw, &is_delete, &dirty_bins);
+					rw, &is_delete, p_is_unchanged, &dirty_bins);
 		}
 	}
 	else {
 		if (ns->single_bin) {
 			result = write_master_ssd_single_bin(tr, &rd,
 					must_fetch_data, increment_generation,
-					rw, &is_delete, &dirty_bins);
+					rw, &is_delete, p_is_unchanged, &dirty_bins);
 		}
 		else {
 			result = write_master_ssd(tr, set_name, &rd,
 					must_fetch_data, record_level_replace, increment_generation,
-					rw, &is_delete, &dirty_bins);
+					rw, &is_delete, p_is_unchanged, &dirty_bins);
 		}
 	}
 
@@ -677,12 +712,24 @@ write_master(rw_request* rw, as_transaction* tr)
 	tr->void_time = r->void_time;
 	tr->last_update_time = r->last_update_time;
 
+	// Nothing was written - no replica writes or XDR write needed.
+	if (is_unchanged) {
+		tr->flags |= AS_TRANSACTION_FLAG_UNCHANGED;
+		cf_atomic64_incr(&ns->n_client_write_unchanged);
+
+		as_storage_record_close(&rd);
+		as_record_done(&r_ref, ns);
+
+		return TRANS_IN_PROGRESS;
+	}
+
 	// Get set-id before releasing.
 	uint16_t set_id = as_index_get_set_id(r_ref.r);
 
-	// Collect more info for XDR.
+	// Collect more info for XDR and the change stream.
 	uint16_t generation = tr->generation;
 	xdr_op_type op_type = XDR_OP_TYPE_WRITE;
+	as_change_op change_op = AS_CHANGE_OP_WRITE;
 
 	// Handle deletion if appropriate.
 	if (is_delete) {
@@ -693,6 +740,8 @@ write_master(rw_request* rw, as_transaction* tr)
 		generation = 0;
 		op_type = as_transaction_is_durable_delete(tr) ?
 				XDR_OP_TYPE_DURABLE_DELETE : XDR_OP_TYPE_DROP;
+		change_op = as_transaction_is_durable_delete(tr) ?
+				AS_CHANGE_OP_DURABLE_DELETE : AS_CHANGE_OP_DELETE;
 	}
 	// Or (normally) adjust max void-time.
 	else if (r->void_time != 0) {
@@ -702,6 +751,9 @@ write_master(rw_request* rw, as_transaction* tr)
 	as_storage_record_close(&rd);
 	as_record_done(&r_ref, ns);
 
+	as_change_stream_append(ns, &tr->keyd, set_id, generation,
+			tr->last_update_time, change_op);
+
 	// Don't send an XDR delete if it's disallowed.
 	if (is_delete && ! is_xdr_delete_shipping_enabled()) {
 		return TRANS_IN_PROGRESS;
@@ -906,6 +958,21 @@ write_master_policies(as_transaction* tr, bool* p_must_not_create,
 			generates_response_bin = true;
 			must_fetch_data = true;
 		}
+		else if (op->op == AS_MSG_OP_HLL_MODIFY ||
+				op->op == AS_MSG_OP_TIMESERIES_MODIFY) {
+			if (record_level_replace) {
+				cf_warning_digest(AS_RW, &tr->keyd, "{%s} write_master: hll/timeseries modify op can't have record-level replace flag ", ns->name);
+				return AS_PROTO_RESULT_FAIL_PARAMETER;
+			}
+
+			generates_response_bin = true; // may generate a response bin
+			must_fetch_data = true;
+		}
+		else if (op->op == AS_MSG_OP_HLL_READ ||
+				op->op == AS_MSG_OP_TIMESERIES_READ) {
+			generates_response_bin = true;
+			must_fetch_data = true;
+		}
 	}
 
 	if (has_read_all_op && generates_response_bin) {
@@ -970,7 +1037,7 @@ check_msg_set_name(as_transaction* tr, const char* set_name)
 int
 write_master_dim_single_bin(as_transaction* tr, as_storage_rd* rd,
 		bool increment_generation, rw_request* rw, bool* is_delete,
-		xdr_dirty_bins* dirty_bins)
+		bool* is_unchanged, xdr_dirty_bins* dirty_bins)
 {
 	// Shortcut pointers.
 	as_msg* m = &tr->msgp->msg;
@@ -1021,7 +1088,8 @@ write_master_dim_single_bin(as_transaction* tr, as_storage_rd* rd,
 
 	uint32_t n_new_bins = 0;
 	int result = write_master_bin_ops(tr, rd, NULL, cleanup_bins,
-			&n_cleanup_bins, &rw->response_db, &n_new_bins, dirty_bins);
+			&n_cleanup_bins, &rw->response_db, &n_new_bins, dirty_bins,
+			&old_bin, n_old_bins, &old_metadata, is_unchanged);
 
 	if (result != 0) {
 		write_master_index_metadata_unwind(&old_metadata, r);
@@ -1029,6 +1097,12 @@ write_master_dim_single_bin(as_transaction* tr, as_storage_rd* rd,
 		return result;
 	}
 
+	// If nothing changed, keep the existing bin - metadata already unwound.
+	if (is_unchanged && *is_unchanged) {
+		write_master_dim_single_bin_unwind(&old_bin, rd->bins, cleanup_bins, n_cleanup_bins);
+		return 0;
+	}
+
 	//------------------------------------------------------
 	// Created the new bin to write.
 	//
@@ -1072,7 +1146,7 @@ write_master_dim_single_bin(as_transaction* tr, as_storage_rd* rd,
 int
 write_master_dim(as_transaction* tr, const char* set_name, as_storage_rd* rd,
 		bool record_level_replace, bool increment_generation, rw_request* rw,
-		bool* is_delete, xdr_dirty_bins* dirty_bins)
+		bool* is_delete, bool* is_unchanged, xdr_dirty_bins* dirty_bins)
 {
 	// Shortcut pointers.
 	as_msg* m = &tr->msgp->msg;
@@ -1137,7 +1211,8 @@ write_master_dim(as_transaction* tr, const char* set_name, as_storage_rd* rd,
 	//
 
 	int result = write_master_bin_ops(tr, rd, NULL, cleanup_bins,
-			&n_cleanup_bins, &rw->response_db, &n_new_bins, dirty_bins);
+			&n_cleanup_bins, &rw->response_db, &n_new_bins, dirty_bins,
+			old_bins, n_old_bins, &old_metadata, is_unchanged);
 
 	if (result != 0) {
 		write_master_index_metadata_unwind(&old_metadata, r);
@@ -1145,6 +1220,12 @@ write_master_dim(as_transaction* tr, const char* set_name, as_storage_rd* rd,
 		return result;
 	}
 
+	// If nothing changed, keep the existing bins - metadata already unwound.
+	if (is_unchanged && *is_unchanged) {
+		write_master_dim_unwind(old_bins, n_old_bins, new_bins, n_new_bins, cleanup_bins, n_cleanup_bins);
+		return 0;
+	}
+
 	//------------------------------------------------------
 	// Created the new bins to write.
 	//
@@ -1242,13 +1323,14 @@ write_master_dim(as_transaction* tr, const char* set_name, as_storage_rd* rd,
 int
 write_master_ssd_single_bin(as_transaction* tr, as_storage_rd* rd,
 		bool must_fetch_data, bool increment_generation, rw_request* rw,
-		bool* is_delete, xdr_dirty_bins* dirty_bins)
+		bool* is_delete, bool* is_unchanged, xdr_dirty_bins* dirty_bins)
 {
 	// Shortcut pointers.
 	as_namespace* ns = tr->rsv.ns;
 	as_record* r = rd->r;
 
-	rd->ignore_record_on_device = ! must_fetch_data;
+	// Must read existing bin to know if the write changes it.
+	rd->ignore_record_on_device = ! must_fetch_data && ! is_unchanged;
 	rd->n_bins = 1;
 
 	as_bin stack_bin;
@@ -1269,6 +1351,11 @@ write_master_ssd_single_bin(as_transaction* tr, as_storage_rd* rd,
 
 	uint32_t n_old_bins = as_bin_inuse(rd->bins) ? 1 : 0;
 
+	// Keep existing bin (particle points into block buffer) for comparison.
+	as_bin old_bin;
+
+	as_single_bin_copy(&old_bin, rd->bins);
+
 	//------------------------------------------------------
 	// Apply changes to metadata in as_index needed for
 	// response, pickling, and writing.
@@ -1288,12 +1375,19 @@ write_master_ssd_single_bin(as_transaction* tr, as_storage_rd* rd,
 	uint32_t n_new_bins = 0;
 
 	if ((result = write_master_bin_ops(tr, rd, &particles_llb, NULL, NULL,
-			&rw->response_db, &n_new_bins, dirty_bins)) != 0) {
+			&rw->response_db, &n_new_bins, dirty_bins, &old_bin, n_old_bins,
+			&old_metadata, is_unchanged)) != 0) {
 		cf_ll_buf_free(&particles_llb);
 		write_master_index_metadata_unwind(&old_metadata, r);
 		return result;
 	}
 
+	// If nothing changed, there's nothing to write - metadata already unwound.
+	if (is_unchanged && *is_unchanged) {
+		cf_ll_buf_free(&particles_llb);
+		return 0;
+	}
+
 	//------------------------------------------------------
 	// Created the new bin to write.
 	//
@@ -1341,7 +1435,7 @@ int
 write_master_ssd(as_transaction* tr, const char* set_name, as_storage_rd* rd,
 		bool must_fetch_data, bool record_level_replace,
 		bool increment_generation, rw_request* rw, bool* is_delete,
-		xdr_dirty_bins* dirty_bins)
+		bool* is_unchanged, xdr_dirty_bins* dirty_bins)
 {
 	// Shortcut pointers.
 	as_msg* m = &tr->msgp->msg;
@@ -1349,9 +1443,12 @@ write_master_ssd(as_transaction* tr, const char* set_name, as_storage_rd* rd,
 	as_record* r = rd->r;
 	bool has_sindex = record_has_sindex(r, ns);
 
+	// Old bins are needed for sindex adjustment, and to detect no-op writes.
+	bool keep_old_bins = has_sindex || is_unchanged;
+
 	// If it's not touch or modify, determine if we must read existing record.
 	if (! must_fetch_data) {
-		must_fetch_data = has_sindex || ! record_level_replace;
+		must_fetch_data = keep_old_bins || ! record_level_replace;
 	}
 
 	rd->ignore_record_on_device = ! must_fetch_data;
@@ -1390,10 +1487,11 @@ write_master_ssd(as_transaction* tr, const char* set_name, as_storage_rd* rd,
 
 	//------------------------------------------------------
 	// Copy old bins (if any) - which are currently in new
-	// bins array - to old bins array, for sindex purposes.
+	// bins array - to old bins array, for sindex purposes
+	// and comparison.
 	//
 
-	if (has_sindex && n_old_bins != 0) {
+	if (keep_old_bins && n_old_bins != 0) {
 		memcpy(old_bins, new_bins, n_old_bins * sizeof(as_bin));
 
 		// If it's a replace, clear the new bins array.
@@ -1402,6 +1500,19 @@ write_master_ssd(as_transaction* tr, const char* set_name, as_storage_rd* rd,
 		}
 	}
 
+	//------------------------------------------------------
+	// For a replace that only writes bins, string and blob
+	// values can stay in the client message, and be copied
+	// just once each into the write buffer and the pickle.
+	//
+
+	as_msg_op* client_ops[n_new_bins];
+
+	if (rd->ignore_record_on_device && ops_only_write_bins(m)) {
+		memset(client_ops, 0, sizeof(client_ops));
+		rd->client_ops = client_ops;
+	}
+
 	//------------------------------------------------------
 	// Apply changes to metadata in as_index needed for
 	// response, pickling, and writing.
@@ -1419,12 +1530,21 @@ write_master_ssd(as_transaction* tr, const char* set_name, as_storage_rd* rd,
 	cf_ll_buf_define(particles_llb, STACK_PARTICLES_SIZE);
 
 	if ((result = write_master_bin_ops(tr, rd, &particles_llb, NULL, NULL,
-			&rw->response_db, &n_new_bins, dirty_bins)) != 0) {
+			&rw->response_db, &n_new_bins, dirty_bins, old_bins, n_old_bins,
+			&old_metadata, is_unchanged)) != 0) {
+		rd->client_ops = NULL;
 		cf_ll_buf_free(&particles_llb);
 		write_master_index_metadata_unwind(&old_metadata, r);
 		return result;
 	}
 
+	// If nothing changed, there's nothing to write - metadata already unwound.
+	if (is_unchanged && *is_unchanged) {
+		rd->client_ops = NULL;
+		cf_ll_buf_free(&particles_llb);
+		return 0;
+	}
+
 	//------------------------------------------------------
 	// Created the new bins to write.
 	//
@@ -1434,6 +1554,7 @@ write_master_ssd(as_transaction* tr, const char* set_name, as_storage_rd* rd,
 
 	if (n_new_bins == 0) {
 		if (n_old_bins == 0) {
+			rd->client_ops = NULL;
 			cf_ll_buf_free(&particles_llb);
 			write_master_index_metadata_unwind(&old_metadata, r);
 			return AS_PROTO_RESULT_FAIL_NOT_FOUND;
@@ -1449,7 +1570,12 @@ write_master_ssd(as_transaction* tr, const char* set_name, as_storage_rd* rd,
 	// Write the record to storage.
 	//
 
-	if ((result = as_storage_record_write(rd)) < 0) {
+	result = as_storage_record_write(rd);
+
+	// Done with client message values - don't leave rd pointing at our stack.
+	rd->client_ops = NULL;
+
+	if (result < 0) {
 		cf_warning_digest(AS_RW, &tr->keyd, "{%s} write_master: failed as_storage_record_write() ", ns->name);
 		cf_ll_buf_free(&particles_llb);
 		write_master_index_metadata_unwind(&old_metadata, r);
@@ -1501,7 +1627,8 @@ int
 write_master_bin_ops(as_transaction* tr, as_storage_rd* rd,
 		cf_ll_buf* particles_llb, as_bin* cleanup_bins,
 		uint32_t* p_n_cleanup_bins, cf_dyn_buf* db, uint32_t* p_n_final_bins,
-		xdr_dirty_bins* dirty_bins)
+		xdr_dirty_bins* dirty_bins, as_bin* old_bins, uint32_t n_old_bins,
+		index_metadata* old_metadata, bool* is_unchanged)
 {
 	// Shortcut pointers.
 	as_msg* m = &tr->msgp->msg;
@@ -1527,6 +1654,14 @@ write_master_bin_ops(as_transaction* tr, as_storage_rd* rd,
 
 	*p_n_final_bins = as_bin_inuse_count(rd);
 
+	// If the write changed nothing, respond with the existing metadata.
+	if (is_unchanged &&
+			write_master_bins_unchanged(rd, old_metadata, old_bins,
+					n_old_bins)) {
+		write_master_index_metadata_unwind(old_metadata, r);
+		*is_unchanged = true;
+	}
+
 	if (n_response_bins == 0) {
 		// If 'ordered-ops' flag was not set, and there were no read ops or CDT
 		// ops with results, there's no response to build and send later.
@@ -1629,11 +1764,20 @@ write_master_bin_ops_loop(as_transaction* tr, as_storage_rd* rd,
 
 					append_bin_to_destroy(&cleanup_bin, cleanup_bins, p_n_cleanup_bins);
 				}
+				else if (rd->client_ops &&
+						as_bin_particle_ref_from_client(b, op)) {
+					rd->client_ops[b - rd->bins] = op;
+				}
 				else {
 					if ((result = as_bin_particle_stack_from_client(b, particles_llb, op)) < 0) {
 						cf_warning_digest(AS_RW, &tr->keyd, "{%s} write_master: failed as_bin_particle_stack_from_client() ", ns->name);
 						return -result;
 					}
+
+					// May be overwriting a bin that referenced an earlier op.
+					if (rd->client_ops) {
+						rd->client_ops[b - rd->bins] = NULL;
+					}
 				}
 
 				xdr_add_dirty_bin(ns, dirty_bins, (const char*)op->name, op->name_sz);
@@ -1773,6 +1917,88 @@ write_master_bin_ops_loop(as_transaction* tr, as_storage_rd* rd,
 				as_bin_set_empty(&response_bins[(*p_n_response_bins)++]);
 			}
 		}
+		else if (op->op == AS_MSG_OP_HLL_MODIFY ||
+				op->op == AS_MSG_OP_TIMESERIES_MODIFY) {
+			bool is_hll = op->op == AS_MSG_OP_HLL_MODIFY;
+			as_bin* b = as_bin_get_or_create_from_buf(rd, op->name, op->name_sz, &result);
+
+			if (! b) {
+				return result;
+			}
+
+			as_bin result_bin;
+			as_bin_set_empty(&result_bin);
+
+			if (ns->storage_data_in_memory) {
+				as_bin cleanup_bin;
+				as_bin_copy(ns, &cleanup_bin, b);
+
+				if ((result = is_hll ?
+						as_bin_hll_alloc_modify_from_client(b, op, &result_bin) :
+						as_bin_timeseries_alloc_modify_from_client(b, op, &result_bin)) < 0) {
+					cf_warning_digest(AS_RW, &tr->keyd, "{%s} write_master: failed %s alloc modify ", ns->name, is_hll ? "hll" : "timeseries");
+					return -result;
+				}
+
+				// Account for noop operations. Modifying non-mutable
+				// particle contents in-place is still disallowed.
+				if (cleanup_bin.particle != b->particle) {
+					append_bin_to_destroy(&cleanup_bin, cleanup_bins, p_n_cleanup_bins);
+				}
+			}
+			else {
+				if ((result = is_hll ?
+						as_bin_hll_stack_modify_from_client(b, particles_llb, op, &result_bin) :
+						as_bin_timeseries_stack_modify_from_client(b, particles_llb, op, &result_bin)) < 0) {
+					cf_warning_digest(AS_RW, &tr->keyd, "{%s} write_master: failed %s stack modify ", ns->name, is_hll ? "hll" : "timeseries");
+					return -result;
+				}
+			}
+
+			if (respond_all_ops || as_bin_inuse(&result_bin)) {
+				ops[*p_n_response_bins] = op;
+				response_bins[(*p_n_response_bins)++] = result_bin;
+				append_bin_to_destroy(&result_bin, result_bins, p_n_result_bins);
+			}
+
+			if (! as_bin_inuse(b)) {
+				// TODO - could do better than finding index from name.
+				int32_t index = as_bin_get_index_from_buf(rd, op->name, op->name_sz);
+
+				if (index >= 0) {
+					as_bin_set_empty_shift(rd, (uint32_t)index);
+					xdr_fill_dirty_bins(dirty_bins);
+				}
+			}
+			else {
+				xdr_add_dirty_bin(ns, dirty_bins, (const char*)op->name, op->name_sz);
+			}
+		}
+		else if (op->op == AS_MSG_OP_HLL_READ ||
+				op->op == AS_MSG_OP_TIMESERIES_READ) {
+			as_bin* b = as_bin_get_from_buf(rd, op->name, op->name_sz);
+
+			if (b) {
+				bool is_hll = op->op == AS_MSG_OP_HLL_READ;
+				as_bin result_bin;
+				as_bin_set_empty(&result_bin);
+
+				if ((result = is_hll ?
+						as_bin_hll_read_from_client(b, op, &result_bin) :
+						as_bin_timeseries_read_from_client(b, op, &result_bin)) < 0) {
+					cf_warning_digest(AS_RW, &tr->keyd, "{%s} write_master: failed %s read ", ns->name, is_hll ? "hll" : "timeseries");
+					return -result;
+				}
+
+				ops[*p_n_response_bins] = op;
+				response_bins[(*p_n_response_bins)++] = result_bin;
+				append_bin_to_destroy(&result_bin, result_bins, p_n_result_bins);
+			}
+			else if (respond_all_ops) {
+				ops[*p_n_response_bins] = op;
+				as_bin_set_empty(&response_bins[(*p_n_response_bins)++]);
+			}
+		}
 		else {
 			cf_warning_digest(AS_RW, &tr->keyd, "{%s} write_master: unknown bin op %u ", ns->name, op->op);
 			return AS_PROTO_RESULT_FAIL_PARAMETER;
@@ -1783,6 +2009,48 @@ write_master_bin_ops_loop(as_transaction* tr, as_storage_rd* rd,
 }
 
 
+bool
+write_master_bins_unchanged(as_storage_rd* rd, const index_metadata* old,
+		as_bin* old_bins, uint32_t n_old_bins)
+{
+	as_record* r = rd->r;
+
+	// Void-time and a newly stored key go to storage along with the bins.
+	if (r->void_time != old->void_time || (r->key_stored == 0 && rd->key)) {
+		return false;
+	}
+
+	uint32_t n_new_bins = as_bin_inuse_count(rd);
+
+	// Creates and deletes always change something.
+	if (n_new_bins == 0 || n_new_bins != n_old_bins) {
+		return false;
+	}
+
+	if (rd->ns->single_bin) {
+		return as_bin_particle_equal(old_bins, rd->bins);
+	}
+
+	for (uint32_t i_new = 0; i_new < n_new_bins; i_new++) {
+		as_bin* b_new = &rd->bins[i_new];
+		uint32_t i_old;
+
+		for (i_old = 0; i_old < n_old_bins; i_old++) {
+			if (old_bins[i_old].id == b_new->id) {
+				break;
+			}
+		}
+
+		if (i_old == n_old_bins ||
+				! as_bin_particle_equal(&old_bins[i_old], b_new)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 //==========================================================
 // write_master() - unwind on failure or cleanup.
 //
@@ -124,3 +124,27 @@ int32_t cf_rc_count(const void *p);
 int32_t cf_rc_reserve(void *p);
 int32_t cf_rc_release(void *p);
 int32_t cf_rc_releaseandfree(void *p);
+
+
+//==========================================================
+// Public API - per-thread transaction regions.
+//
+
+// Transient allocations made between enter and exit are bump-allocated from
+// the calling thread's region, which is reset when the outermost exit is
+// reached. Objects must not be used after exit or passed to another thread -
+// cf_region_escape() them to the heap first. Regionless threads, and objects
+// that don't fit, fall back to the heap. Frees must use cf_region_free().
+
+void cf_alloc_region_enter(void);
+void cf_alloc_region_exit(void);
+void cf_alloc_region_stats(uint64_t *region_bytes, uint64_t *heap_bytes);
+
+// Don't call these directly - use wrappers below.
+void *cf_alloc_region_malloc(size_t sz);
+void cf_alloc_region_free(void *p);
+void *cf_alloc_region_escape(void *p, size_t sz);
+
+#define cf_region_malloc(_sz)        cf_alloc_region_malloc(_sz)
+#define cf_region_free(_p)           cf_alloc_region_free(_p)
+#define cf_region_escape(_p, _sz)    cf_alloc_region_escape(_p, _sz)
@@ -30,6 +30,7 @@
 #include <netinet/in.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/types.h>
 
 #include "fault.h"
 #include "msg.h"
@@ -129,6 +130,7 @@ typedef struct cf_sockets_s {
 typedef enum {
 	CF_SOCK_OWNER_SERVICE,
 	CF_SOCK_OWNER_SERVICE_TLS,
+	CF_SOCK_OWNER_SERVICE_UNIX,
 	CF_SOCK_OWNER_HEARTBEAT,
 	CF_SOCK_OWNER_HEARTBEAT_TLS,
 	CF_SOCK_OWNER_FABRIC,
@@ -258,12 +260,14 @@ static inline void cf_socket_copy(const cf_socket *from, cf_socket *to)
 }
 
 CF_MUST_CHECK int32_t cf_socket_init_server(cf_serv_cfg *cfg, cf_sockets *socks);
+CF_MUST_CHECK int32_t cf_socket_init_server_unix(const char *path, mode_t mode, cf_sock_cfg *cfg, cf_sockets *socks);
 void cf_socket_show_server(cf_fault_context cont, const char *tag, const cf_sockets *socks);
 CF_MUST_CHECK int32_t cf_socket_init_client(cf_sock_cfg *cfg, int32_t timeout, cf_socket *sock);
 
 CF_MUST_CHECK int32_t cf_socket_accept(cf_socket *lsock, cf_socket *sock, cf_sock_addr *addr);
 CF_MUST_CHECK int32_t cf_socket_remote_name(const cf_socket *sock, cf_sock_addr *addr);
 CF_MUST_CHECK int32_t cf_socket_local_name(const cf_socket *sock, cf_sock_addr *addr);
+CF_MUST_CHECK int32_t cf_socket_peer_pid(const cf_socket *sock, int32_t *pid);
 CF_MUST_CHECK int32_t cf_socket_available(cf_socket *sock);
 
 CF_MUST_CHECK int32_t cf_socket_recv_from(cf_socket *sock, void *buff, size_t size, int32_t flags, cf_sock_addr *addr);
@@ -61,6 +61,9 @@
 #define MAX_SITES 4096
 #define MAX_THREADS 256
 
+#define REGION_SZ (4 * 1024 * 1024)
+#define REGION_ALIGN 16
+
 #define MULT 3486784401u
 #define MULT_INV 3396732273u
 
@@ -95,6 +98,19 @@ static uint32_t g_n_site_infos = 1;
 static __thread uint32_t g_thread_site_infos[MAX_SITES];
 
 static __thread pid_t g_tid;
+
+typedef struct region_s {
+	uint8_t *buf; // lazily allocated, kept for the thread's lifetime
+	size_t used_sz;
+	uint32_t depth;
+	uint64_t region_bytes; // not yet added to the global stats
+	uint64_t heap_bytes;
+} region;
+
+static __thread region g_region;
+
+static cf_atomic64 g_region_bytes;
+static cf_atomic64 g_region_heap_bytes;
 // Start with *_ALL; see cf_alloc_set_debug() for details.
 static cf_alloc_debug g_debug = CF_ALLOC_DEBUG_ALL;
 
@@ -1073,3 +1089,114 @@ cf_rc_count(const void *p)
 	const cf_rc_header *head = (const cf_rc_header *)p - 1;
 	return (int32_t)head->rc;
 }
+
+
+//==========================================================
+// Per-thread transaction regions.
+//
+
+static inline bool
+in_region(const void *p)
+{
+	const uint8_t *p8 = (const uint8_t *)p;
+
+	return g_region.buf != NULL && p8 >= g_region.buf &&
+			p8 < g_region.buf + REGION_SZ;
+}
+
+void
+cf_alloc_region_enter(void)
+{
+	if (g_region.depth++ != 0) {
+		return;
+	}
+
+	if (g_region.buf == NULL) {
+		g_region.buf = jem_mallocx(REGION_SZ, 0);
+		cf_assert(g_region.buf, CF_ALLOC, "region alloc failed sz %d", REGION_SZ);
+	}
+
+	g_region.used_sz = 0;
+}
+
+void
+cf_alloc_region_exit(void)
+{
+	cf_assert(g_region.depth != 0, CF_ALLOC, "region exit without enter");
+
+	if (--g_region.depth != 0) {
+		return;
+	}
+
+	// Everything allocated from the region is dead now.
+	g_region.used_sz = 0;
+
+	if (g_region.region_bytes != 0) {
+		cf_atomic64_add(&g_region_bytes, (int64_t)g_region.region_bytes);
+		g_region.region_bytes = 0;
+	}
+
+	if (g_region.heap_bytes != 0) {
+		cf_atomic64_add(&g_region_heap_bytes, (int64_t)g_region.heap_bytes);
+		g_region.heap_bytes = 0;
+	}
+}
+
+void
+cf_alloc_region_stats(uint64_t *region_bytes, uint64_t *heap_bytes)
+{
+	*region_bytes = cf_atomic64_get(g_region_bytes);
+	*heap_bytes = cf_atomic64_get(g_region_heap_bytes);
+}
+
+void *
+cf_alloc_region_malloc(size_t sz)
+{
+	if (g_region.depth != 0) {
+		size_t aligned_sz = (sz + REGION_ALIGN - 1) & ~(size_t)(REGION_ALIGN - 1);
+
+		if (aligned_sz <= REGION_SZ - g_region.used_sz) {
+			void *p = g_region.buf + g_region.used_sz;
+
+			g_region.used_sz += aligned_sz;
+			g_region.region_bytes += sz;
+
+			return p;
+		}
+
+		g_region.heap_bytes += sz;
+	}
+	else {
+		// No thread-local batching outside a region.
+		cf_atomic64_add(&g_region_heap_bytes, (int64_t)sz);
+	}
+
+	void *p = do_mallocx(sz, -1, __builtin_return_address(0));
+	cf_assert(p, CF_ALLOC, "region fallback malloc failed sz %zu", sz);
+	return p;
+}
+
+void
+cf_alloc_region_free(void *p)
+{
+	if (in_region(p)) {
+		return; // reclaimed at exit
+	}
+
+	do_free(p, __builtin_return_address(0));
+}
+
+void *
+cf_alloc_region_escape(void *p, size_t sz)
+{
+	if (! in_region(p)) {
+		return p;
+	}
+
+	void *p_heap = do_mallocx(sz, -1, __builtin_return_address(0));
+	cf_assert(p_heap, CF_ALLOC, "region escape malloc failed sz %zu", sz);
+
+	memcpy(p_heap, p, sz);
+
+	return p_heap;
+}
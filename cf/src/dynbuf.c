@@ -493,7 +493,9 @@ void
 cf_ll_buf_grow(cf_ll_buf *llb, size_t sz)
 {
 	size_t buf_sz = sz > llb->head->buf_sz ? sz : llb->head->buf_sz;
-	cf_ll_buf_stage *new_tail = cf_malloc(sizeof(cf_ll_buf_stage) + buf_sz);
+	// Overflow stages never outlive the caller - use the transaction region.
+	cf_ll_buf_stage *new_tail = cf_region_malloc(sizeof(cf_ll_buf_stage) +
+			buf_sz);
 
 	new_tail->next = NULL;
 	new_tail->buf_sz = buf_sz;
@@ -529,6 +531,6 @@ cf_ll_buf_free(cf_ll_buf *llb)
 		cf_ll_buf_stage *temp = cur;
 
 		cur = cur->next;
-		cf_free(temp);
+		cf_region_free(temp);
 	}
 }
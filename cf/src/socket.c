@@ -44,7 +44,9 @@
 #include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 
 #include "fault.h"
 #include "tls.h"
@@ -686,6 +688,108 @@ cleanup0:
 	return res;
 }
 
+int32_t
+cf_socket_init_server_unix(const char *path, mode_t mode, cf_sock_cfg *cfg, cf_sockets *socks)
+{
+	int32_t res = -1;
+	struct sockaddr_un sau;
+
+	if (strlen(path) >= sizeof(sau.sun_path)) {
+		cf_warning(CF_SOCKET, "Unix socket path %s too long", path);
+		goto cleanup0;
+	}
+
+	memset(&sau, 0, sizeof(sau));
+	sau.sun_family = AF_UNIX;
+	strcpy(sau.sun_path, path);
+
+	cf_debug(CF_SOCKET, "Initializing server for %s", path);
+	int32_t fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (fd < 0) {
+		cf_warning(CF_SOCKET, "Error while creating socket for %s: %d (%s)",
+				path, errno, cf_strerror(errno));
+		goto cleanup0;
+	}
+
+	cf_socket *sock = &socks->socks[0];
+
+	cf_socket_init(sock);
+	sock->fd = fd;
+	fd = -1;
+
+	cf_socket_disable_blocking(sock);
+
+	// Remove a socket file left behind by a previous run - but nothing else,
+	// and not a socket something is still listening on.
+	struct stat st;
+
+	if (lstat(path, &st) == 0) {
+		if (! S_ISSOCK(st.st_mode)) {
+			cf_warning(CF_SOCKET, "%s exists and is not a socket", path);
+			goto cleanup1;
+		}
+
+		int32_t probe_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		if (probe_fd < 0) {
+			cf_warning(CF_SOCKET, "Error while creating probe socket for %s: %d (%s)",
+					path, errno, cf_strerror(errno));
+			goto cleanup1;
+		}
+
+		int32_t probe_res = connect(probe_fd, (struct sockaddr *)&sau, sizeof(sau));
+		int32_t probe_errno = errno;
+
+		close(probe_fd);
+
+		if (probe_res == 0 || probe_errno != ECONNREFUSED) {
+			cf_warning(CF_SOCKET, "%s is in use by another process", path);
+			goto cleanup1;
+		}
+
+		if (unlink(path) < 0 && errno != ENOENT) {
+			cf_warning(CF_SOCKET, "Error while removing stale %s: %d (%s)",
+					path, errno, cf_strerror(errno));
+			goto cleanup1;
+		}
+	}
+
+	if (bind(sock->fd, (struct sockaddr *)&sau, sizeof(sau)) < 0) {
+		cf_warning(CF_SOCKET, "Error while binding to %s: %d (%s)",
+				path, errno, cf_strerror(errno));
+		goto cleanup1;
+	}
+
+	// Nobody can connect until we listen, so there's no window with the
+	// umask-derived mode.
+	if (chmod(path, mode) < 0) {
+		cf_warning(CF_SOCKET, "Error while setting mode %04o on %s: %d (%s)",
+				(uint32_t)mode, path, errno, cf_strerror(errno));
+		unlink(path);
+		goto cleanup1;
+	}
+
+	if (listen(sock->fd, 512) < 0) {
+		cf_warning(CF_SOCKET, "Error while listening on %s: %d (%s)",
+				path, errno, cf_strerror(errno));
+		unlink(path);
+		goto cleanup1;
+	}
+
+	sock->cfg = cfg;
+	socks->n_socks = 1;
+	res = 0;
+	goto cleanup0;
+
+cleanup1:
+	cf_socket_close(sock);
+	cf_socket_term(sock);
+
+cleanup0:
+	return res;
+}
+
 void
 cf_socket_show_server(cf_fault_context cont, const char *tag, const cf_sockets *socks)
 {
@@ -827,13 +931,8 @@ cf_socket_accept(cf_socket *lsock, cf_socket *sock, cf_sock_addr *addr)
 	int32_t res = -1;
 
 	struct sockaddr_storage sas;
-	struct sockaddr *sa = NULL;
-	socklen_t sa_len = 0;
-
-	if (addr != NULL) {
-		sa = (struct sockaddr *)&sas;
-		sa_len = sizeof(sas);
-	}
+	struct sockaddr *sa = (struct sockaddr *)&sas;
+	socklen_t sa_len = sizeof(sas);
 
 	int32_t fd = accept(lsock->fd, sa, &sa_len);
 
@@ -843,8 +942,16 @@ cf_socket_accept(cf_socket *lsock, cf_socket *sock, cf_sock_addr *addr)
 		goto cleanup0;
 	}
 
+	// Unix domain peers have no IP address and don't do Nagle.
+	bool is_unix = sa->sa_family == AF_UNIX;
+
 	if (addr != NULL) {
-		cf_sock_addr_from_native(sa, addr);
+		if (is_unix) {
+			cf_sock_addr_set_any(addr);
+		}
+		else {
+			cf_sock_addr_from_native(sa, addr);
+		}
 	}
 
 	cf_socket_init(sock);
@@ -852,7 +959,10 @@ cf_socket_accept(cf_socket *lsock, cf_socket *sock, cf_sock_addr *addr)
 	fd = -1;
 
 	cf_socket_disable_blocking(sock);
-	cf_socket_disable_nagle(sock);
+
+	if (! is_unix) {
+		cf_socket_disable_nagle(sock);
+	}
 
 	sock->cfg = lsock->cfg;
 	res = 0;
@@ -891,6 +1001,23 @@ cf_socket_local_name(const cf_socket *sock, cf_sock_addr *addr)
 	return x_name(getsockname, "local", sock->fd, addr);
 }
 
+// Unix domain peers have no address - identify them by process instead.
+int32_t
+cf_socket_peer_pid(const cf_socket *sock, int32_t *pid)
+{
+	struct ucred cred;
+	socklen_t cred_len = sizeof(cred);
+
+	if (getsockopt(sock->fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0) {
+		cf_warning(CF_SOCKET, "Error while getting peer credentials for FD %d: %d (%s)",
+				sock->fd, errno, cf_strerror(errno));
+		return -1;
+	}
+
+	*pid = (int32_t)cred.pid;
+	return 0;
+}
+
 int32_t
 cf_socket_available(cf_socket *sock)
 {